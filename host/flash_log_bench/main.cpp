@@ -0,0 +1,371 @@
+/*
+ * File: main.cpp
+ * Project: flash_log_bench
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+/*
+ * Measures FlashLog on simulated NOR flash. Reports how many bytes are programmed and erased
+ * for each byte of samples stored, how long the flash is busy, how many days of samples
+ * the log holds, and whether every committed record survives a loss of power at any point.
+ */
+
+#include <FlashLog.h>
+#include <StoreAndForward.h>
+#include <host_stubs.h>
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#define SECONDS_PER_DAY 86400.0
+#define SECTOR_ENDURANCE 100000.0
+
+#define REGION_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_LOG_SIZE)
+
+// Samples stored in the throughput runs, enough to wrap the log several times
+#define THROUGHPUT_SAMPLES 40000
+
+// Power loss trials, each appending records while a reader drains most of them
+#define POWER_LOSS_TRIALS 500
+#define POWER_LOSS_RECORDS 25000
+#define POWER_LOSS_APPENDS 20
+#define POWER_LOSS_POPS 19
+
+static uint64_t now = 0;
+// Drains where the backlog reported before didn't match the samples read
+static uint32_t miscounts = 0;
+
+uint64_t host_time_us(void)
+{
+    return now;
+}
+
+void host_sleep_us(uint64_t us)
+{
+    now += us;
+}
+
+typedef struct __attribute__((packed))
+{
+    uint32_t id;
+    uint8_t fill[sizeof(StoredSample) - sizeof(uint32_t)];
+} BenchRecord;
+
+static_assert(sizeof(BenchRecord) == sizeof(StoredSample), "Records are the size of a stored sample");
+
+static BenchRecord makeRecord(uint32_t id)
+{
+    BenchRecord record = {.id = id};
+    for (size_t i = 0; i < sizeof(record.fill); i++)
+    {
+        record.fill[i] = (uint8_t)(id * 31 + i);
+    }
+    return record;
+}
+
+static bool checkRecord(const uint8_t *data, size_t length, uint32_t *id)
+{
+    BenchRecord record;
+    BenchRecord expected;
+
+    if (length != sizeof(record))
+    {
+        return false;
+    }
+
+    memcpy(&record, data, sizeof(record));
+    *id = record.id;
+    expected = makeRecord(record.id);
+    return memcmp(&record, &expected, sizeof(record)) == 0;
+}
+
+/**
+ * @brief Stores samples offline and replays them, going online every so many samples.
+ * Going online writes the page that is only partly filled.
+ */
+static void drain(StoreAndForward *history)
+{
+    StoredSample sample;
+    size_t backlog = history->size();
+    size_t drained = 0;
+
+    while (history->peek(&sample))
+    {
+        history->pop();
+        drained++;
+    }
+
+    if (drained != backlog || history->size() != 0)
+    {
+        miscounts++;
+    }
+}
+
+static void throughput(const char *name, uint32_t samplesPerOutage)
+{
+    host_flash_clear();
+    now = 0;
+
+    FlashLog log(REGION_OFFSET, FLASH_LOG_SIZE);
+    log.begin();
+
+    StoreAndForward history(0);
+    history.setFlashLog(&log);
+    uint32_t key = history.add("Victron", "Battery Voltage", SPARKPLUG_UINT32);
+
+    for (uint32_t i = 0; i < THROUGHPUT_SAMPLES; i++)
+    {
+        history.store(key, i);
+
+        if ((i + 1) % samplesPerOutage == 0)
+        {
+            history.setOnline(true);
+            drain(&history);
+            history.setOnline(false);
+        }
+    }
+
+    FlashLogStatistics statistics = log.getStatistics();
+    HostFlashCounters counters = host_flash_counters();
+    double stored = (double)statistics.bytesAppended;
+    double busy = (double)(statistics.programTime + statistics.eraseTime);
+
+    printf("%-22s %8u %7.2f %7.2f %7.2f %9.1f %9.0f\n",
+           name,
+           statistics.pagesWritten,
+           (double)statistics.recordsAppended / statistics.pagesWritten,
+           counters.programmedBytes / stored,
+           counters.erasedBytes / stored,
+           busy / statistics.recordsAppended,
+           statistics.recordsAppended / (busy / 1000000.0));
+
+    // What is left after the oldest sectors were erased is still counted right
+    history.setOnline(true);
+    drain(&history);
+}
+
+static void capacity(uint32_t size)
+{
+    FlashLog log(REGION_OFFSET, size);
+    uint32_t perPage = FLASH_LOG_DATA_SIZE / (1 + sizeof(StoredSample));
+    double samples = (double)log.getStatistics().capacity * perPage;
+    double perLap = (double)(size / FLASH_PAGE_SIZE) * perPage;
+
+    printf("%6u KiB %9.0f", size / 1024, samples);
+    for (double interval : {1.0, 10.0, 60.0})
+    {
+        printf(" %9.2f", samples * interval / SECONDS_PER_DAY);
+    }
+    // Every sector is erased once a lap, storing one sample a second without ever going online
+    printf(" %11.0f\n", SECTOR_ENDURANCE * perLap / SECONDS_PER_DAY / 365.0);
+}
+
+typedef struct
+{
+    uint32_t trials;
+    uint32_t tornPages;
+    uint32_t recovered;
+    uint32_t lost;
+    uint32_t duplicates;
+    uint32_t corrupt;
+    uint32_t outOfOrder;
+    uint32_t resumeFailures;
+    // Recoveries where the backlog the log reported didn't match the records read
+    uint32_t miscounted;
+} PowerLossResult;
+
+/**
+ * @brief Appends and reads records until the power is cut, then starts a new log on the same
+ * flash and checks what it replays.
+ */
+static void powerLoss(int64_t tearAfter, PowerLossResult *result)
+{
+    uint8_t data[FLASH_LOG_MAX_RECORD];
+    size_t length;
+    uint32_t id;
+
+    host_flash_clear();
+    host_flash_tear_after(tearAfter);
+
+    // Records up to durable were committed with the power still on, and up to read were handed to the reader
+    int64_t durable = -1;
+    int64_t read = -1;
+    {
+        FlashLog log(REGION_OFFSET, FLASH_LOG_SIZE);
+        log.begin();
+
+        for (uint32_t i = 0; i < POWER_LOSS_RECORDS && host_flash_powered(); i++)
+        {
+            uint32_t written = log.getStatistics().pagesWritten;
+            BenchRecord record = makeRecord(i);
+            log.append(&record, sizeof(record));
+
+            // Appending a record that doesn't fit writes the page of the records before it
+            if (log.getStatistics().pagesWritten != written && host_flash_powered())
+            {
+                durable = (int64_t)i - 1;
+            }
+
+            if ((i + 1) % POWER_LOSS_APPENDS != 0)
+            {
+                continue;
+            }
+
+            for (int j = 0; j < POWER_LOSS_POPS && host_flash_powered() && log.peek(data, &length); j++)
+            {
+                if (!checkRecord(data, length, &id) || (int64_t)id <= read)
+                {
+                    result->corrupt++;
+                }
+                read = id;
+                log.pop();
+            }
+        }
+    }
+
+    host_flash_power_on();
+
+    FlashLog log(REGION_OFFSET, FLASH_LOG_SIZE);
+    log.begin();
+    result->trials++;
+    result->tornPages += log.getStatistics().pagesInvalid;
+
+    std::vector<bool> seen(POWER_LOSS_RECORDS, false);
+    int64_t last = -1;
+    size_t backlog = log.size();
+    size_t popped = 0;
+
+    while (log.peek(data, &length))
+    {
+        if (!checkRecord(data, length, &id) || id >= POWER_LOSS_RECORDS)
+        {
+            result->corrupt++;
+        }
+        else
+        {
+            if ((int64_t)id <= last)
+            {
+                result->outOfOrder++;
+            }
+            if ((int64_t)id <= read)
+            {
+                result->duplicates++;
+            }
+            seen[id] = true;
+            last = id;
+            result->recovered++;
+        }
+        log.pop();
+        popped++;
+    }
+
+    if (popped != backlog || log.size() != 0)
+    {
+        result->miscounted++;
+    }
+
+    for (int64_t i = read + 1; i <= durable; i++)
+    {
+        if (!seen[i])
+        {
+            result->lost++;
+        }
+    }
+
+    // The log has to carry on from where it was after recovering
+    for (uint32_t i = 0; i < POWER_LOSS_APPENDS; i++)
+    {
+        BenchRecord record = makeRecord(i);
+        log.append(&record, sizeof(record));
+    }
+    log.flush();
+    if (log.size() != POWER_LOSS_APPENDS)
+    {
+        result->miscounted++;
+    }
+
+    for (uint32_t i = 0; i < POWER_LOSS_APPENDS; i++)
+    {
+        if (!log.peek(data, &length) || !checkRecord(data, length, &id) || id != i)
+        {
+            result->resumeFailures++;
+            break;
+        }
+        log.pop();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    printf("Throughput, %u samples of %zu bytes, %llu us page program, %llu us sector erase\n",
+           THROUGHPUT_SAMPLES, sizeof(StoredSample), 400ULL, 45000ULL);
+    printf("%-22s %8s %7s %7s %7s %9s %9s\n",
+           "outage", "pages", "fill", "prog/B", "erase/B", "busy us", "samples/s");
+
+    throughput("never online", THROUGHPUT_SAMPLES + 1);
+    throughput("online every 1000", 1000);
+    throughput("online every 95", 95);
+    throughput("online every 25", 25);
+    throughput("online every 5", 5);
+
+    printf("\nCapacity, samples and days of samples at one every 1 s, 10 s and 60 s\n");
+    printf("%10s %9s %9s %9s %9s %11s\n", "region", "samples", "1 s", "10 s", "60 s", "wear years");
+    for (uint32_t size : {64 * 1024, FLASH_LOG_SIZE, 512 * 1024, 1024 * 1024})
+    {
+        capacity(size);
+    }
+
+    // Find how many bytes a whole trial programs and erases, then cut the power somewhere in it
+    PowerLossResult result = {};
+    powerLoss(-1, &result);
+    HostFlashCounters counters = host_flash_counters();
+    uint64_t flashBytes = counters.programmedBytes + counters.erasedBytes;
+
+    result = {};
+    std::mt19937 random(0x5EED);
+    std::uniform_int_distribution<int64_t> tear(1, flashBytes);
+    for (int i = 0; i < POWER_LOSS_TRIALS; i++)
+    {
+        powerLoss(tear(random), &result);
+    }
+
+    printf("\nPower loss, %u trials cut at a random byte of %llu programmed or erased\n",
+           result.trials, (unsigned long long)flashBytes);
+    printf("%-16s %u\n", "torn pages", result.tornPages);
+    printf("%-16s %u\n", "recovered", result.recovered);
+    printf("%-16s %u\n", "lost", result.lost);
+    printf("%-16s %u\n", "replayed twice", result.duplicates);
+    printf("%-16s %u\n", "corrupt", result.corrupt);
+    printf("%-16s %u\n", "out of order", result.outOfOrder);
+    printf("%-16s %u\n", "resume failures", result.resumeFailures);
+    printf("%-16s %u\n", "miscounted", result.miscounted + miscounts);
+
+    return result.lost + result.corrupt + result.outOfOrder + result.resumeFailures + result.miscounted + miscounts > 0 ? 1 : 0;
+}
@@ -0,0 +1,225 @@
+/*
+ * File: FleetNode.cpp
+ * Project: fleet
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#include "FleetNode.h"
+
+#include "pico/stdlib.h"
+#include <SparkplugPayload.h>
+#include <time_service.h>
+
+#include <math.h>
+#include <stdio.h>
+
+#define FLEET_NTP_ADDRESS "127.0.0.1"
+#define FLEET_NTP_PORT 123
+#define FLEET_CONNECT_TIMEOUT_MS 5000
+#define FLEET_KEEP_ALIVE_S 5
+
+#define VICTRON_INTERVAL_US 1000000
+// The door control samples the position this often while the door moves
+#define DOOR_SAMPLE_US 35000
+#define DOOR_CYCLE_US 60000000
+#define DOOR_TRAVEL_US 10000000
+#define BED_INTERVAL_US 5000000
+
+static const char *deviceNames[FLEET_KINDS] = {"victron", "door", "bed"};
+static const uint32_t devicePeriods[FLEET_KINDS] = {1000, 100, 5000};
+
+struct FleetNode::Private
+{
+    static const char *formatNodeId(char *nodeId, uint32_t index)
+    {
+        snprintf(nodeId, FLEET_NODE_ID_SIZE, "Node%03u", (unsigned)index);
+        return nodeId;
+    }
+
+    static const char *formatClientId(char *clientId, uint32_t index)
+    {
+        snprintf(clientId, FLEET_CLIENT_ID_SIZE, "fleet_%03u_%lu", (unsigned)index, (unsigned long)get_rand_32());
+        return clientId;
+    }
+};
+
+FleetNode::FleetNode(FleetNodeKind kind, uint32_t index, const FleetNodeOptions *options, FleetCapture *capture)
+    : kind(kind),
+      nodeOptions(options->groupId, Private::formatNodeId(nodeId, index), options->hostId, options->period,
+                  NODE_CONTROL_REBIRTH),
+      clientOptions{.address = Uri(options->brokerAddress),
+                    .clientId = Private::formatClientId(clientId, index),
+                    .username = NULL,
+                    .password = NULL,
+                    .connectTimeout = FLEET_CONNECT_TIMEOUT_MS,
+                    .keepAliveInterval = FLEET_KEEP_ALIVE_S},
+      node(&nodeOptions),
+      device(Device(deviceNames[kind], devicePeriods[kind])),
+      capture(capture),
+      phase((uint64_t)index * 7919 * 1000)
+{
+    client = node.addClient<PicoSparkplugClient>(&clientOptions);
+    client->useNtpServer(FLEET_NTP_ADDRESS, FLEET_NTP_PORT);
+    client->publishNtpMetrics((Publishable *)&node);
+    client->setPublishWindow(options->publishWindow);
+
+    sequence = Int32Metric::create("sequence", 0);
+    device.addMetric(sequence);
+
+    switch (kind)
+    {
+    case FLEET_VICTRON:
+        readings = {
+            Int32Metric::create("batteryVoltage", 12800),
+            Int32Metric::create("current", 0),
+            Int32Metric::create("panelVoltage", 18000),
+            Int32Metric::create("panelPower", 0),
+            Int32Metric::create("state", 0),
+            Int32Metric::create("yieldToday", 0),
+        };
+        break;
+    case FLEET_DOOR:
+        readings = {
+            Int32Metric::create("position", 0),
+            Int32Metric::create("state", 0),
+        };
+        break;
+    default:
+        readings = {
+            Int32Metric::create("moisture", 0),
+            Int32Metric::create("temperature", 0),
+        };
+        break;
+    }
+    for (auto &reading : readings)
+    {
+        device.addMetric(reading);
+    }
+
+    node.addDevice(&device);
+    latencyKey = client->publishLatencyMetrics((Publishable *)&node, deviceNames[kind]);
+    capture->devices = 1;
+}
+
+uint64_t FleetNode::sampleVictron(uint64_t now)
+{
+    double minutes = (double)(now + phase) / 60000000.0;
+    int32_t current = (int32_t)(1500 * sin(minutes * 3));
+    int32_t voltage = 12800 + (int32_t)(200 * sin(minutes));
+
+    readings[0]->setValue(voltage);
+    readings[1]->setValue(current);
+    readings[2]->setValue(18000 + (int32_t)(500 * cos(minutes)));
+    readings[3]->setValue(current > 0 ? voltage * current / 1000000 : 0);
+    readings[4]->setValue(current > 0 ? 3 : 0);
+    readings[5]->setValue((int32_t)(minutes * 10));
+    return now + VICTRON_INTERVAL_US;
+}
+
+uint64_t FleetNode::sampleDoor(uint64_t now)
+{
+    uint64_t cycle = (now + phase) % DOOR_CYCLE_US;
+    bool opening = ((now + phase) / DOOR_CYCLE_US) % 2 == 0;
+
+    if (cycle >= DOOR_TRAVEL_US)
+    {
+        // Stopped until the next cycle
+        readings[1]->setValue(opening ? 2 : 0);
+        readings[0]->setValue(opening ? 100 : 0);
+        return now + (DOOR_CYCLE_US - cycle);
+    }
+
+    int32_t travelled = (int32_t)(cycle * 100 / DOOR_TRAVEL_US);
+    readings[0]->setValue(opening ? travelled : 100 - travelled);
+    readings[1]->setValue(opening ? 1 : 3);
+    return now + DOOR_SAMPLE_US;
+}
+
+uint64_t FleetNode::sampleBed(uint64_t now)
+{
+    double hours = (double)(now + phase) / 3600000000.0;
+    readings[0]->setValue(400 + (int32_t)(50 * sin(hours)) + (int32_t)(get_rand_32() % 5));
+    readings[1]->setValue(180 + (int32_t)(40 * sin(hours / 4)));
+    return now + BED_INTERVAL_US;
+}
+
+void FleetNode::sample(uint64_t now)
+{
+    if (now < nextSample)
+    {
+        return;
+    }
+
+    switch (kind)
+    {
+    case FLEET_VICTRON:
+        nextSample = sampleVictron(now);
+        break;
+    case FLEET_DOOR:
+        nextSample = sampleDoor(now);
+        break;
+    default:
+        nextSample = sampleBed(now);
+        break;
+    }
+
+    samples++;
+    sequence->setValue((int32_t)samples);
+    capture->samples[samples % FLEET_CAPTURE_RING].store(
+        ((uint64_t)(samples & FLEET_CAPTURE_SEQUENCE_MASK) << FLEET_CAPTURE_TIME_BITS) | (now & FLEET_CAPTURE_TIME_MASK),
+        std::memory_order_release);
+    client->captured(latencyKey, now);
+}
+
+uint64_t FleetNode::nextDeadline()
+{
+    uint64_t deadline = client->nextDeadline();
+    return nextSample < deadline ? nextSample : deadline;
+}
+
+void FleetNode::execute(uint32_t elapsed)
+{
+    if (node.isActive())
+    {
+        node.execute(elapsed);
+    }
+    else if (client->getNtpClient())
+    {
+        client->getNtpClient()->sync();
+    }
+}
+
+void FleetNode::enable()
+{
+    node.enable();
+}
+
+FleetNodeKind FleetNode::getKind()
+{
+    return kind;
+}
@@ -0,0 +1,133 @@
+/*
+ * File: FleetNode.h
+ * Project: fleet
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef FLEET_NODE
+#define FLEET_NODE
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include <Node.h>
+#include <Device.h>
+#include <PicoSparkplugClient.h>
+#include <metrics/simple/Int32Metric.h>
+
+#include "Observer.h"
+
+#define FLEET_NODE_ID_SIZE 16
+#define FLEET_CLIENT_ID_SIZE 40
+
+typedef enum
+{
+    // A charge controller frame of readings every second
+    FLEET_VICTRON,
+    // A door that opens or closes once a minute, its position sampled at the door control's rate while it moves
+    FLEET_DOOR,
+    // Soil readings every few seconds
+    FLEET_BED,
+    FLEET_KINDS
+} FleetNodeKind;
+
+typedef struct
+{
+    const char *brokerAddress;
+    const char *groupId;
+    const char *hostId;
+    // Period of the node in milliseconds
+    uint32_t period;
+    // Publish window of the client in milliseconds, 0 to publish every change as it is made
+    uint32_t publishWindow;
+} FleetNodeOptions;
+
+/**
+ * @brief One node of the fleet, a Node and PicoSparkplugClient with a device of synthetic metrics
+ * shaped like one of the real nodes. Every device has a sequence metric, counted up with each sample,
+ * that the observer matches to the sample's capture time.
+ */
+class FleetNode
+{
+private:
+    FleetNodeKind kind;
+    char nodeId[FLEET_NODE_ID_SIZE];
+    char clientId[FLEET_CLIENT_ID_SIZE];
+    NodeOptions nodeOptions;
+    ClientOptions clientOptions;
+    Node node;
+    Device device;
+    PicoSparkplugClient *client;
+    FleetCapture *capture;
+    size_t latencyKey;
+
+    std::shared_ptr<Int32Metric> sequence;
+    std::vector<std::shared_ptr<Int32Metric>> readings;
+    uint32_t samples = 0;
+    uint64_t nextSample = 0;
+    // Where the node is in its cycle, so the nodes of the fleet don't all sample together
+    uint64_t phase;
+
+    struct Private;
+
+    uint64_t sampleVictron(uint64_t now);
+    uint64_t sampleDoor(uint64_t now);
+    uint64_t sampleBed(uint64_t now);
+
+public:
+    FleetNode(FleetNodeKind kind, uint32_t index, const FleetNodeOptions *options, FleetCapture *capture);
+
+    /**
+     * @brief Takes the node's next sample when it is due
+     *
+     * @param now Monotonic time in microseconds
+     */
+    void sample(uint64_t now);
+
+    /**
+     * @brief Get the time the node next has work to do, a sample or its client's deadline
+     *
+     * @return uint64_t Monotonic time in microseconds
+     */
+    uint64_t nextDeadline();
+
+    /**
+     * @brief Runs the node while it's active, the same as the runtime's loop
+     *
+     * @param elapsed Milliseconds since the last execute
+     */
+    void execute(uint32_t elapsed);
+
+    void enable();
+
+    FleetNodeKind getKind();
+};
+
+#endif /* FLEET_NODE */
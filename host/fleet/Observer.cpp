@@ -0,0 +1,628 @@
+/*
+ * File: Observer.cpp
+ * Project: fleet
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#include "Observer.h"
+
+#include <Protobuf.h>
+#include <SparkplugPayload.h>
+#include <SparkplugTransport.h>
+
+#include "host_stubs.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MQTT_CONNACK 2
+#define MQTT_SUBSCRIBE 8
+#define MQTT_PINGREQ 12
+
+#define OBSERVER_CLIENT_ID "fleet_observer"
+#define OBSERVER_KEEP_ALIVE_S 30
+// Births of a whole fleet can be large, only this much of each packet is kept
+#define OBSERVER_CAPTURE_LIMIT 65536
+#define OBSERVER_READ_CHUNK 16384
+#define OBSERVER_CONNECT_TIMEOUT_MS 5000
+
+#define SPARKPLUG_NAMESPACE "spBv1.0"
+#define SEQUENCE_METRIC "sequence"
+#define SPARKPLUG_BOOLEAN_DATATYPE 11
+
+#define US_PER_MS 1000
+#define US_PER_S 1000000
+
+struct FleetObserver::Private
+{
+    static void writeString(std::vector<uint8_t> *packet, const char *text, size_t length)
+    {
+        packet->push_back((uint8_t)(length >> 8));
+        packet->push_back((uint8_t)length);
+        packet->insert(packet->end(), (const uint8_t *)text, (const uint8_t *)text + length);
+    }
+
+    static void writeLength(std::vector<uint8_t> *packet, size_t remaining)
+    {
+        do
+        {
+            uint8_t byte = remaining & 0x7F;
+            remaining >>= 7;
+            packet->push_back(remaining > 0 ? byte | 0x80 : byte);
+        } while (remaining > 0);
+    }
+
+    static uint64_t utcMs()
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+    }
+
+    static std::string stateJson(bool online)
+    {
+        char json[64];
+        snprintf(json, sizeof(json), "{\"online\":%s,\"timestamp\":%llu}", online ? "true" : "false",
+                 (unsigned long long)utcMs());
+        return json;
+    }
+
+    /**
+     * @brief Finds the node of a topic from the number at the end of its node ID
+     *
+     * @return size_t The node, or SIZE_MAX if the topic isn't from a node of the fleet
+     */
+    static size_t topicNode(const char *topic, size_t length, size_t nodes)
+    {
+        // spBv1.0/group/TYPE/node[/device]
+        size_t slashes = 0;
+        size_t start = 0;
+        size_t end = length;
+        for (size_t i = 0; i < length; i++)
+        {
+            if (topic[i] != '/')
+            {
+                continue;
+            }
+            slashes++;
+            if (slashes == 3)
+            {
+                start = i + 1;
+            }
+            else if (slashes == 4)
+            {
+                end = i;
+                break;
+            }
+        }
+
+        size_t digits = end;
+        while (digits > start && topic[digits - 1] >= '0' && topic[digits - 1] <= '9')
+        {
+            digits--;
+        }
+        if (slashes < 3 || digits == end)
+        {
+            return SIZE_MAX;
+        }
+
+        size_t node = 0;
+        for (size_t i = digits; i < end; i++)
+        {
+            node = node * 10 + (topic[i] - '0');
+        }
+        return node < nodes ? node : SIZE_MAX;
+    }
+
+    /**
+     * @brief Finds the sequence metric in a payload, by its name or by its alias
+     *
+     * @param value Set to the sequence number when it is found
+     * @param alias Set to the alias given with the name, if there was one
+     * @return true if the payload had the sequence metric
+     */
+    static bool findSequence(const uint8_t *payload, size_t length, bool hasAlias, uint64_t knownAlias,
+                             uint64_t *value, uint64_t *alias, bool *aliased)
+    {
+        ProtobufReader reader(payload, length);
+        ProtobufField field;
+
+        while (reader.next(&field))
+        {
+            if (field.number != PAYLOAD_METRICS)
+            {
+                continue;
+            }
+
+            ProtobufReader metricReader(field.data, field.length);
+            ProtobufField metricField;
+            bool named = false;
+            bool hasMetricAlias = false;
+            uint64_t metricAlias = 0;
+            bool hasValue = false;
+            uint64_t metricValue = 0;
+
+            while (metricReader.next(&metricField))
+            {
+                if (metricField.number == METRIC_NAME)
+                {
+                    named = metricField.length == strlen(SEQUENCE_METRIC) &&
+                            memcmp(metricField.data, SEQUENCE_METRIC, metricField.length) == 0;
+                }
+                else if (metricField.number == METRIC_ALIAS)
+                {
+                    hasMetricAlias = true;
+                    metricAlias = metricField.value;
+                }
+                else if (metricField.number == METRIC_INT_VALUE || metricField.number == METRIC_LONG_VALUE)
+                {
+                    hasValue = true;
+                    metricValue = metricField.value;
+                }
+            }
+
+            if (hasValue && (named || (hasAlias && hasMetricAlias && metricAlias == knownAlias)))
+            {
+                *value = metricValue;
+                *alias = metricAlias;
+                *aliased = hasMetricAlias;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+FleetObserver::FleetObserver(const FleetObserverOptions *options, std::vector<FleetCapture> *captures)
+    : options(*options), captures(captures), nodes(captures->size()), stream(OBSERVER_CAPTURE_LIMIT)
+{
+}
+
+bool FleetObserver::isReady()
+{
+    return ready.load();
+}
+
+bool FleetObserver::isFinished()
+{
+    return finished.load();
+}
+
+void FleetObserver::stop()
+{
+    stopping = true;
+}
+
+bool FleetObserver::send(const std::vector<uint8_t> &packet)
+{
+    size_t sent = 0;
+    while (sent < packet.size())
+    {
+        ssize_t written = ::send(socket, packet.data() + sent, packet.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0)
+        {
+            fprintf(options.output, "fleet: lost the broker\n");
+            return false;
+        }
+        sent += written;
+    }
+    return true;
+}
+
+void FleetObserver::publish(const std::string &topic, const std::vector<uint8_t> &payload, uint8_t qos, bool retain)
+{
+    std::vector<uint8_t> packet;
+    uint8_t header = (MQTT_PUBLISH << 4) | (qos << 1) | (retain ? 1 : 0);
+    mqttWritePublishHeader(&packet, header, topic.data(), topic.size(), nextPacketId++, payload.size());
+    packet.insert(packet.end(), payload.begin(), payload.end());
+    if (nextPacketId == 0)
+    {
+        nextPacketId = 1;
+    }
+    send(packet);
+}
+
+void FleetObserver::publishState(bool online)
+{
+    std::string json = Private::stateJson(online);
+    publish(std::string(SPARKPLUG_NAMESPACE "/STATE/") + options.hostId,
+            std::vector<uint8_t>(json.begin(), json.end()), 1, true);
+}
+
+bool FleetObserver::open()
+{
+    struct addrinfo hints = {};
+    struct addrinfo *results = NULL;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    char port[8];
+    snprintf(port, sizeof(port), "%u", (unsigned)options.port);
+    if (getaddrinfo(options.host.c_str(), port, &hints, &results) != 0 || results == NULL)
+    {
+        fprintf(options.output, "fleet: couldn't resolve %s\n", options.host.c_str());
+        return false;
+    }
+
+    socket = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int connected = connect(socket, results->ai_addr, results->ai_addrlen);
+    freeaddrinfo(results);
+    if (connected != 0)
+    {
+        fprintf(options.output, "fleet: couldn't connect to %s:%u\n", options.host.c_str(), (unsigned)options.port);
+        return false;
+    }
+
+    int noDelay = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    // MQTT 3.1.1 with a clean session, and a retained will so the nodes see the host go if this dies
+    std::string willTopic = std::string(SPARKPLUG_NAMESPACE "/STATE/") + options.hostId;
+    std::string will = Private::stateJson(false);
+    std::vector<uint8_t> body;
+    Private::writeString(&body, "MQTT", 4);
+    body.push_back(4);
+    body.push_back(0x02 | 0x04 | 0x08 | 0x20);
+    body.push_back(0);
+    body.push_back(OBSERVER_KEEP_ALIVE_S);
+    Private::writeString(&body, OBSERVER_CLIENT_ID, strlen(OBSERVER_CLIENT_ID));
+    Private::writeString(&body, willTopic.data(), willTopic.size());
+    Private::writeString(&body, will.data(), will.size());
+
+    std::vector<uint8_t> packet = {MQTT_CONNECT << 4};
+    Private::writeLength(&packet, body.size());
+    packet.insert(packet.end(), body.begin(), body.end());
+    if (!send(packet))
+    {
+        return false;
+    }
+
+    struct pollfd fd = {.fd = socket, .events = POLLIN, .revents = 0};
+    uint8_t connack[4];
+    if (poll(&fd, 1, OBSERVER_CONNECT_TIMEOUT_MS) <= 0 || recv(socket, connack, sizeof(connack), MSG_WAITALL) != 4 ||
+        MQTT_PACKET_TYPE(connack[0]) != MQTT_CONNACK || connack[3] != 0)
+    {
+        fprintf(options.output, "fleet: the broker refused the connection\n");
+        return false;
+    }
+
+    std::string filter = std::string(SPARKPLUG_NAMESPACE "/") + options.groupId + "/#";
+    body.clear();
+    body.push_back(0);
+    body.push_back(nextPacketId++);
+    Private::writeString(&body, filter.data(), filter.size());
+    body.push_back(0);
+
+    packet = {(MQTT_SUBSCRIBE << 4) | 0x02};
+    Private::writeLength(&packet, body.size());
+    packet.insert(packet.end(), body.begin(), body.end());
+    if (!send(packet))
+    {
+        return false;
+    }
+
+    publishState(true);
+    return true;
+}
+
+void FleetObserver::birth(size_t node, bool device, const uint8_t *payload, size_t length, uint64_t now)
+{
+    NodeState &state = nodes[node];
+    Storm &storm = storms.back();
+
+    if (!device)
+    {
+        state.births++;
+        if (storm.end == 0 && !state.reborn)
+        {
+            state.reborn = true;
+            state.devicesReborn = 0;
+            state.birthLatency = now - storm.start;
+            storm.births.record(state.birthLatency);
+            storm.reborn++;
+        }
+        return;
+    }
+
+    uint64_t value;
+    uint64_t alias;
+    bool aliased;
+    if (Private::findSequence(payload, length, false, 0, &value, &alias, &aliased) && aliased)
+    {
+        state.sequenceAlias = alias;
+        state.hasAlias = true;
+    }
+
+    if (storm.end == 0 && state.reborn)
+    {
+        state.devicesReborn++;
+    }
+
+    // The storm is over once every node has been born with all of its devices
+    if (storm.end == 0 && storm.reborn == nodes.size())
+    {
+        for (size_t i = 0; i < nodes.size(); i++)
+        {
+            if (nodes[i].devicesReborn < (*captures)[i].devices)
+            {
+                return;
+            }
+        }
+        storm.end = now;
+    }
+}
+
+void FleetObserver::data(size_t node, const uint8_t *payload, size_t length, uint64_t now)
+{
+    NodeState &state = nodes[node];
+    uint64_t value;
+    uint64_t alias;
+    bool aliased;
+
+    if (!Private::findSequence(payload, length, state.hasAlias, state.sequenceAlias, &value, &alias, &aliased))
+    {
+        return;
+    }
+
+    uint64_t slot = (*captures)[node].samples[value % FLEET_CAPTURE_RING].load(std::memory_order_acquire);
+    if ((slot >> FLEET_CAPTURE_TIME_BITS) != (value & FLEET_CAPTURE_SEQUENCE_MASK))
+    {
+        // Overwritten by a later sample, the fleet is far ahead of the broker
+        return;
+    }
+
+    uint64_t captured = slot & FLEET_CAPTURE_TIME_MASK;
+    uint64_t delay = now > captured ? now - captured : 0;
+    state.latency.record(delay);
+    latency.record(delay);
+    reportLatency.record(delay);
+}
+
+void FleetObserver::handle(std::vector<uint8_t> &packet, uint64_t now)
+{
+    MqttPublish publish;
+    if (MQTT_PACKET_TYPE(packet[0]) != MQTT_PUBLISH || !mqttParsePublish(packet.data(), packet.size(), &publish))
+    {
+        return;
+    }
+
+    size_t node = Private::topicNode(publish.topic, publish.topicLength, nodes.size());
+    if (node == SIZE_MAX)
+    {
+        return;
+    }
+
+    messages++;
+    nodes[node].messages++;
+    if (storms.back().end == 0)
+    {
+        storms.back().messages++;
+        storms.back().bytes += packet.size();
+    }
+
+    switch (sparkplugMessageType(publish.topic, publish.topicLength))
+    {
+    case SPARKPLUG_NBIRTH:
+        birth(node, false, publish.payload, publish.payloadLength, now);
+        break;
+    case SPARKPLUG_DBIRTH:
+        birth(node, true, publish.payload, publish.payloadLength, now);
+        break;
+    case SPARKPLUG_NDATA:
+    case SPARKPLUG_DDATA:
+        data(node, publish.payload, publish.payloadLength, now);
+        break;
+    default:
+        break;
+    }
+}
+
+void FleetObserver::startStorm(uint64_t now, bool rebirth)
+{
+    storms.emplace_back();
+    Storm &storm = storms.back();
+    storm.start = now;
+    storm.end = 0;
+    storm.reborn = 0;
+    storm.bytes = 0;
+    storm.messages = 0;
+
+    for (NodeState &state : nodes)
+    {
+        state.reborn = false;
+        state.devicesReborn = 0;
+    }
+
+    if (!rebirth)
+    {
+        return;
+    }
+
+    // Every node is asked at once, as a primary host coming online does
+    ProtobufBuffer payload;
+    ProtobufWriter writer(&payload);
+    ProtobufBuffer metric;
+    ProtobufWriter metricWriter(&metric);
+    metricWriter.bytesField(METRIC_NAME, NODE_CONTROL_REBIRTH, strlen(NODE_CONTROL_REBIRTH));
+    metricWriter.varintField(METRIC_DATATYPE, SPARKPLUG_BOOLEAN_DATATYPE);
+    metricWriter.varintField(METRIC_BOOLEAN_VALUE, 1);
+    writer.varintField(PAYLOAD_TIMESTAMP, Private::utcMs());
+    writer.bytesField(PAYLOAD_METRICS, metric.data(), metric.size());
+
+    std::vector<uint8_t> encoded(payload.begin(), payload.end());
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        char topic[96];
+        snprintf(topic, sizeof(topic), SPARKPLUG_NAMESPACE "/%s/NCMD/Node%03u", options.groupId, (unsigned)i);
+        publish(topic, encoded, 0, false);
+    }
+}
+
+void FleetObserver::report(uint64_t now)
+{
+    double seconds = (double)(now - reportStart) / US_PER_S;
+    HostTcpCounters counters = host_tcp_counters();
+
+    fprintf(options.output,
+            "fleet %6.1fs: %8.1f msg/s %9.1f KB/s through the broker, latency p50 %6.2f ms p99 %6.2f ms max %7.2f ms, "
+            "fleet sent %llu KB\n",
+            (double)now / US_PER_S, seconds > 0 ? (messages - reportMessages) / seconds : 0.0,
+            seconds > 0 ? (bytes - reportBytes) / seconds / 1024 : 0.0,
+            reportLatency.percentile(50) / 1000.0, reportLatency.percentile(99) / 1000.0, reportLatency.max() / 1000.0,
+            (unsigned long long)(counters.bytesSent / 1024));
+    fflush(options.output);
+
+    reportMessages = messages;
+    reportBytes = bytes;
+    reportStart = now;
+    reportLatency.reset();
+}
+
+bool FleetObserver::run()
+{
+    if (!open())
+    {
+        finished = true;
+        return false;
+    }
+
+    uint64_t now = host_time_us();
+    uint64_t nextPing = now + (uint64_t)OBSERVER_KEEP_ALIVE_S * US_PER_S / 2;
+    uint64_t stormInterval = (uint64_t)options.stormInterval * US_PER_S;
+    uint64_t nextStorm = stormInterval > 0 ? now + stormInterval : UINT64_MAX;
+    uint64_t reportInterval = (uint64_t)options.reportInterval * US_PER_S;
+    uint64_t nextReport = now + reportInterval;
+    reportStart = now;
+
+    // The fleet starting is the first storm
+    startStorm(now, false);
+    ready = true;
+
+    uint8_t buffer[OBSERVER_READ_CHUNK];
+    while (!stopping)
+    {
+        now = host_time_us();
+        uint64_t until = nextPing < nextStorm ? nextPing : nextStorm;
+        until = nextReport < until ? nextReport : until;
+        int timeout = until > now ? (int)((until - now + US_PER_MS - 1) / US_PER_MS) : 0;
+        // Wakes now and then to notice the stop
+        timeout = timeout < 100 ? timeout : 100;
+
+        struct pollfd fd = {.fd = socket, .events = POLLIN, .revents = 0};
+        if (poll(&fd, 1, timeout) > 0)
+        {
+            ssize_t length = recv(socket, buffer, sizeof(buffer), 0);
+            if (length <= 0)
+            {
+                fprintf(options.output, "fleet: the broker closed the connection\n");
+                break;
+            }
+
+            now = host_time_us();
+            bytes += length;
+            size_t used = 0;
+            while (used < (size_t)length)
+            {
+                used += stream.feed(buffer + used, length - used);
+                if (stream.complete())
+                {
+                    handle(stream.getPacket(), now);
+                    stream.reset();
+                }
+            }
+        }
+
+        now = host_time_us();
+        if (now >= nextStorm)
+        {
+            startStorm(now, true);
+            nextStorm = now + stormInterval;
+        }
+        if (now >= nextReport)
+        {
+            report(now);
+            nextReport = now + reportInterval;
+        }
+        if (now >= nextPing)
+        {
+            std::vector<uint8_t> ping = {MQTT_PINGREQ << 4, 0};
+            send(ping);
+            nextPing = now + (uint64_t)OBSERVER_KEEP_ALIVE_S * US_PER_S / 2;
+        }
+    }
+
+    publishState(false);
+    std::vector<uint8_t> disconnect = {MQTT_DISCONNECT << 4, 0};
+    send(disconnect);
+    close(socket);
+    finished = true;
+    return true;
+}
+
+void FleetObserver::summary()
+{
+    FILE *output = options.output;
+
+    fprintf(output, "\n%-8s %9s %9s %8s %12s %12s %12s %10s\n", "storm", "reborn", "duration", "messages", "KB",
+            "birth p50", "birth p99", "birth max");
+    for (size_t i = 0; i < storms.size(); i++)
+    {
+        Storm &storm = storms[i];
+        char duration[16] = "-";
+        if (storm.end != 0)
+        {
+            snprintf(duration, sizeof(duration), "%.1f ms", (storm.end - storm.start) / 1000.0);
+        }
+        fprintf(output, "%-8s %4u/%-4u %9s %8llu %12.1f %9.2f ms %9.2f ms %7.2f ms\n", i == 0 ? "start" : "rebirth",
+                (unsigned)storm.reborn, (unsigned)nodes.size(), duration, (unsigned long long)storm.messages,
+                storm.bytes / 1024.0, storm.births.percentile(50) / 1000.0, storm.births.percentile(99) / 1000.0,
+                storm.births.max() / 1000.0);
+    }
+
+    fprintf(output, "\n%-8s %7s %9s %9s %12s %12s %12s %12s\n", "node", "births", "messages", "samples", "p50", "p90",
+            "p99", "max");
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        NodeState &state = nodes[i];
+        fprintf(output, "Node%03u  %7u %9llu %9u %9.2f ms %9.2f ms %9.2f ms %9.2f ms\n", (unsigned)i,
+                (unsigned)state.births, (unsigned long long)state.messages, (unsigned)state.latency.count(),
+                state.latency.percentile(50) / 1000.0, state.latency.percentile(90) / 1000.0,
+                state.latency.percentile(99) / 1000.0, state.latency.max() / 1000.0);
+    }
+    fprintf(output, "%-8s %7s %9llu %9u %9.2f ms %9.2f ms %9.2f ms %9.2f ms\n", "fleet", "",
+            (unsigned long long)messages, (unsigned)latency.count(), latency.percentile(50) / 1000.0,
+            latency.percentile(90) / 1000.0, latency.percentile(99) / 1000.0, latency.max() / 1000.0);
+    fflush(output);
+}
@@ -0,0 +1,174 @@
+/*
+ * File: Observer.h
+ * Project: fleet
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef FLEET_OBSERVER
+#define FLEET_OBSERVER
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <LatencyHistogram.h>
+#include <MqttPacket.h>
+
+// Sequence numbers of recent samples are matched to their capture time in a ring this long
+#define FLEET_CAPTURE_RING 256
+// Capture times are packed under the sequence number, in microseconds they last about 200 days
+#define FLEET_CAPTURE_TIME_BITS 44
+#define FLEET_CAPTURE_TIME_MASK ((1ULL << FLEET_CAPTURE_TIME_BITS) - 1)
+#define FLEET_CAPTURE_SEQUENCE_MASK ((1ULL << (64 - FLEET_CAPTURE_TIME_BITS)) - 1)
+
+/**
+ * @brief When the samples of a node were captured, written by the fleet and read by the observer
+ */
+typedef struct
+{
+    std::atomic<uint64_t> samples[FLEET_CAPTURE_RING];
+    // Devices the node births, so the observer knows when its births are done
+    uint32_t devices;
+} FleetCapture;
+
+typedef struct
+{
+    std::string host;
+    uint16_t port;
+    const char *groupId;
+    const char *hostId;
+    // Seconds between rebirth storms, or 0 for only the storm of the fleet starting
+    uint32_t stormInterval;
+    // Seconds between throughput reports
+    uint32_t reportInterval;
+    FILE *output;
+} FleetObserverOptions;
+
+/**
+ * @brief The primary host of the fleet. A plain MQTT client on its own thread that subscribes to the
+ * fleet's group, times every sample from capture to arrival through the broker, and sends every node
+ * a rebirth at once to time how long the fleet takes to be born again.
+ */
+class FleetObserver
+{
+private:
+    typedef struct
+    {
+        // Alias of the device's sequence metric from its birth
+        uint64_t sequenceAlias;
+        bool hasAlias;
+        // Births seen since the current storm started
+        bool reborn;
+        uint32_t devicesReborn;
+        uint64_t birthLatency;
+        uint32_t births;
+        uint64_t messages;
+        LatencyHistogram latency;
+    } NodeState;
+
+    typedef struct
+    {
+        uint64_t start;
+        uint64_t end;
+        uint32_t reborn;
+        uint64_t bytes;
+        uint64_t messages;
+        LatencyHistogram births;
+    } Storm;
+
+    FleetObserverOptions options;
+    std::vector<FleetCapture> *captures;
+    std::vector<NodeState> nodes;
+    std::vector<Storm> storms;
+    MqttPacketStream stream;
+    int socket = -1;
+    uint16_t nextPacketId = 1;
+
+    std::atomic<bool> ready{false};
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> finished{false};
+
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    uint64_t reportMessages = 0;
+    uint64_t reportBytes = 0;
+    uint64_t reportStart = 0;
+    LatencyHistogram reportLatency;
+    LatencyHistogram latency;
+
+    struct Private;
+
+    bool open();
+    bool send(const std::vector<uint8_t> &packet);
+    void publish(const std::string &topic, const std::vector<uint8_t> &payload, uint8_t qos, bool retain);
+    void publishState(bool online);
+    void handle(std::vector<uint8_t> &packet, uint64_t now);
+    void birth(size_t node, bool device, const uint8_t *payload, size_t length, uint64_t now);
+    void data(size_t node, const uint8_t *payload, size_t length, uint64_t now);
+    void startStorm(uint64_t now, bool rebirth);
+    void report(uint64_t now);
+
+public:
+    /**
+     * @brief Construct a new Fleet Observer
+     *
+     * @param options
+     * @param captures One for each node of the fleet, indexed by the number in its node ID
+     */
+    FleetObserver(const FleetObserverOptions *options, std::vector<FleetCapture> *captures);
+
+    /**
+     * @brief Connects to the broker and observes until stop is called. Run it on its own thread.
+     *
+     * @return true if it could connect
+     */
+    bool run();
+
+    /**
+     * @brief Whether the observer has subscribed, after which the nodes can start
+     */
+    bool isReady();
+
+    /**
+     * @brief Whether run has returned, because it was stopped or lost the broker
+     */
+    bool isFinished();
+
+    void stop();
+
+    /**
+     * @brief Prints the storms and the latency of every node. Call after run has returned.
+     */
+    void summary();
+};
+
+#endif /* FLEET_OBSERVER */
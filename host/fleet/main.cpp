@@ -0,0 +1,267 @@
+/*
+ * File: main.cpp
+ * Project: fleet
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+/*
+ * Runs a fleet of nodes built from the real PicoSparkplugClient and Node stack in one process,
+ * against a broker on the host, to see how the broker and a primary host cope with dozens of nodes.
+ * The nodes take turns at being shaped like the shed's Victron, the garage door and the garden bed.
+ * An observer standing in for the primary host reports the throughput through the broker, the time
+ * from each sample being captured to it arriving through the broker for every node, and how long
+ * the fleet takes to be born again when every node is asked to rebirth at once.
+ *
+ *   fleet [-n nodes] [-t seconds] [-b tcp://host:port] [-s storm interval] [-w publish window ms]
+ *         [-r report interval] [-v]
+ */
+
+#include "FleetNode.h"
+#include "Observer.h"
+
+#include <NodeScheduler.h>
+
+#include "pico/cyw43_arch.h"
+#include "host_stubs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define DEFAULT_NODES 24
+#define DEFAULT_DURATION_S 60
+#define DEFAULT_BROKER "tcp://127.0.0.1:1883"
+#define DEFAULT_STORM_INTERVAL_S 20
+#define DEFAULT_PUBLISH_WINDOW_MS 100
+#define DEFAULT_REPORT_S 5
+#define DEFAULT_MQTT_PORT 1883
+
+#define FLEET_GROUP_ID "Fleet"
+#define FLEET_HOST_ID "FleetHost"
+#define FLEET_NODE_PERIOD_MS 100
+
+#define US_PER_S 1000000
+
+typedef struct
+{
+    uint32_t nodes;
+    uint32_t duration;
+    const char *broker;
+    uint32_t stormInterval;
+    uint32_t publishWindow;
+    uint32_t reportInterval;
+    bool verbose;
+} Arguments;
+
+static bool parseArguments(int argc, char **argv, Arguments *arguments)
+{
+    int option;
+    while ((option = getopt(argc, argv, "n:t:b:s:w:r:v")) != -1)
+    {
+        switch (option)
+        {
+        case 'n':
+            arguments->nodes = (uint32_t)atoi(optarg);
+            break;
+        case 't':
+            arguments->duration = (uint32_t)atoi(optarg);
+            break;
+        case 'b':
+            arguments->broker = optarg;
+            break;
+        case 's':
+            arguments->stormInterval = (uint32_t)atoi(optarg);
+            break;
+        case 'w':
+            arguments->publishWindow = (uint32_t)atoi(optarg);
+            break;
+        case 'r':
+            arguments->reportInterval = (uint32_t)atoi(optarg);
+            break;
+        case 'v':
+            arguments->verbose = true;
+            break;
+        default:
+            return false;
+        }
+    }
+    return arguments->nodes > 0 && arguments->reportInterval > 0;
+}
+
+/**
+ * @brief Splits the host and port out of a broker address of the form tcp://host:port
+ */
+static void parseBroker(const char *broker, std::string *host, uint16_t *port)
+{
+    std::string address = broker;
+    size_t scheme = address.find("://");
+    if (scheme != std::string::npos)
+    {
+        address = address.substr(scheme + 3);
+    }
+
+    size_t colon = address.rfind(':');
+    *port = DEFAULT_MQTT_PORT;
+    if (colon != std::string::npos)
+    {
+        *port = (uint16_t)atoi(address.c_str() + colon + 1);
+        address = address.substr(0, colon);
+    }
+    *host = address;
+}
+
+static uint64_t threadCpuUs()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return (uint64_t)time.tv_sec * US_PER_S + (uint64_t)time.tv_nsec / 1000;
+}
+
+int main(int argc, char **argv)
+{
+    Arguments arguments = {
+        .nodes = DEFAULT_NODES,
+        .duration = DEFAULT_DURATION_S,
+        .broker = DEFAULT_BROKER,
+        .stormInterval = DEFAULT_STORM_INTERVAL_S,
+        .publishWindow = DEFAULT_PUBLISH_WINDOW_MS,
+        .reportInterval = DEFAULT_REPORT_S,
+        .verbose = false};
+
+    if (!parseArguments(argc, argv, &arguments))
+    {
+        fprintf(stderr, "usage: %s [-n nodes] [-t seconds] [-b tcp://host:port] [-s storm interval s] "
+                        "[-w publish window ms] [-r report interval s] [-v]\n",
+                argv[0]);
+        return 2;
+    }
+
+    // The nodes log every connect and publish, the report goes to the real output
+    FILE *output = fdopen(dup(STDOUT_FILENO), "w");
+    if (!arguments.verbose)
+    {
+        fflush(stdout);
+        freopen("/dev/null", "w", stdout);
+    }
+
+    std::vector<FleetCapture> captures(arguments.nodes);
+    FleetObserverOptions observerOptions = {
+        .host = "",
+        .port = 0,
+        .groupId = FLEET_GROUP_ID,
+        .hostId = FLEET_HOST_ID,
+        .stormInterval = arguments.stormInterval,
+        .reportInterval = arguments.reportInterval,
+        .output = output};
+    parseBroker(arguments.broker, &observerOptions.host, &observerOptions.port);
+
+    FleetNodeOptions nodeOptions = {
+        .brokerAddress = arguments.broker,
+        .groupId = FLEET_GROUP_ID,
+        .hostId = FLEET_HOST_ID,
+        .period = FLEET_NODE_PERIOD_MS,
+        .publishWindow = arguments.publishWindow};
+
+    std::vector<std::unique_ptr<FleetNode>> fleet;
+    for (uint32_t i = 0; i < arguments.nodes; i++)
+    {
+        fleet.push_back(std::make_unique<FleetNode>((FleetNodeKind)(i % FLEET_KINDS), i, &nodeOptions, &captures[i]));
+    }
+
+    fprintf(output, "fleet: %u nodes against %s for %u s, rebirth storms every %u s, publish window %u ms\n",
+            (unsigned)arguments.nodes, arguments.broker, (unsigned)arguments.duration,
+            (unsigned)arguments.stormInterval, (unsigned)arguments.publishWindow);
+    fflush(output);
+
+    FleetObserver observer(&observerOptions, &captures);
+    std::thread observing([&observer]
+                          { observer.run(); });
+    while (!observer.isReady() && !observer.isFinished())
+    {
+        host_sleep_us(1000);
+    }
+    if (!observer.isReady())
+    {
+        observing.join();
+        return 1;
+    }
+
+    cyw43_arch_init();
+    NodeScheduler scheduler(FLEET_NODE_PERIOD_MS);
+    for (auto &node : fleet)
+    {
+        scheduler.addDeadline([](void *context)
+                              { return ((FleetNode *)context)->nextDeadline(); },
+                              node.get());
+    }
+    scheduler.begin();
+
+    // Every node starts at once, the first storm
+    for (auto &node : fleet)
+    {
+        node->enable();
+    }
+
+    uint64_t end = host_time_us() + (uint64_t)arguments.duration * US_PER_S;
+    uint64_t cpuStart = threadCpuUs();
+    HostTcpCounters countersStart = host_tcp_counters();
+    while (host_time_us() < end && !observer.isFinished())
+    {
+        uint64_t now = host_time_us();
+        uint32_t elapsed = scheduler.elapsed();
+        for (auto &node : fleet)
+        {
+            node->sample(now);
+            node->execute(elapsed);
+        }
+        scheduler.wakeBy(end);
+        scheduler.wait();
+    }
+
+    uint64_t cpu = threadCpuUs() - cpuStart;
+    HostTcpCounters counters = host_tcp_counters();
+
+    observer.stop();
+    observing.join();
+    observer.summary();
+
+    fprintf(output, "\nfleet: the nodes' thread used %.2f s of CPU, %.1f%% of one core, and sent %llu KB over %u connects\n",
+            cpu / 1e6, arguments.duration > 0 ? cpu * 100.0 / ((double)arguments.duration * US_PER_S) : 0.0,
+            (unsigned long long)((counters.bytesSent - countersStart.bytesSent) / 1024), (unsigned)counters.connects);
+    fflush(output);
+
+    // The nodes aren't torn down, as a node that loses power isn't
+    _exit(0);
+}
@@ -0,0 +1,285 @@
+/*
+ * File: main.cpp
+ * Project: intercore_stress
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+/*
+ * Hammers SpscRing and Mailbox with a producer and a consumer thread standing in for the two cores.
+ * Checks the ring is lossless and in order when the producer waits for space, that a ring which
+ * drops when full only ever drops and counts, and that a mailbox read never returns a torn value.
+ */
+
+#include <SpscRing.h>
+#include <Mailbox.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#define RING_ITEMS 4000000
+#define LOSSY_ITEMS 4000000
+#define MAILBOX_WRITES 2000000
+// The producers yield this often so the threads interleave on a single host core too
+#define YIELD_EVERY 64
+
+// Sized like a door sample, and checked for tearing the same way as the mailbox values
+typedef struct
+{
+    uint32_t sequence;
+    uint32_t inverse;
+    uint64_t product;
+} StressItem;
+
+// Larger than a word so a torn read would mix two writes
+typedef struct
+{
+    uint32_t sequence;
+    uint32_t values[15];
+} StressValue;
+
+typedef struct
+{
+    uint64_t items;
+    uint64_t failures;
+    uint64_t dropped;
+    uint64_t producerWaits;
+    double seconds;
+} StressResult;
+
+static StressItem makeItem(uint32_t sequence)
+{
+    return {.sequence = sequence, .inverse = ~sequence, .product = (uint64_t)sequence * 2654435761u};
+}
+
+static bool checkItem(const StressItem &item)
+{
+    return item.inverse == ~item.sequence && item.product == (uint64_t)item.sequence * 2654435761u;
+}
+
+static StressValue makeValue(uint32_t sequence)
+{
+    StressValue value = {.sequence = sequence};
+    for (uint32_t i = 0; i < 15; i++)
+    {
+        value.values[i] = sequence * (i + 3) + i;
+    }
+    return value;
+}
+
+static bool checkValue(const StressValue &value)
+{
+    StressValue expected = makeValue(value.sequence);
+    return memcmp(&value, &expected, sizeof(value)) == 0;
+}
+
+static double since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief The producer waits whenever the ring is full, so every item must arrive once and in order
+ */
+template <size_t N>
+static StressResult lossless()
+{
+    static SpscRing<StressItem, N> ring;
+    StressResult result = {};
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread producer([&result]()
+                         {
+        for (uint32_t i = 0; i < RING_ITEMS; i++)
+        {
+            while (!ring.push(makeItem(i)))
+            {
+                result.producerWaits++;
+                std::this_thread::yield();
+            }
+        } });
+
+    uint32_t expected = 0;
+    while (expected < RING_ITEMS)
+    {
+        StressItem *item = ring.front();
+        if (item == NULL)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        if (item->sequence != expected || !checkItem(*item))
+        {
+            result.failures++;
+        }
+        expected = item->sequence + 1;
+        result.items++;
+        ring.pop();
+    }
+
+    producer.join();
+    result.seconds = since(start);
+    // Waiting producers show up as drops in the counter, they were retried so none were lost
+    result.dropped = ring.getDropped() - result.producerWaits;
+    return result;
+}
+
+/**
+ * @brief The producer never waits, items may be dropped but the rest must arrive in order and be counted
+ */
+template <size_t N>
+static StressResult lossy()
+{
+    static SpscRing<StressItem, N> ring;
+    static std::atomic<bool> done{false};
+    StressResult result = {};
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread producer([]()
+                         {
+        for (uint32_t i = 0; i < LOSSY_ITEMS; i++)
+        {
+            ring.push(makeItem(i));
+            if (i % YIELD_EVERY == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+        done.store(true, std::memory_order_release); });
+
+    int64_t last = -1;
+    StressItem item;
+    while (true)
+    {
+        bool finished = done.load(std::memory_order_acquire);
+        while (ring.pop(&item))
+        {
+            if ((int64_t)item.sequence <= last || !checkItem(item))
+            {
+                result.failures++;
+            }
+            last = item.sequence;
+            result.items++;
+        }
+        if (finished)
+        {
+            break;
+        }
+        std::this_thread::yield();
+    }
+
+    producer.join();
+    result.seconds = since(start);
+    result.dropped = ring.getDropped();
+    if (result.items + result.dropped != LOSSY_ITEMS)
+    {
+        result.failures++;
+    }
+    return result;
+}
+
+/**
+ * @brief The reader must only see whole values, and never one older than it has already seen
+ */
+static StressResult mailbox()
+{
+    static Mailbox<StressValue> box;
+    static std::atomic<bool> done{false};
+    StressResult result = {};
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread writer([]()
+                       {
+        for (uint32_t i = 1; i <= MAILBOX_WRITES; i++)
+        {
+            box.write(makeValue(i));
+            if (i % YIELD_EVERY == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+        done.store(true, std::memory_order_release); });
+
+    uint32_t last = 0;
+    StressValue value;
+    while (true)
+    {
+        bool finished = done.load(std::memory_order_acquire);
+        if (box.take(&value))
+        {
+            if (value.sequence < last || !checkValue(value))
+            {
+                result.failures++;
+            }
+            last = value.sequence;
+            result.items++;
+        }
+        else if (finished)
+        {
+            break;
+        }
+        std::this_thread::yield();
+    }
+
+    writer.join();
+    result.seconds = since(start);
+    // The last value written must be the one left in the mailbox
+    box.read(&value);
+    if (value.sequence != MAILBOX_WRITES || box.getWrites() != MAILBOX_WRITES)
+    {
+        result.failures++;
+    }
+    return result;
+}
+
+static uint64_t report(const char *name, StressResult result)
+{
+    printf("%-22s %9llu %9llu %9llu %11.0f %8llu\n", name,
+           (unsigned long long)result.items, (unsigned long long)result.dropped,
+           (unsigned long long)result.producerWaits, result.items / result.seconds,
+           (unsigned long long)result.failures);
+    return result.failures;
+}
+
+int main(int argc, char **argv)
+{
+    printf("%u hardware threads\n", std::thread::hardware_concurrency());
+    printf("%-22s %9s %9s %9s %11s %8s\n", "run", "received", "dropped", "waits", "items/s", "failures");
+
+    uint64_t failures = 0;
+    failures += report("ring of 2, lossless", lossless<2>());
+    failures += report("ring of 8, lossless", lossless<8>());
+    failures += report("ring of 256, lossless", lossless<256>());
+    failures += report("ring of 2, lossy", lossy<2>());
+    failures += report("ring of 64, lossy", lossy<64>());
+    failures += report("mailbox", mailbox());
+
+    return failures > 0 ? 1 : 0;
+}
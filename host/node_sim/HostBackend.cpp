@@ -0,0 +1,149 @@
+/*
+ * File: HostBackend.cpp
+ * Project: node_sim
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+/*
+ * The host program side of the stand-ins for a node running on Linux. The hardware timer is the
+ * host's monotonic clock from the start of the process, DNS goes to the host's resolver, and NTP
+ * requests are answered in process from the host's real time clock.
+ */
+
+#include "NtpResponder.h"
+
+#include "host_stubs.h"
+#include "lwip/udp.h"
+#include "pico/stdlib.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define NTP_PORT 123
+
+// The RP2040's 264K of SRAM, so the node's Diagnostics report the heap a Pico would have left
+asm(".globl __end__\n"
+    ".globl __StackLimit\n"
+    ".section .bss\n"
+    ".balign 8\n"
+    "__end__:\n"
+    ".zero 270336\n"
+    "__StackLimit:\n"
+    ".text\n");
+
+typedef struct
+{
+    struct udp_pcb *pcb;
+    uint8_t data[NTP_MSG_LEN];
+    ip_addr_t address;
+    uint16_t port;
+} PendingDatagram;
+
+static uint64_t clockUs(clockid_t clock)
+{
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+// Function statics, so the clock starts before any thread the other static constructors start reads it
+static uint64_t bootUs()
+{
+    static const uint64_t boot = clockUs(CLOCK_MONOTONIC);
+    return boot;
+}
+
+static NtpResponder *ntpServer()
+{
+    static NtpResponder server((int64_t)clockUs(CLOCK_REALTIME) - (int64_t)host_time_us());
+    return &server;
+}
+
+uint64_t host_time_us(void)
+{
+    return clockUs(CLOCK_MONOTONIC) - bootUs();
+}
+
+void host_sleep_us(uint64_t us)
+{
+    struct timespec duration = {.tv_sec = (time_t)(us / 1000000), .tv_nsec = (long)(us % 1000000) * 1000};
+    while (nanosleep(&duration, &duration) != 0)
+    {
+    }
+}
+
+static int64_t deliverDatagram(alarm_id_t id, void *data)
+{
+    PendingDatagram *datagram = (PendingDatagram *)data;
+    host_udp_deliver(datagram->pcb, datagram->data, NTP_MSG_LEN, &datagram->address, datagram->port);
+    delete datagram;
+    return 0;
+}
+
+void host_udp_send(struct udp_pcb *pcb, const void *data, uint16_t length, const ip_addr_t *address, uint16_t port)
+{
+    if (port != NTP_PORT)
+    {
+        // The nodes only use UDP for NTP
+        return;
+    }
+
+    PendingDatagram *datagram = new PendingDatagram();
+    if (!ntpServer()->respond((const uint8_t *)data, length, host_time_us(), datagram->data))
+    {
+        delete datagram;
+        return;
+    }
+
+    // Delivered from the network poll, as a reply off the wire would be
+    datagram->pcb = pcb;
+    datagram->address = *address;
+    datagram->port = port;
+    add_alarm_in_ms(0, deliverDatagram, datagram, true);
+}
+
+int host_dns_lookup(const char *hostname, ip_addr_t *address)
+{
+    struct addrinfo hints = {};
+    struct addrinfo *results = NULL;
+    hints.ai_family = AF_INET;
+
+    int status = getaddrinfo(hostname, NULL, &hints, &results);
+    if (status != 0 || results == NULL)
+    {
+        printf("node_sim: couldn't resolve %s: %s\n", hostname, gai_strerror(status));
+        return -1;
+    }
+
+    address->addr = ((struct sockaddr_in *)results->ai_addr)->sin_addr.s_addr;
+    freeaddrinfo(results);
+    return 0;
+}
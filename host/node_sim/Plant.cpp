@@ -0,0 +1,169 @@
+/*
+ * File: Plant.cpp
+ * Project: node_sim
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+/*
+ * What the nodes' peripherals are wired to. A thread stands in for the Victron charge controller
+ * on the shed's UART, the shed door switch and the garage door's motor and position sensor.
+ * Every node gets all of them, each only reads the ones it has.
+ */
+
+#include "host_stubs.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+
+#define PLANT_TICK_US 10000
+
+#define VICTRON_UART 0
+// 19200 baud 8N1
+#define VICTRON_BYTES_PER_SECOND 1920
+#define VICTRON_INTERVAL_US 1000000
+
+#define SHED_DOOR_PIN 3
+#define SHED_DOOR_TOGGLE_US 30000000
+
+#define GARAGE_RELAY_PIN 22
+#define GARAGE_POSITION_INPUT 0
+#define GARAGE_CLOSED 220
+#define GARAGE_OPEN 4095
+// Full travel takes about ten seconds
+#define GARAGE_TRAVEL_PER_TICK 4.0
+
+/**
+ * @brief A VE.Direct text block from a BlueSolar MPPT, with a checksum that brings the block's bytes to zero
+ */
+static std::string victronBlock(uint64_t now)
+{
+    double minutes = (double)now / 60000000.0;
+    int voltage = 12800 + (int)(200 * sin(minutes));
+    int current = (int)(1500 * sin(minutes * 3));
+    int panelVoltage = 18000 + (int)(500 * cos(minutes));
+    int panelPower = current > 0 ? voltage * current / 1000000 : 0;
+
+    char block[256];
+    snprintf(block, sizeof(block),
+             "\r\nPID\t0xA053\r\nFW\t159\r\nSER#\tHQ2132SIMUL\r\nV\t%d\r\nI\t%d\r\nVPV\t%d\r\nPPV\t%d"
+             "\r\nCS\t%d\r\nMPPT\t2\r\nERR\t0\r\nLOAD\tON\r\nH19\t1234\r\nH20\t12\r\nH21\t%d\r\nH22\t10"
+             "\r\nH23\t40\r\nHSDS\t42\r\nChecksum\t",
+             voltage, current, panelVoltage, panelPower, current > 0 ? 3 : 0, panelPower);
+
+    std::string text = block;
+    uint8_t sum = 0;
+    for (char c : text)
+    {
+        sum += (uint8_t)c;
+    }
+    text.push_back((char)(uint8_t)(256 - sum));
+    return text;
+}
+
+static void plant()
+{
+    uint64_t nextBlock = 0;
+    std::string sending;
+    size_t sent = 0;
+
+    uint64_t nextToggle = SHED_DOOR_TOGGLE_US;
+    bool shedDoorOpen = false;
+
+    double position = GARAGE_CLOSED;
+    double direction = 0;
+    double lastDirection = -1;
+    bool relay = false;
+    host_adc_drive(GARAGE_POSITION_INPUT, GARAGE_CLOSED);
+
+    while (true)
+    {
+        uint64_t now = host_time_us();
+
+        if (now >= nextBlock && sent == sending.size())
+        {
+            sending = victronBlock(now);
+            sent = 0;
+            nextBlock = now + VICTRON_INTERVAL_US;
+        }
+        if (sent < sending.size())
+        {
+            // Whatever doesn't fit in the FIFO is lost, as it is on the wire
+            size_t length = VICTRON_BYTES_PER_SECOND * PLANT_TICK_US / 1000000;
+            length = length < sending.size() - sent ? length : sending.size() - sent;
+            host_uart_receive(VICTRON_UART, sending.data() + sent, length);
+            sent += length;
+        }
+
+        if (now >= nextToggle)
+        {
+            shedDoorOpen = !shedDoorOpen;
+            // The switch closes when the door does
+            host_gpio_drive(SHED_DOOR_PIN, !shedDoorOpen);
+            nextToggle = now + SHED_DOOR_TOGGLE_US;
+        }
+
+        // Like the opener, each press of the button starts the door, stops it, or sends it back the other way
+        bool pressed = host_gpio_level(GARAGE_RELAY_PIN);
+        if (pressed && !relay)
+        {
+            if (direction != 0)
+            {
+                direction = 0;
+            }
+            else
+            {
+                direction = -lastDirection;
+                lastDirection = direction;
+            }
+        }
+        relay = pressed;
+
+        if (direction != 0)
+        {
+            position += direction * GARAGE_TRAVEL_PER_TICK;
+            if (position <= GARAGE_CLOSED || position >= GARAGE_OPEN)
+            {
+                position = position <= GARAGE_CLOSED ? GARAGE_CLOSED : GARAGE_OPEN;
+                direction = 0;
+            }
+            host_adc_drive(GARAGE_POSITION_INPUT, (uint16_t)position);
+        }
+
+        host_sleep_us(PLANT_TICK_US);
+    }
+}
+
+static struct PlantStart
+{
+    PlantStart()
+    {
+        std::thread(plant).detach();
+    }
+} plantStart;
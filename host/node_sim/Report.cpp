@@ -0,0 +1,203 @@
+/*
+ * File: Report.cpp
+ * Project: node_sim
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+/*
+ * Reports what a simulated node costs. The MQTT packets it sends are counted from its TCP stream,
+ * and the CPU time of the main thread, which runs the node the way core 0 does, is divided over
+ * them. Set NODE_SIM_REPORT_S to change how often it reports, and NODE_SIM_DURATION_S to exit
+ * after a run of that length.
+ */
+
+#include "host_stubs.h"
+
+#include <atomic>
+#include <malloc.h>
+#include <map>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_REPORT_S 10
+
+#define MQTT_PUBLISH 3
+
+/**
+ * @brief Where the parser is in an MQTT packet, across the writes of one connection
+ */
+typedef struct
+{
+    // 0 before the fixed header, then 1 to 4 while reading the remaining length
+    uint8_t headerBytes;
+    uint8_t type;
+    uint32_t remaining;
+    uint32_t multiplier;
+    // Body bytes of the current packet still to skip
+    uint32_t skip;
+} Framing;
+
+static std::map<struct tcp_pcb *, Framing> framing;
+static std::atomic<uint64_t> publishes{0};
+static std::atomic<uint64_t> packets{0};
+static clockid_t mainClock;
+
+static void countPacket(uint8_t type)
+{
+    packets++;
+    if (type == MQTT_PUBLISH)
+    {
+        publishes++;
+    }
+}
+
+static void observe(struct tcp_pcb *pcb, const void *data, size_t length, bool outbound)
+{
+    if (data == NULL)
+    {
+        framing.erase(pcb);
+        return;
+    }
+    if (!outbound)
+    {
+        return;
+    }
+
+    Framing &state = framing[pcb];
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < length;)
+    {
+        if (state.skip > 0)
+        {
+            size_t body = length - i < state.skip ? length - i : state.skip;
+            state.skip -= body;
+            i += body;
+            continue;
+        }
+
+        uint8_t byte = bytes[i++];
+        if (state.headerBytes == 0)
+        {
+            state.type = byte >> 4;
+            state.remaining = 0;
+            state.multiplier = 1;
+            state.headerBytes = 1;
+            continue;
+        }
+
+        state.remaining += (byte & 0x7F) * state.multiplier;
+        state.multiplier *= 128;
+        if (byte & 0x80)
+        {
+            continue;
+        }
+
+        state.headerBytes = 0;
+        state.skip = state.remaining;
+        countPacket(state.type);
+    }
+}
+
+static uint64_t cpuUs(clockid_t clock)
+{
+    struct timespec time;
+    clock_gettime(clock, &time);
+    return (uint64_t)time.tv_sec * 1000000 + (uint64_t)time.tv_nsec / 1000;
+}
+
+static void report(uint64_t elapsedUs, uint64_t publishesBefore, uint64_t mainBefore)
+{
+    HostTcpCounters counters = host_tcp_counters();
+    struct mallinfo2 heap = mallinfo2();
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    uint64_t published = publishes.load();
+    uint64_t mainUs = cpuUs(mainClock);
+    uint64_t interval = published - publishesBefore;
+
+    printf("node_sim %6.1fs: %llu publishes (%llu packets), %llu bytes out, %llu in, %u connects, %u failed\n",
+           elapsedUs / 1e6, (unsigned long long)published, (unsigned long long)packets.load(),
+           (unsigned long long)counters.bytesSent, (unsigned long long)counters.bytesReceived,
+           (unsigned)counters.connects, (unsigned)counters.failures);
+    printf("node_sim         main %.1f us/publish, main %.2fs, process %.2fs, heap %zu bytes, peak rss %ld KB, "
+           "uart overruns %u\n",
+           interval > 0 ? (double)(mainUs - mainBefore) / interval : 0.0, mainUs / 1e6,
+           cpuUs(CLOCK_PROCESS_CPUTIME_ID) / 1e6, heap.uordblks, usage.ru_maxrss, host_uart_overruns(0));
+    fflush(stdout);
+}
+
+static void reporter()
+{
+    const char *every = getenv("NODE_SIM_REPORT_S");
+    const char *duration = getenv("NODE_SIM_DURATION_S");
+    uint64_t intervalUs = (uint64_t)(every ? atoi(every) : DEFAULT_REPORT_S) * 1000000;
+    uint64_t endUs = duration ? (uint64_t)atoi(duration) * 1000000 : UINT64_MAX;
+    intervalUs = intervalUs > 0 ? intervalUs : DEFAULT_REPORT_S * 1000000;
+
+    uint64_t next = host_time_us() + intervalUs;
+    uint64_t publishesBefore = 0;
+    uint64_t mainBefore = 0;
+    while (true)
+    {
+        uint64_t now = host_time_us();
+        uint64_t wake = next < endUs ? next : endUs;
+        if (now < wake)
+        {
+            host_sleep_us(wake - now);
+            continue;
+        }
+
+        report(now, publishesBefore, mainBefore);
+        publishesBefore = publishes.load();
+        mainBefore = cpuUs(mainClock);
+        next += intervalUs;
+
+        if (now >= endUs)
+        {
+            // The nodes never return from their loop
+            _exit(0);
+        }
+    }
+}
+
+static struct ReportStart
+{
+    ReportStart()
+    {
+        // Static constructors run on the main thread, which goes on to run the node
+        pthread_getcpuclockid(pthread_self(), &mainClock);
+        host_tcp_observe(observe);
+        std::thread(reporter).detach();
+    }
+} reportStart;
@@ -0,0 +1,116 @@
+/*
+ * File: NtpResponder.cpp
+ * Project: ntp_harness
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#include "NtpResponder.h"
+
+#include <cstring>
+
+#define NTP_DELTA 2208988800 // seconds between 1 Jan 1900 and 1 Jan 1970
+#define SECONDS_TO_US 1000000
+
+#define NTP_ORIGINATE_OFFSET 24
+#define NTP_RECEIVE_OFFSET 32
+#define NTP_TRANSMIT_OFFSET 40
+
+#define NTP_MODE_CLIENT 0x3
+#define NTP_MODE_SERVER 0x4
+#define NTP_MODE_BROADCAST 0x5
+#define NTP_VERSION 4
+#define NTP_STRATUM 2
+
+NtpResponder::NtpResponder(int64_t epochStart) : epochStart(epochStart)
+{
+}
+
+void NtpResponder::setStep(uint64_t stepTime, int64_t step)
+{
+    this->stepTime = stepTime;
+    this->step = step;
+}
+
+void NtpResponder::setKissOfDeath(uint32_t count)
+{
+    kissOfDeath = count;
+}
+
+int64_t NtpResponder::serverTime(uint64_t now)
+{
+    return epochStart + (int64_t)now + (step != 0 && now >= stepTime ? step : 0);
+}
+
+void NtpResponder::writeTimestamp(uint8_t *packet, size_t offset, int64_t epochUs)
+{
+    uint64_t seconds = (uint64_t)(epochUs / SECONDS_TO_US) + NTP_DELTA;
+    uint64_t fraction = ((uint64_t)(epochUs % SECONDS_TO_US) << 32) / SECONDS_TO_US;
+    uint64_t timestamp = (seconds << 32) | fraction;
+
+    for (int i = 0; i < 8; i++)
+    {
+        packet[offset + i] = (uint8_t)(timestamp >> (56 - (i * 8)));
+    }
+}
+
+bool NtpResponder::respond(const uint8_t *request, size_t length, uint64_t now, uint8_t *response)
+{
+    if (length != NTP_MSG_LEN || (request[0] & 0x7) != NTP_MODE_CLIENT)
+    {
+        return false;
+    }
+
+    requests++;
+    memset(response, 0, NTP_MSG_LEN);
+    response[0] = (NTP_VERSION << 3) | NTP_MODE_SERVER;
+    memcpy(&response[NTP_ORIGINATE_OFFSET], &request[NTP_TRANSMIT_OFFSET], 8);
+
+    if (requests <= kissOfDeath)
+    {
+        // Stratum 0 with the kiss code in the reference identifier
+        response[1] = 0;
+        memcpy(&response[12], "RATE", 4);
+        return true;
+    }
+
+    response[1] = NTP_STRATUM;
+    memcpy(&response[12], "GPS", 3);
+    writeTimestamp(response, NTP_RECEIVE_OFFSET, serverTime(now));
+    writeTimestamp(response, NTP_TRANSMIT_OFFSET, serverTime(now + processingTime));
+
+    return true;
+}
+
+void NtpResponder::broadcast(uint64_t now, uint8_t *packet)
+{
+    memset(packet, 0, NTP_MSG_LEN);
+    packet[0] = (NTP_VERSION << 3) | NTP_MODE_BROADCAST;
+    packet[1] = NTP_STRATUM;
+    memcpy(&packet[12], "GPS", 3);
+    writeTimestamp(packet, NTP_TRANSMIT_OFFSET, serverTime(now));
+}
@@ -0,0 +1,114 @@
+/*
+ * File: NtpResponder.h
+ * Project: ntp_harness
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef NTPRESPONDER
+#define NTPRESPONDER
+
+#include <cstdint>
+#include <cstddef>
+
+#define NTP_MSG_LEN 48
+
+/**
+ * @brief A scripted NTP server running on the harness' virtual clock.
+ * The server clock can be stepped and it can be told to answer with kiss of death packets.
+ */
+class NtpResponder
+{
+private:
+    int64_t epochStart;
+    uint64_t stepTime = 0;
+    int64_t step = 0;
+    uint32_t kissOfDeath = 0;
+    uint32_t processingTime = 100;
+    uint32_t requests = 0;
+
+    void writeTimestamp(uint8_t *packet, size_t offset, int64_t epochUs);
+
+protected:
+public:
+    /**
+     * @brief Construct a new NTP Responder
+     *
+     * @param epochStart Epoch time in microseconds at virtual time zero
+     */
+    NtpResponder(int64_t epochStart);
+
+    /**
+     * @brief Steps the server clock at a point in virtual time
+     *
+     * @param stepTime Virtual time of the step in microseconds
+     * @param step Size of the step in microseconds
+     */
+    void setStep(uint64_t stepTime, int64_t step);
+
+    /**
+     * @brief Answers the first requests with a RATE kiss of death
+     *
+     * @param count The number of requests to refuse
+     */
+    void setKissOfDeath(uint32_t count);
+
+    /**
+     * @brief Epoch time of the server clock in microseconds
+     *
+     * @param now Virtual time in microseconds
+     */
+    int64_t serverTime(uint64_t now);
+
+    /**
+     * @brief Builds the response to a client request
+     *
+     * @param request The request packet
+     * @param length Length of the request packet
+     * @param now Virtual time the request arrived at the server
+     * @param response Buffer of NTP_MSG_LEN for the response
+     * @return true when a response should be sent
+     */
+    bool respond(const uint8_t *request, size_t length, uint64_t now, uint8_t *response);
+
+    /**
+     * @brief Builds a broadcast mode packet
+     *
+     * @param now Virtual time the packet is sent
+     * @param packet Buffer of NTP_MSG_LEN for the packet
+     */
+    void broadcast(uint64_t now, uint8_t *packet);
+
+    /**
+     * @brief Time between a request arriving and its response being sent
+     *
+     * @return uint32_t microseconds
+     */
+    uint32_t getProcessingTime() { return processingTime; };
+};
+
+#endif /* NTPRESPONDER */
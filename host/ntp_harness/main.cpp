@@ -0,0 +1,346 @@
+/*
+ * File: main.cpp
+ * Project: ntp_harness
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+/*
+ * Runs NtpClient against a scripted NTP responder on a virtual clock and network.
+ * Each scenario reports how far the client's clock is from true time and how long
+ * it takes to get there.
+ */
+
+#include <NtpClient.h>
+#include "NtpResponder.h"
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <random>
+#include <unistd.h>
+
+#define NTP_ADDRESS "ntp.harness"
+#define NTP_PORT 123
+#define SYNC_TIME 3600
+#define CALIBRATION_TIME 86400
+
+#define SECONDS_TO_US 1000000ULL
+#define TICK_US 1000
+#define EXECUTE_US 5000
+
+// 2026-01-01T00:00:00Z
+#define EPOCH_START (1767225600LL * 1000000LL)
+
+// Clock error considered converged
+#define CONVERGED_US 5000
+
+typedef struct
+{
+    const char *name;
+    // One way delays in microseconds
+    uint32_t delayOut;
+    uint32_t delayBack;
+    // Uniform random variation added to each one way delay
+    uint32_t jitter;
+    float loss;
+    uint32_t kissOfDeath;
+    // Server clock step
+    uint32_t stepAt;
+    int64_t step;
+    // All packets are lost from outageStart until this many seconds in
+    uint32_t outage;
+    // Drift of the client's hardware clock
+    float drift;
+    uint32_t duration;
+    // Seconds between server broadcasts, zero for a unicast only client
+    uint32_t broadcast;
+    uint32_t outageStart;
+} Scenario;
+
+static const Scenario scenarios[] = {
+    {"baseline", 2000, 2000, 0, 0.0f, 0, 0, 0, 0, 20.0f, 8 * 3600},
+    {"wan jitter", 15000, 15000, 10000, 0.0f, 0, 0, 0, 0, 20.0f, 8 * 3600},
+    {"asymmetric", 2000, 40000, 0, 0.0f, 0, 0, 0, 0, 20.0f, 8 * 3600},
+    {"30% loss", 5000, 5000, 2000, 0.3f, 0, 0, 0, 0, 20.0f, 8 * 3600},
+    {"kiss of death", 2000, 2000, 0, 0.0f, 2, 0, 0, 0, 20.0f, 8 * 3600},
+    {"clock step", 2000, 2000, 0, 0.0f, 0, 3 * 3600, 1500000, 0, 20.0f, 8 * 3600},
+    {"outage", 2000, 2000, 0, 0.0f, 0, 0, 0, 1800, -35.0f, 8 * 3600},
+    {"broadcast", 2000, 2000, 0, 0.0f, 0, 0, 0, 0, 20.0f, 8 * 3600, 64},
+    {"bcast wan", 15000, 15000, 10000, 0.0f, 0, 0, 0, 0, 20.0f, 8 * 3600, 64},
+    {"bcast loss", 5000, 5000, 2000, 0.3f, 0, 0, 0, 0, 20.0f, 8 * 3600, 64},
+    {"bcast step", 2000, 2000, 0, 0.0f, 0, 3 * 3600, 1500000, 0, 20.0f, 8 * 3600, 64},
+    // The broadcasts stop and the server goes with them, requests should back off rather than repeat
+    {"bcast outage", 2000, 2000, 0, 0.0f, 0, 0, 0, 5 * 3600, 20.0f, 8 * 3600, 64, 3600},
+};
+
+typedef struct
+{
+    uint32_t requests;
+    uint32_t syncs;
+    uint32_t failures;
+    int64_t convergence;
+    double syncErrorTotal;
+    int64_t syncErrorMax;
+    uint32_t syncErrorCount;
+    int64_t holdoverMax;
+    NtpStatistics statistics;
+} Report;
+
+// Virtual time in microseconds
+static uint64_t now = 0;
+static const Scenario *scenario;
+static NtpResponder *responder;
+static std::mt19937 generator;
+static std::multimap<uint64_t, std::function<void()>> events;
+static const ip_addr_t serverAddress = {0x0100000A};
+static uint32_t requests;
+
+uint64_t host_time_us(void)
+{
+    // The client's hardware clock drifts from true time
+    return now + (uint64_t)llround((double)now * scenario->drift / 1000000.0);
+}
+
+void host_sleep_us(uint64_t us)
+{
+    now += us;
+}
+
+int host_dns_lookup(const char *hostname, ip_addr_t *address)
+{
+    *address = serverAddress;
+    return 0;
+}
+
+static uint32_t pathDelay(uint32_t delay)
+{
+    if (scenario->jitter == 0)
+    {
+        return delay;
+    }
+    return delay + std::uniform_int_distribution<uint32_t>(0, scenario->jitter)(generator);
+}
+
+static bool lost()
+{
+    if (now >= (uint64_t)scenario->outageStart * SECONDS_TO_US && now < (uint64_t)scenario->outage * SECONDS_TO_US)
+    {
+        return true;
+    }
+    return std::uniform_real_distribution<float>(0.0f, 1.0f)(generator) < scenario->loss;
+}
+
+void host_udp_send(struct udp_pcb *pcb, const void *data, uint16_t length, const ip_addr_t *address, uint16_t port)
+{
+    if (!ip_addr_cmp(address, &serverAddress) || port != NTP_PORT)
+    {
+        return;
+    }
+
+    requests++;
+    if (lost())
+    {
+        return;
+    }
+
+    uint8_t request[NTP_MSG_LEN];
+    memcpy(request, data, length < NTP_MSG_LEN ? length : NTP_MSG_LEN);
+
+    uint64_t arrival = now + pathDelay(scenario->delayOut);
+    events.emplace(arrival, [pcb, request, length, arrival]()
+                   {
+                       uint8_t response[NTP_MSG_LEN];
+                       if (!responder->respond(request, length, arrival, response) || lost())
+                       {
+                           return;
+                       }
+
+                       uint64_t delivery = arrival + responder->getProcessingTime() + pathDelay(scenario->delayBack);
+                       events.emplace(delivery, [pcb, response]()
+                                      { host_udp_deliver(pcb, response, NTP_MSG_LEN, &serverAddress, NTP_PORT); });
+                   });
+}
+
+static void broadcast()
+{
+    uint8_t packet[NTP_MSG_LEN];
+    responder->broadcast(now, packet);
+
+    if (lost())
+    {
+        return;
+    }
+
+    events.emplace(now + pathDelay(scenario->delayBack), [packet]()
+                   { host_udp_deliver(host_udp_find(NTP_PORT), packet, NTP_MSG_LEN, &serverAddress, NTP_PORT); });
+}
+
+static void runEvents()
+{
+    while (!events.empty() && events.begin()->first <= now)
+    {
+        auto event = events.begin()->second;
+        events.erase(events.begin());
+        event();
+    }
+}
+
+static Report run(const Scenario *current)
+{
+    Report report = {};
+    report.convergence = -1;
+
+    scenario = current;
+    now = 0;
+    requests = 0;
+    events.clear();
+    generator.seed(0x4E5450);
+
+    NtpResponder server(EPOCH_START);
+    server.setKissOfDeath(scenario->kissOfDeath);
+    server.setStep((uint64_t)scenario->stepAt * SECONDS_TO_US, scenario->step);
+    responder = &server;
+
+    // Every scenario starts from a node that has never had UTC
+    time_service_clear_utc();
+    NtpClient client(NTP_ADDRESS, NTP_PORT, SYNC_TIME);
+    if (scenario->broadcast)
+    {
+        client.listen(NULL, CALIBRATION_TIME);
+    }
+    uint32_t lastSyncs = 0;
+    uint64_t end = (uint64_t)scenario->duration * SECONDS_TO_US;
+
+    for (now = 0; now < end; now += TICK_US)
+    {
+        if (scenario->broadcast && now % (scenario->broadcast * SECONDS_TO_US) == 0)
+        {
+            broadcast();
+        }
+
+        runEvents();
+        host_alarm_poll();
+
+        if (now % EXECUTE_US == 0)
+        {
+            client.sync();
+        }
+
+        NtpStatistics statistics = client.getStatistics();
+        bool synced = statistics.syncs != lastSyncs;
+
+        if (statistics.syncs == 0 || (!synced && now % SECONDS_TO_US != 0))
+        {
+            continue;
+        }
+
+        // The client reports whole milliseconds, so compare the middle of its millisecond against the server
+        int64_t error = ((int64_t)client.getTime() * 1000) + 500 - server.serverTime(now);
+        int64_t magnitude = error < 0 ? -error : error;
+
+        if (synced)
+        {
+            if (report.convergence < 0 && magnitude <= CONVERGED_US)
+            {
+                report.convergence = (int64_t)now;
+            }
+
+            report.syncErrorTotal += (double)magnitude;
+            report.syncErrorCount++;
+            report.syncErrorMax = magnitude > report.syncErrorMax ? magnitude : report.syncErrorMax;
+            lastSyncs = statistics.syncs;
+        }
+        else
+        {
+            report.holdoverMax = magnitude > report.holdoverMax ? magnitude : report.holdoverMax;
+        }
+    }
+
+    report.statistics = client.getStatistics();
+    report.requests = requests;
+    report.syncs = report.statistics.syncs;
+    report.failures = report.statistics.timeouts + report.statistics.invalidResponses +
+                      report.statistics.dnsFailures + report.statistics.kissOfDeath;
+
+    events.clear();
+    return report;
+}
+
+int main(int argc, char **argv)
+{
+    bool verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    int output = dup(STDOUT_FILENO);
+
+    printf("%-14s %5s %6s %6s %10s %10s %10s %10s %9s %9s %15s\n",
+           "scenario", "reqs", "syncs", "fails", "converged", "sync err", "sync max", "holdover", "delay", "jitter", "drift est/true");
+    printf("%-14s %5s %6s %6s %10s %10s %10s %10s %9s %9s %15s\n",
+           "", "", "", "", "(s)", "mean (ms)", "(ms)", "max (ms)", "(ms)", "(ms)", "(ppm)");
+    fflush(stdout);
+
+    for (const Scenario &current : scenarios)
+    {
+        // The client logs every request, only keep that when asked
+        if (!verbose)
+        {
+            fflush(stdout);
+            freopen("/dev/null", "w", stdout);
+        }
+
+        Report report = run(&current);
+
+        if (!verbose)
+        {
+            fflush(stdout);
+            dup2(output, STDOUT_FILENO);
+        }
+
+        char convergence[16] = "never";
+        if (report.convergence >= 0)
+        {
+            snprintf(convergence, sizeof(convergence), "%.1f", (double)report.convergence / SECONDS_TO_US);
+        }
+
+        printf("%-14s %5u %6u %6u %10s %10.2f %10.2f %10.2f %9.2f %9.2f %7.1f/%-7.1f\n",
+               current.name,
+               report.requests,
+               report.syncs,
+               report.failures,
+               convergence,
+               report.syncErrorCount ? report.syncErrorTotal / report.syncErrorCount / 1000.0 : 0.0,
+               report.syncErrorMax / 1000.0,
+               report.holdoverMax / 1000.0,
+               report.statistics.delay / 1000.0,
+               report.statistics.jitter / 1000.0,
+               report.statistics.drift,
+               current.drift);
+        fflush(stdout);
+    }
+
+    return 0;
+}
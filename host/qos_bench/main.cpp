@@ -0,0 +1,599 @@
+/*
+ * File: main.cpp
+ * Project: qos_bench
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+/*
+ * Runs SparkplugTransport against a simulated broker over a lossy link on a virtual clock.
+ * Segments lost on the link are sent again by TCP after its retransmission timeout, holding up
+ * everything behind them. In the delivery runs the link also goes down now and then, losing
+ * whatever was on the wire, and the node reconnects and is born again.
+ * Reports the QoS 1 throughput of each in-flight window at 0%, 1% and 5% loss, and how many state
+ * changes reach the broker when they are published at QoS 0 and at QoS 1. Exits with an error
+ * if a change published at QoS 1 never arrives, or if the MQTT client is given an acknowledgement.
+ */
+
+#include <SparkplugTransport.h>
+#include <SparkplugPayload.h>
+#include <StoreAndForward.h>
+#include <host_stubs.h>
+
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#define SECONDS_TO_US 1000000ULL
+#define MS_TO_US 1000ULL
+#define TICK_US 1000
+#define ARENA_SIZE 4096
+
+// One way delay of the link, and TCP's retransmission timeout which doubles each time the same segment is lost
+#define LINK_DELAY_US 20000
+#define RETRANSMIT_US 200000
+
+// Mean time between the link going down in the delivery runs, and how long the node takes to notice and come back
+#define OUTAGE_INTERVAL_S 20
+#define OUTAGE_NOTICE_US 1000000
+#define RECONNECT_US 500000
+
+#define RUN_DURATION_S 600
+#define DATA_INTERVAL_US 50000
+
+#define TOPIC_PREFIX "spBv1.0/Bench/"
+#define NODE_ID "Node"
+#define DEVICE_ID "Victron"
+#define NODE_METRIC "result"
+#define DEVICE_METRIC "errorState"
+#define DATA_METRIC "current"
+
+typedef struct
+{
+    float loss;
+    // In-flight window of the transport, 0 to publish the changes at QoS 0
+    size_t window;
+    uint32_t changeInterval;
+    bool outages;
+} Scenario;
+
+typedef struct
+{
+    uint32_t offered;
+    uint32_t delivered;
+    uint32_t duplicates;
+    uint32_t connects;
+    uint32_t strayAcknowledgements;
+    uint64_t bytes;
+    LatencyHistogram latency;
+    SparkplugTransportStatistics statistics;
+} Report;
+
+typedef struct
+{
+    uint64_t arrival;
+    std::vector<uint8_t> packet;
+} Segment;
+
+// Virtual time in microseconds
+static uint64_t now = 0;
+static std::mt19937 generator;
+
+uint64_t host_time_us(void)
+{
+    return now;
+}
+
+void host_sleep_us(uint64_t us)
+{
+    now += us;
+}
+
+/**
+ * @brief The TCP connection to the broker, carrying whole MQTT packets as segments in each direction
+ */
+class BenchLink : public Client
+{
+private:
+    float loss;
+    MqttPacketStream outbound;
+    uint64_t lastToBroker = 0;
+    uint64_t lastToNode = 0;
+    std::vector<uint8_t> received;
+    size_t receivedPosition = 0;
+
+    uint64_t arrival(uint64_t *last)
+    {
+        std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+        uint64_t time = now + LINK_DELAY_US;
+        uint64_t timeout = RETRANSMIT_US;
+
+        while (chance(generator) < loss)
+        {
+            time += timeout;
+            timeout *= 2;
+        }
+
+        // TCP delivers in order, so a segment sent again holds up those behind it
+        time = time > *last ? time : *last;
+        *last = time;
+        return time;
+    }
+
+public:
+    std::deque<Segment> toBroker;
+    std::deque<Segment> toNode;
+    bool up = false;
+    uint64_t downSince = 0;
+    uint64_t bytes = 0;
+
+    BenchLink(float loss) : loss(loss), outbound(SIZE_MAX)
+    {
+    }
+
+    /**
+     * @brief Takes the link down, losing everything on the wire. The node notices some time later.
+     */
+    void drop()
+    {
+        toBroker.clear();
+        toNode.clear();
+        up = false;
+        downSince = now;
+    }
+
+    void reply(const uint8_t *packet, size_t length)
+    {
+        toNode.push_back({.arrival = arrival(&lastToNode), .packet = std::vector<uint8_t>(packet, packet + length)});
+    }
+
+    virtual int connect(const char *host, uint16_t port) override
+    {
+        up = true;
+        toBroker.clear();
+        toNode.clear();
+        outbound.reset();
+        received.clear();
+        receivedPosition = 0;
+        lastToBroker = lastToNode = now;
+        return 1;
+    }
+
+    virtual size_t write(uint8_t data) override
+    {
+        return write(&data, 1);
+    }
+
+    virtual size_t write(const void *data, size_t length) override
+    {
+        const uint8_t *position = (const uint8_t *)data;
+        size_t remaining = length;
+
+        while (remaining > 0)
+        {
+            size_t consumed = outbound.feed(position, remaining);
+            position += consumed;
+            remaining -= consumed;
+
+            if (outbound.complete())
+            {
+                // Written into a link that is down but not yet noticed, and never arrives
+                if (up)
+                {
+                    bytes += outbound.getPacket().size();
+                    toBroker.push_back({.arrival = arrival(&lastToBroker), .packet = outbound.getPacket()});
+                }
+                outbound.reset();
+            }
+        }
+        return length;
+    }
+
+    virtual int available() override
+    {
+        while (up && !toNode.empty() && toNode.front().arrival <= now)
+        {
+            received.insert(received.end(), toNode.front().packet.begin(), toNode.front().packet.end());
+            toNode.pop_front();
+        }
+        return received.size() - receivedPosition;
+    }
+
+    virtual int read(void *data, size_t length) override
+    {
+        size_t count = available();
+        count = length < count ? length : count;
+        memcpy(data, received.data() + receivedPosition, count);
+        receivedPosition += count;
+        if (receivedPosition == received.size())
+        {
+            received.clear();
+            receivedPosition = 0;
+        }
+        return count;
+    }
+
+    virtual void stop() override
+    {
+        up = false;
+    }
+
+    virtual uint8_t connected() override
+    {
+        return up || now < downSince + OUTAGE_NOTICE_US;
+    }
+
+    virtual void sync() override
+    {
+    }
+};
+
+/**
+ * @brief Acknowledges QoS 1 publishes and counts the changes of the watched metrics that arrive in data
+ */
+class BenchBroker
+{
+private:
+    BenchLink *link;
+    Report *report;
+    const std::vector<uint64_t> *changed;
+    // Aliases of each topic's metrics, learned from the births
+    std::map<std::string, std::map<uint64_t, std::string>> aliases;
+    std::vector<uint8_t> seen;
+
+    void deliver(const std::string &name, uint64_t value)
+    {
+        if (name != NODE_METRIC && name != DEVICE_METRIC)
+        {
+            return;
+        }
+
+        if (value >= seen.size())
+        {
+            seen.resize(value + 1);
+        }
+        if (seen[value]++ > 0)
+        {
+            report->duplicates++;
+            return;
+        }
+        report->delivered++;
+        report->latency.record(now - (*changed)[value]);
+    }
+
+    void publish(MqttPublish *publish)
+    {
+        std::string topic(publish->topic, publish->topicLength);
+        SparkplugMessageType type = sparkplugMessageType(publish->topic, publish->topicLength);
+        bool birth = type == SPARKPLUG_NBIRTH || type == SPARKPLUG_DBIRTH;
+        std::string key = topic.substr(topic.find(birth ? "BIRTH/" : "DATA/") + (birth ? 6 : 5));
+        ProtobufReader reader(publish->payload, publish->payloadLength);
+        ProtobufField field;
+
+        if (type != SPARKPLUG_NDATA && type != SPARKPLUG_DDATA && !birth)
+        {
+            return;
+        }
+
+        while (reader.next(&field))
+        {
+            if (field.number != PAYLOAD_METRICS)
+            {
+                continue;
+            }
+
+            ProtobufReader metricReader(field.data, field.length);
+            ProtobufField metricField;
+            std::string name;
+            uint64_t alias = UINT64_MAX;
+            uint64_t value = 0;
+
+            while (metricReader.next(&metricField))
+            {
+                if (metricField.number == METRIC_NAME)
+                {
+                    name.assign((const char *)metricField.data, metricField.length);
+                }
+                else if (metricField.number == METRIC_ALIAS)
+                {
+                    alias = metricField.value;
+                }
+                else if (metricField.number == METRIC_INT_VALUE)
+                {
+                    value = metricField.value;
+                }
+            }
+
+            if (birth)
+            {
+                aliases[key][alias] = name;
+            }
+            else
+            {
+                deliver(name.empty() ? aliases[key][alias] : name, value);
+            }
+        }
+    }
+
+public:
+    BenchBroker(BenchLink *link, Report *report, const std::vector<uint64_t> *changed)
+        : link(link), report(report), changed(changed)
+    {
+    }
+
+    void run()
+    {
+        while (link->up && !link->toBroker.empty() && link->toBroker.front().arrival <= now)
+        {
+            Segment segment = std::move(link->toBroker.front());
+            link->toBroker.pop_front();
+            std::vector<uint8_t> &packet = segment.packet;
+            MqttPublish parsed;
+
+            if (MQTT_PACKET_TYPE(packet[0]) == MQTT_CONNECT)
+            {
+                static const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+                link->reply(connack, sizeof(connack));
+            }
+            else if (mqttParsePublish(packet.data(), packet.size(), &parsed))
+            {
+                if (MQTT_PUBLISH_QOS(parsed.header) == 1)
+                {
+                    uint8_t puback[] = {MQTT_PUBACK << 4, 0x02, (uint8_t)(parsed.packetId >> 8), (uint8_t)parsed.packetId};
+                    link->reply(puback, sizeof(puback));
+                }
+                publish(&parsed);
+            }
+        }
+    }
+};
+
+typedef struct
+{
+    const char *name;
+    uint8_t datatype;
+    uint64_t value;
+} BenchMetric;
+
+/**
+ * @brief Writes a publish the way the MQTT client would, with every metric named
+ */
+static void publish(Client *client, const char *type, const char *device, std::vector<BenchMetric> metrics)
+{
+    ProtobufBuffer payload;
+    ProtobufBuffer metric;
+    ProtobufWriter writer(&payload);
+    ProtobufWriter metricWriter(&metric);
+    std::string topic = std::string(TOPIC_PREFIX) + type + "/" NODE_ID + (device ? std::string("/") + device : "");
+    std::vector<uint8_t> packet;
+
+    writer.varintField(PAYLOAD_TIMESTAMP, now / MS_TO_US);
+    for (auto &entry : metrics)
+    {
+        metric.clear();
+        metricWriter.bytesField(METRIC_NAME, entry.name, strlen(entry.name));
+        metricWriter.varintField(METRIC_DATATYPE, entry.datatype);
+        metricWriter.varintField(METRIC_INT_VALUE, entry.value);
+        writer.bytesField(PAYLOAD_METRICS, metric.data(), metric.size());
+    }
+    writer.varintField(PAYLOAD_SEQ, 0);
+
+    mqttWritePublishHeader(&packet, MQTT_PUBLISH << 4, topic.data(), topic.size(), 0, payload.size());
+    packet.insert(packet.end(), payload.begin(), payload.end());
+    client->write(packet.data(), packet.size());
+}
+
+static Report run(const Scenario *scenario)
+{
+    typedef enum
+    {
+        OFFLINE,
+        CONNECTING,
+        ONLINE
+    } State;
+
+    // The MQTT client's CONNECT, clean session with a 5 second keep alive
+    static const uint8_t connect[] = {0x10, 0x11, 0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0x02, 0x00, 0x05,
+                                      0x00, 0x05, 'b', 'e', 'n', 'c', 'h'};
+
+    Report report = {};
+    std::vector<uint64_t> changed = {0};
+    BenchLink link(scenario->loss);
+    BenchBroker broker(&link, &report, &changed);
+    Arena arena(ARENA_SIZE);
+    SparkplugTransport transport(&link, &arena);
+    MqttPacketStream inbound(SIZE_MAX);
+    // Outages come from their own generator, so every run of a loss rate sees the same ones
+    std::mt19937 outages(0x0D0E);
+    std::exponential_distribution<double> outage(1.0 / (OUTAGE_INTERVAL_S * SECONDS_TO_US));
+    State state = OFFLINE;
+    uint64_t reconnectAt = 0;
+    uint64_t nextOutage = scenario->outages ? (uint64_t)outage(outages) : UINT64_MAX;
+    uint64_t nodeValue = 0;
+    uint64_t deviceValue = 0;
+    uint8_t buffer[SPARKPLUG_READ_CHUNK];
+
+    generator.seed(0x5EED);
+    now = 0;
+    if (scenario->window > 0)
+    {
+        transport.setInFlightWindow(scenario->window);
+        transport.deliverAtLeastOnce(NULL, NODE_METRIC);
+        transport.deliverAtLeastOnce(DEVICE_ID, DEVICE_METRIC);
+    }
+
+    for (now = 0; now < RUN_DURATION_S * SECONDS_TO_US; now += TICK_US)
+    {
+        if (now >= nextOutage)
+        {
+            link.drop();
+            nextOutage = now + (uint64_t)outage(outages) + OUTAGE_NOTICE_US;
+        }
+
+        broker.run();
+
+        if (state != OFFLINE && !transport.connected())
+        {
+            transport.stop();
+            state = OFFLINE;
+            reconnectAt = now + RECONNECT_US;
+        }
+
+        if (state == OFFLINE && now >= reconnectAt)
+        {
+            transport.connect("broker", 1883);
+            transport.write(connect, sizeof(connect));
+            report.connects++;
+            state = CONNECTING;
+        }
+
+        while (transport.available() > 0)
+        {
+            size_t count = transport.read(buffer, sizeof(buffer));
+            const uint8_t *position = buffer;
+
+            while (count > 0)
+            {
+                size_t consumed = inbound.feed(position, count);
+                position += consumed;
+                count -= consumed;
+                if (!inbound.complete())
+                {
+                    continue;
+                }
+
+                uint8_t type = MQTT_PACKET_TYPE(inbound.getPacket()[0]);
+                if (type == MQTT_PUBACK)
+                {
+                    report.strayAcknowledgements++;
+                }
+                else if (type == 2 && state == CONNECTING)
+                {
+                    publish(&transport, "NBIRTH", NULL, {{NODE_METRIC, SPARKPLUG_UINT32, nodeValue}});
+                    publish(&transport, "DBIRTH", DEVICE_ID,
+                            {{DEVICE_METRIC, SPARKPLUG_UINT32, deviceValue}, {DATA_METRIC, SPARKPLUG_INT32, 0}});
+                    state = ONLINE;
+                }
+                inbound.reset();
+            }
+        }
+
+        // Changes alternate between the node and the device, and are numbered so the broker can tell which arrived
+        if (now % scenario->changeInterval == 0)
+        {
+            bool node = (changed.size() % 2) == 0;
+            changed.push_back(now);
+            (node ? nodeValue : deviceValue) = changed.size() - 1;
+
+            if (state == ONLINE)
+            {
+                report.offered++;
+                publish(&transport, node ? "NDATA" : "DDATA", node ? NULL : DEVICE_ID,
+                        {{node ? NODE_METRIC : DEVICE_METRIC, SPARKPLUG_UINT32, changed.size() - 1}});
+            }
+        }
+
+        if (now % DATA_INTERVAL_US == 0 && state == ONLINE)
+        {
+            publish(&transport, "DDATA", DEVICE_ID, {{DATA_METRIC, SPARKPLUG_INT32, generator() % 2000}});
+        }
+
+        transport.sync();
+    }
+
+    report.bytes = link.bytes;
+    report.statistics = transport.getStatistics();
+    return report;
+}
+
+int main()
+{
+    static const float losses[] = {0.0f, 0.01f, 0.05f};
+    static const size_t windows[] = {1, 2, 4, 8};
+    bool failed = false;
+
+    printf("QoS 1 throughput, a change every 10 ms, %u ms round trip\n", (unsigned)(2 * LINK_DELAY_US / MS_TO_US));
+    printf("%6s %7s %10s %10s %11s %9s %9s %9s\n", "loss", "window", "acked/s", "queued", "delivered", "p50", "p99", "max");
+    printf("%6s %7s %10s %10s %11s %9s %9s %9s\n", "(%)", "", "", "", "(%)", "(ms)", "(ms)", "(ms)");
+    for (float loss : losses)
+    {
+        for (size_t window : windows)
+        {
+            Scenario scenario = {.loss = loss, .window = window, .changeInterval = 10000, .outages = false};
+            Report report = run(&scenario);
+
+            printf("%6.0f %7zu %10.1f %10u %11.2f %9.1f %9.1f %9.1f\n",
+                   loss * 100,
+                   window,
+                   (double)report.statistics.acknowledged / RUN_DURATION_S,
+                   report.statistics.queued,
+                   report.offered ? report.delivered * 100.0 / report.offered : 0.0,
+                   report.latency.percentile(50) / 1000.0,
+                   report.latency.percentile(99) / 1000.0,
+                   report.latency.max() / 1000.0);
+            failed |= report.strayAcknowledgements > 0;
+        }
+    }
+
+    printf("\nDelivery of a change every 500 ms with the link going down every %u s on average\n", OUTAGE_INTERVAL_S);
+    printf("%6s %6s %8s %8s %10s %6s %7s %8s %9s %10s\n",
+           "loss", "qos", "offered", "arrived", "lost", "dupes", "resent", "connects", "p99", "bytes per");
+    printf("%6s %6s %8s %8s %10s %6s %7s %8s %9s %10s\n", "(%)", "", "", "", "", "", "", "", "(ms)", "change");
+    for (float loss : losses)
+    {
+        for (size_t window : {(size_t)0, (size_t)SPARKPLUG_INFLIGHT_WINDOW})
+        {
+            Scenario scenario = {.loss = loss, .window = window, .changeInterval = 500000, .outages = true};
+            Report report = run(&scenario);
+
+            printf("%6.0f %6d %8u %8u %10u %6u %7u %8u %9.1f %10.0f\n",
+                   loss * 100,
+                   window > 0 ? 1 : 0,
+                   report.offered,
+                   report.delivered,
+                   report.offered - report.delivered,
+                   report.duplicates,
+                   report.statistics.retransmitted,
+                   report.connects,
+                   report.latency.percentile(99) / 1000.0,
+                   report.delivered ? (double)report.bytes / report.delivered : 0.0);
+
+            if (window > 0 && (report.delivered < report.offered || report.strayAcknowledgements > 0))
+            {
+                printf("FAIL: %u changes published at QoS 1 never arrived, %u acknowledgements reached the MQTT client\n",
+                       report.offered - report.delivered, report.strayAcknowledgements);
+                failed = true;
+            }
+        }
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,27 @@
+#ifndef HOST_HARDWARE_ADC
+#define HOST_HARDWARE_ADC
+
+/*
+ * Host stand-in for hardware/adc.h. Each input reads whatever the host program last set
+ * with host_adc_drive.
+ */
+
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    void adc_init(void);
+    void adc_gpio_init(uint gpio);
+    void adc_select_input(uint input);
+    uint16_t adc_read(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_HARDWARE_ADC */
@@ -0,0 +1,35 @@
+#ifndef HOST_HARDWARE_FLASH
+#define HOST_HARDWARE_FLASH
+
+/*
+ * Host stand-in for hardware/flash.h. Flash is an array in RAM that behaves like NOR flash,
+ * programming can only clear bits and erasing sets a whole sector back to 0xFF.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+
+#ifndef PICO_FLASH_SIZE_BYTES
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    extern uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+
+#define XIP_BASE ((uintptr_t)host_flash)
+
+    void flash_range_erase(uint32_t flash_offs, size_t count);
+    void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_HARDWARE_FLASH */
@@ -0,0 +1,31 @@
+#ifndef HOST_HARDWARE_IRQ
+#define HOST_HARDWARE_IRQ
+
+/*
+ * Host stand-in for hardware/irq.h. Handlers run on the host program's peripheral thread,
+ * concurrently with the node rather than interrupting it, so they must keep to what is
+ * safe from another core.
+ */
+
+#include <stdbool.h>
+
+typedef unsigned int uint;
+typedef void (*irq_handler_t)(void);
+
+#define IO_IRQ_BANK0 13
+#define UART0_IRQ 20
+#define UART1_IRQ 21
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+    void irq_set_enabled(uint num, bool enabled);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_HARDWARE_IRQ */
@@ -0,0 +1,63 @@
+#ifndef HOST_HARDWARE_PWM
+#define HOST_HARDWARE_PWM
+
+/*
+ * Host stand-in for hardware/pwm.h. The level of each pin is kept so the host program can read it.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef unsigned int uint;
+
+typedef struct
+{
+    float clkdiv;
+    uint16_t top;
+} pwm_config;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    static inline uint pwm_gpio_to_slice_num(uint gpio)
+    {
+        return (gpio >> 1u) & 7u;
+    }
+
+    static inline uint pwm_gpio_to_channel(uint gpio)
+    {
+        return gpio & 1u;
+    }
+
+    static inline pwm_config pwm_get_default_config(void)
+    {
+        pwm_config config = {1.0f, 0xFFFF};
+        return config;
+    }
+
+    static inline void pwm_config_set_clkdiv(pwm_config *config, float div)
+    {
+        config->clkdiv = div;
+    }
+
+    static inline void pwm_config_set_wrap(pwm_config *config, uint16_t wrap)
+    {
+        config->top = wrap;
+    }
+
+    static inline void pwm_init(uint slice_num, pwm_config *config, bool start)
+    {
+        (void)slice_num;
+        (void)config;
+        (void)start;
+    }
+
+    void pwm_set_gpio_level(uint gpio, uint16_t level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_HARDWARE_PWM */
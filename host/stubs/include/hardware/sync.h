@@ -0,0 +1,47 @@
+#ifndef HOST_HARDWARE_SYNC
+#define HOST_HARDWARE_SYNC
+
+/*
+ * Host stand-in for hardware/sync.h. Interrupts don't exist on the host, so disabling
+ * them does nothing. SEV and WFE share one event flag between all the threads.
+ */
+
+#include <stdint.h>
+
+#include "host_stubs.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    static inline void __dmb(void)
+    {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+
+    static inline void __sev(void)
+    {
+        host_sev();
+    }
+
+    static inline void __wfe(void)
+    {
+        host_wfe();
+    }
+
+    static inline uint32_t save_and_disable_interrupts(void)
+    {
+        return 0;
+    }
+
+    static inline void restore_interrupts(uint32_t status)
+    {
+        (void)status;
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_HARDWARE_SYNC */
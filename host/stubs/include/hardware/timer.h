@@ -0,0 +1,6 @@
+#ifndef HOST_HARDWARE_TIMER
+#define HOST_HARDWARE_TIMER
+
+#include "pico/stdlib.h"
+
+#endif /* HOST_HARDWARE_TIMER */
@@ -0,0 +1,48 @@
+#ifndef HOST_HARDWARE_UART
+#define HOST_HARDWARE_UART
+
+/*
+ * Host stand-in for hardware/uart.h. Bytes the host program sends with host_uart_receive
+ * go through a 32 byte FIFO, which overruns and drops them like the RP2040's when it isn't
+ * read in time.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef unsigned int uint;
+
+typedef struct uart_inst uart_inst_t;
+
+typedef enum
+{
+    UART_PARITY_NONE,
+    UART_PARITY_EVEN,
+    UART_PARITY_ODD
+} uart_parity_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    extern uart_inst_t *const host_uarts[2];
+
+#define uart0 (host_uarts[0])
+#define uart1 (host_uarts[1])
+
+    uint uart_init(uart_inst_t *uart, uint baudrate);
+    uint uart_set_baudrate(uart_inst_t *uart, uint baudrate);
+    void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts);
+    void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits, uart_parity_t parity);
+    void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled);
+    void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data, bool tx_needs_data);
+    bool uart_is_readable(uart_inst_t *uart);
+    char uart_getc(uart_inst_t *uart);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_HARDWARE_UART */
@@ -0,0 +1,223 @@
+/*
+ * File: host_stubs.h
+ * Project: host
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef HOST_STUBS
+#define HOST_STUBS
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "lwip/ip_addr.h"
+
+/*
+ * Hooks tying the Pico SDK and lwIP stand-ins to a host program.
+ * The stand-ins only cover what the libraries in lib/ use.
+ */
+
+struct udp_pcb;
+struct tcp_pcb;
+
+/**
+ * @brief Called when a file descriptor being watched by the network poll is ready
+ *
+ * @param fd
+ * @param events The poll events that are ready
+ * @param context
+ */
+typedef void (*HostNetworkWatch)(int fd, short events, void *context);
+
+/**
+ * @brief Sees every byte a TCP connection sends or receives, called with NULL data when it closes
+ */
+typedef void (*HostTcpObserver)(struct tcp_pcb *pcb, const void *data, size_t length, bool outbound);
+
+typedef struct
+{
+    uint32_t connects;
+    uint32_t failures;
+    uint64_t bytesSent;
+    uint64_t bytesReceived;
+} HostTcpCounters;
+
+typedef struct
+{
+    // Time charged to the clock for programming each page and erasing each sector
+    uint64_t programUs;
+    uint64_t eraseUs;
+} HostFlashTiming;
+
+typedef struct
+{
+    uint64_t programmedBytes;
+    uint64_t erasedBytes;
+} HostFlashCounters;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Hardware timer in microseconds. Provided by the host program so it can
+     * run on a virtual clock.
+     */
+    uint64_t host_time_us(void);
+
+    /**
+     * @brief Blocks for a number of microseconds. Provided by the host program.
+     */
+    void host_sleep_us(uint64_t us);
+
+    /**
+     * @brief Sends a datagram. Provided by the host program's network backend.
+     */
+    void host_udp_send(struct udp_pcb *pcb, const void *data, uint16_t length, const ip_addr_t *address, uint16_t port);
+
+    /**
+     * @brief Resolves a hostname. Provided by the host program's network backend.
+     *
+     * @return 0 on success
+     */
+    int host_dns_lookup(const char *hostname, ip_addr_t *address);
+
+    /**
+     * @brief Delivers a datagram to a pcb, calling its receive callback.
+     */
+    void host_udp_deliver(struct udp_pcb *pcb, const void *data, uint16_t length, const ip_addr_t *address, uint16_t port);
+
+    /**
+     * @brief Finds the pcb bound to a local port, used to deliver broadcasts.
+     */
+    struct udp_pcb *host_udp_find(uint16_t port);
+
+    /**
+     * @brief Fires all alarms that are due against host_time_us().
+     */
+    void host_alarm_poll(void);
+
+    /**
+     * @brief Get the host time the next alarm is due
+     *
+     * @return uint64_t Microseconds, or UINT64_MAX when there are no alarms
+     */
+    uint64_t host_alarm_next(void);
+
+    /**
+     * @brief Sets how long flash programs and erases take on the host clock
+     */
+    void host_flash_timing(HostFlashTiming timing);
+
+    /**
+     * @brief Cuts the power once a number of bytes have been programmed or erased.
+     * Every flash operation after that does nothing until host_flash_power_on is called.
+     */
+    void host_flash_tear_after(int64_t bytes);
+
+    bool host_flash_powered(void);
+
+    void host_flash_power_on(void);
+
+    /**
+     * @brief Erases all of the host flash and resets the counters
+     */
+    void host_flash_clear(void);
+
+    HostFlashCounters host_flash_counters(void);
+
+    /**
+     * @brief Sets the event flag and wakes any thread waiting in host_wfe, as SEV does
+     */
+    void host_sev(void);
+
+    /**
+     * @brief Waits for the event flag and clears it, returning at once if it was already set, as WFE does
+     */
+    void host_wfe(void);
+
+    /**
+     * @brief Adds a file descriptor to the ones the network poll waits on, replacing any watch of it
+     *
+     * @param fd
+     * @param events The poll events to wait for
+     * @param callback Called from cyw43_arch_poll when the descriptor is ready
+     * @param context Passed to the callback
+     */
+    void host_network_watch(int fd, short events, HostNetworkWatch callback, void *context);
+
+    void host_network_unwatch(int fd);
+
+    /**
+     * @brief Waits for a watched descriptor, a pending worker or the time, then services what is ready
+     *
+     * @param until Host time in microseconds
+     */
+    void host_network_wait(uint64_t until);
+
+    void host_tcp_observe(HostTcpObserver observer);
+
+    HostTcpCounters host_tcp_counters(void);
+
+    /**
+     * @brief Drives an input pin, raising its edge interrupt if one is enabled
+     */
+    void host_gpio_drive(uint32_t gpio, bool level);
+
+    /**
+     * @brief Get the level of a pin, as last put by the node or driven by the host program
+     */
+    bool host_gpio_level(uint32_t gpio);
+
+    /**
+     * @brief Get the level last set on a PWM pin
+     */
+    uint16_t host_pwm_level(uint32_t gpio);
+
+    /**
+     * @brief Sets the value an ADC input reads
+     */
+    void host_adc_drive(uint32_t input, uint16_t value);
+
+    /**
+     * @brief Receives bytes on a UART, as if they had come down the wire. Bytes that don't fit in
+     * the FIFO are dropped and counted as overruns.
+     *
+     * @return size_t The bytes that fitted
+     */
+    size_t host_uart_receive(uint32_t index, const void *data, size_t length);
+
+    uint32_t host_uart_overruns(uint32_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_STUBS */
@@ -0,0 +1,13 @@
+#ifndef HOST_LWIP_ARCH
+#define HOST_LWIP_ARCH
+
+#include <stdint.h>
+
+typedef uint8_t u8_t;
+typedef int8_t s8_t;
+typedef uint16_t u16_t;
+typedef int16_t s16_t;
+typedef uint32_t u32_t;
+typedef int32_t s32_t;
+
+#endif /* HOST_LWIP_ARCH */
@@ -0,0 +1,34 @@
+#ifndef HOST_LWIP_DHCP
+#define HOST_LWIP_DHCP
+
+/*
+ * Host stand-in for lwip/dhcp.h. The host's own address stands in for a lease, which is
+ * bound as soon as the interface comes up.
+ */
+
+#include "lwip/arch.h"
+#include "lwip/ip_addr.h"
+
+struct netif;
+
+struct dhcp
+{
+    u8_t state;
+    ip4_addr_t offered_ip_addr;
+    ip4_addr_t offered_sn_mask;
+    ip4_addr_t offered_gw_addr;
+    u32_t offered_t0_lease;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    void dhcp_release_and_stop(struct netif *netif);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_LWIP_DHCP */
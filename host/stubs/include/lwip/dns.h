@@ -0,0 +1,27 @@
+#ifndef HOST_LWIP_DNS
+#define HOST_LWIP_DNS
+
+/*
+ * Host stand-in for the lwIP DNS resolver. Lookups complete immediately through
+ * host_dns_lookup().
+ */
+
+#include "lwip/arch.h"
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *ipaddr, void *callback_arg);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    err_t dns_gethostbyname(const char *hostname, ip_addr_t *address, dns_found_callback found, void *callback_arg);
+    void dns_setserver(u8_t index, const ip_addr_t *server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_LWIP_DNS */
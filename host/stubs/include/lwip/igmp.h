@@ -0,0 +1,39 @@
+#ifndef HOST_LWIP_IGMP
+#define HOST_LWIP_IGMP
+
+/*
+ * Host stand-in for lwIP IGMP. Every datagram reaches the host program's network
+ * backend, so joining a group has nothing to do.
+ */
+
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+
+#ifndef LWIP_IGMP
+#define LWIP_IGMP 1
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    static inline err_t igmp_joingroup(const ip4_addr_t *ifaddr, const ip4_addr_t *groupaddr)
+    {
+        (void)ifaddr;
+        (void)groupaddr;
+        return ERR_OK;
+    }
+
+    static inline err_t igmp_leavegroup(const ip4_addr_t *ifaddr, const ip4_addr_t *groupaddr)
+    {
+        (void)ifaddr;
+        (void)groupaddr;
+        return ERR_OK;
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_LWIP_IGMP */
@@ -0,0 +1,15 @@
+#ifndef HOST_LWIP_IP4_ADDR
+#define HOST_LWIP_IP4_ADDR
+
+/*
+ * Host stand-in for lwip/ip4_addr.h. Addresses are IPv4 only on the host.
+ */
+
+#include "lwip/ip_addr.h"
+
+#define ip4_addr_isany_val(address) ((address).addr == 0)
+#define ip4_addr_isany(address) ((address) == NULL || (address)->addr == 0)
+#define ip_addr_copy_from_ip4(dest, src) ((dest).addr = (src).addr)
+#define ip4_addr_copy(dest, src) ((dest).addr = (src).addr)
+
+#endif /* HOST_LWIP_IP4_ADDR */
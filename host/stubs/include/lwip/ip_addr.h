@@ -0,0 +1,48 @@
+#ifndef HOST_LWIP_IP_ADDR
+#define HOST_LWIP_IP_ADDR
+
+/*
+ * Host stand-in for lwIP IPv4 addresses. Addresses are stored in network byte order
+ * like lwIP does.
+ */
+
+#include "lwip/arch.h"
+
+typedef struct ip4_addr
+{
+    u32_t addr;
+} ip4_addr_t;
+
+typedef ip4_addr_t ip_addr_t;
+
+#define IPADDR_TYPE_V4 0U
+#define IPADDR_TYPE_ANY 46U
+
+#define ip_addr_cmp(addr1, addr2) ((addr1)->addr == (addr2)->addr)
+#define ip4_addr_get_u32(address) ((address)->addr)
+#define ip4_addr_set_u32(address, value) ((address)->addr = (value))
+#define IP_GET_TYPE(address) IPADDR_TYPE_V4
+#define ip4_addr_ismulticast(address) (((address)->addr & 0x000000F0UL) == 0x000000E0UL)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    extern const ip_addr_t ip_addr_any;
+    extern const ip_addr_t ip_addr_broadcast;
+
+    char *ip4addr_ntoa(const ip4_addr_t *address);
+    int ip4addr_aton(const char *text, ip4_addr_t *address);
+    int ipaddr_aton(const char *text, ip_addr_t *address);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define IP_ADDR_ANY (&ip_addr_any)
+#define IP_ANY_TYPE (&ip_addr_any)
+#define IP4_ADDR_ANY4 (&ip_addr_any)
+#define IP_ADDR_BROADCAST (&ip_addr_broadcast)
+
+#endif /* HOST_LWIP_IP_ADDR */
@@ -0,0 +1,18 @@
+#ifndef HOST_LWIP_MEMP
+#define HOST_LWIP_MEMP
+
+/*
+ * Host stand-in for lwip/memp.h. Only the pools the libraries report on are listed.
+ */
+
+typedef enum
+{
+    MEMP_UDP_PCB,
+    MEMP_TCP_PCB,
+    MEMP_TCP_SEG,
+    MEMP_PBUF,
+    MEMP_PBUF_POOL,
+    MEMP_MAX
+} memp_t;
+
+#endif /* HOST_LWIP_MEMP */
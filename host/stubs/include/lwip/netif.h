@@ -0,0 +1,36 @@
+#ifndef HOST_LWIP_NETIF
+#define HOST_LWIP_NETIF
+
+/*
+ * Host stand-in for lwip/netif.h
+ */
+
+#include "lwip/arch.h"
+#include "lwip/ip_addr.h"
+#include "lwip/dhcp.h"
+
+struct netif
+{
+    ip4_addr_t ip_addr;
+    ip4_addr_t netmask;
+    ip4_addr_t gw;
+    struct dhcp *dhcp;
+};
+
+#define netif_ip4_addr(netif) ((const ip4_addr_t *)&((netif)->ip_addr))
+#define netif_ip4_netmask(netif) ((const ip4_addr_t *)&((netif)->netmask))
+#define netif_ip4_gw(netif) ((const ip4_addr_t *)&((netif)->gw))
+#define netif_dhcp_data(netif) ((netif)->dhcp)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    void netif_set_addr(struct netif *netif, const ip4_addr_t *ipaddr, const ip4_addr_t *netmask, const ip4_addr_t *gw);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_LWIP_NETIF */
@@ -0,0 +1,53 @@
+#ifndef HOST_LWIP_PBUF
+#define HOST_LWIP_PBUF
+
+/*
+ * Host stand-in for lwIP packet buffers. Every pbuf is a single contiguous allocation,
+ * and received TCP data is chained as lwIP does.
+ */
+
+#include "lwip/arch.h"
+#include "lwip/err.h"
+
+typedef enum
+{
+    PBUF_TRANSPORT,
+    PBUF_IP,
+    PBUF_LINK,
+    PBUF_RAW
+} pbuf_layer;
+
+typedef enum
+{
+    PBUF_RAM,
+    PBUF_ROM,
+    PBUF_REF,
+    PBUF_POOL
+} pbuf_type;
+
+struct pbuf
+{
+    struct pbuf *next;
+    void *payload;
+    u16_t tot_len;
+    u16_t len;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type);
+    u8_t pbuf_free(struct pbuf *p);
+    u8_t pbuf_get_at(const struct pbuf *p, u16_t offset);
+    u16_t pbuf_copy_partial(const struct pbuf *p, void *data, u16_t length, u16_t offset);
+    err_t pbuf_take(struct pbuf *p, const void *data, u16_t length);
+    void pbuf_cat(struct pbuf *head, struct pbuf *tail);
+    struct pbuf *pbuf_free_header(struct pbuf *q, u16_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_LWIP_PBUF */
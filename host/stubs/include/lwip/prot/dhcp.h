@@ -0,0 +1,25 @@
+#ifndef HOST_LWIP_PROT_DHCP
+#define HOST_LWIP_PROT_DHCP
+
+/*
+ * Host stand-in for lwip/prot/dhcp.h
+ */
+
+typedef enum
+{
+    DHCP_STATE_OFF = 0,
+    DHCP_STATE_REQUESTING = 1,
+    DHCP_STATE_INIT = 2,
+    DHCP_STATE_REBOOTING = 3,
+    DHCP_STATE_REBINDING = 4,
+    DHCP_STATE_RENEWING = 5,
+    DHCP_STATE_SELECTING = 6,
+    DHCP_STATE_INFORMING = 7,
+    DHCP_STATE_CHECKING = 8,
+    DHCP_STATE_PERMANENT = 9,
+    DHCP_STATE_BOUND = 10,
+    DHCP_STATE_RELEASING = 11,
+    DHCP_STATE_BACKING_OFF = 12
+} dhcp_state_enum_t;
+
+#endif /* HOST_LWIP_PROT_DHCP */
@@ -0,0 +1,39 @@
+#ifndef HOST_LWIP_STATS
+#define HOST_LWIP_STATS
+
+/*
+ * Host stand-in for lwip/stats.h. The host stack only counts its TCP pcbs, the rest stay zero.
+ */
+
+#include "lwip/arch.h"
+#include "lwip/memp.h"
+
+typedef u32_t mem_size_t;
+
+struct stats_mem
+{
+    u16_t err;
+    mem_size_t avail;
+    mem_size_t used;
+    mem_size_t max;
+    u16_t illegal;
+};
+
+struct stats_
+{
+    struct stats_mem mem;
+    struct stats_mem *memp[MEMP_MAX];
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    extern struct stats_ lwip_stats;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_LWIP_STATS */
@@ -0,0 +1,85 @@
+#ifndef HOST_LWIP_TCP
+#define HOST_LWIP_TCP
+
+/*
+ * Host stand-in for the lwIP raw TCP API, carried over a non-blocking POSIX socket.
+ * The callbacks keep lwIP's contract: they are only called while the network is polled,
+ * the error callback means the pcb is already gone, and received data is held against
+ * a TCP_WND sized window until tcp_recved opens it again.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lwip/arch.h"
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+
+#define SOF_KEEPALIVE 0x08U
+#define TCP_WRITE_FLAG_COPY 0x01
+#define TCP_WRITE_FLAG_MORE 0x02
+
+struct tcp_pcb;
+
+typedef err_t (*tcp_connected_fn)(void *arg, struct tcp_pcb *tpcb, err_t err);
+typedef err_t (*tcp_recv_fn)(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
+typedef err_t (*tcp_sent_fn)(void *arg, struct tcp_pcb *tpcb, u16_t len);
+typedef err_t (*tcp_poll_fn)(void *arg, struct tcp_pcb *tpcb);
+typedef void (*tcp_err_fn)(void *arg, err_t err);
+
+struct tcp_pcb
+{
+    u8_t so_options;
+    u32_t keep_idle;
+    u32_t keep_intvl;
+
+    void *callback_arg;
+    tcp_connected_fn connected;
+    tcp_recv_fn recv;
+    tcp_sent_fn sent;
+    tcp_poll_fn poll;
+    tcp_err_fn errf;
+    u8_t pollinterval;
+
+    // Host side of the connection
+    int socket;
+    u8_t state;
+    // Data taken by tcp_write that the socket hasn't accepted yet
+    u8_t *unsent;
+    size_t unsentLength;
+    // Accepted by the socket and not yet reported through the sent callback
+    size_t acknowledged;
+    // Receive window left before tcp_recved is called
+    u32_t window;
+    // Data the receive callback refused, offered again on the next poll
+    struct pbuf *refused;
+    uint64_t nextPoll;
+    struct tcp_pcb *next;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    struct tcp_pcb *tcp_new(void);
+    struct tcp_pcb *tcp_new_ip_type(u8_t type);
+    void tcp_arg(struct tcp_pcb *pcb, void *arg);
+    void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv);
+    void tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent);
+    void tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval);
+    void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err);
+    err_t tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *address, u16_t port, tcp_connected_fn connected);
+    err_t tcp_write(struct tcp_pcb *pcb, const void *data, u16_t length, u8_t flags);
+    err_t tcp_output(struct tcp_pcb *pcb);
+    void tcp_recved(struct tcp_pcb *pcb, u16_t length);
+    u16_t tcp_sndbuf(struct tcp_pcb *pcb);
+    err_t tcp_close(struct tcp_pcb *pcb);
+    void tcp_abort(struct tcp_pcb *pcb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_LWIP_TCP */
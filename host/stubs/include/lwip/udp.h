@@ -0,0 +1,42 @@
+#ifndef HOST_LWIP_UDP
+#define HOST_LWIP_UDP
+
+/*
+ * Host stand-in for the lwIP raw UDP API. Datagrams are handed to host_udp_send()
+ * and arrive through host_udp_deliver().
+ */
+
+#include "lwip/arch.h"
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+
+struct udp_pcb;
+
+typedef void (*udp_recv_fn)(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port);
+
+struct udp_pcb
+{
+    u16_t local_port;
+    udp_recv_fn recv;
+    void *recv_arg;
+    struct udp_pcb *next;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    struct udp_pcb *udp_new_ip_type(u8_t type);
+    struct udp_pcb *udp_new(void);
+    void udp_remove(struct udp_pcb *pcb);
+    err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *address, u16_t port);
+    void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *recv_arg);
+    err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *address, u16_t port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_LWIP_UDP */
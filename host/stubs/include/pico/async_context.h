@@ -0,0 +1,40 @@
+#ifndef HOST_PICO_ASYNC_CONTEXT
+#define HOST_PICO_ASYNC_CONTEXT
+
+/*
+ * Host stand-in for pico/async_context.h. Only the when pending workers are supported,
+ * marking one pending wakes the thread waiting in cyw43_arch_wait_for_work_until and its
+ * work runs on the next poll.
+ */
+
+#include <stdbool.h>
+
+typedef struct async_context async_context_t;
+typedef struct async_when_pending_worker async_when_pending_worker_t;
+
+struct async_when_pending_worker
+{
+    async_when_pending_worker_t *next;
+    void (*do_work)(async_context_t *context, async_when_pending_worker_t *worker);
+    volatile bool work_pending;
+    void *user_data;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    bool async_context_add_when_pending_worker(async_context_t *context, async_when_pending_worker_t *worker);
+    bool async_context_remove_when_pending_worker(async_context_t *context, async_when_pending_worker_t *worker);
+
+    /**
+     * @brief Safe from any thread, as it is from any core or interrupt on the Pico
+     */
+    void async_context_set_work_pending(async_context_t *context, async_when_pending_worker_t *worker);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_PICO_ASYNC_CONTEXT */
@@ -0,0 +1,79 @@
+#ifndef HOST_PICO_CYW43_ARCH
+#define HOST_PICO_CYW43_ARCH
+
+/*
+ * Host stand-in for pico/cyw43_arch.h in poll mode. The host's network is always in range:
+ * a join associates straight away and the interface takes the host's loopback address, as
+ * if DHCP had bound it. Polling services the TCP sockets, datagrams and alarms.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "pico/stdlib.h"
+#include "pico/async_context.h"
+#include "lwip/netif.h"
+
+#define CYW43_ITF_STA 0
+#define CYW43_ITF_AP 1
+
+#define CYW43_LINK_DOWN (0)
+#define CYW43_LINK_JOIN (1)
+#define CYW43_LINK_NOIP (2)
+#define CYW43_LINK_UP (3)
+#define CYW43_LINK_FAIL (-1)
+#define CYW43_LINK_NONET (-2)
+#define CYW43_LINK_BADAUTH (-3)
+
+#define CYW43_AUTH_OPEN (0)
+#define CYW43_AUTH_WPA_TKIP_PSK (0x00200002)
+#define CYW43_AUTH_WPA2_AES_PSK (0x00400004)
+#define CYW43_AUTH_WPA2_MIXED_PSK (0x00400006)
+
+#define CYW43_CHANNEL_NONE (0xffffffff)
+
+typedef struct _cyw43_t
+{
+    struct netif netif[2];
+    int link_status;
+} cyw43_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    extern cyw43_t cyw43_state;
+
+    int cyw43_arch_init(void);
+    void cyw43_arch_deinit(void);
+    void cyw43_arch_enable_sta_mode(void);
+    void cyw43_arch_poll(void);
+    void cyw43_arch_wait_for_work_until(absolute_time_t until);
+    async_context_t *cyw43_arch_async_context(void);
+
+    static inline void cyw43_arch_lwip_begin(void)
+    {
+    }
+
+    static inline void cyw43_arch_lwip_end(void)
+    {
+    }
+
+    static inline void cyw43_arch_lwip_check(void)
+    {
+    }
+
+    int cyw43_wifi_join(cyw43_t *self, size_t ssid_len, const uint8_t *ssid, size_t key_len, const uint8_t *key,
+                        uint32_t auth_type, const uint8_t *bssid, uint32_t channel);
+    int cyw43_wifi_leave(cyw43_t *self, int itf);
+    int cyw43_wifi_link_status(cyw43_t *self, int itf);
+    int cyw43_tcpip_link_status(cyw43_t *self, int itf);
+    int cyw43_wifi_get_bssid(cyw43_t *self, uint8_t bssid[6]);
+    int cyw43_ioctl(cyw43_t *self, uint32_t cmd, size_t len, uint8_t *buf, uint32_t iface);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_PICO_CYW43_ARCH */
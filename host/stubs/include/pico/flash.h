@@ -0,0 +1,30 @@
+#ifndef HOST_PICO_FLASH
+#define HOST_PICO_FLASH
+
+/*
+ * Host stand-in for pico/flash.h. There is no other core to pause, so the function is just called.
+ */
+
+#include <stdint.h>
+
+#ifndef PICO_OK
+#define PICO_OK 0
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    static inline int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms)
+    {
+        (void)enter_exit_timeout_ms;
+        func(param);
+        return PICO_OK;
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_PICO_FLASH */
@@ -0,0 +1,25 @@
+#ifndef HOST_PICO_MULTICORE
+#define HOST_PICO_MULTICORE
+
+/*
+ * Host stand-in for pico/multicore.h. Core 1 is a thread. Flash writes don't stop it, the
+ * host flash is plain memory.
+ */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    void multicore_launch_core1(void (*entry)(void));
+    void multicore_reset_core1(void);
+
+    static inline void multicore_lockout_victim_init(void)
+    {
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_PICO_MULTICORE */
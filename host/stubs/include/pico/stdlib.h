@@ -0,0 +1,94 @@
+#ifndef HOST_PICO_STDLIB
+#define HOST_PICO_STDLIB
+
+/*
+ * Host stand-in for the parts of pico/stdlib.h used by lib/.
+ * Time is read from host_time_us() so programs can run on a virtual clock.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_stubs.h"
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void *user_data);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    static inline uint64_t time_us_64(void)
+    {
+        return host_time_us();
+    }
+
+    static inline uint32_t time_us_32(void)
+    {
+        return (uint32_t)host_time_us();
+    }
+
+    static inline uint32_t us_to_ms(uint64_t us)
+    {
+        return (uint32_t)(us / 1000u);
+    }
+
+    static inline absolute_time_t get_absolute_time(void)
+    {
+        return host_time_us();
+    }
+
+    static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to)
+    {
+        return (int64_t)(to - from);
+    }
+
+    static inline uint64_t to_us_since_boot(absolute_time_t t)
+    {
+        return t;
+    }
+
+    static inline absolute_time_t make_timeout_time_ms(uint32_t ms)
+    {
+        return host_time_us() + ((uint64_t)ms * 1000u);
+    }
+
+    static inline absolute_time_t make_timeout_time_us(uint64_t us)
+    {
+        return host_time_us() + us;
+    }
+
+    static inline absolute_time_t from_us_since_boot(uint64_t us)
+    {
+        return us;
+    }
+
+    static inline bool stdio_init_all(void)
+    {
+        return true;
+    }
+
+    static inline void tight_loop_contents(void)
+    {
+    }
+
+    alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void *user_data, bool fire_if_past);
+    bool cancel_alarm(alarm_id_t alarm_id);
+
+    void sleep_ms(uint32_t ms);
+    void sleep_us(uint64_t us);
+    uint32_t get_rand_32(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_PICO_STDLIB */
@@ -0,0 +1,118 @@
+/*
+ * Host stand-in for the Pico SDK flash functions, with the timing of a typical QSPI NOR
+ * part charged to the virtual clock and a way to cut the power part way through a write.
+ */
+
+#include "hardware/flash.h"
+#include "host_stubs.h"
+
+#include <string.h>
+
+uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+
+// Typical page program and sector erase times of a W25Q16JV
+static HostFlashTiming timing = {.programUs = 400, .eraseUs = 45000};
+static HostFlashCounters counters = {};
+
+// Flash starts out erased, as it would from the factory
+static struct HostFlashInit
+{
+    HostFlashInit()
+    {
+        memset(host_flash, 0xFF, sizeof(host_flash));
+    }
+} hostFlashInit;
+
+// Bytes left before the power is cut, or -1 while the power is on
+static int64_t tearAfter = -1;
+
+static bool powered()
+{
+    return tearAfter != 0;
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count)
+{
+    if (!powered() || flash_offs % FLASH_SECTOR_SIZE != 0 || count % FLASH_SECTOR_SIZE != 0 ||
+        flash_offs + count > PICO_FLASH_SIZE_BYTES)
+    {
+        return;
+    }
+
+    for (size_t sector = 0; sector < count; sector += FLASH_SECTOR_SIZE)
+    {
+        // A torn erase leaves the sector half erased
+        size_t length = FLASH_SECTOR_SIZE;
+        if (tearAfter > 0 && (size_t)tearAfter < length)
+        {
+            length = (size_t)tearAfter;
+        }
+
+        memset(&host_flash[flash_offs + sector], 0xFF, length);
+        counters.erasedBytes += length;
+        host_sleep_us(timing.eraseUs);
+
+        if (tearAfter > 0)
+        {
+            tearAfter -= length;
+            if (!powered())
+            {
+                return;
+            }
+        }
+    }
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count)
+{
+    if (!powered() || flash_offs % FLASH_PAGE_SIZE != 0 || count % FLASH_PAGE_SIZE != 0 ||
+        flash_offs + count > PICO_FLASH_SIZE_BYTES)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (tearAfter > 0 && tearAfter-- == 1)
+        {
+            host_flash[flash_offs + i] &= data[i];
+            counters.programmedBytes += i + 1;
+            return;
+        }
+        host_flash[flash_offs + i] &= data[i];
+    }
+
+    counters.programmedBytes += count;
+    host_sleep_us(timing.programUs * (count / FLASH_PAGE_SIZE));
+}
+
+void host_flash_timing(HostFlashTiming flashTiming)
+{
+    timing = flashTiming;
+}
+
+void host_flash_tear_after(int64_t bytes)
+{
+    tearAfter = bytes;
+}
+
+bool host_flash_powered(void)
+{
+    return powered();
+}
+
+void host_flash_power_on(void)
+{
+    tearAfter = -1;
+}
+
+void host_flash_clear(void)
+{
+    memset(host_flash, 0xFF, sizeof(host_flash));
+    counters = {};
+}
+
+HostFlashCounters host_flash_counters(void)
+{
+    return counters;
+}
@@ -0,0 +1,221 @@
+/*
+ * Host stand-in for the lwIP pbuf, UDP and DNS functions.
+ */
+
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include "lwip/dns.h"
+#include "host_stubs.h"
+
+#include <arpa/inet.h>
+#include <stdlib.h>
+#include <string.h>
+
+const ip_addr_t ip_addr_any = {0};
+const ip_addr_t ip_addr_broadcast = {0xFFFFFFFF};
+
+static struct udp_pcb *pcbs = NULL;
+
+char *ip4addr_ntoa(const ip4_addr_t *address)
+{
+    static char buffer[INET_ADDRSTRLEN];
+    struct in_addr in = {address->addr};
+    return (char *)inet_ntop(AF_INET, &in, buffer, sizeof(buffer));
+}
+
+int ip4addr_aton(const char *text, ip4_addr_t *address)
+{
+    struct in_addr in;
+    if (inet_pton(AF_INET, text, &in) != 1)
+    {
+        return 0;
+    }
+    address->addr = in.s_addr;
+    return 1;
+}
+
+int ipaddr_aton(const char *text, ip_addr_t *address)
+{
+    return ip4addr_aton(text, address);
+}
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
+{
+    struct pbuf *p = (struct pbuf *)malloc(sizeof(struct pbuf) + length);
+
+    p->next = NULL;
+    p->payload = (uint8_t *)p + sizeof(struct pbuf);
+    p->tot_len = p->len = length;
+
+    return p;
+}
+
+u8_t pbuf_free(struct pbuf *p)
+{
+    u8_t count = 0;
+    while (p != NULL)
+    {
+        struct pbuf *next = p->next;
+        free(p);
+        p = next;
+        count++;
+    }
+    return count;
+}
+
+u8_t pbuf_get_at(const struct pbuf *p, u16_t offset)
+{
+    while (p != NULL && offset >= p->len)
+    {
+        offset -= p->len;
+        p = p->next;
+    }
+    return p != NULL ? ((const uint8_t *)p->payload)[offset] : 0;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf *p, void *data, u16_t length, u16_t offset)
+{
+    u16_t copied = 0;
+
+    for (; p != NULL && copied < length; p = p->next)
+    {
+        if (offset >= p->len)
+        {
+            offset -= p->len;
+            continue;
+        }
+
+        u16_t chunk = p->len - offset;
+        chunk = chunk < (length - copied) ? chunk : (length - copied);
+        memcpy((uint8_t *)data + copied, (const uint8_t *)p->payload + offset, chunk);
+        copied += chunk;
+        offset = 0;
+    }
+    return copied;
+}
+
+void pbuf_cat(struct pbuf *head, struct pbuf *tail)
+{
+    struct pbuf *p = head;
+    for (; p->next != NULL; p = p->next)
+    {
+        p->tot_len += tail->tot_len;
+    }
+    p->tot_len += tail->tot_len;
+    p->next = tail;
+}
+
+struct pbuf *pbuf_free_header(struct pbuf *q, u16_t size)
+{
+    // Whole pbufs are freed, the first one left is trimmed
+    while (q != NULL && size >= q->len)
+    {
+        struct pbuf *next = q->next;
+        size -= q->len;
+        q->next = NULL;
+        free(q);
+        q = next;
+    }
+
+    if (q != NULL && size > 0)
+    {
+        q->payload = (uint8_t *)q->payload + size;
+        q->len -= size;
+        q->tot_len -= size;
+    }
+    return q;
+}
+
+err_t pbuf_take(struct pbuf *p, const void *data, u16_t length)
+{
+    if (length > p->len)
+    {
+        return ERR_ARG;
+    }
+    memcpy(p->payload, data, length);
+    return ERR_OK;
+}
+
+struct udp_pcb *udp_new_ip_type(u8_t type)
+{
+    struct udp_pcb *pcb = (struct udp_pcb *)calloc(1, sizeof(struct udp_pcb));
+    pcb->next = pcbs;
+    pcbs = pcb;
+    return pcb;
+}
+
+struct udp_pcb *udp_new(void)
+{
+    return udp_new_ip_type(IPADDR_TYPE_V4);
+}
+
+void udp_remove(struct udp_pcb *pcb)
+{
+    for (struct udp_pcb **current = &pcbs; *current != NULL; current = &(*current)->next)
+    {
+        if (*current == pcb)
+        {
+            *current = pcb->next;
+            break;
+        }
+    }
+    free(pcb);
+}
+
+err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *address, u16_t port)
+{
+    pcb->local_port = port;
+    return ERR_OK;
+}
+
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *recv_arg)
+{
+    pcb->recv = recv;
+    pcb->recv_arg = recv_arg;
+}
+
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *address, u16_t port)
+{
+    host_udp_send(pcb, p->payload, p->len, address, port);
+    return ERR_OK;
+}
+
+struct udp_pcb *host_udp_find(uint16_t port)
+{
+    for (struct udp_pcb *pcb = pcbs; pcb != NULL; pcb = pcb->next)
+    {
+        if (pcb->local_port == port)
+        {
+            return pcb;
+        }
+    }
+    return NULL;
+}
+
+void host_udp_deliver(struct udp_pcb *pcb, const void *data, uint16_t length, const ip_addr_t *address, uint16_t port)
+{
+    if (pcb == NULL || pcb->recv == NULL)
+    {
+        return;
+    }
+
+    // Ownership of the pbuf passes to the receive callback, as with lwIP
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, length, PBUF_RAM);
+    memcpy(p->payload, data, length);
+    pcb->recv(pcb->recv_arg, pcb, p, address, port);
+}
+
+void dns_setserver(u8_t index, const ip_addr_t *server)
+{
+    (void)index;
+    (void)server;
+}
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *address, dns_found_callback found, void *callback_arg)
+{
+    if (ip4addr_aton(hostname, address) || host_dns_lookup(hostname, address) == 0)
+    {
+        return ERR_OK;
+    }
+    return ERR_ARG;
+}
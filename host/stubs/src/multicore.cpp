@@ -0,0 +1,41 @@
+/*
+ * Host stand-in for core 1 and the event flag SEV and WFE share between the cores.
+ */
+
+#include "pico/multicore.h"
+#include "host_stubs.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+static std::mutex eventLock;
+static std::condition_variable eventSignal;
+static bool eventFlag = false;
+
+void multicore_launch_core1(void (*entry)(void))
+{
+    std::thread(entry).detach();
+}
+
+void multicore_reset_core1(void)
+{
+    // A thread can't be stopped from outside, core 1 keeps running until the process exits
+}
+
+void host_sev(void)
+{
+    {
+        std::lock_guard<std::mutex> guard(eventLock);
+        eventFlag = true;
+    }
+    eventSignal.notify_all();
+}
+
+void host_wfe(void)
+{
+    std::unique_lock<std::mutex> guard(eventLock);
+    eventSignal.wait(guard, []
+                     { return eventFlag; });
+    eventFlag = false;
+}
@@ -0,0 +1,326 @@
+/*
+ * Host stand-in for the cyw43 driver in poll mode, its async context and the lwIP network
+ * interface. Waiting and polling go through one ppoll over every watched descriptor, with a
+ * pipe that pending workers write to so another thread can end the wait.
+ */
+
+#include "pico/cyw43_arch.h"
+#include "lwip/netif.h"
+#include "lwip/dhcp.h"
+#include "lwip/prot/dhcp.h"
+#include "lwip/stats.h"
+#include "host_stubs.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+#define CYW43_IOCTL_GET_CHANNEL 0x3a
+#define HOST_CHANNEL 6
+// A day, the lease the host's address is bound with
+#define HOST_LEASE_S 86400
+
+struct async_context
+{
+    async_when_pending_worker_t *workers;
+};
+
+typedef struct
+{
+    int fd;
+    short events;
+    HostNetworkWatch callback;
+    void *context;
+} HostWatch;
+
+cyw43_t cyw43_state = {};
+
+static struct stats_mem mempStats[MEMP_MAX] = {};
+struct stats_ lwip_stats = {
+    .mem = {},
+    .memp = {&mempStats[0], &mempStats[1], &mempStats[2], &mempStats[3], &mempStats[4]}};
+
+static async_context context = {};
+static std::vector<HostWatch> watches;
+static int wakePipe[2] = {-1, -1};
+
+static struct dhcp staDhcp = {};
+static bool joined = false;
+
+static const uint8_t hostBssid[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+
+static void openWakePipe()
+{
+    if (wakePipe[0] >= 0)
+    {
+        return;
+    }
+    if (pipe(wakePipe) == 0)
+    {
+        fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+    }
+}
+
+static bool workPending()
+{
+    for (async_when_pending_worker_t *worker = context.workers; worker != NULL; worker = worker->next)
+    {
+        if (worker->work_pending)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Waits on the watched descriptors and the wake pipe until one is ready or the time is up
+ *
+ * @param until Host time in microseconds
+ * @param ready Filled with the ready descriptors
+ */
+static void waitReady(uint64_t until, std::vector<struct pollfd> *ready)
+{
+    openWakePipe();
+
+    std::vector<struct pollfd> fds;
+    fds.push_back({.fd = wakePipe[0], .events = POLLIN, .revents = 0});
+    for (auto &watch : watches)
+    {
+        fds.push_back({.fd = watch.fd, .events = watch.events, .revents = 0});
+    }
+
+    // Alarms interrupt the wait on the Pico, here the wait ends when the next one is due
+    uint64_t alarm = host_alarm_next();
+    until = alarm < until ? alarm : until;
+
+    uint64_t now = host_time_us();
+    uint64_t wait = until > now && !workPending() ? until - now : 0;
+    struct timespec timeout = {.tv_sec = (time_t)(wait / 1000000), .tv_nsec = (long)(wait % 1000000) * 1000};
+
+    int count = ppoll(fds.data(), fds.size(), &timeout, NULL);
+    if (count <= 0)
+    {
+        return;
+    }
+
+    if (fds[0].revents & POLLIN)
+    {
+        char drain[64];
+        while (read(wakePipe[0], drain, sizeof(drain)) > 0)
+        {
+        }
+    }
+
+    for (size_t i = 1; i < fds.size(); i++)
+    {
+        if (fds[i].revents != 0)
+        {
+            ready->push_back(fds[i]);
+        }
+    }
+}
+
+/**
+ * @brief Calls the watches of the ready descriptors, fires due alarms and runs pending workers
+ */
+static void service(const std::vector<struct pollfd> &ready)
+{
+    for (auto &fd : ready)
+    {
+        // A callback can add or remove watches, so each is looked up again
+        for (auto &watch : watches)
+        {
+            if (watch.fd == fd.fd)
+            {
+                HostWatch current = watch;
+                current.callback(fd.fd, fd.revents, current.context);
+                break;
+            }
+        }
+    }
+
+    host_alarm_poll();
+
+    for (async_when_pending_worker_t *worker = context.workers; worker != NULL; worker = worker->next)
+    {
+        if (worker->work_pending)
+        {
+            worker->work_pending = false;
+            worker->do_work(&context, worker);
+        }
+    }
+}
+
+void host_network_watch(int fd, short events, HostNetworkWatch callback, void *context)
+{
+    for (auto &watch : watches)
+    {
+        if (watch.fd == fd)
+        {
+            watch = {fd, events, callback, context};
+            return;
+        }
+    }
+    watches.push_back({fd, events, callback, context});
+}
+
+void host_network_unwatch(int fd)
+{
+    for (auto iterator = watches.begin(); iterator != watches.end(); iterator++)
+    {
+        if (iterator->fd == fd)
+        {
+            watches.erase(iterator);
+            return;
+        }
+    }
+}
+
+void host_network_wait(uint64_t until)
+{
+    std::vector<struct pollfd> ready;
+    waitReady(until, &ready);
+    service(ready);
+}
+
+bool async_context_add_when_pending_worker(async_context_t *context, async_when_pending_worker_t *worker)
+{
+    worker->next = context->workers;
+    context->workers = worker;
+    return true;
+}
+
+bool async_context_remove_when_pending_worker(async_context_t *context, async_when_pending_worker_t *worker)
+{
+    for (async_when_pending_worker_t **current = &context->workers; *current != NULL; current = &(*current)->next)
+    {
+        if (*current == worker)
+        {
+            *current = worker->next;
+            return true;
+        }
+    }
+    return false;
+}
+
+void async_context_set_work_pending(async_context_t *context, async_when_pending_worker_t *worker)
+{
+    worker->work_pending = true;
+    if (wakePipe[1] >= 0)
+    {
+        char wake = 1;
+        // A full pipe already wakes the wait
+        (void)!write(wakePipe[1], &wake, 1);
+    }
+}
+
+int cyw43_arch_init(void)
+{
+    openWakePipe();
+    cyw43_state.netif[CYW43_ITF_STA].dhcp = &staDhcp;
+    return 0;
+}
+
+void cyw43_arch_deinit(void)
+{
+}
+
+void cyw43_arch_enable_sta_mode(void)
+{
+}
+
+void cyw43_arch_poll(void)
+{
+    host_network_wait(0);
+}
+
+void cyw43_arch_wait_for_work_until(absolute_time_t until)
+{
+    // Only waits, what became ready is serviced by the next poll as on the Pico
+    std::vector<struct pollfd> ready;
+    waitReady(until, &ready);
+}
+
+async_context_t *cyw43_arch_async_context(void)
+{
+    return &context;
+}
+
+int cyw43_wifi_join(cyw43_t *self, size_t ssid_len, const uint8_t *ssid, size_t key_len, const uint8_t *key,
+                    uint32_t auth_type, const uint8_t *bssid, uint32_t channel)
+{
+    struct netif *netif = &self->netif[CYW43_ITF_STA];
+
+    joined = true;
+    self->link_status = CYW43_LINK_JOIN;
+
+    // The host's loopback address stands in for the lease, unless an address was set by hand
+    if (staDhcp.state != DHCP_STATE_OFF || ip4_addr_get_u32(netif_ip4_addr(netif)) == 0)
+    {
+        ip4addr_aton("127.0.0.1", &staDhcp.offered_ip_addr);
+        ip4addr_aton("255.0.0.0", &staDhcp.offered_sn_mask);
+        ip4addr_aton("127.0.0.1", &staDhcp.offered_gw_addr);
+        staDhcp.offered_t0_lease = HOST_LEASE_S;
+        staDhcp.state = DHCP_STATE_BOUND;
+        netif_set_addr(netif, &staDhcp.offered_ip_addr, &staDhcp.offered_sn_mask, &staDhcp.offered_gw_addr);
+    }
+    return 0;
+}
+
+int cyw43_wifi_leave(cyw43_t *self, int itf)
+{
+    joined = false;
+    self->link_status = CYW43_LINK_DOWN;
+    return 0;
+}
+
+int cyw43_wifi_link_status(cyw43_t *self, int itf)
+{
+    return joined ? CYW43_LINK_JOIN : CYW43_LINK_DOWN;
+}
+
+int cyw43_tcpip_link_status(cyw43_t *self, int itf)
+{
+    if (!joined)
+    {
+        return CYW43_LINK_DOWN;
+    }
+    return ip4_addr_get_u32(netif_ip4_addr(&self->netif[itf])) != 0 ? CYW43_LINK_UP : CYW43_LINK_NOIP;
+}
+
+int cyw43_wifi_get_bssid(cyw43_t *self, uint8_t bssid[6])
+{
+    memcpy(bssid, hostBssid, sizeof(hostBssid));
+    return 0;
+}
+
+int cyw43_ioctl(cyw43_t *self, uint32_t cmd, size_t len, uint8_t *buf, uint32_t iface)
+{
+    if (cmd == CYW43_IOCTL_GET_CHANNEL && len >= sizeof(uint32_t))
+    {
+        uint32_t channel = HOST_CHANNEL;
+        memcpy(buf, &channel, sizeof(channel));
+    }
+    return 0;
+}
+
+void netif_set_addr(struct netif *netif, const ip4_addr_t *ipaddr, const ip4_addr_t *netmask, const ip4_addr_t *gw)
+{
+    netif->ip_addr = *ipaddr;
+    netif->netmask = *netmask;
+    netif->gw = *gw;
+}
+
+void dhcp_release_and_stop(struct netif *netif)
+{
+    if (netif->dhcp != NULL)
+    {
+        netif->dhcp->state = DHCP_STATE_OFF;
+    }
+}
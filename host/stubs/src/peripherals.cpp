@@ -0,0 +1,284 @@
+/*
+ * Host stand-in for the GPIO, ADC, PWM and UART peripherals and their interrupts.
+ * Interrupt handlers are called on the thread of the host program that drove the input,
+ * outside the lock, so a handler can read the peripheral that raised it.
+ */
+
+#include "hardware/adc.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#include "hardware/uart.h"
+#include "host_stubs.h"
+
+#include <mutex>
+
+#define HOST_ADC_INPUTS 5
+#define HOST_IRQS 32
+// Depth of the RP2040's UART receive FIFO
+#define HOST_UART_FIFO 32
+
+struct uart_inst
+{
+    uint8_t fifo[HOST_UART_FIFO];
+    size_t head;
+    size_t count;
+    uint32_t overruns;
+    bool rxInterrupt;
+    uint irq;
+};
+
+static uart_inst hostUarts[2] = {{{}, 0, 0, 0, false, UART0_IRQ}, {{}, 0, 0, 0, false, UART1_IRQ}};
+uart_inst_t *const host_uarts[2] = {&hostUarts[0], &hostUarts[1]};
+
+static std::mutex lock;
+
+static bool levels[NUM_BANK0_GPIOS] = {};
+static bool outputs[NUM_BANK0_GPIOS] = {};
+static uint32_t irqMasks[NUM_BANK0_GPIOS] = {};
+static gpio_irq_callback_t gpioCallback = NULL;
+static uint16_t pwmLevels[NUM_BANK0_GPIOS] = {};
+static uint16_t adcValues[HOST_ADC_INPUTS] = {};
+static uint adcInput = 0;
+static irq_handler_t irqHandlers[HOST_IRQS] = {};
+static bool irqEnabled[HOST_IRQS] = {};
+
+/**
+ * @brief Get the handler to call for an interrupt, if it's enabled. Called with the lock held.
+ */
+static irq_handler_t raised(uint irq)
+{
+    return irq < HOST_IRQS && irqEnabled[irq] ? irqHandlers[irq] : NULL;
+}
+
+void gpio_init(uint gpio)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    outputs[gpio] = false;
+    levels[gpio] = false;
+}
+
+void gpio_set_dir(uint gpio, bool out)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    outputs[gpio] = out;
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn)
+{
+}
+
+void gpio_pull_up(uint gpio)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (!outputs[gpio])
+    {
+        levels[gpio] = true;
+    }
+}
+
+void gpio_pull_down(uint gpio)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (!outputs[gpio])
+    {
+        levels[gpio] = false;
+    }
+}
+
+void gpio_put(uint gpio, bool value)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    levels[gpio] = value;
+}
+
+bool gpio_get(uint gpio)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return levels[gpio];
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled, gpio_irq_callback_t callback)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    irqMasks[gpio] = enabled ? irqMasks[gpio] | event_mask : irqMasks[gpio] & ~event_mask;
+    gpioCallback = callback;
+    irqEnabled[IO_IRQ_BANK0] = true;
+}
+
+void adc_init(void)
+{
+}
+
+void adc_gpio_init(uint gpio)
+{
+}
+
+void adc_select_input(uint input)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    adcInput = input < HOST_ADC_INPUTS ? input : 0;
+}
+
+uint16_t adc_read(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return adcValues[adcInput];
+}
+
+void pwm_set_gpio_level(uint gpio, uint16_t level)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    pwmLevels[gpio] = level;
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    irqHandlers[num] = handler;
+}
+
+void irq_set_enabled(uint num, bool enabled)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    irqEnabled[num] = enabled;
+}
+
+uint uart_init(uart_inst_t *uart, uint baudrate)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    uart->head = 0;
+    uart->count = 0;
+    return baudrate;
+}
+
+uint uart_set_baudrate(uart_inst_t *uart, uint baudrate)
+{
+    return baudrate;
+}
+
+void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts)
+{
+}
+
+void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits, uart_parity_t parity)
+{
+}
+
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled)
+{
+}
+
+void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data, bool tx_needs_data)
+{
+    irq_handler_t handler = NULL;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        uart->rxInterrupt = rx_has_data;
+        // The receive interrupt is level triggered, data already waiting raises it at once
+        if (rx_has_data && uart->count > 0)
+        {
+            handler = raised(uart->irq);
+        }
+    }
+    if (handler)
+    {
+        handler();
+    }
+}
+
+bool uart_is_readable(uart_inst_t *uart)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return uart->count > 0;
+}
+
+char uart_getc(uart_inst_t *uart)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (uart->count == 0)
+    {
+        return 0;
+    }
+    char c = (char)uart->fifo[uart->head];
+    uart->head = (uart->head + 1) % HOST_UART_FIFO;
+    uart->count--;
+    return c;
+}
+
+void host_gpio_drive(uint32_t gpio, bool level)
+{
+    gpio_irq_callback_t callback = NULL;
+    uint32_t events = 0;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (levels[gpio] != level)
+        {
+            events = irqMasks[gpio] & (level ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL);
+        }
+        levels[gpio] = level;
+        if (events != 0 && irqEnabled[IO_IRQ_BANK0])
+        {
+            callback = gpioCallback;
+        }
+    }
+    if (callback)
+    {
+        callback(gpio, events);
+    }
+}
+
+bool host_gpio_level(uint32_t gpio)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return levels[gpio];
+}
+
+uint16_t host_pwm_level(uint32_t gpio)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return pwmLevels[gpio];
+}
+
+void host_adc_drive(uint32_t input, uint16_t value)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    adcValues[input < HOST_ADC_INPUTS ? input : 0] = value & 0xFFF;
+}
+
+size_t host_uart_receive(uint32_t index, const void *data, size_t length)
+{
+    uart_inst_t *uart = host_uarts[index];
+    const uint8_t *bytes = (const uint8_t *)data;
+    size_t fitted = 0;
+    irq_handler_t handler = NULL;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (size_t i = 0; i < length; i++)
+        {
+            if (uart->count == HOST_UART_FIFO)
+            {
+                uart->overruns++;
+                continue;
+            }
+            uart->fifo[(uart->head + uart->count) % HOST_UART_FIFO] = bytes[i];
+            uart->count++;
+            fitted++;
+        }
+        if (uart->rxInterrupt && uart->count > 0)
+        {
+            handler = raised(uart->irq);
+        }
+    }
+    if (handler)
+    {
+        handler();
+    }
+    return fitted;
+}
+
+uint32_t host_uart_overruns(uint32_t index)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return host_uarts[index]->overruns;
+}
@@ -0,0 +1,472 @@
+/*
+ * Host stand-in for the lwIP raw TCP API over non-blocking POSIX sockets.
+ * Data the socket has accepted counts as acknowledged, and is reported through the sent
+ * callback on the next poll. Closed pcbs are freed by the slow timer, so a pcb closed from
+ * inside one of its own callbacks stays valid until the callback has returned.
+ */
+
+#include "lwip/tcp.h"
+#include "lwip/stats.h"
+#include "pico/stdlib.h"
+#include "host_stubs.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// The window and send buffer of lib/lwip/lwipopts.h
+#define HOST_TCP_MSS 1460
+#define HOST_TCP_WND (8 * HOST_TCP_MSS)
+#define HOST_TCP_SND_BUF (8 * HOST_TCP_MSS)
+// Largest read handed to the receive callback in one pbuf
+#define HOST_TCP_READ 2048
+// lwIP's slow timer, which drives the poll callbacks
+#define HOST_TCP_SLOW_INTERVAL_MS 500
+
+enum
+{
+    HOST_TCP_CLOSED,
+    HOST_TCP_CONNECTING,
+    HOST_TCP_CONNECTED,
+    // The socket failed outside a poll, the error callback is called by the next one
+    HOST_TCP_FAILED,
+    // Waiting for the slow timer to free it
+    HOST_TCP_DEAD
+};
+
+static struct tcp_pcb *pcbs = NULL;
+static HostTcpObserver observer = NULL;
+static HostTcpCounters counters = {};
+static bool slowTimerRunning = false;
+
+static void watch(struct tcp_pcb *pcb);
+
+static void countPcbs(int change)
+{
+    struct stats_mem *stats = lwip_stats.memp[MEMP_TCP_PCB];
+    stats->used += change;
+    stats->max = stats->used > stats->max ? stats->used : stats->max;
+}
+
+/**
+ * @brief Closes the socket and leaves the pcb for the slow timer to free
+ */
+static void release(struct tcp_pcb *pcb)
+{
+    if (pcb->socket >= 0)
+    {
+        host_network_unwatch(pcb->socket);
+        close(pcb->socket);
+        pcb->socket = -1;
+    }
+    if (pcb->state != HOST_TCP_DEAD && observer)
+    {
+        observer(pcb, NULL, 0, false);
+    }
+    pcb->state = HOST_TCP_DEAD;
+    pcb->connected = NULL;
+    pcb->recv = NULL;
+    pcb->sent = NULL;
+    pcb->poll = NULL;
+    pcb->errf = NULL;
+}
+
+/**
+ * @brief The connection is gone. As with lwIP the pcb is freed before the error callback is called.
+ */
+static void fail(struct tcp_pcb *pcb, err_t error)
+{
+    tcp_err_fn errf = pcb->errf;
+    void *arg = pcb->callback_arg;
+
+    if (pcb->state == HOST_TCP_CONNECTING)
+    {
+        counters.failures++;
+    }
+    release(pcb);
+    if (errf)
+    {
+        errf(arg, error);
+    }
+}
+
+static void flush(struct tcp_pcb *pcb)
+{
+    while (pcb->unsentLength > 0)
+    {
+        ssize_t written = send(pcb->socket, pcb->unsent, pcb->unsentLength, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (written < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                pcb->state = HOST_TCP_FAILED;
+            }
+            break;
+        }
+
+        memmove(pcb->unsent, pcb->unsent + written, pcb->unsentLength - written);
+        pcb->unsentLength -= written;
+        pcb->acknowledged += written;
+        counters.bytesSent += written;
+    }
+    watch(pcb);
+}
+
+/**
+ * @brief Offers received data to the receive callback
+ *
+ * @return false if the pcb was closed or aborted by the callback
+ */
+static bool deliver(struct tcp_pcb *pcb, struct pbuf *p)
+{
+    if (pcb->recv == NULL)
+    {
+        // lwIP's default receive callback closes the connection at its end
+        if (p == NULL)
+        {
+            tcp_close(pcb);
+            return false;
+        }
+        tcp_recved(pcb, p->tot_len);
+        pbuf_free(p);
+        return true;
+    }
+
+    err_t result = pcb->recv(pcb->callback_arg, pcb, p, ERR_OK);
+    if (pcb->state == HOST_TCP_DEAD || result == ERR_ABRT)
+    {
+        return false;
+    }
+    if (result != ERR_OK && p != NULL)
+    {
+        // Refused data is held and offered again, as lwIP does
+        pcb->refused = p;
+    }
+    return true;
+}
+
+static void receive(struct tcp_pcb *pcb)
+{
+    if (pcb->refused != NULL)
+    {
+        struct pbuf *refused = pcb->refused;
+        pcb->refused = NULL;
+        if (!deliver(pcb, refused) || pcb->refused != NULL)
+        {
+            return;
+        }
+    }
+
+    while (pcb->window > 0)
+    {
+        uint8_t buffer[HOST_TCP_READ];
+        size_t length = pcb->window < sizeof(buffer) ? pcb->window : sizeof(buffer);
+        ssize_t received = recv(pcb->socket, buffer, length, MSG_DONTWAIT);
+
+        if (received == 0)
+        {
+            // The broker closed the connection
+            deliver(pcb, NULL);
+            return;
+        }
+        if (received < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                fail(pcb, ERR_RST);
+            }
+            return;
+        }
+
+        counters.bytesReceived += received;
+        pcb->window -= received;
+        if (observer)
+        {
+            observer(pcb, buffer, received, false);
+        }
+
+        struct pbuf *p = pbuf_alloc(PBUF_RAW, (u16_t)received, PBUF_RAM);
+        memcpy(p->payload, buffer, received);
+        if (!deliver(pcb, p) || pcb->refused != NULL)
+        {
+            return;
+        }
+    }
+}
+
+static void ready(int fd, short events, void *context)
+{
+    struct tcp_pcb *pcb = (struct tcp_pcb *)context;
+
+    if (pcb->state == HOST_TCP_CONNECTING)
+    {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0)
+        {
+            fail(pcb, ERR_RST);
+            return;
+        }
+
+        pcb->state = HOST_TCP_CONNECTED;
+        counters.connects++;
+        watch(pcb);
+        if (pcb->connected && pcb->connected(pcb->callback_arg, pcb, ERR_OK) == ERR_ABRT)
+        {
+            return;
+        }
+    }
+
+    if (pcb->state == HOST_TCP_CONNECTED && (events & (POLLIN | POLLHUP | POLLERR)))
+    {
+        receive(pcb);
+    }
+
+    if (pcb->state == HOST_TCP_CONNECTED)
+    {
+        flush(pcb);
+    }
+
+    while (pcb->state == HOST_TCP_CONNECTED && pcb->acknowledged > 0)
+    {
+        u16_t length = pcb->acknowledged > 0xFFFF ? 0xFFFF : (u16_t)pcb->acknowledged;
+        pcb->acknowledged -= length;
+        if (pcb->sent && pcb->sent(pcb->callback_arg, pcb, length) == ERR_ABRT)
+        {
+            return;
+        }
+    }
+
+    if (pcb->state == HOST_TCP_FAILED)
+    {
+        fail(pcb, ERR_RST);
+        return;
+    }
+
+    if (pcb->state == HOST_TCP_CONNECTED)
+    {
+        watch(pcb);
+    }
+}
+
+static void watch(struct tcp_pcb *pcb)
+{
+    if (pcb->socket < 0)
+    {
+        return;
+    }
+
+    short events = 0;
+    if (pcb->state == HOST_TCP_CONNECTING || pcb->unsentLength > 0 || pcb->acknowledged > 0 ||
+        pcb->state == HOST_TCP_FAILED)
+    {
+        // Writable straight away when there is only something to report, so the next poll does it
+        events |= POLLOUT;
+    }
+    if (pcb->state == HOST_TCP_CONNECTED && (pcb->window > 0 || pcb->refused != NULL))
+    {
+        events |= POLLIN;
+    }
+    host_network_watch(pcb->socket, events, ready, pcb);
+}
+
+/**
+ * @brief lwIP's slow timer, calls the poll callbacks and frees the pcbs that were closed
+ */
+static int64_t slowTimer(alarm_id_t id, void *data)
+{
+    for (struct tcp_pcb **current = &pcbs; *current != NULL;)
+    {
+        struct tcp_pcb *pcb = *current;
+        if (pcb->state == HOST_TCP_DEAD)
+        {
+            *current = pcb->next;
+            pbuf_free(pcb->refused);
+            free(pcb->unsent);
+            free(pcb);
+            countPcbs(-1);
+            continue;
+        }
+        current = &pcb->next;
+    }
+
+    uint64_t now = host_time_us();
+    for (struct tcp_pcb *pcb = pcbs; pcb != NULL; pcb = pcb->next)
+    {
+        if (pcb->state != HOST_TCP_CONNECTED || pcb->poll == NULL || pcb->pollinterval == 0 || now < pcb->nextPoll)
+        {
+            continue;
+        }
+        pcb->nextPoll = now + (uint64_t)pcb->pollinterval * HOST_TCP_SLOW_INTERVAL_MS * 1000;
+        pcb->poll(pcb->callback_arg, pcb);
+    }
+
+    return (int64_t)HOST_TCP_SLOW_INTERVAL_MS * 1000;
+}
+
+struct tcp_pcb *tcp_new_ip_type(u8_t type)
+{
+    struct tcp_pcb *pcb = (struct tcp_pcb *)calloc(1, sizeof(struct tcp_pcb));
+
+    pcb->socket = -1;
+    pcb->state = HOST_TCP_CLOSED;
+    pcb->window = HOST_TCP_WND;
+    pcb->unsent = (u8_t *)malloc(HOST_TCP_SND_BUF);
+    pcb->next = pcbs;
+    pcbs = pcb;
+    countPcbs(1);
+
+    if (!slowTimerRunning)
+    {
+        add_alarm_in_ms(HOST_TCP_SLOW_INTERVAL_MS, slowTimer, NULL, true);
+        slowTimerRunning = true;
+    }
+    return pcb;
+}
+
+struct tcp_pcb *tcp_new(void)
+{
+    return tcp_new_ip_type(IPADDR_TYPE_V4);
+}
+
+void tcp_arg(struct tcp_pcb *pcb, void *arg)
+{
+    pcb->callback_arg = arg;
+}
+
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv)
+{
+    pcb->recv = recv;
+}
+
+void tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent)
+{
+    pcb->sent = sent;
+}
+
+void tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval)
+{
+    pcb->poll = poll;
+    pcb->pollinterval = interval;
+    pcb->nextPoll = host_time_us() + (uint64_t)interval * HOST_TCP_SLOW_INTERVAL_MS * 1000;
+}
+
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err)
+{
+    pcb->errf = err;
+}
+
+err_t tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *address, u16_t port, tcp_connected_fn connected)
+{
+    if (pcb->state != HOST_TCP_CLOSED)
+    {
+        return ERR_ISCONN;
+    }
+
+    pcb->socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (pcb->socket < 0)
+    {
+        return ERR_MEM;
+    }
+
+    if (pcb->so_options & SOF_KEEPALIVE)
+    {
+        int enable = 1;
+        int idle = pcb->keep_idle / 1000 > 0 ? pcb->keep_idle / 1000 : 1;
+        int interval = pcb->keep_intvl / 1000 > 0 ? pcb->keep_intvl / 1000 : 1;
+        setsockopt(pcb->socket, SOL_SOCKET, SO_KEEPALIVE, &enable, sizeof(enable));
+        setsockopt(pcb->socket, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+        setsockopt(pcb->socket, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    }
+
+    struct sockaddr_in remote = {};
+    remote.sin_family = AF_INET;
+    remote.sin_port = htons(port);
+    remote.sin_addr.s_addr = ip4_addr_get_u32(address);
+
+    pcb->connected = connected;
+    pcb->state = HOST_TCP_CONNECTING;
+    if (connect(pcb->socket, (struct sockaddr *)&remote, sizeof(remote)) < 0 && errno != EINPROGRESS)
+    {
+        // Reported through the error callback on the next poll, as a refused SYN would be
+        pcb->state = HOST_TCP_FAILED;
+        counters.failures++;
+    }
+    watch(pcb);
+    return ERR_OK;
+}
+
+err_t tcp_write(struct tcp_pcb *pcb, const void *data, u16_t length, u8_t flags)
+{
+    if (pcb->state != HOST_TCP_CONNECTED)
+    {
+        return ERR_CONN;
+    }
+    if (length > tcp_sndbuf(pcb))
+    {
+        return ERR_MEM;
+    }
+
+    memcpy(pcb->unsent + pcb->unsentLength, data, length);
+    pcb->unsentLength += length;
+    if (observer)
+    {
+        observer(pcb, data, length, true);
+    }
+    return ERR_OK;
+}
+
+err_t tcp_output(struct tcp_pcb *pcb)
+{
+    if (pcb->state == HOST_TCP_CONNECTED)
+    {
+        flush(pcb);
+    }
+    return ERR_OK;
+}
+
+void tcp_recved(struct tcp_pcb *pcb, u16_t length)
+{
+    pcb->window = pcb->window + length > HOST_TCP_WND ? HOST_TCP_WND : pcb->window + length;
+    if (pcb->state == HOST_TCP_CONNECTED)
+    {
+        watch(pcb);
+    }
+}
+
+u16_t tcp_sndbuf(struct tcp_pcb *pcb)
+{
+    return (u16_t)(HOST_TCP_SND_BUF - pcb->unsentLength);
+}
+
+err_t tcp_close(struct tcp_pcb *pcb)
+{
+    if (pcb->state == HOST_TCP_CONNECTED)
+    {
+        // Whatever the socket will still take goes out before the FIN
+        flush(pcb);
+    }
+    release(pcb);
+    return ERR_OK;
+}
+
+void tcp_abort(struct tcp_pcb *pcb)
+{
+    fail(pcb, ERR_ABRT);
+}
+
+void host_tcp_observe(HostTcpObserver callback)
+{
+    observer = callback;
+}
+
+HostTcpCounters host_tcp_counters(void)
+{
+    return counters;
+}
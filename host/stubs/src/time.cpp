@@ -0,0 +1,82 @@
+/*
+ * Host stand-in for the Pico SDK alarm and sleep functions.
+ */
+
+#include "pico/stdlib.h"
+
+#include <map>
+#include <random>
+
+typedef struct
+{
+    uint64_t time;
+    alarm_callback_t callback;
+    void *data;
+} HostAlarm;
+
+static std::map<alarm_id_t, HostAlarm> alarms;
+static alarm_id_t nextAlarmId = 1;
+
+alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void *user_data, bool fire_if_past)
+{
+    alarm_id_t id = nextAlarmId++;
+    alarms[id] = {host_time_us() + ((uint64_t)ms * 1000u), callback, user_data};
+    return id;
+}
+
+bool cancel_alarm(alarm_id_t alarm_id)
+{
+    return alarms.erase(alarm_id) > 0;
+}
+
+void host_alarm_poll(void)
+{
+    uint64_t now = host_time_us();
+
+    for (auto iterator = alarms.begin(); iterator != alarms.end();)
+    {
+        if (iterator->second.time > now)
+        {
+            iterator++;
+            continue;
+        }
+
+        alarm_id_t id = iterator->first;
+        HostAlarm alarm = iterator->second;
+        iterator = alarms.erase(iterator);
+
+        // Same contract as the SDK, a positive return reschedules in microseconds from the last fire
+        int64_t reschedule = alarm.callback(id, alarm.data);
+        if (reschedule > 0)
+        {
+            alarms[id] = {alarm.time + (uint64_t)reschedule, alarm.callback, alarm.data};
+        }
+        iterator = alarms.begin();
+    }
+}
+
+uint64_t host_alarm_next(void)
+{
+    uint64_t next = UINT64_MAX;
+    for (auto &alarm : alarms)
+    {
+        next = alarm.second.time < next ? alarm.second.time : next;
+    }
+    return next;
+}
+
+void sleep_ms(uint32_t ms)
+{
+    host_sleep_us((uint64_t)ms * 1000u);
+}
+
+void sleep_us(uint64_t us)
+{
+    host_sleep_us(us);
+}
+
+uint32_t get_rand_32(void)
+{
+    static std::mt19937 generator(0x5EED);
+    return generator();
+}
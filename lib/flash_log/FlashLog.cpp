@@ -0,0 +1,373 @@
+/*
+ * File: FlashLog.cpp
+ * Project: pico_flash_log
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#include "FlashLog.h"
+
+#include <string.h>
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include <time_service.h>
+
+// How long to wait for the other core to pause while flash is written
+#define FLASH_LOG_LOCKOUT_TIMEOUT_MS 100
+
+#define CRC32_POLYNOMIAL 0xEDB88320
+
+typedef struct
+{
+    uint32_t offset;
+    const uint8_t *data;
+} FlashOperation;
+
+struct FlashLog::Private
+{
+    static void program(void *param)
+    {
+        FlashOperation *operation = (FlashOperation *)param;
+        flash_range_program(operation->offset, operation->data, FLASH_PAGE_SIZE);
+    }
+
+    static void erase(void *param)
+    {
+        FlashOperation *operation = (FlashOperation *)param;
+        flash_range_erase(operation->offset, FLASH_SECTOR_SIZE);
+    }
+};
+
+static uint32_t crc32(uint32_t crc, const void *data, size_t length)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+
+    crc = ~crc;
+    while (length--)
+    {
+        crc ^= *bytes++;
+        for (int i = 0; i < 8; i++)
+        {
+            crc = (crc >> 1) ^ (CRC32_POLYNOMIAL & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t pageCrc(const FlashLogPage *page)
+{
+    uint32_t crc = crc32(0, &page->sequence, sizeof(page->sequence) + sizeof(page->length) + sizeof(page->records));
+    return crc32(crc, page->data, page->length <= FLASH_LOG_DATA_SIZE ? page->length : 0);
+}
+
+FlashLog::FlashLog(uint32_t offset, uint32_t size) : offset(offset), pages(size / FLASH_PAGE_SIZE)
+{
+    resetWritePage();
+    statistics.capacity = pages - FLASH_LOG_PAGES_PER_SECTOR;
+}
+
+const FlashLogPage *FlashLog::page(uint32_t index)
+{
+    return (const FlashLogPage *)(XIP_BASE + offset + (index * FLASH_PAGE_SIZE));
+}
+
+bool FlashLog::valid(const FlashLogPage *page)
+{
+    return page->magic == FLASH_LOG_MAGIC &&
+           page->commit != FLASH_LOG_ERASED &&
+           page->length <= FLASH_LOG_DATA_SIZE &&
+           page->crc == pageCrc(page);
+}
+
+bool FlashLog::erased(uint32_t index)
+{
+    const uint32_t *words = (const uint32_t *)page(index);
+
+    for (size_t i = 0; i < FLASH_PAGE_SIZE / sizeof(uint32_t); i++)
+    {
+        if (words[i] != FLASH_LOG_ERASED)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FlashLog::program(uint32_t index, const FlashLogPage *data)
+{
+    FlashOperation operation = {offset + (index * FLASH_PAGE_SIZE), (const uint8_t *)data};
+    uint64_t start = time_service_monotonic_us();
+
+    if (flash_safe_execute(Private::program, &operation, FLASH_LOG_LOCKOUT_TIMEOUT_MS) != PICO_OK)
+    {
+        printf("flash log program failed\n");
+    }
+
+    statistics.programs++;
+    statistics.programTime += time_service_monotonic_us() - start;
+}
+
+void FlashLog::erase(uint32_t sector)
+{
+    uint32_t first = sector * FLASH_LOG_PAGES_PER_SECTOR;
+    FlashOperation operation = {offset + (first * FLASH_PAGE_SIZE), NULL};
+    bool holdsTail = false;
+
+    for (uint32_t i = first; i < first + FLASH_LOG_PAGES_PER_SECTOR; i++)
+    {
+        const FlashLogPage *current = page(i);
+        if (valid(current) && current->consumed == FLASH_LOG_ERASED)
+        {
+            statistics.pagesDropped++;
+            unread -= current->records - (reading && i == tail ? readRecords : 0);
+        }
+        holdsTail = holdsTail || i == tail;
+    }
+
+    // The oldest records are lost, reading carries on from the next sector
+    if (holdsTail)
+    {
+        tail = (first + FLASH_LOG_PAGES_PER_SECTOR) % pages;
+        reading = false;
+    }
+
+    uint64_t start = time_service_monotonic_us();
+
+    if (flash_safe_execute(Private::erase, &operation, FLASH_LOG_LOCKOUT_TIMEOUT_MS) != PICO_OK)
+    {
+        printf("flash log erase failed\n");
+    }
+
+    statistics.sectorsErased++;
+    statistics.eraseTime += time_service_monotonic_us() - start;
+}
+
+void FlashLog::resetWritePage()
+{
+    memset(&writePage, 0xFF, sizeof(writePage));
+    writePage.magic = FLASH_LOG_MAGIC;
+    writePage.length = 0;
+    writePage.records = 0;
+}
+
+void FlashLog::begin()
+{
+    uint32_t newest = 0;
+    uint32_t oldest = 0;
+    bool written = false;
+    bool found = false;
+
+    unread = writePage.records;
+    for (uint32_t i = 0; i < pages; i++)
+    {
+        const FlashLogPage *current = page(i);
+
+        if (current->magic != FLASH_LOG_MAGIC)
+        {
+            continue;
+        }
+
+        // The sequence of a torn page can't be trusted. The page is skipped when the head reaches it.
+        if (!valid(current))
+        {
+            statistics.pagesInvalid++;
+            continue;
+        }
+
+        if (!written || current->sequence > page(newest)->sequence)
+        {
+            newest = i;
+            written = true;
+        }
+
+        if (current->consumed == FLASH_LOG_ERASED)
+        {
+            unread += current->records;
+        }
+
+        if (current->consumed == FLASH_LOG_ERASED && (!found || current->sequence < page(oldest)->sequence))
+        {
+            oldest = i;
+            found = true;
+        }
+    }
+
+    if (written)
+    {
+        head = (newest + 1) % pages;
+        sequence = page(newest)->sequence + 1;
+    }
+
+    tail = found ? oldest : head;
+    reading = false;
+}
+
+bool FlashLog::append(const void *record, size_t length)
+{
+    if (length == 0 || length > FLASH_LOG_MAX_RECORD)
+    {
+        return false;
+    }
+
+    if (writePage.length + 1 + length > FLASH_LOG_DATA_SIZE)
+    {
+        flush();
+    }
+
+    writePage.data[writePage.length++] = (uint8_t)length;
+    memcpy(&writePage.data[writePage.length], record, length);
+    writePage.length += length;
+    writePage.records++;
+    unread++;
+
+    statistics.recordsAppended++;
+    statistics.bytesAppended += length;
+    return true;
+}
+
+void FlashLog::flush()
+{
+    if (writePage.records == 0)
+    {
+        return;
+    }
+
+    // Sectors are erased as the head reaches them. Pages left dirty by a lost write are skipped.
+    while (true)
+    {
+        if (head % FLASH_LOG_PAGES_PER_SECTOR == 0)
+        {
+            bool clean = true;
+            for (uint32_t i = head; i < head + FLASH_LOG_PAGES_PER_SECTOR && clean; i++)
+            {
+                clean = erased(i);
+            }
+
+            if (!clean)
+            {
+                erase(head / FLASH_LOG_PAGES_PER_SECTOR);
+            }
+            break;
+        }
+
+        if (erased(head))
+        {
+            break;
+        }
+
+        head = (head + 1) % pages;
+    }
+
+    writePage.sequence = sequence++;
+    writePage.crc = pageCrc(&writePage);
+    writePage.commit = FLASH_LOG_ERASED;
+    writePage.consumed = FLASH_LOG_ERASED;
+    program(head, &writePage);
+
+    // Only a page that was completely written gets its commit marker
+    writePage.commit = FLASH_LOG_SET;
+    program(head, &writePage);
+
+    statistics.pagesWritten++;
+    head = (head + 1) % pages;
+    resetWritePage();
+}
+
+bool FlashLog::loadReadPage()
+{
+    if (reading)
+    {
+        return true;
+    }
+
+    while (tail != head)
+    {
+        const FlashLogPage *current = page(tail);
+
+        if (valid(current) && current->consumed == FLASH_LOG_ERASED && current->records > 0)
+        {
+            memcpy(&readPage, current, sizeof(readPage));
+            readOffset = 0;
+            readRecords = 0;
+            reading = true;
+            return true;
+        }
+
+        tail = (tail + 1) % pages;
+    }
+
+    return false;
+}
+
+bool FlashLog::peek(void *record, size_t *length)
+{
+    if (!loadReadPage())
+    {
+        return false;
+    }
+
+    *length = readPage.data[readOffset];
+    memcpy(record, &readPage.data[readOffset + 1], *length);
+    return true;
+}
+
+void FlashLog::pop()
+{
+    if (!loadReadPage())
+    {
+        return;
+    }
+
+    readOffset += 1 + readPage.data[readOffset];
+    readRecords++;
+    unread--;
+
+    // Records of a page are replayed again if power is lost before the whole page is read
+    if (readOffset >= readPage.length)
+    {
+        readPage.consumed = FLASH_LOG_SET;
+        program(tail, &readPage);
+        reading = false;
+        tail = (tail + 1) % pages;
+    }
+}
+
+bool FlashLog::empty()
+{
+    return !loadReadPage();
+}
+
+size_t FlashLog::size()
+{
+    return unread;
+}
+
+FlashLogStatistics FlashLog::getStatistics()
+{
+    return statistics;
+}
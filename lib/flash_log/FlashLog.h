@@ -0,0 +1,192 @@
+/*
+ * File: FlashLog.h
+ * Project: pico_flash_log
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef FLASHLOG
+#define FLASHLOG
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "hardware/flash.h"
+
+// The log takes the end of flash by default, the program must stay clear of it
+#define FLASH_LOG_SIZE (256 * 1024)
+#define FLASH_LOG_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_LOG_SIZE)
+
+#define FLASH_LOG_MAGIC 0x474F4C46
+#define FLASH_LOG_HEADER_SIZE 16
+#define FLASH_LOG_MARKER_SIZE 8
+#define FLASH_LOG_DATA_SIZE (FLASH_PAGE_SIZE - FLASH_LOG_HEADER_SIZE - FLASH_LOG_MARKER_SIZE)
+#define FLASH_LOG_PAGES_PER_SECTOR (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
+
+// Records are prefixed with their length in a single byte
+#define FLASH_LOG_MAX_RECORD (FLASH_LOG_DATA_SIZE - 1)
+
+// Value of an erased marker, markers are set by programming them to zero
+#define FLASH_LOG_ERASED 0xFFFFFFFF
+#define FLASH_LOG_SET 0x00000000
+
+/**
+ * @brief A page of the log as it is stored in flash.
+ * The page is programmed once with its data and again to set the commit marker, so a page
+ * that was being written when power was lost is never read. Once all of its records have
+ * been read it is programmed a third time to set the consumed marker.
+ */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t sequence;
+    uint16_t length;
+    uint16_t records;
+    // CRC32 of the sequence, length, records and data
+    uint32_t crc;
+    uint8_t data[FLASH_LOG_DATA_SIZE];
+    uint32_t commit;
+    uint32_t consumed;
+} FlashLogPage;
+
+static_assert(sizeof(FlashLogPage) == FLASH_PAGE_SIZE, "A log page must fill a flash page");
+
+typedef struct
+{
+    uint32_t recordsAppended;
+    uint32_t bytesAppended;
+    // Every program of a page, including setting the markers
+    uint32_t programs;
+    uint32_t pagesWritten;
+    uint32_t sectorsErased;
+    // Pages with unread records lost to erasing the oldest sector
+    uint32_t pagesDropped;
+    // Pages skipped on recovery because they were torn or corrupt
+    uint32_t pagesInvalid;
+    uint64_t programTime;
+    uint64_t eraseTime;
+    // Pages that can hold unread records at once
+    uint32_t capacity;
+} FlashLogStatistics;
+
+/**
+ * @brief An append only log of records in a reserved region of flash, which survives power loss.
+ * Pages are written in order around the region so every sector is worn evenly, and a sector
+ * is only erased when the log comes back around to it. When the log is full the oldest
+ * sector is erased and its records are dropped.
+ */
+class FlashLog
+{
+private:
+    uint32_t offset;
+    uint32_t pages;
+
+    // Next page to program, and the oldest page that may hold unread records
+    uint32_t head = 0;
+    uint32_t tail = 0;
+    uint32_t sequence = 1;
+
+    FlashLogPage writePage;
+    FlashLogPage readPage;
+    bool reading = false;
+    size_t readOffset = 0;
+    // Records popped from the read page, and records appended that haven't been popped
+    uint32_t readRecords = 0;
+    uint32_t unread = 0;
+
+    FlashLogStatistics statistics = {};
+
+    struct Private;
+
+    const FlashLogPage *page(uint32_t index);
+    bool valid(const FlashLogPage *page);
+    bool erased(uint32_t index);
+    void program(uint32_t index, const FlashLogPage *data);
+    void erase(uint32_t sector);
+    void resetWritePage();
+    bool loadReadPage();
+
+public:
+    /**
+     * @brief Construct a new Flash Log
+     *
+     * @param offset Offset of the region from the start of flash, aligned to a sector
+     * @param size Size of the region, a multiple of the sector size and at least two sectors
+     */
+    FlashLog(uint32_t offset, uint32_t size);
+
+    /**
+     * @brief Scans the region for the records that are still unread from before a reboot
+     */
+    void begin();
+
+    /**
+     * @brief Appends a record. Records are buffered and written a page at a time.
+     *
+     * @param record
+     * @param length At most FLASH_LOG_MAX_RECORD bytes
+     * @return true if the record was appended
+     */
+    bool append(const void *record, size_t length);
+
+    /**
+     * @brief Writes the records that are buffered, even if they don't fill a page
+     */
+    void flush();
+
+    /**
+     * @brief Reads the oldest unread record without removing it
+     *
+     * @param record Buffer of at least FLASH_LOG_MAX_RECORD bytes
+     * @param length Set to the length of the record
+     * @return true if there was a record
+     */
+    bool peek(void *record, size_t *length);
+
+    /**
+     * @brief Marks the oldest record as read
+     */
+    void pop();
+
+    /**
+     * @brief Whether there are unread records that have been written
+     *
+     * @return true if there are no unread records in flash
+     */
+    bool empty();
+
+    /**
+     * @brief Get the number of records that haven't been read, including those still buffered
+     *
+     * @return size_t
+     */
+    size_t size();
+
+    FlashLogStatistics getStatistics();
+};
+
+#endif /* FLASHLOG */
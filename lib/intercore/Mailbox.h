@@ -0,0 +1,137 @@
+/*
+ * File: Mailbox.h
+ * Project: pico_intercore
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef MAILBOX
+#define MAILBOX
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+/**
+ * @brief A lock-free mailbox holding the latest value written by one writer, such as core 1 to core 0.
+ * Writes never wait and overwrite the previous value, so it suits samples where only the newest matters.
+ * A sequence lock guards the value: the sequence is odd while a write is in progress, and a reader
+ * retries if it changed while the value was copied out.
+ * The value is stored as atomic words, so a read that overlaps a write is retried rather than torn.
+ * A reader must not interrupt the writer on the same core, or it would wait on a write that can't finish.
+ *
+ * @tparam T The type of the value, trivially copyable
+ */
+template <typename T>
+class Mailbox
+{
+    static_assert(std::is_trivially_copyable<T>::value, "The value of a Mailbox must be trivially copyable");
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<uint32_t> words[WORDS] = {};
+    // The sequence of the last value taken, only used by the reader
+    uint32_t taken = 0;
+
+public:
+    /**
+     * @brief Replaces the value. Writer only.
+     *
+     * @param value
+     */
+    void write(const T &value)
+    {
+        uint32_t buffer[WORDS] = {};
+        memcpy(buffer, &value, sizeof(T));
+
+        uint32_t start = sequence.load(std::memory_order_relaxed);
+        sequence.store(start + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; i++)
+        {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        sequence.store(start + 2, std::memory_order_release);
+    }
+
+    /**
+     * @brief Copies out the latest value.
+     *
+     * @param value Where to copy the value
+     * @return uint32_t The sequence of the value, 0 if nothing has been written yet
+     */
+    uint32_t read(T *value)
+    {
+        uint32_t buffer[WORDS];
+        uint32_t start;
+        uint32_t end;
+        do
+        {
+            start = sequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < WORDS; i++)
+            {
+                buffer[i] = words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            end = sequence.load(std::memory_order_relaxed);
+        } while ((start & 1) || start != end);
+
+        memcpy(value, buffer, sizeof(T));
+        return start;
+    }
+
+    /**
+     * @brief Copies out the latest value if it was written since the last take. Single reader only.
+     *
+     * @param value Where to copy the value
+     * @return true if there was a new value
+     */
+    bool take(T *value)
+    {
+        if (sequence.load(std::memory_order_acquire) == taken)
+        {
+            return false;
+        }
+        taken = read(value);
+        return true;
+    }
+
+    /**
+     * @brief Get the number of values written
+     *
+     * @return uint32_t
+     */
+    uint32_t getWrites()
+    {
+        return sequence.load(std::memory_order_relaxed) >> 1;
+    }
+};
+
+#endif /* MAILBOX */
@@ -0,0 +1,154 @@
+/*
+ * File: SpscRing.h
+ * Project: pico_intercore
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef SPSC_RING
+#define SPSC_RING
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/**
+ * @brief A lock-free ring of items passed from one producer to one consumer, such as core 1 to core 0.
+ * Each index is only written by one side, and the acquire and release ordering makes an item's
+ * contents visible before its slot is. No interrupts are disabled and nothing spins, so either side
+ * can use it from an interrupt handler as long as it stays the only producer or consumer.
+ *
+ * @tparam T The type of the items, copied in and read in place
+ * @tparam N The number of slots, a power of two
+ */
+template <typename T, size_t N>
+class SpscRing
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "The size of an SpscRing must be a power of two");
+
+private:
+    T items[N];
+    // Free running, only the producer writes head and only the consumer writes tail
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+    // Items the producer couldn't add because the ring was full, only written by the producer
+    std::atomic<uint32_t> dropped{0};
+
+public:
+    /**
+     * @brief Adds an item. Producer only.
+     *
+     * @param item
+     * @return true if it was added, false if the ring was full and it was dropped
+     */
+    bool push(const T &item)
+    {
+        uint32_t position = head.load(std::memory_order_relaxed);
+        if (position - tail.load(std::memory_order_acquire) >= N)
+        {
+            dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        items[position & (N - 1)] = item;
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Get the oldest item without removing it. Consumer only.
+     * The item stays valid until pop is called.
+     *
+     * @return T* The item, or NULL if the ring is empty
+     */
+    T *front()
+    {
+        uint32_t position = tail.load(std::memory_order_relaxed);
+        if (position == head.load(std::memory_order_acquire))
+        {
+            return NULL;
+        }
+        return &items[position & (N - 1)];
+    }
+
+    /**
+     * @brief Removes the oldest item, giving its slot back to the producer. Consumer only.
+     */
+    void pop()
+    {
+        uint32_t position = tail.load(std::memory_order_relaxed);
+        if (position != head.load(std::memory_order_acquire))
+        {
+            tail.store(position + 1, std::memory_order_release);
+        }
+    }
+
+    /**
+     * @brief Copies out and removes the oldest item. Consumer only.
+     *
+     * @param item Where to copy the item
+     * @return true if there was an item
+     */
+    bool pop(T *item)
+    {
+        T *oldest = front();
+        if (oldest == NULL)
+        {
+            return false;
+        }
+        *item = *oldest;
+        pop();
+        return true;
+    }
+
+    /**
+     * @brief Get the number of items waiting. The other side can change it at any time, so it's a snapshot.
+     *
+     * @return size_t
+     */
+    size_t size()
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    bool empty()
+    {
+        return size() == 0;
+    }
+
+    /**
+     * @brief Get the number of items dropped because the ring was full
+     *
+     * @return uint32_t
+     */
+    uint32_t getDropped()
+    {
+        return dropped.load(std::memory_order_relaxed);
+    }
+};
+
+#endif /* SPSC_RING */
@@ -0,0 +1,255 @@
+/*
+ * File: Diagnostics.cpp
+ * Project: pico_node_runtime
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#include "Diagnostics.h"
+
+#include <malloc.h>
+
+#include "pico/cyw43_arch.h"
+
+#include "lwip/memp.h"
+#include "lwip/stats.h"
+
+#include "properties/simple/StringProperty.h"
+#include <PicoSparkplugClient.h>
+#include <time_service.h>
+
+// The heap runs from the end of the static data up to the stack, as in the SDK's _sbrk
+extern char __end__;
+extern char __StackLimit;
+
+#define DIAGNOSTICS_DEVICE_PERIOD_MS 1000
+
+Diagnostics::Diagnostics(NodeScheduler *scheduler, uint32_t interval, bool enabled)
+    : device(Device(DIAGNOSTICS_DEVICE, DIAGNOSTICS_DEVICE_PERIOD_MS)), scheduler(scheduler)
+{
+    this->enabled = BooleanMetric::create("enabled", enabled);
+    this->enabled->setCommandCallback(
+        [](Metric *metric, org_eclipse_tahu_protobuf_Payload_Metric *payload)
+        {
+            metric->setValue(&payload->value.boolean_value);
+        });
+
+    reportInterval = Int32Metric::create("reportInterval", (int32_t)interval);
+    reportInterval->setCommandCallback(
+        [](Metric *metric, org_eclipse_tahu_protobuf_Payload_Metric *payload)
+        {
+            metric->setValue(&payload->value.int_value);
+        });
+    reportInterval->addProperty(StringProperty::create("unit", "s"));
+
+    device.addMetrics({
+        this->enabled,
+        reportInterval,
+        heapFree = Int32Metric::create("heap/free", 0),
+        heapLargestFree = Int32Metric::create("heap/largestFree", 0),
+        heapUsed = Int32Metric::create("heap/used", 0),
+        lwipMemUsed = Int32Metric::create("lwip/memUsed", 0),
+        lwipMemMax = Int32Metric::create("lwip/memMax", 0),
+        lwipMemErrors = Int32Metric::create("lwip/memErrors", 0),
+        pbufPoolUsed = Int32Metric::create("lwip/pbufPoolUsed", 0),
+        pbufPoolMax = Int32Metric::create("lwip/pbufPoolMax", 0),
+        pbufPoolErrors = Int32Metric::create("lwip/pbufPoolErrors", 0),
+        tcpSegUsed = Int32Metric::create("lwip/tcpSegUsed", 0),
+        tcpSegMax = Int32Metric::create("lwip/tcpSegMax", 0),
+        mempErrors = Int32Metric::create("lwip/mempErrors", 0),
+        arenaHighWater = Int32Metric::create("arena/highWater", 0),
+        arenaOverflows = Int32Metric::create("arena/overflows", 0),
+        loopPeriodMin = Int32Metric::create("loop/periodMin", 0),
+        loopPeriodMean = Int32Metric::create("loop/periodMean", 0),
+        loopPeriodMax = Int32Metric::create("loop/periodMax", 0),
+        core0Busy = Int32Metric::create("cpu/core0Busy", 0),
+        core1Busy = Int32Metric::create("cpu/core1Busy", 0),
+        uptime = Int32Metric::create("uptime", 0),
+    });
+
+    heapFree->addProperty(StringProperty::create("unit", "B"));
+    heapLargestFree->addProperty(StringProperty::create("unit", "B"));
+    heapUsed->addProperty(StringProperty::create("unit", "B"));
+    lwipMemUsed->addProperty(StringProperty::create("unit", "B"));
+    lwipMemMax->addProperty(StringProperty::create("unit", "B"));
+    arenaHighWater->addProperty(StringProperty::create("unit", "B"));
+    loopPeriodMin->addProperty(StringProperty::create("unit", "us"));
+    loopPeriodMean->addProperty(StringProperty::create("unit", "us"));
+    loopPeriodMax->addProperty(StringProperty::create("unit", "us"));
+    core0Busy->addProperty(StringProperty::create("unit", "%"));
+    core1Busy->addProperty(StringProperty::create("unit", "%"));
+    uptime->addProperty(StringProperty::create("unit", "s"));
+
+    reportedAt = time_service_monotonic_us();
+}
+
+Device *Diagnostics::getDevice()
+{
+    return &device;
+}
+
+void Diagnostics::setClient(PicoSparkplugClient *client)
+{
+    this->client = client;
+}
+
+void Diagnostics::addCore1Busy(uint32_t busy)
+{
+    core1BusyUs = core1BusyUs + busy;
+}
+
+uint64_t Diagnostics::interval()
+{
+    int32_t seconds = reportInterval->getValue();
+    seconds = seconds < DIAGNOSTICS_MIN_INTERVAL_S ? DIAGNOSTICS_MIN_INTERVAL_S : seconds;
+    seconds = seconds > DIAGNOSTICS_MAX_INTERVAL_S ? DIAGNOSTICS_MAX_INTERVAL_S : seconds;
+    return (uint64_t)seconds * 1000000;
+}
+
+uint64_t Diagnostics::nextDeadline()
+{
+    return enabled->getValue() ? reportedAt + interval() : UINT64_MAX;
+}
+
+void Diagnostics::pass()
+{
+    uint64_t now = time_service_monotonic_us();
+
+    if (lastPass != 0)
+    {
+        uint64_t period = now - lastPass;
+        uint32_t clamped = period > UINT32_MAX ? UINT32_MAX : (uint32_t)period;
+        periodTotal += period;
+        periodMin = clamped < periodMin ? clamped : periodMin;
+        periodMax = clamped > periodMax ? clamped : periodMax;
+        passes++;
+    }
+    lastPass = now;
+
+    if (now < reportedAt + interval())
+    {
+        return;
+    }
+
+    if (enabled->getValue())
+    {
+        reportHeap();
+        reportLwip();
+        reportArena();
+        reportLoad(now);
+        uptime->setValue((int32_t)(now / 1000000));
+    }
+
+    // Each report covers its own interval, even after a time disabled
+    reportedAt = now;
+    reportedScheduler = scheduler->getStatistics();
+    reportedCore1 = core1BusyUs;
+    passes = 0;
+    periodTotal = 0;
+    periodMin = UINT32_MAX;
+    periodMax = 0;
+}
+
+void Diagnostics::reportHeap()
+{
+    struct mallinfo info = mallinfo();
+    size_t total = &__StackLimit - &__end__;
+
+    // Newlib doesn't give the largest free chunk, but everything above the top of the arena and
+    // the releasable chunk at its top is one block, which a large allocation can always use
+    size_t top = total - info.arena + info.keepcost;
+
+    heapUsed->setValue((int32_t)info.uordblks);
+    heapFree->setValue((int32_t)(total - info.uordblks));
+    heapLargestFree->setValue((int32_t)top);
+}
+
+void Diagnostics::reportLwip()
+{
+#if LWIP_STATS
+    cyw43_arch_lwip_begin();
+#if MEM_STATS
+    lwipMemUsed->setValue((int32_t)lwip_stats.mem.used);
+    lwipMemMax->setValue((int32_t)lwip_stats.mem.max);
+    lwipMemErrors->setValue((int32_t)lwip_stats.mem.err);
+#endif
+#if MEMP_STATS
+    pbufPoolUsed->setValue((int32_t)lwip_stats.memp[MEMP_PBUF_POOL]->used);
+    pbufPoolMax->setValue((int32_t)lwip_stats.memp[MEMP_PBUF_POOL]->max);
+    pbufPoolErrors->setValue((int32_t)lwip_stats.memp[MEMP_PBUF_POOL]->err);
+    tcpSegUsed->setValue((int32_t)lwip_stats.memp[MEMP_TCP_SEG]->used);
+    tcpSegMax->setValue((int32_t)lwip_stats.memp[MEMP_TCP_SEG]->max);
+
+    uint32_t errors = 0;
+    for (int i = 0; i < MEMP_MAX; i++)
+    {
+        errors += lwip_stats.memp[i]->err;
+    }
+    mempErrors->setValue((int32_t)errors);
+#endif
+    cyw43_arch_lwip_end();
+#endif
+}
+
+void Diagnostics::reportArena()
+{
+    if (client == NULL)
+    {
+        return;
+    }
+
+    // Only the transport's rewrites use the arena, cpp_sparkplug's own encoding is part of the heap above
+    ArenaStatistics statistics = client->getArenaStatistics();
+    arenaHighWater->setValue((int32_t)statistics.highWater);
+    arenaOverflows->setValue((int32_t)statistics.overflows);
+}
+
+void Diagnostics::reportLoad(uint64_t now)
+{
+    if (passes > 0)
+    {
+        loopPeriodMin->setValue((int32_t)periodMin);
+        loopPeriodMean->setValue((int32_t)(periodTotal / passes));
+        loopPeriodMax->setValue((int32_t)periodMax);
+    }
+
+    NodeSchedulerStatistics current = scheduler->getStatistics();
+    uint64_t running = current.running - reportedScheduler.running;
+    uint64_t sleeping = current.sleeping - reportedScheduler.sleeping;
+    if (running + sleeping > 0)
+    {
+        core0Busy->setValue((int32_t)(running * 100 / (running + sleeping)));
+    }
+
+    uint64_t elapsed = now - reportedAt;
+    uint32_t core1 = core1BusyUs - reportedCore1;
+    if (elapsed > 0)
+    {
+        uint64_t busy = (uint64_t)core1 * 100 / elapsed;
+        core1Busy->setValue((int32_t)(busy > 100 ? 100 : busy));
+    }
+}
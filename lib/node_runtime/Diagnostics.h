@@ -0,0 +1,145 @@
+/*
+ * File: Diagnostics.h
+ * Project: pico_node_runtime
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef DIAGNOSTICS
+#define DIAGNOSTICS
+
+#include <stdint.h>
+#include <memory>
+
+#include <Device.h>
+#include <metrics/simple/Int32Metric.h>
+#include <metrics/simple/BooleanMetric.h>
+
+#include <NodeScheduler.h>
+
+#define DIAGNOSTICS_DEVICE "Diagnostics"
+// Reports more often than this aren't useful, and the core 1 counter would wrap over long ones
+#define DIAGNOSTICS_MIN_INTERVAL_S 1
+#define DIAGNOSTICS_MAX_INTERVAL_S 3600
+
+class PicoSparkplugClient;
+
+/**
+ * @brief A device that reports the health of the node itself: the heap, lwIP's memory pools,
+ * the Sparkplug client's scratch arena, how regularly the main loop runs, how busy each core is and the uptime.
+ * Reports are made every reportInterval seconds while enabled is true, both can be set by a DCMD.
+ */
+class Diagnostics
+{
+private:
+    Device device;
+    NodeScheduler *scheduler;
+    PicoSparkplugClient *client = NULL;
+
+    std::shared_ptr<BooleanMetric> enabled;
+    std::shared_ptr<Int32Metric> reportInterval;
+
+    std::shared_ptr<Int32Metric> heapFree;
+    std::shared_ptr<Int32Metric> heapLargestFree;
+    std::shared_ptr<Int32Metric> heapUsed;
+    std::shared_ptr<Int32Metric> lwipMemUsed;
+    std::shared_ptr<Int32Metric> lwipMemMax;
+    std::shared_ptr<Int32Metric> lwipMemErrors;
+    std::shared_ptr<Int32Metric> pbufPoolUsed;
+    std::shared_ptr<Int32Metric> pbufPoolMax;
+    std::shared_ptr<Int32Metric> pbufPoolErrors;
+    std::shared_ptr<Int32Metric> tcpSegUsed;
+    std::shared_ptr<Int32Metric> tcpSegMax;
+    std::shared_ptr<Int32Metric> mempErrors;
+    std::shared_ptr<Int32Metric> arenaHighWater;
+    std::shared_ptr<Int32Metric> arenaOverflows;
+    std::shared_ptr<Int32Metric> loopPeriodMin;
+    std::shared_ptr<Int32Metric> loopPeriodMean;
+    std::shared_ptr<Int32Metric> loopPeriodMax;
+    std::shared_ptr<Int32Metric> core0Busy;
+    std::shared_ptr<Int32Metric> core1Busy;
+    std::shared_ptr<Int32Metric> uptime;
+
+    // Loop passes since the last report
+    uint64_t lastPass = 0;
+    uint32_t passes = 0;
+    uint64_t periodTotal = 0;
+    uint32_t periodMin = UINT32_MAX;
+    uint32_t periodMax = 0;
+
+    uint64_t reportedAt = 0;
+    NodeSchedulerStatistics reportedScheduler = {};
+    uint32_t reportedCore1 = 0;
+    // Only written by core 1, a single aligned word so core 0 never reads it torn
+    volatile uint32_t core1BusyUs = 0;
+
+    uint64_t interval();
+    void reportHeap();
+    void reportLwip();
+    void reportArena();
+    void reportLoad(uint64_t now);
+
+public:
+    /**
+     * @brief Construct the diagnostics device
+     *
+     * @param scheduler The scheduler of the main loop, for the time core 0 is busy
+     * @param interval Seconds between reports
+     * @param enabled Whether to report before a DCMD says otherwise
+     */
+    Diagnostics(NodeScheduler *scheduler, uint32_t interval, bool enabled);
+
+    Device *getDevice();
+
+    /**
+     * @brief Sets the client whose scratch arena is reported
+     *
+     * @param client
+     */
+    void setClient(PicoSparkplugClient *client);
+
+    /**
+     * @brief Times a pass of the main loop and reports when the interval is up. Call once per pass.
+     */
+    void pass();
+
+    /**
+     * @brief Get the time of the next report
+     *
+     * @return uint64_t Monotonic time in microseconds, or UINT64_MAX while disabled
+     */
+    uint64_t nextDeadline();
+
+    /**
+     * @brief Adds to the time core 1 has been busy. Only call it from core 1.
+     *
+     * @param busy Microseconds of work
+     */
+    void addCore1Busy(uint32_t busy);
+};
+
+#endif /* DIAGNOSTICS */
@@ -0,0 +1,485 @@
+/*
+ * File: NodeRuntime.cpp
+ * Project: pico_node_runtime
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#include "NodeRuntime.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+
+#include "lwip/dhcp.h"
+#include "lwip/dns.h"
+#include "lwip/netif.h"
+#include "lwip/prot/dhcp.h"
+
+#include "properties/simple/StringProperty.h"
+#include <time_service.h>
+
+// Not exported by the driver, WLC_GET_CHANNEL in the get form the driver's ioctl expects
+#ifndef CYW43_IOCTL_GET_CHANNEL
+#define CYW43_IOCTL_GET_CHANNEL (0x3a)
+#endif
+
+struct NodeRuntime::Private
+{
+    static uint64_t clientDeadline(void *context)
+    {
+        return ((PicoSparkplugClient *)context)->nextDeadline();
+    }
+
+    static uint64_t diagnosticsDeadline(void *context)
+    {
+        return ((Diagnostics *)context)->nextDeadline();
+    }
+
+    static bool isSet(const char *value)
+    {
+        return value != NULL && strlen(value) > 0;
+    }
+
+    static struct netif *staNetif()
+    {
+        return &cyw43_state.netif[CYW43_ITF_STA];
+    }
+
+    static bool parseAddress(const char *name, const char *value, ip4_addr_t *address)
+    {
+        if (!isSet(value) || !ip4addr_aton(value, address))
+        {
+            printf("Invalid %s address: %s\n", name, value ? value : "(null)");
+            return false;
+        }
+        return true;
+    }
+};
+
+NodeRuntime::NodeRuntime(const NodeRuntimeOptions *options)
+    : options(*options),
+      nodeOptions(options->groupId, options->nodeId, options->hostId, options->period, NODE_CONTROL_REBIRTH),
+      clientOptions{.address = Uri(options->brokerAddress),
+                    .clientId = clientId,
+                    .username = NULL,
+                    .password = NULL,
+                    .connectTimeout = NODE_RUNTIME_CONNECT_TIMEOUT_MS,
+                    .keepAliveInterval = NODE_RUNTIME_KEEP_ALIVE_S},
+      node(&nodeOptions),
+      scheduler(options->period),
+      diagnostics(&scheduler, options->diagnosticsInterval ? options->diagnosticsInterval : NODE_RUNTIME_DIAGNOSTICS_INTERVAL_S,
+                  options->diagnostics)
+{
+    snprintf(clientId, sizeof(clientId), "%s_%lu", options->clientIdPrefix, (unsigned long)get_rand_32());
+
+    client = node.addClient<PicoSparkplugClient>(&clientOptions);
+    // The NTP client itself needs lwIP, it is made once run has started the chip
+    if (Private::isSet(options->ntpAddress))
+    {
+        client->publishNtpMetrics((Publishable *)&node);
+    }
+
+    // Data is held back while the primary host is away, and stored if the project stores samples
+    if (Private::isSet(options->hostId))
+    {
+        client->followPrimaryHost(options->hostId);
+    }
+
+    scheduler.addDeadline(Private::clientDeadline, client);
+
+    diagnostics.setClient(client);
+    node.addDevice(diagnostics.getDevice());
+    scheduler.addDeadline(Private::diagnosticsDeadline, &diagnostics);
+
+    ((Publishable *)&node)->addMetrics({
+        joinTime = Int32Metric::create("runtime/joinTime", 0),
+        addressTime = Int32Metric::create("runtime/addressTime", 0),
+        ntpTime = Int32Metric::create("runtime/ntpTime", 0),
+        activeTime = Int32Metric::create("runtime/activeTime", 0),
+    });
+    joinTime->addProperty(StringProperty::create("unit", "ms"));
+    addressTime->addProperty(StringProperty::create("unit", "ms"));
+    ntpTime->addProperty(StringProperty::create("unit", "ms"));
+    activeTime->addProperty(StringProperty::create("unit", "ms"));
+}
+
+Node *NodeRuntime::getNode()
+{
+    return &node;
+}
+
+PicoSparkplugClient *NodeRuntime::getClient()
+{
+    return client;
+}
+
+NodeScheduler *NodeRuntime::getScheduler()
+{
+    return &scheduler;
+}
+
+Diagnostics *NodeRuntime::getDiagnostics()
+{
+    return &diagnostics;
+}
+
+void NodeRuntime::addTask(NodeRuntimeTask callback, void *context)
+{
+    tasks.push_back({.callback = callback, .context = context});
+}
+
+void NodeRuntime::addDeadline(NodeDeadlineCallback callback, void *context)
+{
+    scheduler.addDeadline(callback, context);
+}
+
+NodeRuntimeTimings NodeRuntime::getTimings()
+{
+    return timings;
+}
+
+void NodeRuntime::runTasks()
+{
+    diagnostics.pass();
+    for (auto &task : tasks)
+    {
+        task.callback(task.context);
+    }
+}
+
+uint32_t NodeRuntime::sinceAttempt()
+{
+    return (uint32_t)((time_service_monotonic_us() - attemptStart) / TIME_SERVICE_US_PER_MS);
+}
+
+bool NodeRuntime::startJoin(bool fast)
+{
+    const uint8_t *bssid = fast ? association.bssid : NULL;
+    uint32_t channel = fast ? association.channel : CYW43_CHANNEL_NONE;
+
+    int result = cyw43_wifi_join(&cyw43_state, strlen(options.ssid), (const uint8_t *)options.ssid,
+                                 strlen(options.password), (const uint8_t *)options.password,
+                                 CYW43_AUTH_WPA2_AES_PSK, bssid, channel);
+    if (result)
+    {
+        printf("failed to start join: %d\n", result);
+        return false;
+    }
+    return true;
+}
+
+bool NodeRuntime::joinWifi()
+{
+    bool fast = options.fastJoin && association.valid;
+    uint64_t deadline = time_service_monotonic_us() +
+                        (uint64_t)(fast ? NODE_RUNTIME_FAST_JOIN_TIMEOUT_MS : NODE_RUNTIME_WIFI_TIMEOUT_MS) * TIME_SERVICE_US_PER_MS;
+
+    attemptStart = time_service_monotonic_us();
+    timings = {};
+    timings.fastJoin = fast;
+    ntpSyncs = client->getNtpClient() ? client->getNtpClient()->getStatistics().syncs : 0;
+
+    if (fast)
+    {
+        printf("Rejoining WiFi on channel %lu...\n", (unsigned long)association.channel);
+    }
+    else
+    {
+        printf("Connecting to WiFi...\n");
+    }
+    if (!startJoin(fast))
+    {
+        return false;
+    }
+
+    // The link status is polled as the join runs, so tasks keep sampling while the chip associates
+    bool joined = false;
+    while (true)
+    {
+        int status = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+
+        if (!joined && (status == CYW43_LINK_NOIP || status == CYW43_LINK_UP))
+        {
+            joined = true;
+            associated();
+        }
+
+        if (status == CYW43_LINK_UP)
+        {
+            break;
+        }
+
+        if (status < 0 || time_service_reached(deadline))
+        {
+            // The access point may have moved channel or gone, forget it and scan for the network
+            if (fast && !joined)
+            {
+                printf("fast join failed (%d), scanning.\n", status);
+                fast = false;
+                timings.fastJoin = false;
+                association.valid = false;
+                deadline = time_service_monotonic_us() + (uint64_t)NODE_RUNTIME_WIFI_TIMEOUT_MS * TIME_SERVICE_US_PER_MS;
+                cyw43_wifi_leave(&cyw43_state, CYW43_ITF_STA);
+                if (!startJoin(false))
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            printf("failed to connect: %d\n", status);
+            cyw43_wifi_leave(&cyw43_state, CYW43_ITF_STA);
+            return false;
+        }
+
+        runTasks();
+        scheduler.wakeBy(time_service_monotonic_us() + (uint64_t)NODE_RUNTIME_LINK_POLL_MS * TIME_SERVICE_US_PER_MS);
+        scheduler.wait();
+    }
+
+    addressed();
+    printf("WIFI Connected.\n");
+    return true;
+}
+
+void NodeRuntime::associated()
+{
+    timings.joined = sinceAttempt();
+
+    // Remember where the network was, so the next join can skip the scan
+    uint32_t channel[3] = {};
+    if (cyw43_wifi_get_bssid(&cyw43_state, association.bssid) == 0 &&
+        cyw43_ioctl(&cyw43_state, CYW43_IOCTL_GET_CHANNEL, sizeof(channel), (uint8_t *)channel, CYW43_ITF_STA) == 0)
+    {
+        association.channel = channel[0];
+        association.valid = true;
+    }
+
+    if (Private::isSet(options.staticIp) || !options.fastJoin || !association.hasLease ||
+        time_service_reached(association.leaseExpires))
+    {
+        return;
+    }
+
+    // lwIP confirms a lease it still holds with an INIT-REBOOT request, the address is used in the
+    // meantime instead of waiting for the reply. A NAK clears it and DHCP starts over.
+    cyw43_arch_lwip_begin();
+    struct netif *netif = Private::staNetif();
+    struct dhcp *dhcp = netif_dhcp_data(netif);
+    if (dhcp != NULL && dhcp->state == DHCP_STATE_REBOOTING)
+    {
+        if (ip4_addr_isany_val(*netif_ip4_addr(netif)))
+        {
+            netif_set_addr(netif, &association.address, &association.netmask, &association.gateway);
+        }
+        timings.cachedLease = true;
+    }
+    cyw43_arch_lwip_end();
+}
+
+void NodeRuntime::addressed()
+{
+    timings.addressed = sinceAttempt();
+
+    if (!Private::isSet(options.staticIp))
+    {
+        cyw43_arch_lwip_begin();
+        struct netif *netif = Private::staNetif();
+        struct dhcp *dhcp = netif_dhcp_data(netif);
+        if (dhcp != NULL && dhcp->state == DHCP_STATE_BOUND)
+        {
+            association.hasLease = true;
+            association.address = dhcp->offered_ip_addr;
+            association.netmask = dhcp->offered_sn_mask;
+            association.gateway = dhcp->offered_gw_addr;
+            association.leaseExpires = time_service_monotonic_us() + (uint64_t)dhcp->offered_t0_lease * 1000000;
+        }
+        cyw43_arch_lwip_end();
+    }
+
+    // Group memberships are reported on the new link, and the first sync runs alongside the
+    // broker connection rather than after it
+    if (client->getNtpClient())
+    {
+        client->joinNtpGroup();
+        client->getNtpClient()->sync();
+    }
+}
+
+bool NodeRuntime::useStaticAddress()
+{
+    ip4_addr_t address, netmask, gateway, dnsServer;
+    if (!Private::parseAddress("static", options.staticIp, &address) ||
+        !Private::parseAddress("netmask", options.netmask, &netmask) ||
+        !Private::parseAddress("gateway", options.gateway, &gateway) ||
+        !Private::parseAddress("DNS server", options.dnsServer, &dnsServer))
+    {
+        return false;
+    }
+
+    ip_addr_t dns;
+    ip_addr_copy_from_ip4(dns, dnsServer);
+
+    cyw43_arch_lwip_begin();
+    struct netif *netif = Private::staNetif();
+    dhcp_release_and_stop(netif);
+    netif_set_addr(netif, &address, &netmask, &gateway);
+    dns_setserver(0, &dns);
+    cyw43_arch_lwip_end();
+
+    printf("Using static address %s\n", options.staticIp);
+    return true;
+}
+
+bool NodeRuntime::linkUp()
+{
+    return cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA) == CYW43_LINK_JOIN;
+}
+
+void NodeRuntime::waitUntil(uint64_t deadline)
+{
+    while (!time_service_reached(deadline))
+    {
+        runTasks();
+        scheduler.wakeBy(deadline);
+        scheduler.wait();
+    }
+}
+
+void NodeRuntime::trackNtp()
+{
+    NtpClient *ntpClient = client->getNtpClient();
+    if (timings.ntpSynced == 0 && ntpClient != NULL && ntpClient->getStatistics().syncs != ntpSyncs)
+    {
+        timings.ntpSynced = sinceAttempt();
+        ntpTime->setValue((int32_t)timings.ntpSynced);
+    }
+}
+
+void NodeRuntime::trackHost()
+{
+    if (client->isPrimaryHostOnline() != hostOnline)
+    {
+        hostOnline = !hostOnline;
+        printf(hostOnline ? "Primary host %s is online, publishing\n" : "Primary host %s is offline, pausing data\n",
+               options.hostId);
+    }
+}
+
+bool NodeRuntime::waitForActive()
+{
+    uint64_t deadline = time_service_monotonic_us() + (uint64_t)NODE_RUNTIME_ACTIVE_TIMEOUT_MS * TIME_SERVICE_US_PER_MS;
+
+    while (!node.isActive())
+    {
+        if (time_service_reached(deadline))
+        {
+            return false;
+        }
+        if (client->getNtpClient())
+        {
+            client->getNtpClient()->sync();
+        }
+        trackNtp();
+        runTasks();
+        scheduler.wakeBy(deadline);
+        scheduler.wait();
+    }
+
+    if (timings.active == 0)
+    {
+        timings.active = sinceAttempt();
+        trackNtp();
+        joinTime->setValue((int32_t)timings.joined);
+        addressTime->setValue((int32_t)timings.addressed);
+        activeTime->setValue((int32_t)timings.active);
+        printf("Active in %lu ms: joined %lu ms%s, address %lu ms%s, NTP %lu ms\n",
+               (unsigned long)timings.active, (unsigned long)timings.joined, timings.fastJoin ? " (cached)" : "",
+               (unsigned long)timings.addressed, timings.cachedLease ? " (cached)" : "", (unsigned long)timings.ntpSynced);
+    }
+
+    return true;
+}
+
+void NodeRuntime::execute()
+{
+    printf("Node is Active, starting Sparkplug execution\n");
+    while (node.isActive())
+    {
+        trackNtp();
+        trackHost();
+        runTasks();
+        node.execute(scheduler.elapsed());
+        scheduler.wait();
+    }
+    printf("Node is no longer Active, checking wifi status\n");
+}
+
+int NodeRuntime::run()
+{
+    if (cyw43_arch_init())
+    {
+        printf("failed to initialise\n");
+        return 1;
+    }
+    cyw43_arch_enable_sta_mode();
+    if (Private::isSet(options.staticIp) && !useStaticAddress())
+    {
+        return 1;
+    }
+    if (Private::isSet(options.ntpAddress))
+    {
+        client->useNtpServer(options.ntpAddress, NODE_RUNTIME_NTP_PORT);
+        if (Private::isSet(options.ntpBroadcast))
+        {
+            client->listenNtpBroadcast(options.ntpBroadcast);
+        }
+    }
+    scheduler.begin();
+
+    node.enable();
+
+    while (true)
+    {
+        if (joinWifi())
+        {
+            while (linkUp())
+            {
+                if (waitForActive())
+                {
+                    execute();
+                }
+            }
+        }
+
+        printf("WIFI not connected, waiting %d seconds\n", NODE_RUNTIME_WIFI_RETRY_MS / 1000);
+        waitUntil(time_service_monotonic_us() + (uint64_t)NODE_RUNTIME_WIFI_RETRY_MS * TIME_SERVICE_US_PER_MS);
+    }
+}
@@ -0,0 +1,225 @@
+/*
+ * File: NodeRuntime.h
+ * Project: pico_node_runtime
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef NODE_RUNTIME
+#define NODE_RUNTIME
+
+#include <stdint.h>
+#include <vector>
+
+#include <Node.h>
+#include <PicoSparkplugClient.h>
+#include <NodeScheduler.h>
+#include "Diagnostics.h"
+#include <metrics/simple/Int32Metric.h>
+#include <memory>
+
+#include "lwip/ip4_addr.h"
+
+#define NODE_RUNTIME_CLIENT_ID_SIZE 40
+#define NODE_RUNTIME_NTP_PORT 123
+#define NODE_RUNTIME_CONNECT_TIMEOUT_MS 5000
+#define NODE_RUNTIME_KEEP_ALIVE_S 5
+
+// How long joining the network is given before it is tried again
+#define NODE_RUNTIME_WIFI_TIMEOUT_MS 30000
+// How long a join to the cached access point is given before falling back to a scan
+#define NODE_RUNTIME_FAST_JOIN_TIMEOUT_MS 3000
+// Link changes don't always raise an interrupt, so the status is checked this often while joining
+#define NODE_RUNTIME_LINK_POLL_MS 10
+#define NODE_RUNTIME_WIFI_RETRY_MS 5000
+// How long the node is given to become active once the network is up
+#define NODE_RUNTIME_ACTIVE_TIMEOUT_MS 5000
+// Seconds between reports of the diagnostics device when the options don't give one
+#define NODE_RUNTIME_DIAGNOSTICS_INTERVAL_S 60
+
+/**
+ * @brief Runs a part of the project on every pass of the loop, online or not
+ *
+ * @param context
+ */
+typedef void (*NodeRuntimeTask)(void *context);
+
+/**
+ * @brief What the runtime needs to bring a node online
+ */
+typedef struct
+{
+    const char *ssid;
+    const char *password;
+    const char *brokerAddress;
+    // Empty or NULL to use the monotonic clock for timestamps
+    const char *ntpAddress;
+    // Empty or NULL to only sync with unicast requests
+    const char *ntpBroadcast;
+    const char *groupId;
+    const char *nodeId;
+    // Empty or NULL to publish whether or not a primary host is online
+    const char *hostId;
+    // Start of the MQTT client ID, a random number is added to it
+    const char *clientIdPrefix;
+    // Period of the node in milliseconds. The loop runs at least this often.
+    uint32_t period;
+    // Rejoins the access point of the last connection on its channel without scanning, and
+    // uses the last DHCP lease straight away while it is confirmed
+    bool fastJoin;
+    // Empty or NULL to use DHCP. The netmask, gateway and DNS server are needed with an address.
+    const char *staticIp;
+    const char *netmask;
+    const char *gateway;
+    const char *dnsServer;
+    // Whether the Diagnostics device reports from boot, a DCMD to its enabled metric can change it
+    bool diagnostics;
+    // Seconds between diagnostics reports, or 0 for NODE_RUNTIME_DIAGNOSTICS_INTERVAL_S
+    uint32_t diagnosticsInterval;
+} NodeRuntimeOptions;
+
+/**
+ * @brief How long each stage of the last connection took, in milliseconds from the join starting.
+ * A stage that hasn't been reached is 0.
+ */
+typedef struct
+{
+    uint32_t joined;
+    uint32_t addressed;
+    uint32_t ntpSynced;
+    uint32_t active;
+    // Whether the access point was joined from the cache, and the address came from the cached lease
+    bool fastJoin;
+    bool cachedLease;
+} NodeRuntimeTimings;
+
+/**
+ * @brief Owns the parts every node has: the Wi-Fi connection, the Sparkplug node with its
+ * client and NTP, the diagnostics device, reconnecting, and the loop that runs it all on a NodeScheduler.
+ * A project adds its metrics and devices to the node, tasks for its sensors and deadlines
+ * for them, then calls run.
+ */
+class NodeRuntime
+{
+private:
+    typedef struct
+    {
+        NodeRuntimeTask callback;
+        void *context;
+    } Task;
+
+    // The access point and address of the last good connection
+    typedef struct
+    {
+        bool valid;
+        uint8_t bssid[6];
+        uint32_t channel;
+        bool hasLease;
+        ip4_addr_t address;
+        ip4_addr_t netmask;
+        ip4_addr_t gateway;
+        uint64_t leaseExpires;
+    } Association;
+
+    NodeRuntimeOptions options;
+    char clientId[NODE_RUNTIME_CLIENT_ID_SIZE];
+    NodeOptions nodeOptions;
+    ClientOptions clientOptions;
+    Node node;
+    PicoSparkplugClient *client;
+    NodeScheduler scheduler;
+    Diagnostics diagnostics;
+    std::vector<Task> tasks;
+
+    Association association = {};
+    uint64_t attemptStart = 0;
+    NodeRuntimeTimings timings = {};
+    // NTP syncs before the join, the first one after it is the stage
+    uint32_t ntpSyncs = 0;
+    bool hostOnline = true;
+    std::shared_ptr<Int32Metric> joinTime;
+    std::shared_ptr<Int32Metric> addressTime;
+    std::shared_ptr<Int32Metric> ntpTime;
+    std::shared_ptr<Int32Metric> activeTime;
+
+    struct Private;
+
+    bool joinWifi();
+    bool startJoin(bool fast);
+    void associated();
+    void addressed();
+    bool useStaticAddress();
+    void trackNtp();
+    void trackHost();
+    uint32_t sinceAttempt();
+    bool linkUp();
+    bool waitForActive();
+    void execute();
+    void waitUntil(uint64_t deadline);
+    void runTasks();
+
+public:
+    NodeRuntime(const NodeRuntimeOptions *options);
+
+    Node *getNode();
+    PicoSparkplugClient *getClient();
+    NodeScheduler *getScheduler();
+    Diagnostics *getDiagnostics();
+
+    /**
+     * @brief Adds a task that runs on every pass of the loop, such as reading a sensor.
+     * Tasks keep running while the node is offline, so samples can be stored.
+     *
+     * @param callback
+     * @param context Passed to the callback
+     */
+    void addTask(NodeRuntimeTask callback, void *context);
+
+    /**
+     * @brief Adds a source of deadlines to the scheduler, for tasks that need to run at a time
+     *
+     * @param callback
+     * @param context Passed to the callback
+     */
+    void addDeadline(NodeDeadlineCallback callback, void *context);
+
+    /**
+     * @brief Get how long each stage of the last connection took
+     *
+     * @return NodeRuntimeTimings
+     */
+    NodeRuntimeTimings getTimings();
+
+    /**
+     * @brief Initialises the Wi-Fi chip and runs the node, reconnecting whenever it drops
+     *
+     * @return int Only returns if the Wi-Fi chip couldn't be initialised or the static address is invalid
+     */
+    int run();
+};
+
+#endif /* NODE_RUNTIME */
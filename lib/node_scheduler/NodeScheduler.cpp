@@ -0,0 +1,146 @@
+/*
+ * File: NodeScheduler.cpp
+ * Project: pico_node_scheduler
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#include "NodeScheduler.h"
+
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "pico/async_context.h"
+
+#include <time_service.h>
+
+struct NodeScheduler::Private
+{
+    // Waking only needs the wait to return, the work is done by the node loop
+    static void wakeWork(__attribute__((unused)) async_context_t *context, __attribute__((unused)) async_when_pending_worker_t *worker)
+    {
+    }
+
+    static async_when_pending_worker_t wakeWorker;
+    static bool registered;
+};
+
+async_when_pending_worker_t NodeScheduler::Private::wakeWorker = {.do_work = NodeScheduler::Private::wakeWork};
+bool NodeScheduler::Private::registered = false;
+
+NodeScheduler::NodeScheduler(uint32_t maxSleep) : maxSleep(maxSleep)
+{
+    executed = time_service_monotonic_us();
+    runningSince = executed;
+}
+
+void NodeScheduler::begin()
+{
+    if (!Private::registered)
+    {
+        async_context_add_when_pending_worker(cyw43_arch_async_context(), &Private::wakeWorker);
+        Private::registered = true;
+    }
+}
+
+void NodeScheduler::addDeadline(NodeDeadlineCallback callback, void *context)
+{
+    sources.push_back({.callback = callback, .context = context});
+}
+
+void NodeScheduler::wakeBy(uint64_t deadline)
+{
+    requested = deadline < requested ? deadline : requested;
+}
+
+uint64_t NodeScheduler::nextDeadline()
+{
+    uint64_t deadline = requested;
+
+    for (auto &source : sources)
+    {
+        uint64_t next = source.callback(source.context);
+        deadline = next < deadline ? next : deadline;
+    }
+
+    return deadline;
+}
+
+void NodeScheduler::wait()
+{
+    uint64_t now = time_service_monotonic_us();
+    uint64_t limit = now + (uint64_t)maxSleep * TIME_SERVICE_US_PER_MS;
+    uint64_t deadline = nextDeadline();
+
+    deadline = deadline < limit ? deadline : limit;
+    requested = NODE_SCHEDULER_NO_DEADLINE;
+    statistics.running += now - runningSince;
+
+    if (deadline > now)
+    {
+        // Returns early once the cyw43 interrupt or a wake has made work pending
+        cyw43_arch_wait_for_work_until(from_us_since_boot(deadline));
+    }
+
+#if PICO_CYW43_ARCH_POLL
+    cyw43_arch_poll();
+#endif
+
+    runningSince = time_service_monotonic_us();
+    statistics.sleeping += runningSince - now;
+    if (runningSince >= deadline)
+    {
+        statistics.deadlines++;
+    }
+    else
+    {
+        statistics.events++;
+    }
+}
+
+uint32_t NodeScheduler::elapsed()
+{
+    uint64_t now = time_service_monotonic_us();
+    uint32_t milliseconds = (now - executed) / TIME_SERVICE_US_PER_MS;
+
+    executed += (uint64_t)milliseconds * TIME_SERVICE_US_PER_MS;
+    return milliseconds;
+}
+
+void NodeScheduler::wake()
+{
+    if (Private::registered)
+    {
+        async_context_set_work_pending(cyw43_arch_async_context(), &Private::wakeWorker);
+    }
+}
+
+NodeSchedulerStatistics NodeScheduler::getStatistics()
+{
+    NodeSchedulerStatistics current = statistics;
+    current.running += time_service_monotonic_us() - runningSince;
+    return current;
+}
@@ -0,0 +1,144 @@
+/*
+ * File: NodeScheduler.h
+ * Project: pico_node_scheduler
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef NODE_SCHEDULER
+#define NODE_SCHEDULER
+
+#include <stdint.h>
+#include <vector>
+
+// A deadline source with nothing due
+#define NODE_SCHEDULER_NO_DEADLINE UINT64_MAX
+
+/**
+ * @brief Gets the next time a part of the node has work to do
+ *
+ * @param context
+ * @return uint64_t Monotonic time in microseconds, or NODE_SCHEDULER_NO_DEADLINE
+ */
+typedef uint64_t (*NodeDeadlineCallback)(void *context);
+
+/**
+ * @brief How the node spent its time. Times are in microseconds.
+ */
+typedef struct
+{
+    // Time spent waiting for work
+    uint64_t sleeping;
+    // Time spent running between waits
+    uint64_t running;
+    // Waits that ended at a deadline
+    uint32_t deadlines;
+    // Waits that ended early, for network work or a wake from an interrupt
+    uint32_t events;
+} NodeSchedulerStatistics;
+
+/**
+ * @brief Runs the node loop only when there is work for it.
+ * Each wait sleeps until the earliest deadline of the node's parts, until the network has
+ * work, or until an interrupt calls wake, whichever comes first. Parts whose timers can't be
+ * seen from outside are run at least every maxSleep.
+ */
+class NodeScheduler
+{
+private:
+    typedef struct
+    {
+        NodeDeadlineCallback callback;
+        void *context;
+    } DeadlineSource;
+
+    std::vector<DeadlineSource> sources;
+    uint32_t maxSleep;
+    uint64_t requested = NODE_SCHEDULER_NO_DEADLINE;
+    uint64_t executed = 0;
+    uint64_t runningSince = 0;
+    NodeSchedulerStatistics statistics = {};
+
+    struct Private;
+
+public:
+    /**
+     * @brief Construct a new Node Scheduler
+     *
+     * @param maxSleep The longest wait in milliseconds
+     */
+    NodeScheduler(uint32_t maxSleep);
+
+    /**
+     * @brief Lets interrupts and the other core wake the node. Call once after cyw43_arch_init.
+     */
+    void begin();
+
+    /**
+     * @brief Adds a source of deadlines, asked for its next deadline before every wait
+     *
+     * @param callback
+     * @param context Passed to the callback
+     */
+    void addDeadline(NodeDeadlineCallback callback, void *context);
+
+    /**
+     * @brief Ends the next wait no later than the deadline
+     *
+     * @param deadline Monotonic time in microseconds
+     */
+    void wakeBy(uint64_t deadline);
+
+    /**
+     * @brief Get the earliest deadline of the sources and requested wakes
+     *
+     * @return uint64_t Monotonic time in microseconds
+     */
+    uint64_t nextDeadline();
+
+    /**
+     * @brief Sleeps until the next deadline, network work or a wake, then polls the network
+     */
+    void wait();
+
+    /**
+     * @brief Get the milliseconds since this was last called, for the node's execute.
+     * The part of a millisecond left over is carried to the next call.
+     *
+     * @return uint32_t
+     */
+    uint32_t elapsed();
+
+    /**
+     * @brief Ends the current or next wait. Safe to call from an interrupt handler or the other core.
+     */
+    static void wake();
+
+    NodeSchedulerStatistics getStatistics();
+};
+
+#endif /* NODE_SCHEDULER */
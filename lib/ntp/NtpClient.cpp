@@ -4,15 +4,34 @@
 #include <iostream>
 #include <iomanip>
 #include <cstdint>
+#include <cmath>
 #include "hardware/timer.h"
-#include "hardware/sync.h"
+#include "lwip/igmp.h"
 
 #define NTP_SERVER "pool.ntp.org"
 #define NTP_MSG_LEN 48
 #define NTP_PORT 123
 #define NTP_DELTA 2208988800 // seconds between 1 Jan 1900 and 1 Jan 1970
 #define SECONDS_TO_MS 1000
+#define SECONDS_TO_US 1000000
 #define NTP_RESEND_TIME (10 * SECONDS_TO_MS)
+// First retry after a failed sync, doubled for every failure in a row up to the sync time
+#define NTP_RETRY_TIME 16
+
+#define NTP_RESULT_OK 0
+#define NTP_RESULT_FAILED -1
+#define NTP_RESULT_KISS_OF_DEATH -2
+
+#define NTP_ORIGINATE_OFFSET 24
+#define NTP_RECEIVE_OFFSET 32
+#define NTP_TRANSMIT_OFFSET 40
+#define NTP_LEAP_ALARM 0x3
+#define NTP_MODE_SERVER 0x4
+#define NTP_MODE_BROADCAST 0x5
+// Weight of new samples in the jitter and drift running averages
+#define NTP_AVERAGE_WEIGHT 4
+// Corrections larger than this are treated as a step of the server clock
+#define NTP_STEP_THRESHOLD 128000
 
 struct NtpClient::Private
 {
@@ -35,43 +54,143 @@ struct NtpClient::Private
     }
 };
 
+uint64_t NtpClient::nextSync()
+{
+    // The resend alarm covers a request that gets no reply
+    if (dns_request_sent)
+    {
+        return UINT64_MAX;
+    }
+
+    uint64_t next = syncStamp;
+    if (listening && lastSyncTime > 0 && !broadcastSilent)
+    {
+        uint64_t silence = lastSyncTime + (uint64_t)syncTime * SECONDS_TO_US;
+        next = silence < next ? silence : next;
+    }
+
+    return next;
+}
+
 void NtpClient::sync()
 {
+    if (dns_request_sent)
+    {
+        return;
+    }
+
+    // While listening the unicast exchange only calibrates the path delay, unless the broadcasts have
+    // stopped arriving. The silence brings the next request forward once, after that result() owns
+    // the schedule so failures still back off.
+    uint64_t silence = lastSyncTime + (uint64_t)syncTime * SECONDS_TO_US;
+    if (listening && lastSyncTime > 0 && !broadcastSilent && time_service_monotonic_us() > silence)
     {
-        if (absolute_time_diff_us(get_absolute_time(), this->syncStamp) < 0 && !this->dns_request_sent)
+        broadcastSilent = true;
+        if (silence < syncStamp)
         {
+            syncStamp = silence;
+        }
+    }
+
+    if (!time_service_reached(this->syncStamp))
+    {
+        return;
+    }
+
+    // Set alarm in case udp requests are lost
+    ntp_resend_alarm = add_alarm_in_ms(NTP_RESEND_TIME, Private::failed, this, true);
+    dns_request_sent = true;
+
+    // The server address is only looked up again after a failure
+    if (serverResolved)
+    {
+        request();
+        return;
+    }
 
-            // Set alarm in case udp requests are lost
-            ntp_resend_alarm = add_alarm_in_ms(NTP_RESEND_TIME, Private::failed, this, true);
 #if PICO_CYW43_ARCH_THREADSAFE_BACKGROUND
-            // cyw43_arch_lwip_begin/end should be used around calls into lwIP to ensure correct locking.
-            // You can omit them if you are in a callback from lwIP. Note that when using pico_cyw_arch_poll
-            // these calls are a no-op and can be omitted, but it is a good practice to use them in
-            // case you switch the cyw43_arch type later.
-            cyw43_arch_lwip_begin();
+    // cyw43_arch_lwip_begin/end should be used around calls into lwIP to ensure correct locking.
+    // You can omit them if you are in a callback from lwIP. Note that when using pico_cyw_arch_poll
+    // these calls are a no-op and can be omitted, but it is a good practice to use them in
+    // case you switch the cyw43_arch type later.
+    cyw43_arch_lwip_begin();
 #endif
-            int err = dns_gethostbyname(address.c_str(), &ntp_server_address, Private::dnsFound, this);
+    int err = dns_gethostbyname(address.c_str(), &ntp_server_address, Private::dnsFound, this);
 #if PICO_CYW43_ARCH_THREADSAFE_BACKGROUND
-            cyw43_arch_lwip_end();
+    cyw43_arch_lwip_end();
 #endif
 
-            dns_request_sent = true;
-            if (err == ERR_OK)
-            {
-                request(); // Cached result
-            }
-            else if (err != ERR_INPROGRESS)
-            { // ERR_INPROGRESS means expect a callback
-                printf("dns request failed\n");
-                result(-1, NULL);
-            }
-        }
+    if (err == ERR_OK)
+    {
+        serverResolved = true;
+        request(); // Cached result
+    }
+    else if (err != ERR_INPROGRESS)
+    { // ERR_INPROGRESS means expect a callback
+        printf("dns request failed\n");
+        statistics.dnsFailures++;
+        result(NTP_RESULT_FAILED, 0, 0);
     }
 }
 
+void NtpClient::listen(const char *group, size_t calibrationTime)
+{
+    listening = true;
+    this->calibrationTime = calibrationTime;
+
+    udp_bind(ntp_pcb, IP_ANY_TYPE, NTP_PORT);
+
+    hasGroup = group && ip4addr_aton(group, &this->group) && ip4_addr_ismulticast(&this->group);
+}
+
+void NtpClient::joinGroup()
+{
+#if LWIP_IGMP
+    if (!hasGroup)
+    {
+        return;
+    }
+
+    // The membership is left first so repeated joins don't pile up in lwIP's use count
+#if PICO_CYW43_ARCH_THREADSAFE_BACKGROUND
+    cyw43_arch_lwip_begin();
+#endif
+    if (joined)
+    {
+        igmp_leavegroup(IP4_ADDR_ANY4, &group);
+    }
+    joined = igmp_joingroup(IP4_ADDR_ANY4, &group) == ERR_OK;
+#if PICO_CYW43_ARCH_THREADSAFE_BACKGROUND
+    cyw43_arch_lwip_end();
+#endif
+#endif
+}
+
+void NtpClient::setOffset(int64_t offset)
+{
+    time_service_set_utc_offset(offset);
+}
+
+int64_t NtpClient::getOffset()
+{
+    return time_service_utc_offset();
+}
+
 time_t NtpClient::getTime()
 {
-    return ((time_t)us_to_ms(time_us_64())) + hardwareOffset;
+    return getTime(time_service_monotonic_us());
+}
+
+time_t NtpClient::getTime(uint64_t timestampUs)
+{
+    return (time_t)(((int64_t)timestampUs + getOffset()) / (SECONDS_TO_US / SECONDS_TO_MS));
+}
+
+NtpStatistics NtpClient::getStatistics()
+{
+    NtpStatistics current = statistics;
+    current.sinceSync = lastSyncTime ? (int64_t)(time_service_monotonic_us() - lastSyncTime) : -1;
+    return current;
 }
 
 void NtpClient::request()
@@ -89,6 +208,15 @@ void NtpClient::request()
     uint8_t *req = (uint8_t *)p->payload;
     memset(req, 0, NTP_MSG_LEN);
     req[0] = 0x1b;
+
+    // The transmit timestamp is echoed back as the originate timestamp, which lets
+    // us match the response to this request and measure the round trip.
+    requestTime = time_service_monotonic_us();
+    for (int i = 0; i < 8; i++)
+    {
+        req[NTP_TRANSMIT_OFFSET + i] = (uint8_t)(requestTime >> (56 - (i * 8)));
+    }
+
     udp_sendto(ntp_pcb, p, &ntp_server_address, port);
     pbuf_free(p);
 #if PICO_CYW43_ARCH_THREADSAFE_BACKGROUND
@@ -96,42 +224,151 @@ void NtpClient::request()
 #endif
 }
 
-void NtpClient::result(int status, time_t *result)
+void NtpClient::adjust(int64_t offset, int64_t delay)
+{
+    uint64_t now = time_service_monotonic_us();
+
+    if (statistics.syncs > 0)
+    {
+        int64_t correction = offset - getOffset();
+        int64_t change = correction - lastCorrection;
+
+        // Steps of the server clock say nothing about the quality of ours
+        if (correction < NTP_STEP_THRESHOLD && correction > -NTP_STEP_THRESHOLD)
+        {
+            // A hardware clock running fast pulls the offset down between syncs
+            float drift = -((float)correction * 1000000.0f) / (float)(now - lastSyncTime);
+
+            if (driftSamples++ > 0)
+            {
+                jitterSquared += ((float)change * (float)change - jitterSquared) / NTP_AVERAGE_WEIGHT;
+                statistics.drift += (drift - statistics.drift) / NTP_AVERAGE_WEIGHT;
+                statistics.jitter = (int64_t)sqrtf(jitterSquared);
+            }
+            else
+            {
+                statistics.drift = drift;
+            }
+            lastCorrection = correction;
+        }
+        statistics.offset = correction;
+    }
+
+    statistics.delay = delay;
+    statistics.syncs++;
+    lastSyncTime = now;
+    broadcastSilent = false;
+
+    setOffset(offset);
+}
+
+void NtpClient::result(int status, int64_t offset, int64_t delay)
 {
-    if (status == 0 && result)
+    size_t nextSync = syncTime;
+
+    if (status == NTP_RESULT_OK)
+    {
+        adjust(offset, delay);
+        failuresInRow = 0;
+
+        if (listening)
+        {
+            broadcastDelay = delay;
+            nextSync = calibrationTime;
+        }
+    }
+    else if (status == NTP_RESULT_FAILED)
     {
-        hardwareOffset = (*result * 1000) - ((time_t)us_to_ms(time_us_64()));
+        // Retry sooner than a full sync period so one lost packet doesn't cost an hour.
+        // Kiss of death responses ask us to back off, so those wait the full period.
+        nextSync = NTP_RETRY_TIME << (failuresInRow < 16 ? failuresInRow : 16);
+        nextSync = nextSync < syncTime ? nextSync : syncTime;
+        failuresInRow++;
+        serverResolved = false;
     }
 
+    requestTime = 0;
+
     if (ntp_resend_alarm > 0)
     {
         cancel_alarm(ntp_resend_alarm);
         ntp_resend_alarm = 0;
     }
-    syncStamp = make_timeout_time_ms(syncTime * SECONDS_TO_MS);
+    syncStamp = time_service_monotonic_us() + (uint64_t)nextSync * SECONDS_TO_US;
     dns_request_sent = false;
 }
 
+static uint64_t readTimestamp(struct pbuf *p, uint16_t offset)
+{
+    uint8_t buffer[8] = {0};
+    uint64_t timestamp = 0;
+
+    pbuf_copy_partial(p, buffer, sizeof(buffer), offset);
+    for (int i = 0; i < 8; i++)
+    {
+        timestamp = (timestamp << 8) | buffer[i];
+    }
+    return timestamp;
+}
+
+// Converts a 64 bit NTP timestamp into microseconds since 1 Jan 1970
+static int64_t ntpToEpochUs(uint64_t timestamp)
+{
+    int64_t seconds = (int64_t)(timestamp >> 32) - NTP_DELTA;
+    uint64_t fraction = ((timestamp & 0xFFFFFFFF) * SECONDS_TO_US) >> 32;
+    return (seconds * SECONDS_TO_US) + (int64_t)fraction;
+}
+
 void NtpClient::receive(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
 {
+    uint64_t receiveTime = time_service_monotonic_us();
+    uint8_t leap = pbuf_get_at(p, 0) >> 6;
     uint8_t mode = pbuf_get_at(p, 0) & 0x7;
     uint8_t stratum = pbuf_get_at(p, 1);
 
-    // Check the result, void *arg
-    if (ip_addr_cmp(addr, &ntp_server_address) && port == this->port && p->tot_len == NTP_MSG_LEN &&
-        mode == 0x4 && stratum != 0)
+    if (!ip_addr_cmp(addr, &ntp_server_address) || port != this->port || p->tot_len != NTP_MSG_LEN)
+    {
+        printf("invalid ntp response\n");
+        statistics.invalidResponses++;
+    }
+    else if (mode == NTP_MODE_BROADCAST)
+    {
+        // Broadcasts are only followed once a unicast exchange has calibrated the path delay
+        if (listening && broadcastDelay >= 0 && stratum != 0 && leap != NTP_LEAP_ALARM)
+        {
+            int64_t serverTransmit = ntpToEpochUs(readTimestamp(p, NTP_TRANSMIT_OFFSET));
+            statistics.broadcasts++;
+            adjust(serverTransmit + (broadcastDelay / 2) - (int64_t)receiveTime, broadcastDelay);
+        }
+    }
+    else if (requestTime == 0 || readTimestamp(p, NTP_ORIGINATE_OFFSET) != requestTime)
     {
-        uint8_t seconds_buf[4] = {0};
-        pbuf_copy_partial(p, seconds_buf, sizeof(seconds_buf), 40);
-        uint32_t seconds_since_1900 = seconds_buf[0] << 24 | seconds_buf[1] << 16 | seconds_buf[2] << 8 | seconds_buf[3];
-        uint32_t seconds_since_1970 = seconds_since_1900 - NTP_DELTA;
-        time_t epoch = seconds_since_1970;
-        result(0, &epoch);
+        // Late response to a request that already timed out
+        printf("stale ntp response\n");
+        statistics.invalidResponses++;
+    }
+    else if (mode == NTP_MODE_SERVER && stratum == 0)
+    {
+        printf("ntp kiss of death %c%c%c%c\n",
+               pbuf_get_at(p, 12), pbuf_get_at(p, 13), pbuf_get_at(p, 14), pbuf_get_at(p, 15));
+        statistics.kissOfDeath++;
+        result(NTP_RESULT_KISS_OF_DEATH, 0, 0);
+    }
+    else if (mode == NTP_MODE_SERVER && leap != NTP_LEAP_ALARM)
+    {
+        int64_t serverReceive = ntpToEpochUs(readTimestamp(p, NTP_RECEIVE_OFFSET));
+        int64_t serverTransmit = ntpToEpochUs(readTimestamp(p, NTP_TRANSMIT_OFFSET));
+
+        int64_t offset = ((serverReceive - (int64_t)requestTime) + (serverTransmit - (int64_t)receiveTime)) / 2;
+        int64_t delay = (int64_t)(receiveTime - requestTime) - (serverTransmit - serverReceive);
+
+        result(NTP_RESULT_OK, offset, delay);
     }
     else
     {
         printf("invalid ntp response\n");
-        result(-1, NULL);
+        statistics.invalidResponses++;
+        result(NTP_RESULT_FAILED, 0, 0);
     }
     pbuf_free(p);
 }
@@ -141,20 +378,24 @@ void NtpClient::dnsFound(const char *hostname, const ip_addr_t *ipaddr)
     if (ipaddr)
     {
         ntp_server_address = *ipaddr;
+        serverResolved = true;
         printf("ntp address %s\n", ip4addr_ntoa(ipaddr));
         request();
     }
     else
     {
         printf("ntp dns request failed\n");
-        result(-1, NULL);
+        statistics.dnsFailures++;
+        result(NTP_RESULT_FAILED, 0, 0);
     }
 }
 
 int64_t NtpClient::failed(alarm_id_t id)
 {
     printf("ntp request failed\n");
-    result(-1, NULL);
+    statistics.timeouts++;
+    ntp_resend_alarm = 0;
+    result(NTP_RESULT_FAILED, 0, 0);
     return 0;
 }
 std::unique_ptr<NtpClient> NtpClient::create(std::string ntpServer, int port, size_t syncTime)
@@ -164,7 +405,7 @@ std::unique_ptr<NtpClient> NtpClient::create(std::string ntpServer, int port, si
 
 NtpClient::NtpClient(std::string address, int port, size_t syncTime) : address(address), port(port), syncTime(syncTime)
 {
-    syncStamp = get_absolute_time();
+    syncStamp = time_service_monotonic_us();
     ntp_pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
     if (!ntp_pcb)
     {
@@ -172,3 +413,15 @@ NtpClient::NtpClient(std::string address, int port, size_t syncTime) : address(a
     }
     udp_recv(ntp_pcb, Private::receive, this);
 }
+
+NtpClient::~NtpClient()
+{
+    if (ntp_resend_alarm > 0)
+    {
+        cancel_alarm(ntp_resend_alarm);
+    }
+    if (ntp_pcb)
+    {
+        udp_remove(ntp_pcb);
+    }
+}
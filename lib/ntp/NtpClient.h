@@ -7,21 +7,67 @@
 #include "lwip/pbuf.h"
 #include "lwip/udp.h"
 
+#include "time_service.h"
+
 #include <string>
 #include <string.h>
 #include <memory>
 
+/**
+ * @brief Quality information about the NTP synchronisation.
+ * Offsets, delays and jitter are in microseconds.
+ */
+typedef struct
+{
+    // Correction applied to the clock at the last good sync
+    int64_t offset;
+    // Round trip delay of the last good sync
+    int64_t delay;
+    // RMS of the change between successive offsets
+    int64_t jitter;
+    // Estimated drift of the hardware clock in parts per million. Positive when running fast.
+    float drift;
+    // Microseconds since the last good sync, or -1 if the client has never synced
+    int64_t sinceSync;
+    uint32_t syncs;
+    // Syncs that came from broadcasts
+    uint32_t broadcasts;
+    uint32_t timeouts;
+    uint32_t invalidResponses;
+    uint32_t dnsFailures;
+    uint32_t kissOfDeath;
+} NtpStatistics;
+
 class NtpClient
 {
 private:
-    ip_addr_t ntp_server_address;
+    ip_addr_t ntp_server_address = {};
     bool dns_request_sent = false;
+    bool serverResolved = false;
     struct udp_pcb *ntp_pcb;
-    absolute_time_t syncStamp;
-    absolute_time_t ntp_test_time;
-    alarm_id_t ntp_resend_alarm;
+    // Monotonic microseconds the next request is due
+    uint64_t syncStamp;
+    alarm_id_t ntp_resend_alarm = 0;
 
-    time_t hardwareOffset = 0;
+    // Hardware time the pending request was sent. Echoed back by the server as the originate timestamp.
+    uint64_t requestTime = 0;
+    uint64_t lastSyncTime = 0;
+    int64_t lastCorrection = 0;
+    float jitterSquared = 0;
+    uint32_t driftSamples = 0;
+    uint32_t failuresInRow = 0;
+
+    // Broadcast mode, the round trip delay from the last unicast calibration
+    bool listening = false;
+    size_t calibrationTime = 0;
+    int64_t broadcastDelay = -1;
+    // Set once the broadcasts have been silent for the sync time and a request was scheduled for it
+    bool broadcastSilent = false;
+    // Multicast group the broadcasts are sent to, joined each time the link comes up
+    ip4_addr_t group = {};
+    bool hasGroup = false;
+    bool joined = false;
+    NtpStatistics statistics = {};
 
     std::string address;
     int port;
@@ -30,8 +76,11 @@ private:
     struct Private;
 
     void init();
+    void setOffset(int64_t offset);
+    int64_t getOffset();
     void request();
-    void result(int status, time_t *result);
+    void adjust(int64_t offset, int64_t delay);
+    void result(int status, int64_t offset, int64_t delay);
     void receive(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port);
     void dnsFound(const char *hostname, const ip_addr_t *ipaddr);
     int64_t failed(alarm_id_t id);
@@ -39,17 +88,62 @@ private:
 protected:
 public:
     NtpClient(std::string address, int port, size_t syncTime);
-    ~NtpClient()
-    {
-    }
+    ~NtpClient();
     static std::unique_ptr<NtpClient> create(std::string ntpServer, int port, size_t syncTime);
     void sync();
+
+    /**
+     * @brief Follows time broadcast by the server instead of sending a request every sync.
+     * A unicast exchange calibrates the path delay every calibrationTime seconds,
+     * or whenever no broadcast has been heard for the sync time.
+     *
+     * @param group Multicast group to join with joinGroup, or NULL to only listen for broadcasts
+     * @param calibrationTime Seconds between unicast calibrations
+     */
+    void listen(const char *group, size_t calibrationTime);
+
+    /**
+     * @brief Joins the multicast group given to listen. Call once the link is up, and again after
+     * every reconnect so the membership is reported on the new link.
+     */
+    void joinGroup();
+
     inline bool synced()
     {
-        return absolute_time_diff_us(get_absolute_time(), this->syncStamp) >= 0 && !this->dns_request_sent;
+        return !time_service_reached(this->syncStamp) && !this->dns_request_sent;
     }
 
+    /**
+     * @brief Get the current epoch time in milliseconds.
+     * Lock free and safe to call from either core or from an interrupt handler.
+     * The NtpClient is the UTC source of the time service, prefer time_service_utc_ms.
+     *
+     * @return time_t
+     */
     time_t getTime();
+
+    /**
+     * @brief Converts a monotonic timestamp captured with time_service_monotonic_us() into epoch milliseconds.
+     * Lock free and safe to call from either core or from an interrupt handler.
+     *
+     * @param timestampUs Hardware timestamp in microseconds
+     * @return time_t
+     */
+    time_t getTime(uint64_t timestampUs);
+
+    /**
+     * @brief Get the time the next sync is due
+     *
+     * @return uint64_t Monotonic time in microseconds, or UINT64_MAX while a request is outstanding
+     */
+    uint64_t nextSync();
+
+    /**
+     * @brief Get the quality statistics of the synchronisation
+     *
+     * @return NtpStatistics
+     */
+    NtpStatistics getStatistics();
 };
 
 #endif /* NTP_CLIENT */
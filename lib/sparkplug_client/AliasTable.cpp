@@ -0,0 +1,297 @@
+/*
+ * File: AliasTable.cpp
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#include "AliasTable.h"
+#include "SparkplugPayload.h"
+#include "Fnv.h"
+
+#include <string.h>
+#include <algorithm>
+
+static uint32_t metricHash(const char *device, size_t deviceLength, const char *name, size_t nameLength)
+{
+    return fnvHash(fnvHash(fnvHash(FNV_OFFSET, device, deviceLength), "/", 1), name, nameLength);
+}
+
+static bool equals(const std::string &value, const char *data, size_t length)
+{
+    return value.size() == length && memcmp(value.data(), data, length) == 0;
+}
+
+bool AliasTable::find(const char *device, size_t deviceLength, const char *name, size_t nameLength, uint64_t *alias)
+{
+    uint32_t hash = metricHash(device, deviceLength, name, nameLength);
+    auto entry = std::lower_bound(index.begin(), index.end(), hash,
+                                  [](const AliasIndex &entry, uint32_t hash)
+                                  { return entry.hash < hash; });
+
+    // Names that share a hash sit next to each other
+    for (; entry != index.end() && entry->hash == hash; entry++)
+    {
+        AliasedMetric &metric = metrics[entry->alias];
+        if (equals(metric.device, device, deviceLength) && equals(metric.name, name, nameLength))
+        {
+            *alias = first + entry->alias;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint64_t AliasTable::assign(const char *device, size_t deviceLength, const char *name, size_t nameLength)
+{
+    uint64_t alias;
+
+    if (find(device, deviceLength, name, nameLength, &alias))
+    {
+        return alias;
+    }
+
+    AliasIndex entry = {.hash = metricHash(device, deviceLength, name, nameLength), .alias = (uint32_t)metrics.size()};
+    metrics.push_back({.device = std::string(device, deviceLength), .name = std::string(name, nameLength)});
+    index.insert(std::upper_bound(index.begin(), index.end(), entry,
+                                  [](const AliasIndex &a, const AliasIndex &b)
+                                  { return a.hash < b.hash; }),
+                 entry);
+
+    return first + entry.alias;
+}
+
+void AliasTable::reserve(uint64_t alias)
+{
+    reserved = alias >= reserved ? alias + 1 : reserved;
+
+    // Every alias from first up is either handed out or will be
+    if (metrics.empty())
+    {
+        first = reserved;
+    }
+    else if (alias >= first)
+    {
+        clashed = true;
+    }
+}
+
+void AliasTable::renumber()
+{
+    if (!clashed)
+    {
+        return;
+    }
+
+    metrics.clear();
+    index.clear();
+    first = reserved;
+    clashed = false;
+}
+
+const AliasedMetric *AliasTable::get(uint64_t alias)
+{
+    return alias >= first && alias - first < metrics.size() ? &metrics[alias - first] : NULL;
+}
+
+size_t AliasTable::size()
+{
+    return metrics.size();
+}
+
+/**
+ * @brief Rewrites each metric of a payload, calling the function with the metric's name and
+ * alias fields. The function writes its replacement for them, and the other fields are copied.
+ */
+template <typename F>
+static bool rewriteMetrics(const uint8_t *payload, size_t length, ProtobufBuffer *rewritten, F rewrite)
+{
+    ProtobufReader reader(payload, length);
+    ProtobufWriter writer(rewritten);
+    ProtobufField field;
+    ProtobufBuffer metric(rewritten->get_allocator());
+    bool changed = false;
+
+    rewritten->clear();
+    rewritten->reserve(length + PROTOBUF_MAX_VARINT);
+
+    while (reader.next(&field))
+    {
+        if (field.number != PAYLOAD_METRICS)
+        {
+            writer.raw(field.start, field.size);
+            continue;
+        }
+
+        ProtobufReader metricReader(field.data, field.length);
+        ProtobufWriter metricWriter(&metric);
+        ProtobufField metricField;
+        ProtobufField name = {};
+        ProtobufField alias = {};
+
+        while (metricReader.next(&metricField))
+        {
+            if (metricField.number == METRIC_NAME)
+            {
+                name = metricField;
+            }
+            else if (metricField.number == METRIC_ALIAS)
+            {
+                alias = metricField;
+            }
+        }
+
+        if (metricReader.error())
+        {
+            return false;
+        }
+
+        metric.clear();
+        if (!rewrite(&metricWriter, name.start ? &name : NULL, alias.start ? &alias : NULL))
+        {
+            writer.raw(field.start, field.size);
+            continue;
+        }
+
+        metricReader = ProtobufReader(field.data, field.length);
+        while (metricReader.next(&metricField))
+        {
+            if (metricField.number != METRIC_NAME && metricField.number != METRIC_ALIAS)
+            {
+                metricWriter.raw(metricField.start, metricField.size);
+            }
+        }
+
+        writer.bytesField(PAYLOAD_METRICS, metric.data(), metric.size());
+        changed = true;
+    }
+
+    return changed && !reader.error();
+}
+
+/**
+ * @brief Reserves the aliases the MQTT client gave the metrics of a birth
+ *
+ * @return true if any metric has an alias
+ */
+static bool reserveClientAliases(AliasTable *aliases, const uint8_t *payload, size_t length)
+{
+    ProtobufReader reader(payload, length);
+    ProtobufField field;
+    bool found = false;
+
+    while (reader.next(&field))
+    {
+        if (field.number != PAYLOAD_METRICS)
+        {
+            continue;
+        }
+
+        ProtobufReader metricReader(field.data, field.length);
+        ProtobufField metricField;
+        while (metricReader.next(&metricField))
+        {
+            if (metricField.number == METRIC_ALIAS)
+            {
+                aliases->reserve(metricField.value);
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+bool sparkplugAliasBirth(AliasTable *aliases, const char *device, size_t deviceLength,
+                         const uint8_t *payload, size_t length, ProtobufBuffer *rewritten)
+{
+    // A new session can start the aliases again above the ones the MQTT client took for itself
+    if (deviceLength == 0)
+    {
+        aliases->renumber();
+    }
+
+    // Aliases given by the MQTT client are left alone, along with the rest of their birth
+    if (reserveClientAliases(aliases, payload, length))
+    {
+        return false;
+    }
+
+    return rewriteMetrics(payload, length, rewritten,
+                          [&](ProtobufWriter *writer, ProtobufField *name, ProtobufField *alias)
+                          {
+                              if (name == NULL)
+                              {
+                                  return false;
+                              }
+                              writer->raw(name->start, name->size);
+                              writer->varintField(METRIC_ALIAS, aliases->assign(device, deviceLength, (const char *)name->data, name->length));
+                              return true;
+                          });
+}
+
+bool sparkplugAliasData(AliasTable *aliases, const char *device, size_t deviceLength,
+                        const uint8_t *payload, size_t length, ProtobufBuffer *rewritten)
+{
+    return rewriteMetrics(payload, length, rewritten,
+                          [&](ProtobufWriter *writer, ProtobufField *name, ProtobufField *alias)
+                          {
+                              uint64_t value;
+
+                              // A metric that wasn't in a birth keeps its name
+                              if (name == NULL || alias != NULL ||
+                                  !aliases->find(device, deviceLength, (const char *)name->data, name->length, &value))
+                              {
+                                  return false;
+                              }
+                              writer->varintField(METRIC_ALIAS, value);
+                              return true;
+                          });
+}
+
+bool sparkplugUnaliasCommand(AliasTable *aliases, const char *device, size_t deviceLength,
+                             const uint8_t *payload, size_t length, ProtobufBuffer *rewritten)
+{
+    return rewriteMetrics(payload, length, rewritten,
+                          [&](ProtobufWriter *writer, ProtobufField *name, ProtobufField *alias)
+                          {
+                              if (name != NULL || alias == NULL)
+                              {
+                                  return false;
+                              }
+
+                              const AliasedMetric *metric = aliases->get(alias->value);
+                              if (metric == NULL || !equals(metric->device, device, deviceLength))
+                              {
+                                  return false;
+                              }
+                              writer->bytesField(METRIC_NAME, metric->name.data(), metric->name.size());
+                              writer->raw(alias->start, alias->size);
+                              return true;
+                          });
+}
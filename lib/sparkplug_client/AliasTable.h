@@ -0,0 +1,156 @@
+/*
+ * File: AliasTable.h
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef ALIAS_TABLE
+#define ALIAS_TABLE
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "Protobuf.h"
+
+typedef struct
+{
+    std::string device;
+    std::string name;
+} AliasedMetric;
+
+/**
+ * @brief Numeric aliases for the metrics of a node and its devices.
+ * Aliases are handed out in order from above any the MQTT client gave itself, so the metric of an
+ * alias is found by indexing a flat array. They stay the same across sessions so the births of a
+ * reconnect match, unless the MQTT client took one of them.
+ * Only outbound births and data use the aliases. The MQTT client still dispatches commands by name,
+ * so a command that only gives an alias has the name put back before it gets there.
+ */
+class AliasTable
+{
+private:
+    typedef struct
+    {
+        uint32_t hash;
+        uint32_t alias;
+    } AliasIndex;
+
+    // Indexed by alias
+    std::vector<AliasedMetric> metrics;
+    // Sorted by the hash of the device and name, for finding the alias of a name
+    std::vector<AliasIndex> index;
+    // The alias of the first metric, above every alias reserved before it was handed out
+    uint64_t first = 0;
+    uint64_t reserved = 0;
+    // Set when the MQTT client took an alias that was already handed out, or would be next
+    bool clashed = false;
+
+public:
+    /**
+     * @brief Get the alias of a metric, giving it the next one if it doesn't have one yet
+     *
+     * @param device Empty for metrics of the node
+     * @param deviceLength
+     * @param name
+     * @param nameLength
+     * @return uint64_t
+     */
+    uint64_t assign(const char *device, size_t deviceLength, const char *name, size_t nameLength);
+
+    /**
+     * @brief Find the alias of a metric
+     *
+     * @param device Empty for metrics of the node
+     * @param deviceLength
+     * @param name
+     * @param nameLength
+     * @param alias Set to the alias
+     * @return true if the metric has an alias
+     */
+    bool find(const char *device, size_t deviceLength, const char *name, size_t nameLength, uint64_t *alias);
+
+    /**
+     * @brief Get the metric an alias was given to
+     *
+     * @param alias
+     * @return const AliasedMetric* NULL if the alias hasn't been given out
+     */
+    const AliasedMetric *get(uint64_t alias);
+
+    /**
+     * @brief Keeps an alias the MQTT client gave a metric itself from being handed out
+     *
+     * @param alias
+     */
+    void reserve(uint64_t alias);
+
+    /**
+     * @brief Hands the aliases out again from above the reserved ones if the MQTT client took one
+     * already handed out. Only safe at the start of a session, before its births.
+     */
+    void renumber();
+
+    size_t size();
+};
+
+/**
+ * @brief Adds aliases to the metrics of a birth, giving each metric the next one.
+ * A birth where the MQTT client gave any metric an alias is left as it is, and its aliases are reserved.
+ *
+ * @param aliases
+ * @param device Empty for the NBIRTH
+ * @param deviceLength
+ * @param payload
+ * @param length
+ * @param rewritten The payload with aliases
+ * @return true if the payload was rewritten
+ */
+bool sparkplugAliasBirth(AliasTable *aliases, const char *device, size_t deviceLength,
+                         const uint8_t *payload, size_t length, ProtobufBuffer *rewritten);
+
+/**
+ * @brief Replaces the names of metrics in data with their aliases
+ *
+ * @return true if the payload was rewritten
+ */
+bool sparkplugAliasData(AliasTable *aliases, const char *device, size_t deviceLength,
+                        const uint8_t *payload, size_t length, ProtobufBuffer *rewritten);
+
+/**
+ * @brief Adds the names of metrics that a command only gave by alias, so the command can be
+ * dispatched by name. The MQTT client doesn't look commands up by alias, this saves none of the
+ * work of matching names on the way in.
+ *
+ * @return true if the payload was rewritten
+ */
+bool sparkplugUnaliasCommand(AliasTable *aliases, const char *device, size_t deviceLength,
+                             const uint8_t *payload, size_t length, ProtobufBuffer *rewritten);
+
+#endif /* ALIAS_TABLE */
@@ -0,0 +1,80 @@
+/*
+ * File: Arena.cpp
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#include "Arena.h"
+
+#include <stdlib.h>
+
+Arena::Arena(size_t capacity)
+{
+    memory = (uint8_t *)malloc(capacity);
+    statistics.capacity = memory ? capacity : 0;
+}
+
+Arena::~Arena()
+{
+    free(memory);
+}
+
+void *Arena::allocate(size_t size, size_t alignment)
+{
+    size_t start = (statistics.used + alignment - 1) & ~(alignment - 1);
+
+    if (start + size > statistics.capacity)
+    {
+        statistics.overflows++;
+        return NULL;
+    }
+
+    statistics.used = start + size;
+    if (statistics.used > statistics.highWater)
+    {
+        statistics.highWater = statistics.used;
+    }
+
+    return memory + start;
+}
+
+bool Arena::owns(const void *pointer)
+{
+    return (const uint8_t *)pointer >= memory && (const uint8_t *)pointer < memory + statistics.capacity;
+}
+
+void Arena::reset()
+{
+    statistics.used = 0;
+    statistics.resets++;
+}
+
+ArenaStatistics Arena::getStatistics()
+{
+    return statistics;
+}
@@ -0,0 +1,141 @@
+/*
+ * File: Arena.h
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef ARENA
+#define ARENA
+
+#include <stdint.h>
+#include <stddef.h>
+#include <new>
+
+typedef struct
+{
+    size_t capacity;
+    // Bytes allocated since the last reset, and the most there have ever been
+    size_t used;
+    size_t highWater;
+    uint32_t resets;
+    // Allocations that didn't fit and went to the heap instead
+    uint32_t overflows;
+} ArenaStatistics;
+
+/**
+ * @brief A bump allocator for the scratch memory of a single message.
+ * Allocating only moves a pointer and nothing is freed until the whole arena is reset,
+ * so the transport's rewrite of a message never touches the heap once the arena is big enough.
+ * The MQTT client's own encoding doesn't use it.
+ */
+class Arena
+{
+private:
+    uint8_t *memory;
+    ArenaStatistics statistics = {};
+
+public:
+    Arena(size_t capacity);
+    ~Arena();
+
+    /**
+     * @brief Allocates from the arena
+     *
+     * @param size
+     * @param alignment A power of two
+     * @return void* NULL if the arena is full
+     */
+    void *allocate(size_t size, size_t alignment);
+
+    /**
+     * @brief Whether memory was allocated from the arena
+     *
+     * @param pointer
+     * @return true if it is inside the arena
+     */
+    bool owns(const void *pointer);
+
+    /**
+     * @brief Frees everything allocated from the arena. Nothing allocated from it may still be in use.
+     */
+    void reset();
+
+    ArenaStatistics getStatistics();
+};
+
+/**
+ * @brief Allocator for standard containers that takes memory from an arena.
+ * Without an arena, or once the arena is full, memory comes from the heap.
+ *
+ * @tparam T
+ */
+template <typename T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+
+    Arena *arena;
+
+    ArenaAllocator(Arena *arena = NULL) noexcept : arena(arena)
+    {
+    }
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) noexcept : arena(other.arena)
+    {
+    }
+
+    T *allocate(size_t count)
+    {
+        void *memory = arena ? arena->allocate(count * sizeof(T), alignof(T)) : NULL;
+        return (T *)(memory ? memory : ::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(T *pointer, size_t count)
+    {
+        if (arena == NULL || !arena->owns(pointer))
+        {
+            ::operator delete(pointer);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &other) const noexcept
+    {
+        return arena == other.arena;
+    }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U> &other) const noexcept
+    {
+        return arena != other.arena;
+    }
+};
+
+#endif /* ARENA */
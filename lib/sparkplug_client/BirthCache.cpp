@@ -0,0 +1,411 @@
+/*
+ * File: BirthCache.cpp
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#include "BirthCache.h"
+#include "SparkplugPayload.h"
+#include "Fnv.h"
+
+#include <string.h>
+
+static const uint8_t metricSeparator = 0;
+
+static size_t valueWidth(uint32_t number)
+{
+    switch (number)
+    {
+    case METRIC_INT_VALUE:
+        return BIRTH_CACHE_INT_WIDTH;
+    case METRIC_LONG_VALUE:
+        return BIRTH_CACHE_LONG_WIDTH;
+    default:
+        // Booleans are always 0 or 1
+        return 1;
+    }
+}
+
+static uint32_t signature(const uint8_t *payload, size_t length)
+{
+    ProtobufReader reader(payload, length);
+    ProtobufField field;
+    uint32_t hash = FNV_OFFSET;
+
+    while (reader.next(&field))
+    {
+        if (field.number != PAYLOAD_METRICS)
+        {
+            continue;
+        }
+
+        ProtobufReader metricReader(field.data, field.length);
+        ProtobufField metricField;
+
+        while (metricReader.next(&metricField))
+        {
+            if (metricField.number == METRIC_TIMESTAMP || metricField.number == METRIC_IS_NULL)
+            {
+                continue;
+            }
+
+            // Only which field holds the value matters, not the value itself
+            if (METRIC_VALUE_FIELD(metricField.number))
+            {
+                hash = fnvHash(hash, &metricField.number, sizeof(metricField.number));
+            }
+            else
+            {
+                hash = fnvHash(hash, metricField.start, metricField.size);
+            }
+        }
+
+        // Keeps the fields of neighbouring metrics apart
+        hash = fnvHash(hash, &metricSeparator, sizeof(metricSeparator));
+    }
+
+    return hash;
+}
+
+CachedBirth *BirthCache::find(const char *device, size_t length)
+{
+    for (auto &birth : births)
+    {
+        if (birth.device.size() == length && memcmp(birth.device.data(), device, length) == 0)
+        {
+            return &birth;
+        }
+    }
+    return NULL;
+}
+
+bool BirthCache::rebuild(CachedBirth *birth, MqttPublish *publish)
+{
+    ProtobufReader reader(publish->payload, publish->payloadLength);
+    ProtobufWriter writer(&birth->body);
+    ProtobufField field;
+    ProtobufBuffer metric;
+
+    birth->body.clear();
+    birth->metrics.clear();
+
+    while (reader.next(&field))
+    {
+        if (field.number == PAYLOAD_TIMESTAMP || field.number == PAYLOAD_SEQ)
+        {
+            continue;
+        }
+
+        // Anything else, such as a compressed body, isn't cached
+        if (field.number != PAYLOAD_METRICS)
+        {
+            return false;
+        }
+
+        ProtobufReader metricReader(field.data, field.length);
+        ProtobufWriter metricWriter(&metric);
+        ProtobufField metricField;
+        CachedMetric cached = {};
+
+        metric.clear();
+
+        while (metricReader.next(&metricField))
+        {
+            switch (metricField.number)
+            {
+            case METRIC_NAME:
+                cached.name.assign((const char *)metricField.data, metricField.length);
+                metricWriter.raw(metricField.start, metricField.size);
+                break;
+            case METRIC_ALIAS:
+                cached.alias = metricField.value;
+                cached.hasAlias = true;
+                metricWriter.raw(metricField.start, metricField.size);
+                break;
+            case METRIC_TIMESTAMP:
+                metricWriter.tag(METRIC_TIMESTAMP, PROTOBUF_VARINT);
+                cached.timestampOffset = metric.size();
+                metricWriter.paddedVarint(metricField.value, BIRTH_CACHE_TIMESTAMP_WIDTH);
+                break;
+            case METRIC_INT_VALUE:
+            case METRIC_LONG_VALUE:
+            case METRIC_BOOLEAN_VALUE:
+                cached.number = metricField.number;
+                cached.valueWidth = valueWidth(metricField.number);
+                metricWriter.tag(metricField.number, PROTOBUF_VARINT);
+                cached.valueOffset = metric.size();
+                metricWriter.paddedVarint(metricField.value, cached.valueWidth);
+                break;
+            default:
+                // Fixed width and length delimited values are patched in place while their length stays the same
+                if (METRIC_VALUE_FIELD(metricField.number))
+                {
+                    cached.number = metricField.number;
+                    cached.valueWidth = metricField.type == PROTOBUF_VARINT ? 0 : metricField.length;
+                    cached.valueOffset = metric.size() + (metricField.data - metricField.start);
+                }
+                metricWriter.raw(metricField.start, metricField.size);
+                break;
+            }
+        }
+
+        if (metricReader.error())
+        {
+            return false;
+        }
+
+        writer.bytesField(PAYLOAD_METRICS, metric.data(), metric.size());
+
+        size_t base = birth->body.size() - metric.size();
+        cached.valueOffset += base;
+        if (cached.timestampOffset > 0)
+        {
+            cached.timestampOffset += base;
+        }
+        birth->metrics.push_back(std::move(cached));
+    }
+
+    return !reader.error();
+}
+
+void BirthCache::patch(CachedBirth *birth, const ProtobufField &metric)
+{
+    ProtobufReader reader(metric.data, metric.length);
+    ProtobufField field;
+    ProtobufField value = {};
+    const uint8_t *name = NULL;
+    size_t nameLength = 0;
+    uint64_t alias = 0;
+    bool hasAlias = false;
+    uint64_t timestamp = 0;
+    bool hasTimestamp = false;
+
+    while (reader.next(&field))
+    {
+        switch (field.number)
+        {
+        case METRIC_NAME:
+            name = field.data;
+            nameLength = field.length;
+            break;
+        case METRIC_ALIAS:
+            alias = field.value;
+            hasAlias = true;
+            break;
+        case METRIC_TIMESTAMP:
+            timestamp = field.value;
+            hasTimestamp = true;
+            break;
+        case METRIC_IS_HISTORICAL:
+            // Old values don't belong in a birth
+            if (field.value)
+            {
+                return;
+            }
+            break;
+        case METRIC_IS_NULL:
+            if (field.value)
+            {
+                birth->stale = true;
+                return;
+            }
+            break;
+        default:
+            if (METRIC_VALUE_FIELD(field.number))
+            {
+                value = field;
+            }
+            break;
+        }
+    }
+
+    CachedMetric *cached = NULL;
+    for (auto &candidate : birth->metrics)
+    {
+        if (name ? candidate.name.size() == nameLength && memcmp(candidate.name.data(), name, nameLength) == 0
+                 : hasAlias && candidate.hasAlias && candidate.alias == alias)
+        {
+            cached = &candidate;
+            break;
+        }
+    }
+
+    if (reader.error() || cached == NULL)
+    {
+        return;
+    }
+
+    uint8_t *body = birth->body.data();
+
+    if (hasTimestamp && cached->timestampOffset > 0)
+    {
+        ProtobufWriter::paddedVarint(body + cached->timestampOffset, timestamp, BIRTH_CACHE_TIMESTAMP_WIDTH);
+    }
+
+    if (value.number == 0)
+    {
+        return;
+    }
+
+    if (value.number != cached->number)
+    {
+        birth->stale = true;
+    }
+    else if (value.type == PROTOBUF_VARINT)
+    {
+        birth->stale = !ProtobufWriter::paddedVarint(body + cached->valueOffset, value.value, cached->valueWidth) || birth->stale;
+    }
+    else if (value.length == cached->valueWidth)
+    {
+        memcpy(body + cached->valueOffset, value.data, value.length);
+    }
+    else
+    {
+        birth->stale = true;
+    }
+
+    statistics.patches++;
+}
+
+void BirthCache::store(MqttPublish *publish, const char *device, size_t length)
+{
+    CachedBirth *birth = find(device, length);
+    uint32_t hash = signature(publish->payload, publish->payloadLength);
+
+    if (birth == NULL)
+    {
+        births.push_back({.topic = "", .device = std::string(device, length), .header = 0, .signature = 0, .body = {}, .metrics = {}, .stale = true});
+        birth = &births.back();
+    }
+
+    birth->topic.assign(publish->topic, publish->topicLength);
+    birth->header = publish->header;
+
+    // The metrics are the same, only their values need bringing up to date
+    if (!birth->stale && birth->signature == hash)
+    {
+        ProtobufReader reader(publish->payload, publish->payloadLength);
+        ProtobufField field;
+
+        while (reader.next(&field))
+        {
+            if (field.number == PAYLOAD_METRICS)
+            {
+                patch(birth, field);
+            }
+        }
+        return;
+    }
+
+    birth->signature = hash;
+    birth->stale = !rebuild(birth, publish);
+    statistics.rebuilds++;
+}
+
+void BirthCache::update(MqttPublish *publish, const char *device, size_t length)
+{
+    CachedBirth *birth = find(device, length);
+
+    if (birth == NULL || birth->stale)
+    {
+        return;
+    }
+
+    ProtobufReader reader(publish->payload, publish->payloadLength);
+    ProtobufField field;
+
+    while (reader.next(&field))
+    {
+        if (field.number == PAYLOAD_METRICS)
+        {
+            patch(birth, field);
+        }
+    }
+}
+
+const CachedBirth *BirthCache::get(const std::string &device)
+{
+    CachedBirth *birth = find(device.data(), device.size());
+    return birth != NULL && !birth->stale ? birth : NULL;
+}
+
+void BirthCache::count(bool hit)
+{
+    if (hit)
+    {
+        statistics.hits++;
+    }
+    else
+    {
+        statistics.misses++;
+    }
+}
+
+BirthCacheStatistics BirthCache::getStatistics()
+{
+    return statistics;
+}
+
+bool sparkplugIsRebirth(const uint8_t *payload, size_t length)
+{
+    ProtobufReader reader(payload, length);
+    ProtobufField field;
+    int metrics = 0;
+    bool rebirth = false;
+
+    while (reader.next(&field))
+    {
+        if (field.number != PAYLOAD_METRICS)
+        {
+            continue;
+        }
+
+        ProtobufReader metricReader(field.data, field.length);
+        ProtobufField metricField;
+        bool named = false;
+        bool set = false;
+
+        while (metricReader.next(&metricField))
+        {
+            if (metricField.number == METRIC_NAME)
+            {
+                named = metricField.length == strlen(NODE_CONTROL_REBIRTH) &&
+                        memcmp(metricField.data, NODE_CONTROL_REBIRTH, metricField.length) == 0;
+            }
+            else if (metricField.number == METRIC_BOOLEAN_VALUE)
+            {
+                set = metricField.value != 0;
+            }
+        }
+
+        rebirth = named && set;
+        metrics++;
+    }
+
+    return !reader.error() && metrics == 1 && rebirth;
+}
@@ -0,0 +1,154 @@
+/*
+ * File: BirthCache.h
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef BIRTH_CACHE
+#define BIRTH_CACHE
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "MqttPacket.h"
+#include "Protobuf.h"
+
+// Widths that varint values are padded to in the cache, enough for any value of their field
+#define BIRTH_CACHE_INT_WIDTH 5
+#define BIRTH_CACHE_LONG_WIDTH PROTOBUF_MAX_VARINT
+#define BIRTH_CACHE_TIMESTAMP_WIDTH PROTOBUF_MAX_VARINT
+
+typedef struct
+{
+    // Rebirths answered from the cache
+    uint32_t hits;
+    // Rebirths left to the MQTT client because a birth was missing or stale
+    uint32_t misses;
+    // Births encoded again because their metrics changed
+    uint32_t rebuilds;
+    // Metric values written into cached births
+    uint32_t patches;
+} BirthCacheStatistics;
+
+/**
+ * @brief A birth certificate encoded once, with the offset of each metric's value and timestamp
+ */
+typedef struct
+{
+    // The metric's name and alias, data may use either
+    std::string name;
+    uint64_t alias;
+    bool hasAlias;
+    // Field number of the value, 0 if the birth had no value
+    uint32_t number;
+    size_t valueOffset;
+    size_t valueWidth;
+    // 0 if the birth had no timestamp for the metric
+    size_t timestampOffset;
+} CachedMetric;
+
+typedef struct
+{
+    std::string topic;
+    // Empty for the birth of the node
+    std::string device;
+    uint8_t header;
+    // Hash of everything about the metrics except their values and timestamps
+    uint32_t signature;
+    // The metrics of the payload, without its timestamp and sequence number
+    ProtobufBuffer body;
+    std::vector<CachedMetric> metrics;
+    // A value changed in a way that can't be patched, the birth has to be encoded again
+    bool stale;
+} CachedBirth;
+
+/**
+ * @brief Keeps the NBIRTH and DBIRTH payloads as they were encoded by the MQTT client,
+ * with varint values padded to a fixed width. Metric values published in NDATA and DDATA
+ * are patched into the cached births at known offsets, so a rebirth is a copy of the cache
+ * instead of encoding every metric and property again.
+ * A birth is only encoded again when its metrics change.
+ */
+class BirthCache
+{
+private:
+    std::vector<CachedBirth> births;
+    BirthCacheStatistics statistics = {};
+
+    CachedBirth *find(const char *device, size_t length);
+    bool rebuild(CachedBirth *birth, MqttPublish *publish);
+    void patch(CachedBirth *birth, const ProtobufField &metric);
+
+public:
+    /**
+     * @brief Caches a birth published by the MQTT client
+     *
+     * @param publish The NBIRTH or DBIRTH
+     * @param device The device of a DBIRTH, empty for the NBIRTH
+     * @param length
+     */
+    void store(MqttPublish *publish, const char *device, size_t length);
+
+    /**
+     * @brief Patches the values of data published by the MQTT client into the cached birth
+     *
+     * @param publish The NDATA or DDATA
+     * @param device The device of a DDATA, empty for the NDATA
+     * @param length
+     */
+    void update(MqttPublish *publish, const char *device, size_t length);
+
+    /**
+     * @brief Get the cached birth of the node or a device
+     *
+     * @param device The device, or empty for the node
+     * @return const CachedBirth* NULL if it isn't cached or is stale
+     */
+    const CachedBirth *get(const std::string &device);
+
+    /**
+     * @brief Counts a rebirth as answered from the cache or not
+     *
+     * @param hit
+     */
+    void count(bool hit);
+
+    BirthCacheStatistics getStatistics();
+};
+
+/**
+ * @brief Whether a payload is a command asking for the births and nothing else
+ *
+ * @param payload
+ * @param length
+ * @return true if it only sets Node Control/Rebirth
+ */
+bool sparkplugIsRebirth(const uint8_t *payload, size_t length);
+
+#endif /* BIRTH_CACHE */
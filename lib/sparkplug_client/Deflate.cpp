@@ -0,0 +1,252 @@
+/*
+ * File: Deflate.cpp
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#include "Deflate.h"
+
+#include <string.h>
+
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+#define MAX_DISTANCE 32768
+
+#define END_OF_BLOCK 256
+#define FIRST_LENGTH_CODE 257
+
+// zlib header for deflate with a 32K window and no preset dictionary
+#define ZLIB_CMF 0x78
+#define ZLIB_FLG 0x01
+
+#define ADLER_MODULO 65521
+
+static const uint16_t lengthBase[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27,
+                                      31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t lengthExtra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t distanceBase[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                        193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+                                        6145, 8193, 12289, 16385, 24577};
+static const uint8_t distanceExtra[] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                        6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+/**
+ * @brief Writes bits least significant first, as deflate packs them
+ */
+typedef struct
+{
+    uint8_t *output;
+    size_t capacity;
+    size_t position;
+    uint32_t bits;
+    uint32_t count;
+    bool overflow;
+} BitWriter;
+
+struct Deflate::Private
+{
+    static void flushBits(BitWriter *writer)
+    {
+        while (writer->count >= 8)
+        {
+            if (writer->position < writer->capacity)
+            {
+                writer->output[writer->position++] = (uint8_t)writer->bits;
+            }
+            else
+            {
+                writer->overflow = true;
+            }
+            writer->bits >>= 8;
+            writer->count -= 8;
+        }
+    }
+
+    static void putBits(BitWriter *writer, uint32_t value, uint32_t count)
+    {
+        writer->bits |= value << writer->count;
+        writer->count += count;
+        flushBits(writer);
+    }
+
+    // Huffman codes are packed starting from their most significant bit
+    static void putCode(BitWriter *writer, uint32_t code, uint32_t count)
+    {
+        uint32_t reversed = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            reversed = (reversed << 1) | ((code >> i) & 1);
+        }
+        putBits(writer, reversed, count);
+    }
+
+    static void putSymbol(BitWriter *writer, uint32_t symbol)
+    {
+        // The fixed literal/length codes of RFC 1951 3.2.6
+        if (symbol < 144)
+        {
+            putCode(writer, 0x30 + symbol, 8);
+        }
+        else if (symbol < 256)
+        {
+            putCode(writer, 0x190 + symbol - 144, 9);
+        }
+        else if (symbol < 280)
+        {
+            putCode(writer, symbol - 256, 7);
+        }
+        else
+        {
+            putCode(writer, 0xC0 + symbol - 280, 8);
+        }
+    }
+
+    static void putMatch(BitWriter *writer, uint32_t length, uint32_t distance)
+    {
+        int code = sizeof(lengthBase) / sizeof(lengthBase[0]) - 1;
+        while (lengthBase[code] > length)
+        {
+            code--;
+        }
+        putSymbol(writer, FIRST_LENGTH_CODE + code);
+        putBits(writer, length - lengthBase[code], lengthExtra[code]);
+
+        code = sizeof(distanceBase) / sizeof(distanceBase[0]) - 1;
+        while (distanceBase[code] > distance)
+        {
+            code--;
+        }
+        putCode(writer, code, 5);
+        putBits(writer, distance - distanceBase[code], distanceExtra[code]);
+    }
+
+    static uint32_t hash(const uint8_t *data)
+    {
+        uint32_t value = (uint32_t)data[0] << 16 | (uint32_t)data[1] << 8 | data[2];
+        return (value * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+    }
+
+    static uint32_t adler32(const uint8_t *data, size_t length)
+    {
+        uint32_t a = 1;
+        uint32_t b = 0;
+
+        while (length > 0)
+        {
+            // The sums can't overflow within this many bytes
+            size_t block = length < 5552 ? length : 5552;
+            length -= block;
+            while (block--)
+            {
+                a += *data++;
+                b += a;
+            }
+            a %= ADLER_MODULO;
+            b %= ADLER_MODULO;
+        }
+
+        return (b << 16) | a;
+    }
+};
+
+size_t Deflate::compress(const uint8_t *input, size_t length, uint8_t *output, size_t capacity)
+{
+    BitWriter writer = {.output = output, .capacity = capacity, .position = 0, .bits = 0, .count = 0, .overflow = false};
+    size_t position = 0;
+
+    if (length > DEFLATE_MAX_INPUT)
+    {
+        return 0;
+    }
+
+    // Entries hold the position plus one, so 0 is empty
+    memset(head, 0, sizeof(head));
+
+    Private::putBits(&writer, ZLIB_CMF, 8);
+    Private::putBits(&writer, ZLIB_FLG, 8);
+
+    // A single final block with the fixed codes
+    Private::putBits(&writer, 1, 1);
+    Private::putBits(&writer, 1, 2);
+
+    while (position < length && !writer.overflow)
+    {
+        uint32_t matchLength = 0;
+        uint32_t distance = 0;
+
+        if (length - position >= MIN_MATCH)
+        {
+            uint32_t hash = Private::hash(&input[position]);
+            size_t candidate = head[hash];
+            head[hash] = position + 1;
+
+            if (candidate > 0 && position - (candidate - 1) <= MAX_DISTANCE)
+            {
+                const uint8_t *match = &input[candidate - 1];
+                size_t limit = length - position < MAX_MATCH ? length - position : MAX_MATCH;
+
+                while (matchLength < limit && match[matchLength] == input[position + matchLength])
+                {
+                    matchLength++;
+                }
+                distance = position - (candidate - 1);
+            }
+        }
+
+        if (matchLength < MIN_MATCH)
+        {
+            Private::putSymbol(&writer, input[position]);
+            position++;
+            continue;
+        }
+
+        Private::putMatch(&writer, matchLength, distance);
+
+        // The positions inside the match can be matched by later strings
+        size_t end = position + matchLength;
+        for (position++; position < end; position++)
+        {
+            if (length - position >= MIN_MATCH)
+            {
+                head[Private::hash(&input[position])] = position + 1;
+            }
+        }
+    }
+
+    Private::putSymbol(&writer, END_OF_BLOCK);
+    Private::putBits(&writer, 0, (8 - writer.count % 8) % 8);
+
+    uint32_t checksum = Private::adler32(input, length);
+    for (int shift = 24; shift >= 0; shift -= 8)
+    {
+        Private::putBits(&writer, (checksum >> shift) & 0xFF, 8);
+    }
+
+    return writer.overflow ? 0 : writer.position;
+}
@@ -0,0 +1,70 @@
+/*
+ * File: Deflate.h
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef DEFLATE
+#define DEFLATE
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Bits of the hash of the next three bytes used to find earlier matches. The table costs 2 bytes per entry.
+#define DEFLATE_HASH_BITS 10
+#define DEFLATE_HASH_SIZE (1 << DEFLATE_HASH_BITS)
+
+// Positions in the table are 16 bit
+#define DEFLATE_MAX_INPUT 65535
+
+/**
+ * @brief A small DEFLATE compressor that writes a zlib stream, as Sparkplug's DEFLATE algorithm expects.
+ * Matches are found with a single entry per hash and encoded with the fixed Huffman codes,
+ * so it needs no memory beyond the hash table and runs in one pass.
+ */
+class Deflate
+{
+private:
+    uint16_t head[DEFLATE_HASH_SIZE];
+
+    struct Private;
+
+public:
+    /**
+     * @brief Compress the input into a zlib stream
+     *
+     * @param input
+     * @param length At most DEFLATE_MAX_INPUT
+     * @param output
+     * @param capacity
+     * @return size_t Bytes written, or 0 if the stream didn't fit in the output
+     */
+    size_t compress(const uint8_t *input, size_t length, uint8_t *output, size_t capacity);
+};
+
+#endif /* DEFLATE */
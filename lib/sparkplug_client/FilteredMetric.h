@@ -0,0 +1,212 @@
+/*
+ * File: FilteredMetric.h
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef FILTEREDMETRIC
+#define FILTEREDMETRIC
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <time_service.h>
+
+#include "StoreAndForward.h"
+
+/**
+ * @brief When a sampled value is reported to its metric.
+ * A sample is reported once it has moved past either deadband from the last reported value,
+ * and the minimum interval has passed. The last sample is reported regardless of the
+ * deadbands once the maximum interval has passed.
+ */
+typedef struct
+{
+    // Absolute change from the last reported value, in the units of the metric
+    double deadband;
+    // Change from the last reported value as a percentage of it
+    double deadbandPercent;
+    // Minimum milliseconds between reports, changes are held back until it has passed
+    uint32_t minInterval;
+    // Maximum milliseconds between reports, or 0 to only report on change
+    uint32_t maxInterval;
+} ReportOptions;
+
+/**
+ * @brief Filters the samples written to a metric so only meaningful changes are published.
+ * The filter is evaluated whenever a sample is given, so it suits sensors that are read regularly.
+ *
+ * @tparam M The type of the metric, such as Int32Metric
+ * @tparam T The type of the metric value
+ */
+template <typename M, typename T>
+class FilteredMetric
+{
+private:
+    std::shared_ptr<M> metric;
+    std::string name;
+    ReportOptions options;
+    T reported;
+    T latest;
+    uint64_t reportedAt = 0;
+    bool hasReported = false;
+    StoreAndForward *history = NULL;
+    uint32_t historyKey = 0;
+
+    bool exceedsDeadband(T value)
+    {
+        double difference = (double)value - (double)reported;
+        double magnitude = (double)reported < 0 ? -(double)reported : (double)reported;
+        difference = difference < 0 ? -difference : difference;
+
+        if (options.deadband <= 0 && options.deadbandPercent <= 0)
+        {
+            return value != reported;
+        }
+
+        return (options.deadband > 0 && difference >= options.deadband) ||
+               (options.deadbandPercent > 0 && difference >= magnitude * options.deadbandPercent / 100.0);
+    }
+
+    void report(uint64_t now)
+    {
+        metric->setValue(latest);
+        if (history)
+        {
+            history->store(historyKey, latest);
+        }
+        reported = latest;
+        reportedAt = now;
+        hasReported = true;
+    }
+
+public:
+    FilteredMetric(std::shared_ptr<M> metric, const char *name, T value, ReportOptions options) : metric(metric), name(name), options(options), reported(value), latest(value)
+    {
+    }
+
+    /**
+     * @brief Creates a metric and the filter for writing to it
+     *
+     * @param name The name of the metric
+     * @param value The initial value of the metric
+     * @param options When samples are reported
+     * @return std::shared_ptr<FilteredMetric<M, T>>
+     */
+    static std::shared_ptr<FilteredMetric<M, T>> create(const char *name, T value, ReportOptions options)
+    {
+        return std::make_shared<FilteredMetric<M, T>>(M::create(name, value), name, value, options);
+    }
+
+    /**
+     * @brief Gives the filter a new sample, which is written to the metric if it should be reported
+     *
+     * @param value
+     * @return true if the sample was reported
+     */
+    bool setValue(T value)
+    {
+        uint64_t now = time_service_monotonic_ms();
+        uint64_t elapsed = now - reportedAt;
+
+        latest = value;
+
+        if (!hasReported ||
+            (exceedsDeadband(value) && elapsed >= options.minInterval) ||
+            (options.maxInterval > 0 && elapsed >= options.maxInterval))
+        {
+            report(now);
+            return true;
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Get the next time a new sample could be reported without changing, either because a change
+     * is being held back by the minimum interval or because the maximum interval is due.
+     * The sensor should be sampled again at this time.
+     *
+     * @return uint64_t Monotonic time in milliseconds, or UINT64_MAX if only a change will be reported
+     */
+    uint64_t nextReport()
+    {
+        uint64_t next = UINT64_MAX;
+
+        if (!hasReported)
+        {
+            return 0;
+        }
+
+        if (exceedsDeadband(latest))
+        {
+            next = reportedAt + options.minInterval;
+        }
+
+        if (options.maxInterval > 0 && reportedAt + options.maxInterval < next)
+        {
+            next = reportedAt + options.maxInterval;
+        }
+
+        return next;
+    }
+
+    /**
+     * @brief Stores the reported samples while the node is offline so they can be replayed later
+     *
+     * @param store
+     * @param device The name of the device the metric belongs to, or NULL for a metric of the node
+     */
+    void storeHistory(StoreAndForward *store, const char *device)
+    {
+        history = store;
+        historyKey = store->add(device, name.c_str(), sparkplugDatatype<T>());
+    }
+
+    /**
+     * @brief Get the last sample given to the filter, which may not have been reported
+     *
+     * @return T
+     */
+    T getValue()
+    {
+        return latest;
+    }
+
+    /**
+     * @brief Get the metric the filter writes to, for adding it to a Node or Device
+     *
+     * @return std::shared_ptr<M>
+     */
+    std::shared_ptr<M> getMetric()
+    {
+        return metric;
+    }
+};
+
+#endif /* FILTEREDMETRIC */
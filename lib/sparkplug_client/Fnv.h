@@ -0,0 +1,77 @@
+/*
+ * File: Fnv.h
+ * Project: pico_sparkplug_client
+ * Created Date: Monday October 19th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef FNV
+#define FNV
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 32 bit FNV-1a, used to key metrics by name and to tell births apart
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+/**
+ * @brief Adds bytes to an FNV-1a hash
+ *
+ * @param hash FNV_OFFSET, or the hash so far
+ * @param data
+ * @param length
+ * @return uint32_t
+ */
+static inline uint32_t fnvHash(uint32_t hash, const void *data, size_t length)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+
+    while (length--)
+    {
+        hash = (hash ^ *bytes++) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * @brief Adds a string to an FNV-1a hash, a NULL string adds nothing
+ *
+ * @param hash FNV_OFFSET, or the hash so far
+ * @param value
+ * @return uint32_t
+ */
+static inline uint32_t fnvHash(uint32_t hash, const char *value)
+{
+    while (value && *value)
+    {
+        hash = (hash ^ (uint8_t)*value++) * FNV_PRIME;
+    }
+    return hash;
+}
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * File: LatencyHistogram.cpp
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#include "LatencyHistogram.h"
+
+#include <string.h>
+
+size_t LatencyHistogram::bucket(uint64_t latency)
+{
+    if (latency < LATENCY_HISTOGRAM_SUB_BUCKETS)
+    {
+        return (size_t)latency;
+    }
+
+    // The highest bit picks the power of two, the two bits below it the bucket within it
+    size_t highest = 63 - __builtin_clzll(latency);
+    size_t sub = (size_t)(latency >> (highest - 2)) & (LATENCY_HISTOGRAM_SUB_BUCKETS - 1);
+    size_t index = (highest - 1) * LATENCY_HISTOGRAM_SUB_BUCKETS + sub;
+
+    return index < LATENCY_HISTOGRAM_BUCKETS ? index : LATENCY_HISTOGRAM_BUCKETS - 1;
+}
+
+uint64_t LatencyHistogram::upperBound(size_t bucket)
+{
+    if (bucket < LATENCY_HISTOGRAM_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+
+    size_t highest = bucket / LATENCY_HISTOGRAM_SUB_BUCKETS + 1;
+    uint64_t width = (uint64_t)1 << (highest - 2);
+    return (LATENCY_HISTOGRAM_SUB_BUCKETS + bucket % LATENCY_HISTOGRAM_SUB_BUCKETS) * width + width - 1;
+}
+
+void LatencyHistogram::record(uint64_t latency)
+{
+    counts[bucket(latency)]++;
+    samples++;
+    maximum = latency > maximum ? latency : maximum;
+}
+
+uint64_t LatencyHistogram::percentile(float percent)
+{
+    if (samples == 0)
+    {
+        return 0;
+    }
+
+    // The rank of the sample the percentile falls on, rounded up so p100 is the last sample
+    uint64_t rank = (uint64_t)((double)samples * percent / 100.0 + 0.999999);
+    rank = rank == 0 ? 1 : rank;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+            uint64_t bound = upperBound(i);
+            return bound < maximum ? bound : maximum;
+        }
+    }
+
+    return maximum;
+}
+
+uint32_t LatencyHistogram::count()
+{
+    return samples;
+}
+
+uint64_t LatencyHistogram::max()
+{
+    return maximum;
+}
+
+void LatencyHistogram::reset()
+{
+    memset(counts, 0, sizeof(counts));
+    samples = 0;
+    maximum = 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * File: LatencyHistogram.h
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef LATENCY_HISTOGRAM
+#define LATENCY_HISTOGRAM
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Each power of two is split into this many buckets, so a percentile is within 25% of the true value
+#define LATENCY_HISTOGRAM_SUB_BUCKETS 4
+// Enough powers of two for latencies up to about two minutes in microseconds
+#define LATENCY_HISTOGRAM_BUCKETS (LATENCY_HISTOGRAM_SUB_BUCKETS * 27)
+
+/**
+ * @brief Counts latencies in fixed log-linear buckets, so recording is constant time and the memory
+ * is fixed no matter how many samples are taken. Latencies beyond the last bucket are counted in it.
+ */
+class LatencyHistogram
+{
+private:
+    uint32_t counts[LATENCY_HISTOGRAM_BUCKETS] = {};
+    uint32_t samples = 0;
+    uint64_t maximum = 0;
+
+    static size_t bucket(uint64_t latency);
+    static uint64_t upperBound(size_t bucket);
+
+public:
+    /**
+     * @brief Counts a latency
+     *
+     * @param latency In microseconds
+     */
+    void record(uint64_t latency);
+
+    /**
+     * @brief Get the latency the given percentage of samples were at or below
+     *
+     * @param percent From 0 to 100
+     * @return uint64_t The upper bound of the bucket in microseconds, or 0 without samples
+     */
+    uint64_t percentile(float percent);
+
+    uint32_t count();
+    uint64_t max();
+
+    /**
+     * @brief Forgets every sample, so the next percentiles cover a new period
+     */
+    void reset();
+};
+
+#endif /* LATENCY_HISTOGRAM */
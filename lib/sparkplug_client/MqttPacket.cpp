@@ -0,0 +1,261 @@
+/*
+ * File: MqttPacket.cpp
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#include "MqttPacket.h"
+
+#include <string.h>
+
+MqttPacketStream::MqttPacketStream(size_t captureLimit) : captureLimit(captureLimit)
+{
+}
+
+size_t MqttPacketStream::feed(const uint8_t *data, size_t size)
+{
+    size_t consumed = 0;
+
+    while (consumed < size && !done)
+    {
+        uint8_t byte = data[consumed];
+
+        if (!hasHeader || !hasLength)
+        {
+            consumed++;
+            if (packet.size() < captureLimit)
+            {
+                packet.push_back(byte);
+            }
+
+            if (!hasHeader)
+            {
+                hasHeader = true;
+                continue;
+            }
+
+            length |= (uint32_t)(byte & 0x7F) << (7 * lengthBytes++);
+            if ((byte & 0x80) == 0 || lengthBytes >= MQTT_MAX_LENGTH_BYTES)
+            {
+                hasLength = true;
+                remaining = length;
+                done = remaining == 0;
+            }
+            continue;
+        }
+
+        size_t chunk = size - consumed < remaining ? size - consumed : remaining;
+        size_t capture = packet.size() < captureLimit ? captureLimit - packet.size() : 0;
+        capture = capture < chunk ? capture : chunk;
+
+        packet.insert(packet.end(), data + consumed, data + consumed + capture);
+        consumed += chunk;
+        remaining -= chunk;
+        done = remaining == 0;
+    }
+
+    return consumed;
+}
+
+bool MqttPacketStream::complete()
+{
+    return done;
+}
+
+std::vector<uint8_t> &MqttPacketStream::getPacket()
+{
+    return packet;
+}
+
+size_t MqttPacketStream::getLength()
+{
+    return 1 + lengthBytes + length;
+}
+
+void MqttPacketStream::reset()
+{
+    packet.clear();
+    remaining = 0;
+    length = 0;
+    lengthBytes = 0;
+    hasHeader = false;
+    hasLength = false;
+    done = false;
+}
+
+bool mqttParsePublish(const uint8_t *packet, size_t length, MqttPublish *publish)
+{
+    size_t position = 1;
+
+    if (length < 2 || MQTT_PACKET_TYPE(packet[0]) != MQTT_PUBLISH)
+    {
+        return false;
+    }
+
+    publish->header = packet[0];
+
+    // Skip the remaining length, the packet is already known to be complete
+    while (position < length && position <= MQTT_MAX_LENGTH_BYTES && (packet[position] & 0x80))
+    {
+        position++;
+    }
+    position++;
+
+    if (position + 2 > length)
+    {
+        return false;
+    }
+
+    publish->topicLength = ((size_t)packet[position] << 8) | packet[position + 1];
+    position += 2;
+
+    if (position + publish->topicLength > length)
+    {
+        return false;
+    }
+
+    publish->topic = (const char *)&packet[position];
+    position += publish->topicLength;
+    publish->packetId = 0;
+
+    if (MQTT_PUBLISH_QOS(publish->header) > 0)
+    {
+        if (position + 2 > length)
+        {
+            return false;
+        }
+        publish->packetId = ((uint16_t)packet[position] << 8) | packet[position + 1];
+        position += 2;
+    }
+
+    publish->payload = &packet[position];
+    publish->payloadLength = length - position;
+    return true;
+}
+
+void mqttWritePublishHeader(std::vector<uint8_t> *buffer, uint8_t header, const char *topic, size_t topicLength,
+                            uint16_t packetId, size_t payloadLength)
+{
+    size_t remaining = 2 + topicLength + payloadLength;
+
+    if (MQTT_PUBLISH_QOS(header) > 0)
+    {
+        remaining += 2;
+    }
+
+    buffer->push_back(header);
+    do
+    {
+        uint8_t byte = remaining & 0x7F;
+        remaining >>= 7;
+        buffer->push_back(remaining > 0 ? byte | 0x80 : byte);
+    } while (remaining > 0);
+
+    buffer->push_back((uint8_t)(topicLength >> 8));
+    buffer->push_back((uint8_t)topicLength);
+    buffer->insert(buffer->end(), (const uint8_t *)topic, (const uint8_t *)topic + topicLength);
+
+    if (MQTT_PUBLISH_QOS(header) > 0)
+    {
+        buffer->push_back((uint8_t)(packetId >> 8));
+        buffer->push_back((uint8_t)packetId);
+    }
+}
+
+void mqttWritePuback(std::vector<uint8_t> *buffer, uint16_t packetId)
+{
+    buffer->push_back(MQTT_PUBACK << 4);
+    buffer->push_back(2);
+    buffer->push_back((uint8_t)(packetId >> 8));
+    buffer->push_back((uint8_t)packetId);
+}
+
+void mqttWriteSubscribe(std::vector<uint8_t> *buffer, uint16_t packetId, const std::vector<std::string> &topics, uint8_t qos)
+{
+    size_t remaining = 2;
+
+    for (auto &topic : topics)
+    {
+        remaining += 2 + topic.size() + 1;
+    }
+
+    // The flags of a SUBSCRIBE are fixed at 0010
+    buffer->push_back((MQTT_SUBSCRIBE << 4) | 0x02);
+    do
+    {
+        uint8_t byte = remaining & 0x7F;
+        remaining >>= 7;
+        buffer->push_back(remaining > 0 ? byte | 0x80 : byte);
+    } while (remaining > 0);
+
+    buffer->push_back((uint8_t)(packetId >> 8));
+    buffer->push_back((uint8_t)packetId);
+    for (auto &topic : topics)
+    {
+        buffer->push_back((uint8_t)(topic.size() >> 8));
+        buffer->push_back((uint8_t)topic.size());
+        buffer->insert(buffer->end(), (const uint8_t *)topic.data(), (const uint8_t *)topic.data() + topic.size());
+        buffer->push_back(qos);
+    }
+}
+
+bool mqttSubscribesTo(const uint8_t *packet, size_t length, const char *prefix)
+{
+    size_t prefixLength = strlen(prefix);
+    size_t position = 1;
+
+    if (length < 2 || MQTT_PACKET_TYPE(packet[0]) != MQTT_SUBSCRIBE)
+    {
+        return false;
+    }
+
+    // Skip the remaining length and the packet ID
+    while (position < length && position <= MQTT_MAX_LENGTH_BYTES && (packet[position] & 0x80))
+    {
+        position++;
+    }
+    position += 3;
+
+    while (position + 2 <= length)
+    {
+        size_t filterLength = ((size_t)packet[position] << 8) | packet[position + 1];
+        position += 2;
+        if (position + filterLength > length)
+        {
+            return false;
+        }
+
+        if (filterLength >= prefixLength && memcmp(&packet[position], prefix, prefixLength) == 0)
+        {
+            return true;
+        }
+        // The filter and its requested QoS
+        position += filterLength + 1;
+    }
+    return false;
+}
@@ -0,0 +1,175 @@
+/*
+ * File: MqttPacket.h
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef MQTT_PACKET
+#define MQTT_PACKET
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#define MQTT_CONNECT 1
+#define MQTT_CONNACK 2
+#define MQTT_PUBLISH 3
+#define MQTT_PUBACK 4
+#define MQTT_SUBSCRIBE 8
+#define MQTT_SUBACK 9
+#define MQTT_DISCONNECT 14
+
+#define MQTT_PACKET_TYPE(header) ((header) >> 4)
+#define MQTT_PUBLISH_QOS(header) (((header) >> 1) & 0x3)
+#define MQTT_PUBLISH_WITH_QOS(header, qos) (((header) & ~0x06) | ((qos) << 1))
+
+// Remaining lengths are encoded in at most four bytes
+#define MQTT_MAX_LENGTH_BYTES 4
+
+/**
+ * @brief The parts of a PUBLISH packet, pointing into the packet it was parsed from
+ */
+typedef struct
+{
+    uint8_t header;
+    const char *topic;
+    size_t topicLength;
+    uint16_t packetId;
+    const uint8_t *payload;
+    size_t payloadLength;
+} MqttPublish;
+
+/**
+ * @brief Splits a stream of bytes into MQTT packets.
+ * Bytes past the capture limit are counted but not stored, which lets large
+ * packets be followed when only their start is of interest.
+ */
+class MqttPacketStream
+{
+private:
+    std::vector<uint8_t> packet;
+    size_t captureLimit;
+    size_t remaining = 0;
+    uint32_t length = 0;
+    uint8_t lengthBytes = 0;
+    bool hasHeader = false;
+    bool hasLength = false;
+    bool done = false;
+
+public:
+    MqttPacketStream(size_t captureLimit);
+
+    /**
+     * @brief Feeds bytes into the stream up to the end of the current packet
+     *
+     * @param data
+     * @param length
+     * @return size_t The number of bytes consumed
+     */
+    size_t feed(const uint8_t *data, size_t length);
+
+    /**
+     * @brief Whether a whole packet has been fed
+     *
+     * @return true when the packet is complete
+     */
+    bool complete();
+
+    /**
+     * @brief Get the captured bytes of the current packet
+     *
+     * @return std::vector<uint8_t>&
+     */
+    std::vector<uint8_t> &getPacket();
+
+    /**
+     * @brief Get the full length of the current packet, including any bytes that were not captured
+     *
+     * @return size_t
+     */
+    size_t getLength();
+
+    /**
+     * @brief Clears the current packet to start on the next one
+     */
+    void reset();
+};
+
+/**
+ * @brief Parses a complete PUBLISH packet
+ *
+ * @param packet
+ * @param length
+ * @param publish The parsed publish, pointing into packet
+ * @return true if the packet was a valid PUBLISH
+ */
+bool mqttParsePublish(const uint8_t *packet, size_t length, MqttPublish *publish);
+
+/**
+ * @brief Encodes a PUBLISH packet up to the start of its payload
+ *
+ * @param buffer The buffer to append to
+ * @param header The fixed header byte, including the QoS and retain flags
+ * @param topic
+ * @param topicLength
+ * @param packetId Only written when the QoS is above 0
+ * @param payloadLength The length of the payload that will follow
+ */
+void mqttWritePublishHeader(std::vector<uint8_t> *buffer, uint8_t header, const char *topic, size_t topicLength,
+                            uint16_t packetId, size_t payloadLength);
+
+/**
+ * @brief Encodes the PUBACK of a QoS 1 publish
+ *
+ * @param buffer The buffer to append to
+ * @param packetId
+ */
+void mqttWritePuback(std::vector<uint8_t> *buffer, uint16_t packetId);
+
+/**
+ * @brief Encodes a SUBSCRIBE packet, answered by a single SUBACK for all of its topic filters
+ *
+ * @param buffer The buffer to append to
+ * @param packetId
+ * @param topics The topic filters
+ * @param qos The maximum QoS to receive the topics at
+ */
+void mqttWriteSubscribe(std::vector<uint8_t> *buffer, uint16_t packetId, const std::vector<std::string> &topics, uint8_t qos);
+
+/**
+ * @brief Whether a SUBSCRIBE packet has a topic filter starting with a prefix
+ *
+ * @param packet A complete SUBSCRIBE packet
+ * @param length
+ * @param prefix
+ * @return true if one of its filters starts with the prefix
+ */
+bool mqttSubscribesTo(const uint8_t *packet, size_t length, const char *prefix);
+
+#endif /* MQTT_PACKET */
@@ -30,29 +30,258 @@
  */
 
 #include "PicoSparkplugClient.h"
+#include "properties/simple/StringProperty.h"
+
+// Period for refreshing the time since the last sync when nothing else has changed
+#define NTP_METRICS_PERIOD_MS 60000
+// Latency percentiles cover the samples published over this period
+#define LATENCY_METRICS_PERIOD_MS 60000
+#define NTP_SYNC_TIME 3600
+// Time between unicast calibrations of the path delay when following broadcasts
+#define NTP_CALIBRATION_TIME 86400
 
 Client *PicoSparkplugClient::getClient()
 {
-    return (Client *)&tcpClient;
+    return (Client *)&transport;
 }
 
-PicoSparkplugClient::PicoSparkplugClient(ClientEventHandler *handler, ClientOptions *options) : CppMqttClient(handler, options)
+PicoSparkplugClient::PicoSparkplugClient(ClientEventHandler *handler, ClientOptions *options) : CppMqttClient(handler, options), arena(SPARKPLUG_ARENA_SIZE), transport((Client *)&tcpClient, &arena)
 {
 }
 
 time_t PicoSparkplugClient::getTime()
 {
-    if (ntpClient)
+    uint64_t utc;
+
+    if (time_service_utc_ms(&utc))
     {
-        return ntpClient->getTime();
+        return (time_t)utc;
     }
 
-    return us_to_ms(time_us_64());
+    // Nodes without a UTC source fall back to the monotonic clock
+    return (time_t)time_service_monotonic_ms();
 }
 
 void PicoSparkplugClient::useNtpServer(std::string address, int port)
 {
-    ntpClient = NtpClient::create(address, port, 3600);
+    ntpClient = NtpClient::create(address, port, NTP_SYNC_TIME);
+}
+
+void PicoSparkplugClient::listenNtpBroadcast(const char *group)
+{
+    if (ntpClient)
+    {
+        ntpClient->listen(group, NTP_CALIBRATION_TIME);
+    }
+}
+
+void PicoSparkplugClient::joinNtpGroup()
+{
+    if (ntpClient)
+    {
+        ntpClient->joinGroup();
+    }
+}
+
+void PicoSparkplugClient::setPublishWindow(uint32_t window)
+{
+    transport.setWindow(window);
+}
+
+void PicoSparkplugClient::setCompression(size_t threshold)
+{
+    transport.setCompression(threshold);
+}
+
+void PicoSparkplugClient::deliverAtLeastOnce(const char *device, const char *metric)
+{
+    transport.deliverAtLeastOnce(device, metric);
+}
+
+void PicoSparkplugClient::setInFlightWindow(size_t window)
+{
+    transport.setInFlightWindow(window);
+}
+
+void PicoSparkplugClient::followPrimaryHost(const char *hostId)
+{
+    transport.followPrimaryHost(hostId);
+}
+
+bool PicoSparkplugClient::isPrimaryHostOnline()
+{
+    return transport.isPrimaryHostOnline();
+}
+
+StoreAndForward *PicoSparkplugClient::enableStoreAndForward(size_t capacity)
+{
+    if (!storeAndForward)
+    {
+        storeAndForward = std::make_unique<StoreAndForward>(capacity);
+        transport.setStoreAndForward(storeAndForward.get());
+    }
+    return storeAndForward.get();
+}
+
+StoreAndForward *PicoSparkplugClient::enableStoreAndForward(FlashLog *log)
+{
+    // Samples go straight to the log so the ring in RAM isn't needed
+    StoreAndForward *history = enableStoreAndForward((size_t)0);
+    history->setFlashLog(log);
+    return history;
+}
+
+SampleBatch *PicoSparkplugClient::enableSampleBatch()
+{
+    if (!sampleBatch)
+    {
+        sampleBatch = std::make_unique<SampleBatch>();
+        transport.setSampleBatch(sampleBatch.get());
+    }
+    return sampleBatch.get();
+}
+
+ArenaStatistics PicoSparkplugClient::getArenaStatistics()
+{
+    return arena.getStatistics();
+}
+
+uint64_t PicoSparkplugClient::nextDeadline()
+{
+    uint64_t deadline = transport.nextDeadline();
+
+    if (ntpClient)
+    {
+        uint64_t sync = ntpClient->nextSync();
+        deadline = sync < deadline ? sync : deadline;
+
+        if (ntpOffset)
+        {
+            uint64_t metrics = ntpMetricsStamp;
+            deadline = metrics < deadline ? metrics : deadline;
+        }
+    }
+
+    if (!latencyMetrics.empty())
+    {
+        uint64_t metrics = latencyMetricsStamp;
+        deadline = metrics < deadline ? metrics : deadline;
+    }
+
+    return deadline;
+}
+
+NtpClient *PicoSparkplugClient::getNtpClient()
+{
+    return ntpClient.get();
+}
+
+void PicoSparkplugClient::publishNtpMetrics(Publishable *parent)
+{
+    parent->addMetrics({
+        ntpOffset = Int32Metric::create("ntp/offset", 0),
+        ntpDelay = Int32Metric::create("ntp/delay", 0),
+        ntpJitter = Int32Metric::create("ntp/jitter", 0),
+        ntpDrift = Int32Metric::create("ntp/drift", 0),
+        ntpSinceSync = Int32Metric::create("ntp/sinceSync", -1),
+        ntpTimeouts = Int32Metric::create("ntp/timeouts", 0),
+        ntpInvalidResponses = Int32Metric::create("ntp/invalidResponses", 0),
+        ntpDnsFailures = Int32Metric::create("ntp/dnsFailures", 0),
+        ntpKissOfDeath = Int32Metric::create("ntp/kissOfDeath", 0),
+    });
+
+    ntpOffset->addProperty(StringProperty::create("unit", "us"));
+    ntpDelay->addProperty(StringProperty::create("unit", "us"));
+    ntpJitter->addProperty(StringProperty::create("unit", "us"));
+    ntpDrift->addProperty(StringProperty::create("unit", "ppb"));
+    ntpSinceSync->addProperty(StringProperty::create("unit", "s"));
+
+    ntpMetricsStamp = time_service_monotonic_us();
+}
+
+void PicoSparkplugClient::updateNtpMetrics()
+{
+    NtpStatistics statistics = ntpClient->getStatistics();
+    uint32_t events = statistics.syncs + statistics.timeouts + statistics.invalidResponses +
+                      statistics.dnsFailures + statistics.kissOfDeath;
+
+    // Only refresh on a new sync result, or periodically for the time since sync
+    if (events == ntpEvents && !time_service_reached(ntpMetricsStamp))
+    {
+        return;
+    }
+
+    ntpEvents = events;
+    ntpMetricsStamp = time_service_monotonic_us() + (uint64_t)NTP_METRICS_PERIOD_MS * TIME_SERVICE_US_PER_MS;
+
+    ntpOffset->setValue((int32_t)statistics.offset);
+    ntpDelay->setValue((int32_t)statistics.delay);
+    ntpJitter->setValue((int32_t)statistics.jitter);
+    ntpDrift->setValue((int32_t)(statistics.drift * 1000.0f));
+    ntpSinceSync->setValue((int32_t)(statistics.sinceSync < 0 ? -1 : statistics.sinceSync / 1000000));
+    ntpTimeouts->setValue((int32_t)statistics.timeouts);
+    ntpInvalidResponses->setValue((int32_t)statistics.invalidResponses);
+    ntpDnsFailures->setValue((int32_t)statistics.dnsFailures);
+    ntpKissOfDeath->setValue((int32_t)statistics.kissOfDeath);
+}
+
+size_t PicoSparkplugClient::publishLatencyMetrics(Publishable *parent, const char *device)
+{
+    std::string prefix = std::string("latency/") + (device ? device : "node") + "/";
+    auto name = [&](const char *statistic)
+    {
+        return latencyNames.emplace_back(prefix + statistic).c_str();
+    };
+
+    LatencyMetrics metrics = {
+        .key = transport.trackLatency(device),
+        .p50 = Int32Metric::create(name("p50"), 0),
+        .p90 = Int32Metric::create(name("p90"), 0),
+        .p99 = Int32Metric::create(name("p99"), 0),
+        .max = Int32Metric::create(name("max"), 0),
+        .samples = Int32Metric::create(name("samples"), 0),
+    };
+
+    parent->addMetrics({metrics.p50, metrics.p90, metrics.p99, metrics.max, metrics.samples});
+    metrics.p50->addProperty(StringProperty::create("unit", "us"));
+    metrics.p90->addProperty(StringProperty::create("unit", "us"));
+    metrics.p99->addProperty(StringProperty::create("unit", "us"));
+    metrics.max->addProperty(StringProperty::create("unit", "us"));
+
+    latencyMetrics.push_back(metrics);
+    latencyMetricsStamp = time_service_monotonic_us() + (uint64_t)LATENCY_METRICS_PERIOD_MS * TIME_SERVICE_US_PER_MS;
+    return metrics.key;
+}
+
+void PicoSparkplugClient::captured(size_t key, uint64_t timestamp)
+{
+    transport.captured(key, timestamp);
+}
+
+void PicoSparkplugClient::updateLatencyMetrics()
+{
+    if (!time_service_reached(latencyMetricsStamp))
+    {
+        return;
+    }
+
+    latencyMetricsStamp = time_service_monotonic_us() + (uint64_t)LATENCY_METRICS_PERIOD_MS * TIME_SERVICE_US_PER_MS;
+
+    for (auto &metrics : latencyMetrics)
+    {
+        LatencyHistogram *histogram = transport.getLatency(metrics.key);
+
+        // Percentiles are kept from the last period that published anything
+        if (histogram->count() > 0)
+        {
+            metrics.p50->setValue((int32_t)histogram->percentile(50));
+            metrics.p90->setValue((int32_t)histogram->percentile(90));
+            metrics.p99->setValue((int32_t)histogram->percentile(99));
+            metrics.max->setValue((int32_t)histogram->max());
+        }
+        metrics.samples->setValue((int32_t)histogram->count());
+        histogram->reset();
+    }
 }
 
 void PicoSparkplugClient::sync()
@@ -60,7 +289,17 @@ void PicoSparkplugClient::sync()
     if (ntpClient)
     {
         ntpClient->sync();
+
+        if (ntpOffset)
+        {
+            updateNtpMetrics();
+        }
+    }
+    if (!latencyMetrics.empty())
+    {
+        updateLatencyMetrics();
     }
+    transport.sync();
     CppMqttClient::sync();
 }
 
@@ -68,7 +307,8 @@ bool PicoSparkplugClient::isConnected()
 {
     if (ntpClient)
     {
-        return ntpClient->synced() && CppMqttClient::isConnected();
+        // Payloads aren't published until the UTC mapping can be trusted
+        return time_service_utc_valid() && CppMqttClient::isConnected();
     }
     return CppMqttClient::isConnected();
 }
@@ -34,14 +34,63 @@
 
 #include <clients/CppMqttClient.h>
 #include <NtpClient.h>
+#include <time_service.h>
+#include <Publishable.h>
+#include <metrics/simple/Int32Metric.h>
 #include <memory>
+#include <vector>
+#include <list>
+#include <string>
 #include "PicoTcpClient.h"
+#include "SparkplugTransport.h"
+#include "StoreAndForward.h"
+#include "SampleBatch.h"
+#include "Arena.h"
+
+// Scratch space for the transport to rewrite a single publish or handle a command. Births that don't fit use the heap.
+#define SPARKPLUG_ARENA_SIZE 4096
 
 class PicoSparkplugClient : public CppMqttClient
 {
 private:
     PicoTcpClient tcpClient;
+    Arena arena;
+    SparkplugTransport transport;
     unique_ptr<NtpClient> ntpClient;
+    unique_ptr<StoreAndForward> storeAndForward;
+    unique_ptr<SampleBatch> sampleBatch;
+
+    // NTP quality metrics, only created when publishNtpMetrics is used
+    std::shared_ptr<Int32Metric> ntpOffset;
+    std::shared_ptr<Int32Metric> ntpDelay;
+    std::shared_ptr<Int32Metric> ntpJitter;
+    std::shared_ptr<Int32Metric> ntpDrift;
+    std::shared_ptr<Int32Metric> ntpSinceSync;
+    std::shared_ptr<Int32Metric> ntpTimeouts;
+    std::shared_ptr<Int32Metric> ntpInvalidResponses;
+    std::shared_ptr<Int32Metric> ntpDnsFailures;
+    std::shared_ptr<Int32Metric> ntpKissOfDeath;
+    uint32_t ntpEvents = 0;
+    // Monotonic microseconds the NTP metrics are refreshed again
+    uint64_t ntpMetricsStamp = 0;
+
+    // Sample to publish latency of a device, created by publishLatencyMetrics
+    typedef struct
+    {
+        size_t key;
+        std::shared_ptr<Int32Metric> p50;
+        std::shared_ptr<Int32Metric> p90;
+        std::shared_ptr<Int32Metric> p99;
+        std::shared_ptr<Int32Metric> max;
+        std::shared_ptr<Int32Metric> samples;
+    } LatencyMetrics;
+    std::vector<LatencyMetrics> latencyMetrics;
+    // The names of the latency metrics, which don't move once they are made
+    std::list<std::string> latencyNames;
+    uint64_t latencyMetricsStamp = 0;
+
+    void updateNtpMetrics();
+    void updateLatencyMetrics();
 
 protected:
     /**
@@ -59,13 +108,172 @@ public:
      * @param options The options for configuring the MQTT Client
      */
     PicoSparkplugClient(ClientEventHandler *handler, ClientOptions *options);
+
+    /**
+     * @brief Get the time used for payload timestamps.
+     * UTC milliseconds from the time service once its mapping is valid. Nodes without
+     * a UTC source use the milliseconds since boot.
+     *
+     * @return time_t
+     */
     virtual time_t getTime() override;
 
+    /**
+     * @brief Keeps time with an NTP server. Opens a UDP socket, so it must be called after cyw43_arch_init.
+     *
+     * @param address
+     * @param port
+     */
     void useNtpServer(std::string address, int port);
 
+    /**
+     * @brief Follows the time broadcast by the NTP server between occasional unicast calibrations.
+     * Must be called after useNtpServer. A multicast group is joined by joinNtpGroup once the link is up.
+     *
+     * @param group The multicast group to join, or a broadcast address
+     */
+    void listenNtpBroadcast(const char *group);
+
+    /**
+     * @brief Joins the multicast group of the NTP broadcasts, after every time the link comes up
+     */
+    void joinNtpGroup();
+
+    /**
+     * @brief Get the NTP Client used for time keeping.
+     * The time reads of the NTP Client are lock free and can be used from either core.
+     *
+     * @return NtpClient* The NTP Client, or NULL if no NTP server is in use
+     */
+    NtpClient *getNtpClient();
+
+    /**
+     * @brief Sets the window that metric changes are collected over before being published.
+     * All of the changes to a Node or Device within the window are sent as one NDATA or DDATA.
+     * Changes are still published immediately after a command is received.
+     *
+     * @param window The window in milliseconds, or 0 to publish every change as it is made
+     */
+    void setPublishWindow(uint32_t window);
+
+    /**
+     * @brief Compresses publishes with an encoded payload larger than the threshold, such as a
+     * birth with many metrics or a batch of replayed samples.
+     *
+     * @param threshold The size in bytes, or 0 to never compress
+     */
+    void setCompression(size_t threshold);
+
+    /**
+     * @brief Publishes changes to a metric at QoS 1, so a state change isn't lost to a dropped connection.
+     * Publishes the broker hasn't acknowledged when the connection drops are sent again, as historical
+     * metrics, after the next birth.
+     *
+     * @param device The name of the device, or NULL for a metric of the node
+     * @param metric The name of the metric
+     */
+    void deliverAtLeastOnce(const char *device, const char *metric);
+
+    /**
+     * @brief Sets how many QoS 1 publishes can wait for the broker's acknowledgement at once
+     *
+     * @param window From 1 to SPARKPLUG_INFLIGHT_SLOTS
+     */
+    void setInFlightWindow(size_t window);
+
+    /**
+     * @brief Pauses live data while the primary host's STATE says it is offline.
+     * Samples go to the store and forward buffer while paused, and the node is born again when the host comes back.
+     *
+     * @param hostId The primary host's ID
+     */
+    void followPrimaryHost(const char *hostId);
+
+    /**
+     * @brief Whether the primary host was online in its last STATE
+     *
+     * @return true if no host is followed, or it is online
+     */
+    bool isPrimaryHostOnline();
+
+    /**
+     * @brief Stores metric samples taken while the node is offline, and replays them as
+     * historical metrics after the node is born again.
+     * Samples are given to the store by the metrics that use it, such as a FilteredMetric.
+     *
+     * @param capacity The number of samples to keep, the oldest are dropped when full
+     * @return StoreAndForward* The store for metrics to write to
+     */
+    StoreAndForward *enableStoreAndForward(size_t capacity);
+
+    /**
+     * @brief Stores metric samples taken while the node is offline in a log in flash,
+     * so they are still replayed if the node loses power before it comes back online.
+     *
+     * @param log A log that has already been started with begin
+     * @return StoreAndForward* The store for metrics to write to
+     */
+    StoreAndForward *enableStoreAndForward(FlashLog *log);
+
+    /**
+     * @brief Publishes fast changing metrics as DataSets of timestamped samples, many samples to a publish.
+     * Metrics are added to the batch before the node is born, and their samples given to it as they are taken.
+     *
+     * @return SampleBatch* The batch for metrics to write to
+     */
+    SampleBatch *enableSampleBatch();
+
+    /**
+     * @brief Get the usage of the scratch arena the transport rewrites publishes in.
+     * cpp_sparkplug still encodes each publish on the heap before the transport sees it.
+     * A high water mark close to the capacity, or any overflows, mean SPARKPLUG_ARENA_SIZE is too small.
+     *
+     * @return ArenaStatistics
+     */
+    ArenaStatistics getArenaStatistics();
+
+    /**
+     * @brief Get the next time the client has work to do without anything arriving from the network,
+     * such as an NTP sync, a publish window closing or stored samples to replay
+     *
+     * @return uint64_t Monotonic time in microseconds, or UINT64_MAX if nothing is due
+     */
+    uint64_t nextDeadline();
+
+    /**
+     * @brief Publishes the quality of the NTP synchronisation as metrics of the parent.
+     * Lets the primary host weight or discard timestamps from a node with a bad clock.
+     * Must be called before the Node is enabled, and only when an NTP server will be used.
+     * The metrics are updated once useNtpServer has been called.
+     *
+     * @param parent The Node or Device to add the metrics to
+     */
+    void publishNtpMetrics(Publishable *parent);
+
+    /**
+     * @brief Publishes how long samples of a device take to leave in a data publish as metrics of the parent.
+     * A sample has left once its publish is in the TCP client's send buffer, time spent waiting there
+     * for lwIP isn't counted. The 50th, 90th and 99th percentiles and the maximum are in microseconds,
+     * over the samples published each minute. Must be called before the Node is enabled.
+     *
+     * @param parent The Node or Device to add the metrics to
+     * @param device The name of the device whose samples are timed, or NULL for the metrics of the node
+     * @return size_t The key to give captured
+     */
+    size_t publishLatencyMetrics(Publishable *parent, const char *device);
+
+    /**
+     * @brief Marks a sample as captured, for the latency to the data publish that carries it.
+     * Only call it for samples that change a metric, such as when a FilteredMetric reports.
+     *
+     * @param key From publishLatencyMetrics
+     * @param timestamp Monotonic time the sample was captured in microseconds
+     */
+    void captured(size_t key, uint64_t timestamp);
+
     /**
      * @brief Used to synchronise the MQTT client.
-     * As the Pico Client is async this function does nothing.
+     * Syncs the NTP client and publishes any metric changes whose window has closed.
      *
      */
     void sync();
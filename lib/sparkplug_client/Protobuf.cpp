@@ -0,0 +1,216 @@
+/*
+ * File: Protobuf.cpp
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#include "Protobuf.h"
+
+ProtobufReader::ProtobufReader(const uint8_t *data, size_t length) : position(data), end(data + length)
+{
+}
+
+bool ProtobufReader::readVarint(uint64_t *value)
+{
+    uint64_t result = 0;
+
+    for (int shift = 0; shift < 64 && position < end; shift += 7)
+    {
+        uint8_t byte = *position++;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *value = result;
+            return true;
+        }
+    }
+
+    failed = true;
+    return false;
+}
+
+bool ProtobufReader::next(ProtobufField *field)
+{
+    uint64_t key;
+
+    if (failed || position >= end)
+    {
+        return false;
+    }
+
+    field->start = position;
+
+    if (!readVarint(&key))
+    {
+        return false;
+    }
+
+    field->number = (uint32_t)(key >> 3);
+    field->type = (uint8_t)(key & 0x7);
+    field->value = 0;
+    field->data = NULL;
+    field->length = 0;
+
+    switch (field->type)
+    {
+    case PROTOBUF_VARINT:
+        if (!readVarint(&field->value))
+        {
+            return false;
+        }
+        break;
+    case PROTOBUF_FIXED64:
+    case PROTOBUF_FIXED32:
+        field->length = field->type == PROTOBUF_FIXED64 ? 8 : 4;
+        if ((size_t)(end - position) < field->length)
+        {
+            failed = true;
+            return false;
+        }
+        field->data = position;
+        for (size_t i = 0; i < field->length; i++)
+        {
+            field->value |= (uint64_t)position[i] << (i * 8);
+        }
+        position += field->length;
+        break;
+    case PROTOBUF_LENGTH:
+        if (!readVarint(&field->value) || field->value > (uint64_t)(end - position))
+        {
+            failed = true;
+            return false;
+        }
+        field->data = position;
+        field->length = (size_t)field->value;
+        position += field->length;
+        break;
+    default:
+        // Groups are deprecated and never used by Sparkplug
+        failed = true;
+        return false;
+    }
+
+    field->size = position - field->start;
+    return true;
+}
+
+bool ProtobufReader::error()
+{
+    return failed;
+}
+
+ProtobufWriter::ProtobufWriter(ProtobufBuffer *buffer) : buffer(buffer)
+{
+}
+
+void ProtobufWriter::varint(uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        buffer->push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    buffer->push_back((uint8_t)value);
+}
+
+void ProtobufWriter::tag(uint32_t number, uint8_t type)
+{
+    varint(((uint64_t)number << 3) | type);
+}
+
+void ProtobufWriter::varintField(uint32_t number, uint64_t value)
+{
+    tag(number, PROTOBUF_VARINT);
+    varint(value);
+}
+
+void ProtobufWriter::bytesField(uint32_t number, const void *data, size_t length)
+{
+    tag(number, PROTOBUF_LENGTH);
+    varint(length);
+    raw(data, length);
+}
+
+void ProtobufWriter::fixed32Field(uint32_t number, uint32_t value)
+{
+    tag(number, PROTOBUF_FIXED32);
+    for (int i = 0; i < 4; i++)
+    {
+        buffer->push_back((uint8_t)(value >> (i * 8)));
+    }
+}
+
+void ProtobufWriter::fixed64Field(uint32_t number, uint64_t value)
+{
+    tag(number, PROTOBUF_FIXED64);
+    for (int i = 0; i < 8; i++)
+    {
+        buffer->push_back((uint8_t)(value >> (i * 8)));
+    }
+}
+
+void ProtobufWriter::raw(const void *data, size_t length)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    buffer->insert(buffer->end(), bytes, bytes + length);
+}
+
+void ProtobufWriter::paddedVarint(uint64_t value, size_t width)
+{
+    size_t start = buffer->size();
+    buffer->resize(start + width);
+    paddedVarint(buffer->data() + start, value, width);
+}
+
+bool ProtobufWriter::paddedVarint(uint8_t *position, uint64_t value, size_t width)
+{
+    if (width == 0 || width > PROTOBUF_MAX_VARINT || varintSize(value) > width)
+    {
+        return false;
+    }
+
+    // Every byte but the last has its continuation bit set, even when the rest are zero
+    for (size_t i = 0; i < width - 1; i++)
+    {
+        position[i] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    position[width - 1] = (uint8_t)value;
+    return true;
+}
+
+size_t ProtobufWriter::varintSize(uint64_t value)
+{
+    size_t size = 1;
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
@@ -0,0 +1,150 @@
+/*
+ * File: Protobuf.h
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef PROTOBUF
+#define PROTOBUF
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include "Arena.h"
+
+#define PROTOBUF_VARINT 0
+#define PROTOBUF_FIXED64 1
+#define PROTOBUF_LENGTH 2
+#define PROTOBUF_FIXED32 5
+
+// Bytes in the longest varint, a 64 bit value
+#define PROTOBUF_MAX_VARINT 10
+
+/**
+ * @brief A field read from an encoded protobuf message.
+ * Length delimited fields point into the message being read.
+ */
+typedef struct
+{
+    uint32_t number;
+    uint8_t type;
+    uint64_t value;
+    const uint8_t *data;
+    size_t length;
+    // The whole field including its tag, for copying it unchanged
+    const uint8_t *start;
+    size_t size;
+} ProtobufField;
+
+/**
+ * @brief Reads the fields of an encoded protobuf message without decoding it into a struct.
+ * Used for inspecting and rewriting Sparkplug payloads on their way to the broker.
+ */
+class ProtobufReader
+{
+private:
+    const uint8_t *position;
+    const uint8_t *end;
+    bool failed = false;
+
+    bool readVarint(uint64_t *value);
+
+public:
+    ProtobufReader(const uint8_t *data, size_t length);
+
+    /**
+     * @brief Reads the next field of the message
+     *
+     * @param field The field that was read
+     * @return true if a field was read, false at the end of the message or if it is malformed
+     */
+    bool next(ProtobufField *field);
+
+    /**
+     * @brief Whether the reader stopped on a malformed message
+     *
+     * @return true if the message was malformed
+     */
+    bool error();
+};
+
+/**
+ * @brief A buffer that messages are encoded into, from an arena when it is scratch space
+ * for a single message and from the heap otherwise
+ */
+typedef std::vector<uint8_t, ArenaAllocator<uint8_t>> ProtobufBuffer;
+
+/**
+ * @brief Appends protobuf encoded fields to a buffer
+ */
+class ProtobufWriter
+{
+private:
+    ProtobufBuffer *buffer;
+
+public:
+    ProtobufWriter(ProtobufBuffer *buffer);
+
+    void varint(uint64_t value);
+    void tag(uint32_t number, uint8_t type);
+    void varintField(uint32_t number, uint64_t value);
+    void bytesField(uint32_t number, const void *data, size_t length);
+    void fixed32Field(uint32_t number, uint32_t value);
+    void fixed64Field(uint32_t number, uint64_t value);
+    void raw(const void *data, size_t length);
+
+    /**
+     * @brief Appends a varint padded out to a fixed width with continuation bytes,
+     * so it can be overwritten later without moving the rest of the message
+     *
+     * @param value
+     * @param width At most PROTOBUF_MAX_VARINT bytes, and wide enough for the value
+     */
+    void paddedVarint(uint64_t value, size_t width);
+
+    /**
+     * @brief Overwrites a padded varint in place
+     *
+     * @param position
+     * @param value
+     * @param width The width the varint was padded to
+     * @return true if the value fits in the width
+     */
+    static bool paddedVarint(uint8_t *position, uint64_t value, size_t width);
+
+    /**
+     * @brief Get the encoded size of a varint
+     *
+     * @param value
+     * @return size_t
+     */
+    static size_t varintSize(uint64_t value);
+};
+
+#endif /* PROTOBUF */
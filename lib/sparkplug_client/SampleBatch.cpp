@@ -0,0 +1,131 @@
+/*
+ * File: SampleBatch.cpp
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#include "SampleBatch.h"
+#include <time_service.h>
+
+uint32_t SampleBatch::add(const char *device, const char *name, uint8_t datatype, BatchOptions options)
+{
+    if (options.maxSamples == 0 || options.maxSamples > SAMPLE_BATCH_MAX_SAMPLES)
+    {
+        options.maxSamples = SAMPLE_BATCH_MAX_SAMPLES;
+    }
+
+    metrics.push_back({.datatype = datatype,
+                       .device = device ? device : "",
+                       .name = name,
+                       .options = options,
+                       .samples = std::vector<BatchedSample>(options.maxSamples),
+                       .head = 0,
+                       .count = 0});
+
+    return metrics.size() - 1;
+}
+
+BatchedMetric *SampleBatch::getMetric(uint32_t key)
+{
+    return key < metrics.size() ? &metrics[key] : NULL;
+}
+
+size_t SampleBatch::size()
+{
+    return metrics.size();
+}
+
+void SampleBatch::sample(uint32_t key, uint64_t value, uint64_t timestamp)
+{
+    BatchedMetric *metric = getMetric(key);
+    if (metric == NULL)
+    {
+        return;
+    }
+
+    size_t capacity = metric->samples.size();
+    if (metric->count == capacity)
+    {
+        metric->head = (metric->head + 1) % capacity;
+        metric->count--;
+        statistics.dropped++;
+    }
+
+    metric->samples[(metric->head + metric->count) % capacity] = {.timestamp = timestamp, .value = value};
+    metric->count++;
+    statistics.sampled++;
+}
+
+const BatchedSample *SampleBatch::getSample(uint32_t key, size_t index)
+{
+    BatchedMetric *metric = getMetric(key);
+    if (metric == NULL || index >= metric->count)
+    {
+        return NULL;
+    }
+    return &metric->samples[(metric->head + index) % metric->samples.size()];
+}
+
+uint64_t SampleBatch::due(uint32_t key)
+{
+    BatchedMetric *metric = getMetric(key);
+    if (metric == NULL || metric->count == 0)
+    {
+        return UINT64_MAX;
+    }
+
+    if (metric->count >= metric->options.maxSamples)
+    {
+        return 0;
+    }
+
+    if (metric->options.maxAge == 0)
+    {
+        return UINT64_MAX;
+    }
+
+    return metric->samples[metric->head].timestamp + (uint64_t)metric->options.maxAge * TIME_SERVICE_US_PER_MS;
+}
+
+void SampleBatch::clear(uint32_t key)
+{
+    BatchedMetric *metric = getMetric(key);
+    if (metric == NULL)
+    {
+        return;
+    }
+
+    statistics.published += metric->count;
+    metric->head = 0;
+    metric->count = 0;
+}
+
+SampleBatchStatistics SampleBatch::getStatistics()
+{
+    return statistics;
+}
@@ -0,0 +1,182 @@
+/*
+ * File: SampleBatch.h
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef SAMPLEBATCH
+#define SAMPLEBATCH
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+#include "StoreAndForward.h"
+
+// The most samples a batch can hold, so its DataSet fits in the transport's arena
+#define SAMPLE_BATCH_MAX_SAMPLES 64
+
+/**
+ * @brief When the samples of a batched metric are published
+ */
+typedef struct
+{
+    // Samples in a batch, it is published as soon as it is full. At most SAMPLE_BATCH_MAX_SAMPLES.
+    uint32_t maxSamples;
+    // Milliseconds from the oldest sample in a batch to it being published, or 0 to only publish when full
+    uint32_t maxAge;
+} BatchOptions;
+
+/**
+ * @brief A sample waiting to be published in a batch
+ */
+typedef struct
+{
+    // Monotonic time the sample was taken in microseconds
+    uint64_t timestamp;
+    // The raw bits of the value, signed values are sign extended
+    uint64_t value;
+} BatchedSample;
+
+/**
+ * @brief A metric whose samples are published in batches, and the samples waiting
+ */
+typedef struct
+{
+    uint8_t datatype;
+    // Empty for metrics of the node
+    std::string device;
+    std::string name;
+    BatchOptions options;
+    std::vector<BatchedSample> samples;
+    size_t head;
+    size_t count;
+} BatchedMetric;
+
+typedef struct
+{
+    uint32_t sampled;
+    uint32_t published;
+    // Oldest samples overwritten because the batch couldn't be published in time
+    uint32_t dropped;
+} SampleBatchStatistics;
+
+/**
+ * @brief Collects timestamped samples of fast changing metrics, so many samples go in one publish.
+ * Each batched metric is declared in its birth as a DataSet with a timestamp and a value column,
+ * and the transport publishes a batch as the rows of the DataSet once it is full or its oldest
+ * sample reaches the maximum age. While the node can't publish, the newest samples are kept.
+ */
+class SampleBatch
+{
+private:
+    std::vector<BatchedMetric> metrics;
+    SampleBatchStatistics statistics = {};
+
+public:
+    /**
+     * @brief Adds a metric that samples will be batched for
+     *
+     * @param device The name of the device, or NULL for a metric of the node
+     * @param name The name of the DataSet metric
+     * @param datatype The Sparkplug datatype of the values
+     * @param options When a batch is published
+     * @return uint32_t The key of the metric
+     */
+    uint32_t add(const char *device, const char *name, uint8_t datatype, BatchOptions options);
+
+    /**
+     * @brief Get a metric that was added
+     *
+     * @param key
+     * @return BatchedMetric* The metric, or NULL if the key is unknown
+     */
+    BatchedMetric *getMetric(uint32_t key);
+
+    size_t size();
+
+    /**
+     * @brief Adds a sample to the metric's batch, overwriting the oldest if the batch is full
+     *
+     * @param key The key of the metric
+     * @param value The raw bits of the value
+     * @param timestamp Monotonic time the sample was taken in microseconds
+     */
+    void sample(uint32_t key, uint64_t value, uint64_t timestamp);
+
+    template <typename T>
+    void sample(uint32_t key, T value, uint64_t timestamp)
+    {
+        uint64_t bits = 0;
+
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            memcpy(&bits, &value, sizeof(T));
+        }
+        else if constexpr (std::is_signed_v<T>)
+        {
+            bits = (uint64_t)(int64_t)value;
+        }
+        else
+        {
+            bits = (uint64_t)value;
+        }
+
+        sample(key, bits, timestamp);
+    }
+
+    /**
+     * @brief Get a sample of the metric's batch, oldest first
+     *
+     * @param key
+     * @param index From 0 to the number of samples waiting
+     * @return const BatchedSample*
+     */
+    const BatchedSample *getSample(uint32_t key, size_t index);
+
+    /**
+     * @brief Get the time the metric's batch should be published
+     *
+     * @param key
+     * @return uint64_t Monotonic time in microseconds, or UINT64_MAX if the batch is empty or only publishes when full
+     */
+    uint64_t due(uint32_t key);
+
+    /**
+     * @brief Removes the samples of the metric's batch once they have been published
+     *
+     * @param key
+     */
+    void clear(uint32_t key);
+
+    SampleBatchStatistics getStatistics();
+};
+
+#endif /* SAMPLEBATCH */
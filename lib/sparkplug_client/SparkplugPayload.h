@@ -0,0 +1,80 @@
+/*
+ * File: SparkplugPayload.h
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef SPARKPLUG_PAYLOAD
+#define SPARKPLUG_PAYLOAD
+
+// Field numbers of the Sparkplug B payload
+#define PAYLOAD_TIMESTAMP 1
+#define PAYLOAD_METRICS 2
+#define PAYLOAD_SEQ 3
+#define PAYLOAD_UUID 4
+#define PAYLOAD_BODY 5
+#define METRIC_NAME 1
+#define METRIC_ALIAS 2
+#define METRIC_TIMESTAMP 3
+#define METRIC_DATATYPE 4
+#define METRIC_IS_HISTORICAL 5
+#define METRIC_IS_NULL 7
+#define METRIC_INT_VALUE 10
+#define METRIC_LONG_VALUE 11
+#define METRIC_FLOAT_VALUE 12
+#define METRIC_DOUBLE_VALUE 13
+#define METRIC_BOOLEAN_VALUE 14
+#define METRIC_STRING_VALUE 15
+#define METRIC_DATASET_VALUE 17
+#define METRIC_EXTENSION_VALUE 19
+#define DATASET_NUM_OF_COLUMNS 1
+#define DATASET_COLUMNS 2
+#define DATASET_TYPES 3
+#define DATASET_ROWS 4
+#define DATASET_ROW_ELEMENTS 1
+#define DATASET_INT_VALUE 1
+#define DATASET_LONG_VALUE 2
+#define DATASET_FLOAT_VALUE 3
+#define DATASET_DOUBLE_VALUE 4
+#define DATASET_BOOLEAN_VALUE 5
+
+// The value of a metric is one of the fields from the int value to the extension value
+#define METRIC_VALUE_FIELD(number) ((number) >= METRIC_INT_VALUE && (number) <= METRIC_EXTENSION_VALUE)
+
+// The metric a primary host sets to ask for the births again
+#define NODE_CONTROL_REBIRTH "Node Control/Rebirth"
+
+// A compressed payload carries the whole payload in its body, and names the algorithm in a string metric
+#define COMPRESSED_PAYLOAD_UUID "SPBV1.0_COMPRESSED"
+#define COMPRESSION_ALGORITHM_METRIC "algorithm"
+#define COMPRESSION_ALGORITHM_DEFLATE "DEFLATE"
+#define SPARKPLUG_STRING_DATATYPE 12
+#define SPARKPLUG_DATETIME_DATATYPE 13
+#define SPARKPLUG_DATASET_DATATYPE 16
+
+#endif /* SPARKPLUG_PAYLOAD */
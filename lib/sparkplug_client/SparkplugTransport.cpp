@@ -0,0 +1,1779 @@
+/*
+ * File: SparkplugTransport.cpp
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#include "SparkplugTransport.h"
+#include "Protobuf.h"
+#include "SparkplugPayload.h"
+
+#include <string.h>
+#include <time_service.h>
+
+#define SPARKPLUG_NAMESPACE "spBv1.0"
+
+// Sequence numbers wrap after 255
+#define SEQUENCE_MODULO 256
+
+static bool topicTokenEquals(const char *token, size_t length, const char *value)
+{
+    return strlen(value) == length && memcmp(token, value, length) == 0;
+}
+
+SparkplugMessageType sparkplugMessageType(const char *topic, size_t length)
+{
+    const char *token = topic;
+    const char *end = topic + length;
+    const char *tokens[3];
+    size_t lengths[3];
+
+    // namespace/group_id/message_type/edge_node_id[/device_id]
+    for (int i = 0; i < 3; i++)
+    {
+        const char *separator = (const char *)memchr(token, '/', end - token);
+        if (separator == NULL)
+        {
+            return SPARKPLUG_OTHER;
+        }
+        tokens[i] = token;
+        lengths[i] = separator - token;
+        token = separator + 1;
+    }
+
+    if (!topicTokenEquals(tokens[0], lengths[0], SPARKPLUG_NAMESPACE))
+    {
+        return SPARKPLUG_OTHER;
+    }
+
+    static const struct
+    {
+        const char *name;
+        SparkplugMessageType type;
+    } types[] = {
+        {"NBIRTH", SPARKPLUG_NBIRTH},
+        {"NDEATH", SPARKPLUG_NDEATH},
+        {"DBIRTH", SPARKPLUG_DBIRTH},
+        {"DDEATH", SPARKPLUG_DDEATH},
+        {"NDATA", SPARKPLUG_NDATA},
+        {"DDATA", SPARKPLUG_DDATA},
+        {"NCMD", SPARKPLUG_NCMD},
+        {"DCMD", SPARKPLUG_DCMD},
+    };
+
+    for (const auto &type : types)
+    {
+        if (topicTokenEquals(tokens[2], lengths[2], type.name))
+        {
+            return type.type;
+        }
+    }
+
+    return SPARKPLUG_OTHER;
+}
+
+/**
+ * @brief Reads a primary host's STATE payload, the JSON of Sparkplug 3.0 or the ONLINE and OFFLINE of earlier versions
+ */
+static bool hostStatePayload(const uint8_t *payload, size_t length, bool *online, uint64_t *timestamp)
+{
+    std::string text((const char *)payload, length);
+
+    *timestamp = 0;
+    if (text == "ONLINE" || text == "OFFLINE")
+    {
+        *online = text == "ONLINE";
+        return true;
+    }
+
+    size_t key = text.find("\"online\"");
+    if (key == std::string::npos)
+    {
+        return false;
+    }
+    size_t value = text.find_first_not_of(" \t\r\n:", key + 8);
+    if (value == std::string::npos)
+    {
+        return false;
+    }
+    *online = text.compare(value, 4, "true") == 0;
+
+    key = text.find("\"timestamp\"");
+    if (key != std::string::npos)
+    {
+        value = text.find_first_not_of(" \t\r\n:", key + 11);
+        while (value < text.size() && text[value] >= '0' && text[value] <= '9')
+        {
+            *timestamp = *timestamp * 10 + (text[value++] - '0');
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Writes the columns of a batched metric's DataSet, the time each sample was taken and its value
+ */
+static void writeDataSetColumns(ProtobufWriter *writer, uint8_t datatype)
+{
+    writer->varintField(DATASET_NUM_OF_COLUMNS, 2);
+    writer->bytesField(DATASET_COLUMNS, "timestamp", strlen("timestamp"));
+    writer->bytesField(DATASET_COLUMNS, "value", strlen("value"));
+    writer->varintField(DATASET_TYPES, SPARKPLUG_DATETIME_DATATYPE);
+    writer->varintField(DATASET_TYPES, datatype);
+}
+
+static void writeDataSetValue(ProtobufWriter *writer, uint8_t datatype, uint64_t value)
+{
+    switch (datatype)
+    {
+    case SPARKPLUG_INT64:
+    case SPARKPLUG_UINT64:
+        writer->varintField(DATASET_LONG_VALUE, value);
+        break;
+    case SPARKPLUG_FLOAT:
+        writer->fixed32Field(DATASET_FLOAT_VALUE, (uint32_t)value);
+        break;
+    case SPARKPLUG_DOUBLE:
+        writer->fixed64Field(DATASET_DOUBLE_VALUE, value);
+        break;
+    case SPARKPLUG_BOOLEAN:
+        writer->varintField(DATASET_BOOLEAN_VALUE, value != 0);
+        break;
+    default:
+        writer->varintField(DATASET_INT_VALUE, (uint32_t)value);
+        break;
+    }
+}
+
+static const char *topicDevice(const char *topic, size_t length, size_t *deviceLength)
+{
+    const char *end = topic + length;
+
+    // namespace/group_id/message_type/edge_node_id/device_id
+    for (int i = 0; i < 4; i++)
+    {
+        const char *separator = (const char *)memchr(topic, '/', end - topic);
+        if (separator == NULL)
+        {
+            *deviceLength = 0;
+            return end;
+        }
+        topic = separator + 1;
+    }
+
+    *deviceLength = end - topic;
+    return topic;
+}
+
+SparkplugTransport::SparkplugTransport(Client *client, Arena *arena) : client(client), arena(arena), outbound(SPARKPLUG_MAX_PACKET_SIZE), inbound(SPARKPLUG_MAX_PACKET_SIZE)
+{
+}
+
+void SparkplugTransport::setWindow(uint32_t window)
+{
+    this->window = window;
+}
+
+void SparkplugTransport::setBirthCache(bool enabled)
+{
+    cacheBirths = enabled;
+}
+
+void SparkplugTransport::setAliases(bool enabled)
+{
+    useAliases = enabled;
+}
+
+void SparkplugTransport::setCompression(size_t threshold)
+{
+    compressionThreshold = threshold;
+    if (threshold > 0 && !deflate)
+    {
+        deflate = std::make_unique<Deflate>();
+    }
+}
+
+SparkplugTransportStatistics SparkplugTransport::getStatistics()
+{
+    return statistics;
+}
+
+BirthCacheStatistics SparkplugTransport::getBirthCacheStatistics()
+{
+    return births.getStatistics();
+}
+
+void SparkplugTransport::setStoreAndForward(StoreAndForward *history)
+{
+    this->history = history;
+}
+
+void SparkplugTransport::setSampleBatch(SampleBatch *batch)
+{
+    this->batch = batch;
+    batchTopics.clear();
+}
+
+size_t SparkplugTransport::trackLatency(const char *device)
+{
+    latencies.push_back({.device = device ? device : "", .captured = 0, .histogram = {}});
+    return latencies.size() - 1;
+}
+
+void SparkplugTransport::captured(size_t key, uint64_t timestamp)
+{
+    LatencyTrack &track = latencies[key];
+    if (track.captured == 0)
+    {
+        track.captured = timestamp;
+    }
+}
+
+LatencyHistogram *SparkplugTransport::getLatency(size_t key)
+{
+    return &latencies[key].histogram;
+}
+
+void SparkplugTransport::deliverAtLeastOnce(const char *device, const char *name)
+{
+    atLeastOnce.push_back({.device = device ? device : "", .name = name});
+}
+
+void SparkplugTransport::followPrimaryHost(const char *hostId)
+{
+    stateTopic = std::string(SPARKPLUG_NAMESPACE "/STATE/") + hostId;
+    legacyStateTopic = std::string("STATE/") + hostId;
+}
+
+bool SparkplugTransport::isPrimaryHostOnline()
+{
+    return hostOnline;
+}
+
+void SparkplugTransport::setInFlightWindow(size_t window)
+{
+    window = window < 1 ? 1 : window;
+    inFlightWindow = window > SPARKPLUG_INFLIGHT_SLOTS ? SPARKPLUG_INFLIGHT_SLOTS : window;
+}
+
+void SparkplugTransport::published(const char *topic, size_t topicLength)
+{
+    size_t deviceLength;
+    const char *device = topicDevice(topic, topicLength, &deviceLength);
+
+    for (auto &track : latencies)
+    {
+        if (track.captured != 0 && track.device.size() == deviceLength &&
+            memcmp(track.device.data(), device, deviceLength) == 0)
+        {
+            track.histogram.record(time_service_monotonic_us() - track.captured);
+            track.captured = 0;
+        }
+    }
+}
+
+bool SparkplugTransport::rewriting()
+{
+    // Sequence numbers only need rewriting when publishes are merged or added,
+    // and data publishes only need reading to time them
+    return window > 0 || history != NULL || cacheBirths || useAliases || !latencies.empty() || !atLeastOnce.empty() ||
+           !stateTopic.empty() || batch != NULL;
+}
+
+void SparkplugTransport::clear()
+{
+    // The outbound stream is left alone, a CONNECT is handled while it still holds the packet
+    inbound.reset();
+    received.clear();
+    receivedPosition = 0;
+    unsent.clear();
+    for (auto &publish : pending)
+    {
+        release(&publish);
+    }
+    bornDevices.clear();
+    nodeBorn = false;
+    sequence = 0;
+    immediateUntil = 0;
+    subscribeId = 0;
+    clientFollowsState = false;
+    clientFollowsLegacyState = false;
+
+    // Nothing of the old session will be acknowledged, what it didn't deliver goes again after the births
+    for (size_t i = 0; i < inFlightCount; i++)
+    {
+        InFlightPublish &entry = inFlight[(inFlightHead + i) % SPARKPLUG_INFLIGHT_SLOTS];
+        entry.state = entry.state == INFLIGHT_SENT ? INFLIGHT_WAITING : entry.state;
+        entry.historical = true;
+    }
+    for (auto &entry : backlog)
+    {
+        entry.historical = true;
+    }
+    inFlightSent = 0;
+
+    // The births of the new session carry the samples, so they aren't waiting on a data publish
+    for (auto &track : latencies)
+    {
+        track.captured = 0;
+    }
+
+    if (history)
+    {
+        history->setOnline(false);
+    }
+}
+
+bool SparkplugTransport::coalesce(MqttPublish *publish)
+{
+    ProtobufReader reader(publish->payload, publish->payloadLength);
+    ProtobufField field;
+    uint64_t timestamp = 0;
+
+    while (reader.next(&field))
+    {
+        if (field.number == PAYLOAD_TIMESTAMP)
+        {
+            timestamp = field.value;
+        }
+        // Anything else, such as a compressed body, can't be merged
+        else if (field.number != PAYLOAD_METRICS && field.number != PAYLOAD_SEQ)
+        {
+            return false;
+        }
+    }
+
+    if (reader.error())
+    {
+        return false;
+    }
+
+    PendingPublish *entry = NULL;
+    PendingPublish *unused = NULL;
+    for (auto &candidate : pending)
+    {
+        if (!candidate.active)
+        {
+            unused = unused ? unused : &candidate;
+        }
+        else if (candidate.topic.size() == publish->topicLength &&
+                 memcmp(candidate.topic.data(), publish->topic, publish->topicLength) == 0)
+        {
+            entry = &candidate;
+            statistics.coalesced++;
+            break;
+        }
+    }
+
+    if (entry == NULL)
+    {
+        if (unused == NULL)
+        {
+            pending.push_back({});
+            unused = &pending.back();
+        }
+        entry = unused;
+        entry->active = true;
+        entry->topic.assign(publish->topic, publish->topicLength);
+        entry->header = publish->header;
+        entry->timestamp = 0;
+        entry->deadline = time_service_monotonic_us() + (uint64_t)window * TIME_SERVICE_US_PER_MS;
+    }
+
+    entry->timestamp = timestamp > entry->timestamp ? timestamp : entry->timestamp;
+
+    ProtobufReader metrics(publish->payload, publish->payloadLength);
+    while (metrics.next(&field))
+    {
+        if (field.number != PAYLOAD_METRICS)
+        {
+            continue;
+        }
+
+        ProtobufReader metricReader(field.data, field.length);
+        ProtobufField metricField;
+        size_t keyOffset = entry->keys.size();
+
+        // Metrics are matched by name, or by alias when the name was left out
+        while (metricReader.next(&metricField))
+        {
+            if (metricField.number == METRIC_NAME)
+            {
+                entry->keys.resize(keyOffset);
+                entry->keys.insert(entry->keys.end(), metricField.data, metricField.data + metricField.length);
+                break;
+            }
+            else if (metricField.number == METRIC_ALIAS)
+            {
+                entry->keys.resize(keyOffset);
+                entry->keys.push_back('\0');
+                entry->keys.insert(entry->keys.end(), metricField.start, metricField.start + metricField.size);
+            }
+        }
+
+        PendingMetric metric = {.keyOffset = keyOffset,
+                                .keyLength = entry->keys.size() - keyOffset,
+                                .offset = entry->data.size(),
+                                .length = field.length};
+        entry->data.insert(entry->data.end(), field.data, field.data + field.length);
+
+        // Only the latest value of a metric that changed more than once in the window is kept
+        bool replaced = false;
+        for (auto &existing : entry->metrics)
+        {
+            if (metric.keyLength > 0 &&
+                existing.keyLength == metric.keyLength &&
+                memcmp(&entry->keys[existing.keyOffset], &entry->keys[keyOffset], metric.keyLength) == 0)
+            {
+                existing.offset = metric.offset;
+                existing.length = metric.length;
+                entry->keys.resize(keyOffset);
+                replaced = true;
+                break;
+            }
+        }
+
+        if (!replaced)
+        {
+            entry->metrics.push_back(metric);
+        }
+    }
+
+    return true;
+}
+
+void SparkplugTransport::release(PendingPublish *publish)
+{
+    publish->active = false;
+    publish->keys.clear();
+    publish->data.clear();
+    publish->metrics.clear();
+}
+
+size_t SparkplugTransport::send(PendingPublish *publish)
+{
+    ProtobufBuffer payload(arena);
+    ProtobufWriter writer(&payload);
+
+    payload.reserve(publish->data.size() + (publish->metrics.size() + 1) * (PROTOBUF_MAX_VARINT + 1) + PROTOBUF_MAX_VARINT);
+    writer.varintField(PAYLOAD_TIMESTAMP, publish->timestamp);
+    for (auto &metric : publish->metrics)
+    {
+        writer.bytesField(PAYLOAD_METRICS, &publish->data[metric.offset], metric.length);
+    }
+
+    size_t written = send(publish->header, publish->topic.data(), publish->topic.size(), 0, payload);
+    if (written > 0 && !latencies.empty())
+    {
+        published(publish->topic.data(), publish->topic.size());
+    }
+    return written;
+}
+
+size_t SparkplugTransport::send(uint8_t header, const char *topic, size_t topicLength, uint16_t packetId, ProtobufBuffer &payload)
+{
+    ProtobufWriter writer(&payload);
+
+    writer.varintField(PAYLOAD_SEQ, sequence);
+    sequence = (sequence + 1) % SEQUENCE_MODULO;
+
+    ProtobufBuffer wrapper(arena);
+    ProtobufBuffer &body = compress(payload, &wrapper) ? wrapper : payload;
+
+    buffer.clear();
+    mqttWritePublishHeader(&buffer, header, topic, topicLength, packetId, body.size());
+    buffer.insert(buffer.end(), body.begin(), body.end());
+
+    return transmit(buffer.data(), buffer.size());
+}
+
+bool SparkplugTransport::compress(ProtobufBuffer &payload, ProtobufBuffer *wrapper)
+{
+    if (compressionThreshold == 0 || payload.size() <= compressionThreshold)
+    {
+        return false;
+    }
+
+    // Output that wouldn't be smaller than the payload isn't wanted
+    compressed.resize(payload.size());
+    size_t length = deflate->compress(payload.data(), payload.size(), compressed.data(), compressed.size());
+    if (length == 0)
+    {
+        return false;
+    }
+
+    ProtobufBuffer metric(arena);
+    ProtobufWriter metricWriter(&metric);
+    ProtobufWriter writer(wrapper);
+
+    metricWriter.bytesField(METRIC_NAME, COMPRESSION_ALGORITHM_METRIC, strlen(COMPRESSION_ALGORITHM_METRIC));
+    metricWriter.varintField(METRIC_DATATYPE, SPARKPLUG_STRING_DATATYPE);
+    metricWriter.bytesField(METRIC_STRING_VALUE, COMPRESSION_ALGORITHM_DEFLATE, strlen(COMPRESSION_ALGORITHM_DEFLATE));
+
+    wrapper->reserve(length + metric.size() + sizeof(COMPRESSED_PAYLOAD_UUID) + 4 * PROTOBUF_MAX_VARINT);
+    writer.bytesField(PAYLOAD_METRICS, metric.data(), metric.size());
+    writer.bytesField(PAYLOAD_UUID, COMPRESSED_PAYLOAD_UUID, strlen(COMPRESSED_PAYLOAD_UUID));
+    writer.bytesField(PAYLOAD_BODY, compressed.data(), length);
+
+    if (wrapper->size() >= payload.size())
+    {
+        return false;
+    }
+
+    statistics.compressed++;
+    statistics.compressionSaved += payload.size() - wrapper->size();
+    return true;
+}
+
+size_t SparkplugTransport::forward(MqttPublish *publish, SparkplugMessageType type, bool acknowledged)
+{
+    ProtobufBuffer payload(arena);
+    ProtobufWriter writer(&payload);
+    ProtobufReader reader(publish->payload, publish->payloadLength);
+    ProtobufField field;
+
+    // A birth of the node starts the sequence again
+    if (type == SPARKPLUG_NBIRTH)
+    {
+        sequence = 0;
+    }
+
+    payload.reserve(publish->payloadLength + PROTOBUF_MAX_VARINT);
+    while (reader.next(&field))
+    {
+        if (field.number != PAYLOAD_SEQ)
+        {
+            writer.raw(field.start, field.size);
+        }
+    }
+
+    if (reader.error())
+    {
+        return transmit(outbound.getPacket().data(), outbound.getPacket().size());
+    }
+
+    size_t written = acknowledged ? deliver(publish, payload)
+                                  : send(publish->header, publish->topic, publish->topicLength, publish->packetId, payload);
+    if (written > 0 && (type == SPARKPLUG_NDATA || type == SPARKPLUG_DDATA) && !latencies.empty())
+    {
+        published(publish->topic, publish->topicLength);
+    }
+    return written;
+}
+
+void SparkplugTransport::birth(MqttPublish *publish, SparkplugMessageType type)
+{
+    // namespace/group_id/message_type/edge_node_id[/device_id]
+    std::string topic(publish->topic, publish->topicLength);
+    size_t group = topic.find('/');
+    size_t messageType = topic.find('/', group + 1);
+    size_t node = topic.find('/', messageType + 1);
+    size_t device = topic.find('/', node + 1);
+
+    if (node == std::string::npos)
+    {
+        return;
+    }
+
+    if (type == SPARKPLUG_NBIRTH)
+    {
+        topicPrefix = topic.substr(0, messageType + 1);
+        nodeId = topic.substr(node + 1);
+        bornDevices.clear();
+        if (batch)
+        {
+            nameBatches();
+        }
+        nodeBorn = true;
+        birthTime = time_service_monotonic_ms();
+
+        // Samples keep going to the store while the primary host is away
+        if (history && hostOnline)
+        {
+            history->setOnline(true);
+        }
+    }
+    else if (device != std::string::npos && !isBorn(topic.data() + device + 1, topic.size() - device - 1))
+    {
+        bornDevices.push_back(topic.substr(device + 1));
+    }
+}
+
+void SparkplugTransport::death(MqttPublish *publish)
+{
+    size_t deviceLength;
+    const char *device = topicDevice(publish->topic, publish->topicLength, &deviceLength);
+
+    // A device that has died isn't born again with the node until the MQTT client births it
+    for (auto born = bornDevices.begin(); born != bornDevices.end(); born++)
+    {
+        if (born->size() == deviceLength && memcmp(born->data(), device, deviceLength) == 0)
+        {
+            bornDevices.erase(born);
+            return;
+        }
+    }
+}
+
+bool SparkplugTransport::isBorn(const char *device, size_t length)
+{
+    for (auto &born : bornDevices)
+    {
+        if (born.size() == length && memcmp(born.data(), device, length) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SparkplugTransport::replay()
+{
+    ProtobufBuffer payload(arena);
+    ProtobufBuffer metric(arena);
+    ProtobufWriter writer(&payload);
+    ProtobufWriter metricWriter(&metric);
+    StoredSample sample;
+    std::string device;
+    uint64_t now;
+    int count = 0;
+
+    if (!time_service_utc_ms(&now))
+    {
+        return;
+    }
+
+    writer.varintField(PAYLOAD_TIMESTAMP, now);
+
+    while (count < SPARKPLUG_REPLAY_BATCH && history->peek(&sample))
+    {
+        StoredMetric *stored = history->getMetric(sample.key);
+        uint64_t timestamp = sample.timestamp;
+
+        // Monotonic times from before a reboot never get this far, so the conversion holds while UTC is known
+        if (stored == NULL || (!sample.utc && !time_service_to_utc_ms(sample.timestamp * TIME_SERVICE_US_PER_MS, &timestamp)))
+        {
+            history->drop();
+            continue;
+        }
+
+        if (count == 0)
+        {
+            device = stored->device;
+        }
+
+        // Each publish only holds the metrics of one device
+        if (stored->device != device)
+        {
+            break;
+        }
+
+        // A device's data can't be published before its birth
+        if (!device.empty() && !isBorn(device.data(), device.size()))
+        {
+            if (time_service_monotonic_ms() - birthTime >= SPARKPLUG_REPLAY_BIRTH_TIMEOUT_MS)
+            {
+                history->drop();
+                continue;
+            }
+            break;
+        }
+
+        uint64_t alias;
+        metric.clear();
+        if (useAliases && aliases.find(stored->device.data(), stored->device.size(), stored->name.data(), stored->name.size(), &alias))
+        {
+            metricWriter.varintField(METRIC_ALIAS, alias);
+        }
+        else
+        {
+            metricWriter.bytesField(METRIC_NAME, stored->name.data(), stored->name.size());
+        }
+        metricWriter.varintField(METRIC_TIMESTAMP, timestamp);
+        metricWriter.varintField(METRIC_DATATYPE, stored->datatype);
+        metricWriter.varintField(METRIC_IS_HISTORICAL, 1);
+
+        switch (stored->datatype)
+        {
+        case SPARKPLUG_INT64:
+        case SPARKPLUG_UINT64:
+            metricWriter.varintField(METRIC_LONG_VALUE, sample.value);
+            break;
+        case SPARKPLUG_FLOAT:
+            metricWriter.fixed32Field(METRIC_FLOAT_VALUE, (uint32_t)sample.value);
+            break;
+        case SPARKPLUG_DOUBLE:
+            metricWriter.fixed64Field(METRIC_DOUBLE_VALUE, sample.value);
+            break;
+        case SPARKPLUG_BOOLEAN:
+            metricWriter.varintField(METRIC_BOOLEAN_VALUE, sample.value != 0);
+            break;
+        default:
+            metricWriter.varintField(METRIC_INT_VALUE, (uint32_t)sample.value);
+            break;
+        }
+
+        writer.bytesField(PAYLOAD_METRICS, metric.data(), metric.size());
+        history->pop();
+        count++;
+    }
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    std::string topic = topicPrefix + (device.empty() ? "NDATA/" + nodeId : "DDATA/" + nodeId + "/" + device);
+    send(MQTT_PUBLISH << 4, topic.data(), topic.size(), 0, payload);
+}
+
+void SparkplugTransport::declareBatches(MqttPublish *publish, ProtobufBuffer *declared)
+{
+    ProtobufBuffer metric(arena);
+    ProtobufBuffer dataset(arena);
+    ProtobufWriter writer(declared);
+    ProtobufWriter metricWriter(&metric);
+    ProtobufWriter datasetWriter(&dataset);
+    size_t deviceLength;
+    const char *device = topicDevice(publish->topic, publish->topicLength, &deviceLength);
+
+    for (uint32_t key = 0; key < batch->size(); key++)
+    {
+        BatchedMetric *batched = batch->getMetric(key);
+        if (batched->device.size() != deviceLength || memcmp(batched->device.data(), device, deviceLength) != 0)
+        {
+            continue;
+        }
+
+        if (declared->empty())
+        {
+            writer.raw(publish->payload, publish->payloadLength);
+        }
+
+        // Declared without rows, the batches that follow are its values
+        metric.clear();
+        dataset.clear();
+        writeDataSetColumns(&datasetWriter, batched->datatype);
+        metricWriter.bytesField(METRIC_NAME, batched->name.data(), batched->name.size());
+        metricWriter.varintField(METRIC_DATATYPE, SPARKPLUG_DATASET_DATATYPE);
+        metricWriter.bytesField(METRIC_DATASET_VALUE, dataset.data(), dataset.size());
+        writer.bytesField(PAYLOAD_METRICS, metric.data(), metric.size());
+    }
+
+    if (!declared->empty())
+    {
+        publish->payload = declared->data();
+        publish->payloadLength = declared->size();
+    }
+}
+
+bool SparkplugTransport::canPublishBatch(BatchedMetric *metric)
+{
+    // Samples are kept until the host can read them, the newest are published once it can
+    return nodeBorn && hostOnline && client->connected() && (metric->device.empty() || isBorn(metric->device.data(), metric->device.size()));
+}
+
+void SparkplugTransport::publishBatches(uint64_t now)
+{
+    for (uint32_t key = 0; key < batch->size(); key++)
+    {
+        if (now >= batch->due(key) && canPublishBatch(batch->getMetric(key)))
+        {
+            publishBatch(key);
+        }
+    }
+}
+
+void SparkplugTransport::nameBatches()
+{
+    batchTopics.resize(batch->size());
+    for (uint32_t key = 0; key < batch->size(); key++)
+    {
+        BatchedMetric *batched = batch->getMetric(key);
+        batchTopics[key] = topicPrefix + (batched->device.empty() ? "NDATA/" + nodeId : "DDATA/" + nodeId + "/" + batched->device);
+    }
+}
+
+size_t SparkplugTransport::publishBatch(uint32_t key)
+{
+    BatchedMetric *batched = batch->getMetric(key);
+    ProtobufBuffer payload(arena);
+    ProtobufBuffer metric(arena);
+    ProtobufBuffer dataset(arena);
+    ProtobufBuffer row(arena);
+    ProtobufBuffer element(arena);
+    ProtobufWriter writer(&payload);
+    ProtobufWriter metricWriter(&metric);
+    ProtobufWriter datasetWriter(&dataset);
+    ProtobufWriter rowWriter(&row);
+    ProtobufWriter elementWriter(&element);
+    uint64_t now;
+    uint64_t timestamp = 0;
+
+    if (!time_service_utc_ms(&now))
+    {
+        now = time_service_monotonic_ms();
+    }
+
+    // A row is two elements of a timestamp and a value, a little over 20 bytes
+    dataset.reserve(batched->count * 24 + 32);
+    writeDataSetColumns(&datasetWriter, batched->datatype);
+    for (size_t i = 0; i < batched->count; i++)
+    {
+        const BatchedSample *sample = batch->getSample(key, i);
+
+        if (!time_service_to_utc_ms(sample->timestamp, &timestamp))
+        {
+            timestamp = sample->timestamp / TIME_SERVICE_US_PER_MS;
+        }
+
+        row.clear();
+        element.clear();
+        elementWriter.varintField(DATASET_LONG_VALUE, timestamp);
+        rowWriter.bytesField(DATASET_ROW_ELEMENTS, element.data(), element.size());
+        element.clear();
+        writeDataSetValue(&elementWriter, batched->datatype, sample->value);
+        rowWriter.bytesField(DATASET_ROW_ELEMENTS, element.data(), element.size());
+        datasetWriter.bytesField(DATASET_ROWS, row.data(), row.size());
+    }
+
+    // The metric is stamped with its newest sample
+    metricWriter.bytesField(METRIC_NAME, batched->name.data(), batched->name.size());
+    metricWriter.varintField(METRIC_TIMESTAMP, timestamp);
+    metricWriter.varintField(METRIC_DATATYPE, SPARKPLUG_DATASET_DATATYPE);
+    metricWriter.bytesField(METRIC_DATASET_VALUE, dataset.data(), dataset.size());
+
+    writer.varintField(PAYLOAD_TIMESTAMP, now);
+    writer.bytesField(PAYLOAD_METRICS, metric.data(), metric.size());
+
+    // Metrics added since the node was born don't have a topic yet
+    if (key >= batchTopics.size())
+    {
+        nameBatches();
+    }
+
+    const std::string &topic = batchTopics[key];
+    size_t written = send(MQTT_PUBLISH << 4, topic.data(), topic.size(), 0, payload);
+    if (written > 0)
+    {
+        batch->clear(key);
+        statistics.batches++;
+    }
+    return written;
+}
+
+void SparkplugTransport::handleOutbound(std::vector<uint8_t> &packet)
+{
+    MqttPublish publish;
+    SparkplugMessageType type = SPARKPLUG_OTHER;
+
+    if (MQTT_PACKET_TYPE(packet[0]) == MQTT_CONNECT)
+    {
+        clear();
+    }
+
+    if (MQTT_PACKET_TYPE(packet[0]) == MQTT_SUBSCRIBE && !stateTopic.empty())
+    {
+        clientFollowsState |= mqttSubscribesTo(packet.data(), packet.size(), SPARKPLUG_NAMESPACE "/STATE/");
+        clientFollowsLegacyState |= mqttSubscribesTo(packet.data(), packet.size(), "STATE/");
+    }
+
+    if (!rewriting())
+    {
+        transmit(packet.data(), packet.size());
+        return;
+    }
+
+    if (mqttParsePublish(packet.data(), packet.size(), &publish))
+    {
+        type = sparkplugMessageType(publish.topic, publish.topicLength);
+    }
+
+    // Matched by name before the names are swapped for aliases
+    bool acknowledged = (type == SPARKPLUG_NDATA || type == SPARKPLUG_DDATA) &&
+                        MQTT_PUBLISH_QOS(publish.header) == 0 &&
+                        needsAcknowledgement(&publish);
+
+    // Lives in the arena until the packet has been handled
+    ProtobufBuffer aliased(arena);
+    ProtobufBuffer declared(arena);
+    if (useAliases && type != SPARKPLUG_OTHER)
+    {
+        size_t deviceLength;
+        const char *device = topicDevice(publish.topic, publish.topicLength, &deviceLength);
+        bool rewritten = false;
+
+        if (type == SPARKPLUG_NBIRTH || type == SPARKPLUG_DBIRTH)
+        {
+            rewritten = sparkplugAliasBirth(&aliases, device, deviceLength, publish.payload, publish.payloadLength, &aliased);
+        }
+        else if (type == SPARKPLUG_NDATA || type == SPARKPLUG_DDATA)
+        {
+            rewritten = sparkplugAliasData(&aliases, device, deviceLength, publish.payload, publish.payloadLength, &aliased);
+        }
+
+        if (rewritten)
+        {
+            publish.payload = aliased.data();
+            publish.payloadLength = aliased.size();
+        }
+    }
+
+    if (type == SPARKPLUG_NDATA || type == SPARKPLUG_DDATA)
+    {
+        statistics.publishes++;
+
+        if (cacheBirths)
+        {
+            size_t deviceLength;
+            const char *device = topicDevice(publish.topic, publish.topicLength, &deviceLength);
+            births.update(&publish, device, deviceLength);
+        }
+
+        // Nothing reads live data while the primary host is away, the store and the next birth stand in for it
+        if (!hostOnline && !acknowledged)
+        {
+            statistics.paused++;
+            return;
+        }
+
+        // Publishes that need an acknowledgement keep their own packet
+        if (window > 0 &&
+            MQTT_PUBLISH_QOS(publish.header) == 0 &&
+            !acknowledged &&
+            time_service_reached(immediateUntil) &&
+            coalesce(&publish))
+        {
+            return;
+        }
+    }
+
+    // Anything else keeps its order relative to the pending data
+    flush();
+
+    switch (type)
+    {
+    case SPARKPLUG_NBIRTH:
+    case SPARKPLUG_DBIRTH:
+        if (batch)
+        {
+            declareBatches(&publish, &declared);
+        }
+        if (cacheBirths)
+        {
+            size_t deviceLength;
+            const char *device = topicDevice(publish.topic, publish.topicLength, &deviceLength);
+            births.store(&publish, device, deviceLength);
+        }
+        birth(&publish, type);
+        forward(&publish, type, false);
+        break;
+    case SPARKPLUG_NDEATH:
+        if (history)
+        {
+            history->setOnline(false);
+        }
+        transmit(packet.data(), packet.size());
+        break;
+    case SPARKPLUG_DDEATH:
+        death(&publish);
+        forward(&publish, type, acknowledged);
+        break;
+    case SPARKPLUG_NDATA:
+    case SPARKPLUG_DDATA:
+        forward(&publish, type, acknowledged);
+        break;
+    default:
+        transmit(packet.data(), packet.size());
+        break;
+    }
+}
+
+bool SparkplugTransport::handleInbound(std::vector<uint8_t> &packet)
+{
+    MqttPublish publish;
+
+    // The MQTT client didn't send the publishes the transport made QoS 1, so it isn't given their acknowledgements
+    if (MQTT_PACKET_TYPE(packet[0]) == MQTT_PUBACK)
+    {
+        return !acknowledge(packet);
+    }
+
+    if (MQTT_PACKET_TYPE(packet[0]) == MQTT_CONNACK)
+    {
+        if (!stateTopic.empty() && packet.size() >= 4 && packet[3] == 0)
+        {
+            subscribeState();
+        }
+        return true;
+    }
+
+    if (MQTT_PACKET_TYPE(packet[0]) == MQTT_SUBACK)
+    {
+        return packet.size() < 4 || subscribeId == 0 || (uint16_t)(packet[2] << 8 | packet[3]) != subscribeId;
+    }
+
+    if (MQTT_PACKET_TYPE(packet[0]) != MQTT_PUBLISH || !mqttParsePublish(packet.data(), packet.size(), &publish))
+    {
+        return true;
+    }
+
+    bool state = !stateTopic.empty() && publish.topicLength == stateTopic.size() &&
+                 memcmp(publish.topic, stateTopic.data(), stateTopic.size()) == 0;
+    bool legacyState = !legacyStateTopic.empty() && publish.topicLength == legacyStateTopic.size() &&
+                       memcmp(publish.topic, legacyStateTopic.data(), legacyStateTopic.size()) == 0;
+    if (state || legacyState)
+    {
+        hostState(&publish);
+        if (state ? clientFollowsState : clientFollowsLegacyState)
+        {
+            return true;
+        }
+
+        // Hosts publish STATE at QoS 1, unacknowledged it would hold one of the broker's in-flight slots for good
+        if (MQTT_PUBLISH_QOS(publish.header) == 1)
+        {
+            buffer.clear();
+            mqttWritePuback(&buffer, publish.packetId);
+            transmit(buffer.data(), buffer.size());
+        }
+        return false;
+    }
+
+    SparkplugMessageType type = sparkplugMessageType(publish.topic, publish.topicLength);
+    if (type != SPARKPLUG_NCMD && type != SPARKPLUG_DCMD)
+    {
+        return true;
+    }
+
+    if (useAliases)
+    {
+        unalias(packet, &publish);
+    }
+
+    if (window > 0)
+    {
+        flush();
+        immediateUntil = time_service_monotonic_us() + (uint64_t)window * TIME_SERVICE_US_PER_MS;
+    }
+
+    // A command that needs an acknowledgement has to reach the MQTT client
+    if (type == SPARKPLUG_NCMD &&
+        cacheBirths &&
+        MQTT_PUBLISH_QOS(publish.header) == 0 &&
+        sparkplugIsRebirth(publish.payload, publish.payloadLength))
+    {
+        return !rebirth();
+    }
+
+    return true;
+}
+
+void SparkplugTransport::unalias(std::vector<uint8_t> &packet, MqttPublish *publish)
+{
+    ProtobufBuffer payload(arena);
+    size_t deviceLength;
+    const char *device = topicDevice(publish->topic, publish->topicLength, &deviceLength);
+
+    if (!sparkplugUnaliasCommand(&aliases, device, deviceLength, publish->payload, publish->payloadLength, &payload))
+    {
+        return;
+    }
+
+    buffer.clear();
+    mqttWritePublishHeader(&buffer, publish->header, publish->topic, publish->topicLength, publish->packetId, payload.size());
+    buffer.insert(buffer.end(), payload.begin(), payload.end());
+    packet.swap(buffer);
+    mqttParsePublish(packet.data(), packet.size(), publish);
+}
+
+bool SparkplugTransport::rebirth()
+{
+    const CachedBirth *node = births.get("");
+    std::vector<const CachedBirth *> devices;
+
+    for (auto &device : bornDevices)
+    {
+        devices.push_back(births.get(device));
+    }
+
+    // Without every birth cached the MQTT client has to encode them all again
+    if (node == NULL || topicPrefix.empty())
+    {
+        births.count(false);
+        return false;
+    }
+    for (auto device : devices)
+    {
+        if (device == NULL)
+        {
+            births.count(false);
+            return false;
+        }
+    }
+
+    births.count(true);
+    flush();
+
+    sequence = 0;
+    send(node);
+    for (auto device : devices)
+    {
+        send(device);
+    }
+    return true;
+}
+
+size_t SparkplugTransport::send(const CachedBirth *cached)
+{
+    ProtobufBuffer payload(arena);
+    ProtobufWriter writer(&payload);
+    MqttPublish publish = {.header = cached->header,
+                           .topic = cached->topic.data(),
+                           .topicLength = cached->topic.size(),
+                           .packetId = 0,
+                           .payload = NULL,
+                           .payloadLength = 0};
+    uint64_t now;
+
+    if (!time_service_utc_ms(&now))
+    {
+        now = time_service_monotonic_ms();
+    }
+
+    payload.reserve(ProtobufWriter::varintSize(now) + cached->body.size() + PROTOBUF_MAX_VARINT);
+    writer.varintField(PAYLOAD_TIMESTAMP, now);
+    writer.raw(cached->body.data(), cached->body.size());
+
+    birth(&publish, cached->device.empty() ? SPARKPLUG_NBIRTH : SPARKPLUG_DBIRTH);
+    return send(cached->header, cached->topic.data(), cached->topic.size(), 0, payload);
+}
+
+bool SparkplugTransport::needsAcknowledgement(MqttPublish *publish)
+{
+    if (atLeastOnce.empty())
+    {
+        return false;
+    }
+
+    size_t deviceLength;
+    const char *device = topicDevice(publish->topic, publish->topicLength, &deviceLength);
+    ProtobufReader reader(publish->payload, publish->payloadLength);
+    ProtobufField field;
+
+    while (reader.next(&field))
+    {
+        if (field.number != PAYLOAD_METRICS)
+        {
+            continue;
+        }
+
+        ProtobufReader metricReader(field.data, field.length);
+        ProtobufField metricField;
+        while (metricReader.next(&metricField))
+        {
+            if (metricField.number != METRIC_NAME)
+            {
+                continue;
+            }
+
+            for (auto &metric : atLeastOnce)
+            {
+                if (metric.device.size() == deviceLength &&
+                    memcmp(metric.device.data(), device, deviceLength) == 0 &&
+                    metric.name.size() == metricField.length &&
+                    memcmp(metric.name.data(), metricField.data, metricField.length) == 0)
+                {
+                    return true;
+                }
+            }
+            break;
+        }
+    }
+
+    return false;
+}
+
+size_t SparkplugTransport::deliver(MqttPublish *publish, ProtobufBuffer &payload)
+{
+    // Made while the primary host is away, so the births it comes back to will be newer
+    bool historical = !hostOnline;
+    statistics.atLeastOnce++;
+
+    // The broker sets the pace, a publish with no slot left waits for an acknowledgement to free one
+    if (inFlightCount == SPARKPLUG_INFLIGHT_SLOTS)
+    {
+        statistics.queued++;
+        for (auto &entry : backlog)
+        {
+            if (entry.historical == historical && entry.topic.size() == publish->topicLength &&
+                memcmp(entry.topic.data(), publish->topic, publish->topicLength) == 0)
+            {
+                // Its metrics join those already waiting, so the backlog doesn't grow with the outage
+                ProtobufReader reader(payload.data(), payload.size());
+                ProtobufField field;
+                while (reader.next(&field))
+                {
+                    if (field.number == PAYLOAD_METRICS)
+                    {
+                        entry.payload.insert(entry.payload.end(), field.start, field.start + field.size);
+                    }
+                }
+                return 0;
+            }
+        }
+
+        backlog.emplace_back();
+        InFlightPublish &entry = backlog.back();
+        entry.state = INFLIGHT_WAITING;
+        entry.historical = historical;
+        entry.header = MQTT_PUBLISH_WITH_QOS(publish->header, 1);
+        entry.topic.assign(publish->topic, publish->topicLength);
+        entry.payload.assign(payload.begin(), payload.end());
+        return 0;
+    }
+
+    InFlightPublish &entry = inFlight[(inFlightHead + inFlightCount) % SPARKPLUG_INFLIGHT_SLOTS];
+    inFlightCount++;
+
+    entry.state = INFLIGHT_WAITING;
+    entry.historical = historical;
+    entry.header = MQTT_PUBLISH_WITH_QOS(publish->header, 1);
+    entry.topic.assign(publish->topic, publish->topicLength);
+    entry.payload.assign(payload.begin(), payload.end());
+
+    // Goes out now unless the window is full, in which case it waits behind the others
+    return sendWaiting();
+}
+
+SparkplugTransport::InFlightPublish *SparkplugTransport::firstWaiting()
+{
+    for (size_t i = 0; i < inFlightCount; i++)
+    {
+        InFlightPublish *entry = &inFlight[(inFlightHead + i) % SPARKPLUG_INFLIGHT_SLOTS];
+        if (entry->state == INFLIGHT_WAITING)
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+size_t SparkplugTransport::sendWaiting()
+{
+    size_t written = 0;
+
+    while (inFlightSent < inFlightWindow && nodeBorn && hostOnline && client->connected())
+    {
+        InFlightPublish *entry = firstWaiting();
+        if (entry == NULL)
+        {
+            break;
+        }
+
+        size_t deviceLength;
+        const char *device = topicDevice(entry->topic.data(), entry->topic.size(), &deviceLength);
+        if (deviceLength > 0 && !isBorn(device, deviceLength))
+        {
+            if (time_service_monotonic_ms() - birthTime < SPARKPLUG_REPLAY_BIRTH_TIMEOUT_MS)
+            {
+                break;
+            }
+
+            // A device that isn't born again can't have data published for it
+            entry->state = INFLIGHT_DONE;
+            statistics.abandoned++;
+        }
+        else
+        {
+            written += send(entry);
+        }
+
+        retire();
+    }
+
+    return written;
+}
+
+size_t SparkplugTransport::send(InFlightPublish *entry)
+{
+    ProtobufBuffer payload(arena);
+    ProtobufWriter writer(&payload);
+
+    payload.reserve(entry->payload.size() + PROTOBUF_MAX_VARINT);
+    if (!entry->historical)
+    {
+        writer.raw(entry->payload.data(), entry->payload.size());
+    }
+    else
+    {
+        // The births of the new session carry the current values, these are kept as history
+        ProtobufReader reader(entry->payload.data(), entry->payload.size());
+        ProtobufBuffer metric(arena);
+        ProtobufWriter metricWriter(&metric);
+        ProtobufField field;
+
+        while (reader.next(&field))
+        {
+            if (field.number != PAYLOAD_METRICS)
+            {
+                writer.raw(field.start, field.size);
+                continue;
+            }
+
+            metric.clear();
+            metricWriter.raw(field.data, field.length);
+            metricWriter.varintField(METRIC_IS_HISTORICAL, 1);
+            writer.bytesField(PAYLOAD_METRICS, metric.data(), metric.size());
+        }
+        statistics.retransmitted++;
+    }
+
+    // A new session starts the packet IDs over, so the publish is new to the broker rather than a duplicate
+    entry->packetId = nextPacketId();
+    entry->state = INFLIGHT_SENT;
+    inFlightSent++;
+
+    return send(entry->header, entry->topic.data(), entry->topic.size(), entry->packetId, payload);
+}
+
+uint16_t SparkplugTransport::nextPacketId()
+{
+    uint16_t id = packetId;
+    packetId = packetId == UINT16_MAX ? SPARKPLUG_PACKET_ID_FIRST : packetId + 1;
+    return id;
+}
+
+void SparkplugTransport::subscribeState()
+{
+    subscribeId = nextPacketId();
+    buffer.clear();
+    mqttWriteSubscribe(&buffer, subscribeId, {stateTopic, legacyStateTopic}, 1);
+    transmit(buffer.data(), buffer.size());
+}
+
+void SparkplugTransport::hostState(MqttPublish *publish)
+{
+    bool online;
+    uint64_t timestamp;
+
+    if (!hostStatePayload(publish->payload, publish->payloadLength, &online, &timestamp))
+    {
+        return;
+    }
+
+    // A STATE older than the last one is from a session of the host that has already ended.
+    // The ONLINE and OFFLINE of earlier versions have no timestamp, so they only count until a 3.0 STATE is seen.
+    if (timestamp < hostTimestamp)
+    {
+        return;
+    }
+    hostTimestamp = timestamp;
+
+    if (online != hostOnline)
+    {
+        hostOnline = online;
+        online ? resume() : pause();
+    }
+}
+
+void SparkplugTransport::pause()
+{
+    for (auto &publish : pending)
+    {
+        release(&publish);
+    }
+
+    if (history)
+    {
+        history->setOnline(false);
+    }
+}
+
+void SparkplugTransport::resume()
+{
+    // The births bring the host up to date, so no sample is waiting on a data publish
+    for (auto &track : latencies)
+    {
+        track.captured = 0;
+    }
+
+    // Without a session the next births do it
+    if (!nodeBorn || !client->connected())
+    {
+        return;
+    }
+
+    if (!rebirth())
+    {
+        requestRebirth();
+    }
+}
+
+void SparkplugTransport::requestRebirth()
+{
+    ProtobufBuffer payload(arena);
+    ProtobufBuffer metric(arena);
+    ProtobufWriter writer(&payload);
+    ProtobufWriter metricWriter(&metric);
+    std::string topic = topicPrefix + "NCMD/" + nodeId;
+    uint64_t now;
+
+    if (!time_service_utc_ms(&now))
+    {
+        now = time_service_monotonic_ms();
+    }
+
+    metricWriter.bytesField(METRIC_NAME, NODE_CONTROL_REBIRTH, strlen(NODE_CONTROL_REBIRTH));
+    metricWriter.varintField(METRIC_DATATYPE, SPARKPLUG_BOOLEAN);
+    metricWriter.varintField(METRIC_BOOLEAN_VALUE, 1);
+    writer.varintField(PAYLOAD_TIMESTAMP, now);
+    writer.bytesField(PAYLOAD_METRICS, metric.data(), metric.size());
+
+    // Handed to the MQTT client as if the host had sent it, so the node encodes its births again
+    buffer.clear();
+    mqttWritePublishHeader(&buffer, MQTT_PUBLISH << 4, topic.data(), topic.size(), 0, payload.size());
+    buffer.insert(buffer.end(), payload.begin(), payload.end());
+    received.insert(received.end(), buffer.begin(), buffer.end());
+}
+
+void SparkplugTransport::retire()
+{
+    // Slots are only reused from the head, so a publish acknowledged out of order waits for those before it
+    while (inFlightCount > 0 && inFlight[inFlightHead].state == INFLIGHT_DONE)
+    {
+        inFlightHead = (inFlightHead + 1) % SPARKPLUG_INFLIGHT_SLOTS;
+        inFlightCount--;
+    }
+    admit();
+}
+
+void SparkplugTransport::admit()
+{
+    // The held back publishes take the freed slots in the order they were first made
+    size_t admitted = 0;
+    while (inFlightCount < SPARKPLUG_INFLIGHT_SLOTS && admitted < backlog.size())
+    {
+        InFlightPublish &entry = inFlight[(inFlightHead + inFlightCount) % SPARKPLUG_INFLIGHT_SLOTS];
+        entry = std::move(backlog[admitted++]);
+        inFlightCount++;
+    }
+    backlog.erase(backlog.begin(), backlog.begin() + admitted);
+}
+
+bool SparkplugTransport::acknowledge(std::vector<uint8_t> &packet)
+{
+    if (packet.size() < 4)
+    {
+        return false;
+    }
+
+    uint16_t id = (uint16_t)(packet[2] << 8 | packet[3]);
+    for (size_t i = 0; i < inFlightCount; i++)
+    {
+        InFlightPublish &entry = inFlight[(inFlightHead + i) % SPARKPLUG_INFLIGHT_SLOTS];
+        if (entry.state == INFLIGHT_SENT && entry.packetId == id)
+        {
+            entry.state = INFLIGHT_DONE;
+            inFlightSent--;
+            statistics.acknowledged++;
+            retire();
+            sendWaiting();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint64_t SparkplugTransport::nextDeadline()
+{
+    uint64_t deadline = UINT64_MAX;
+
+    // Data the MQTT client hasn't read yet is handled straight away
+    if (receivedPosition < received.size() || client->available() > 0)
+    {
+        return 0;
+    }
+
+    for (auto &publish : pending)
+    {
+        if (publish.active && publish.deadline < deadline)
+        {
+            deadline = publish.deadline;
+        }
+    }
+
+    if (history && history->isOnline() && !history->empty() && replayTime < deadline)
+    {
+        deadline = replayTime;
+    }
+
+    for (uint32_t key = 0; batch != NULL && key < batch->size(); key++)
+    {
+        uint64_t due = batch->due(key);
+        if (due < deadline && canPublishBatch(batch->getMetric(key)))
+        {
+            deadline = due;
+        }
+    }
+
+    InFlightPublish *waiting = firstWaiting();
+    if (waiting != NULL && inFlightSent < inFlightWindow && nodeBorn && hostOnline && client->connected())
+    {
+        size_t deviceLength;
+        const char *device = topicDevice(waiting->topic.data(), waiting->topic.size(), &deviceLength);
+        uint64_t ready = 0;
+
+        // Held until its device is born again, or given up on
+        if (deviceLength > 0 && !isBorn(device, deviceLength))
+        {
+            ready = (birthTime + SPARKPLUG_REPLAY_BIRTH_TIMEOUT_MS) * TIME_SERVICE_US_PER_MS;
+        }
+        deadline = ready < deadline ? ready : deadline;
+    }
+
+    return deadline;
+}
+
+void SparkplugTransport::flush()
+{
+    for (auto &publish : pending)
+    {
+        if (publish.active)
+        {
+            send(&publish);
+            release(&publish);
+        }
+    }
+}
+
+int SparkplugTransport::connect(const char *host, uint16_t port)
+{
+    outbound.reset();
+    clear();
+    return client->connect(host, port);
+}
+
+size_t SparkplugTransport::write(uint8_t data)
+{
+    return write(&data, 1);
+}
+
+size_t SparkplugTransport::write(const void *data, size_t length)
+{
+    const uint8_t *position = (const uint8_t *)data;
+    size_t remaining = length;
+
+    writeFailed = false;
+    while (remaining > 0)
+    {
+        size_t consumed = outbound.feed(position, remaining);
+        position += consumed;
+        remaining -= consumed;
+
+        if (outbound.complete())
+        {
+            // Only the start of a longer packet was kept, so it can't be passed on
+            if (outbound.getPacket().size() < outbound.getLength())
+            {
+                statistics.oversized++;
+            }
+            else
+            {
+                handleOutbound(outbound.getPacket());
+            }
+            outbound.reset();
+            arena->reset();
+
+            // A short count tells the MQTT client the connection didn't take the packet it just finished
+            if (writeFailed)
+            {
+                return length - remaining - consumed;
+            }
+        }
+    }
+
+    // Packets merged, paused or still being fed were all taken
+    return length;
+}
+
+size_t SparkplugTransport::transmit(const uint8_t *data, size_t length)
+{
+    size_t written = 0;
+
+    // What is left of earlier packets goes first so the stream stays in order
+    writeUnsent();
+    if (unsent.empty())
+    {
+        written = client->write(data, length);
+    }
+    if (written == length)
+    {
+        return length;
+    }
+
+    // Once its start is on the wire the rest has to follow, only a packet not yet started can be refused
+    if (written == 0 && (!client->connected() || unsent.size() + length > SPARKPLUG_UNSENT_SIZE))
+    {
+        statistics.failed++;
+        writeFailed = true;
+        return 0;
+    }
+
+    unsent.insert(unsent.end(), data + written, data + length);
+    statistics.held++;
+    return length;
+}
+
+void SparkplugTransport::writeUnsent()
+{
+    if (unsent.empty() || !client->connected())
+    {
+        return;
+    }
+
+    size_t written = client->write(unsent.data(), unsent.size());
+    unsent.erase(unsent.begin(), unsent.begin() + written);
+}
+
+void SparkplugTransport::receive()
+{
+    uint8_t chunk[SPARKPLUG_READ_CHUNK];
+
+    if (receivedPosition == received.size())
+    {
+        received.clear();
+        receivedPosition = 0;
+    }
+
+    // Packets are only passed on once they are whole, as some are answered here instead
+    while (client->available() > 0)
+    {
+        int count = client->read(chunk, sizeof(chunk));
+        const uint8_t *position = chunk;
+        size_t remaining = count > 0 ? count : 0;
+
+        if (remaining == 0)
+        {
+            break;
+        }
+
+        while (remaining > 0)
+        {
+            size_t consumed = inbound.feed(position, remaining);
+            position += consumed;
+            remaining -= consumed;
+
+            if (inbound.complete())
+            {
+                std::vector<uint8_t> &packet = inbound.getPacket();
+                if (packet.size() < inbound.getLength())
+                {
+                    statistics.oversized++;
+                }
+                else if (handleInbound(packet))
+                {
+                    received.insert(received.end(), packet.begin(), packet.end());
+                }
+                inbound.reset();
+                arena->reset();
+            }
+        }
+    }
+}
+
+int SparkplugTransport::available()
+{
+    receive();
+    return received.size() - receivedPosition;
+}
+
+int SparkplugTransport::read(void *data, size_t length)
+{
+    receive();
+
+    size_t count = received.size() - receivedPosition;
+    count = length < count ? length : count;
+
+    memcpy(data, received.data() + receivedPosition, count);
+    receivedPosition += count;
+    return count;
+}
+
+void SparkplugTransport::stop()
+{
+    outbound.reset();
+    clear();
+    client->stop();
+}
+
+uint8_t SparkplugTransport::connected()
+{
+    return client->connected();
+}
+
+void SparkplugTransport::sync()
+{
+    uint64_t now = time_service_monotonic_us();
+
+    // Acknowledgements since the last sync may have made room for what the TCP client didn't take
+    writeUnsent();
+
+    for (auto &publish : pending)
+    {
+        if (publish.active && now >= publish.deadline)
+        {
+            send(&publish);
+            release(&publish);
+        }
+    }
+
+    sendWaiting();
+
+    if (batch)
+    {
+        publishBatches(now);
+    }
+
+    if (history)
+    {
+        if (!client->connected())
+        {
+            history->setOnline(false);
+        }
+        else if (history->isOnline() && !history->empty() && now >= replayTime)
+        {
+            replay();
+            replayTime = now + (uint64_t)SPARKPLUG_REPLAY_INTERVAL_MS * TIME_SERVICE_US_PER_MS;
+        }
+    }
+
+    arena->reset();
+    client->sync();
+}
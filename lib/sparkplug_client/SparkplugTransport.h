@@ -0,0 +1,461 @@
+/*
+ * File: SparkplugTransport.h
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef SPARKPLUG_TRANSPORT
+#define SPARKPLUG_TRANSPORT
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "Client.h"
+#include "MqttPacket.h"
+#include "StoreAndForward.h"
+#include "SampleBatch.h"
+#include "BirthCache.h"
+#include "AliasTable.h"
+#include "Deflate.h"
+#include "LatencyHistogram.h"
+#include "Arena.h"
+#include "Protobuf.h"
+
+// Inbound bytes are read from the TCP client in chunks of this size
+#define SPARKPLUG_READ_CHUNK 128
+// Largest packet passed on in either direction, longer ones are skipped as the broker or MQTT client would refuse them
+#define SPARKPLUG_MAX_PACKET_SIZE 8192
+// Bytes the TCP client hasn't taken yet that are held for it, further packets are refused past this
+#define SPARKPLUG_UNSENT_SIZE (2 * SPARKPLUG_MAX_PACKET_SIZE)
+
+// Stored samples are replayed in batches so they don't starve live data
+#define SPARKPLUG_REPLAY_BATCH 16
+#define SPARKPLUG_REPLAY_INTERVAL_MS 200
+// Samples of a device that hasn't been born this long after the node are dropped
+#define SPARKPLUG_REPLAY_BIRTH_TIMEOUT_MS 10000
+
+// Publishes sent at QoS 1 are kept in a table of this many until the broker acknowledges them
+#define SPARKPLUG_INFLIGHT_SLOTS 8
+// How many of them can be waiting for an acknowledgement at once by default
+#define SPARKPLUG_INFLIGHT_WINDOW 4
+// Packet IDs of the transport's own QoS 1 publishes, clear of the MQTT client's from 1 upwards
+#define SPARKPLUG_PACKET_ID_FIRST 0xF000
+
+typedef enum
+{
+    SPARKPLUG_OTHER,
+    SPARKPLUG_NBIRTH,
+    SPARKPLUG_NDEATH,
+    SPARKPLUG_DBIRTH,
+    SPARKPLUG_DDEATH,
+    SPARKPLUG_NDATA,
+    SPARKPLUG_DDATA,
+    SPARKPLUG_NCMD,
+    SPARKPLUG_DCMD
+} SparkplugMessageType;
+
+/**
+ * @brief Counts of the data publishes handled by the transport
+ */
+typedef struct
+{
+    // NDATA and DDATA publishes written by the MQTT client
+    uint32_t publishes;
+    // Publishes that were merged into another publish instead of being sent
+    uint32_t coalesced;
+    // Publishes sent compressed, and the bytes compression saved
+    uint32_t compressed;
+    uint32_t compressionSaved;
+    // Publishes carrying a metric delivered at least once, and the acknowledgements for them
+    uint32_t atLeastOnce;
+    uint32_t acknowledged;
+    // Publishes sent again as historical after the session they were sent in ended
+    uint32_t retransmitted;
+    // Publishes held back, or merged into one held back for the same topic, as the in-flight table was full
+    uint32_t queued;
+    // Publishes dropped as their device wasn't born again in the next session
+    uint32_t abandoned;
+    // Data publishes dropped while the primary host was offline
+    uint32_t paused;
+    // Publishes made from batches of samples
+    uint32_t batches;
+    // Packets the connection didn't take whole, and were held to be written once it had room
+    uint32_t held;
+    // Packets refused as the connection was down or too much was already held
+    uint32_t failed;
+    // Packets in either direction skipped as they were longer than SPARKPLUG_MAX_PACKET_SIZE
+    uint32_t oversized;
+} SparkplugTransportStatistics;
+
+/**
+ * @brief A Client that sits between the MQTT client and the TCP client and understands Sparkplug.
+ * Metric changes published as NDATA or DDATA within a window are merged into a single
+ * publish per topic, and the payload sequence numbers are rewritten so the primary host
+ * never sees a gap. Births are cached so a rebirth command is answered without the MQTT
+ * client encoding them again. Metrics are given aliases in their births, and data is published
+ * with the alias in place of the name. The time from a sample being captured to the data publish
+ * carrying it being written can be recorded per device. Data carrying chosen metrics is sent at QoS 1
+ * and kept until the broker acknowledges it. Live data is paused while the primary host is offline.
+ */
+class SparkplugTransport : public Client
+{
+private:
+    typedef struct
+    {
+        // Where the metric's name or alias, and its encoded Metric message, are in the publish's buffers
+        size_t keyOffset;
+        size_t keyLength;
+        size_t offset;
+        size_t length;
+    } PendingMetric;
+
+    typedef struct
+    {
+        bool active;
+        std::string topic;
+        uint8_t header;
+        uint64_t timestamp;
+        uint64_t deadline;
+        // Buffers are kept between windows, so a steady stream of changes doesn't touch the heap
+        std::vector<uint8_t> keys;
+        std::vector<uint8_t> data;
+        std::vector<PendingMetric> metrics;
+    } PendingPublish;
+
+    typedef struct
+    {
+        std::string device;
+        // Capture time of the oldest sample that hasn't been published, or 0 if there is none
+        uint64_t captured;
+        LatencyHistogram histogram;
+    } LatencyTrack;
+
+    Client *client;
+    // Scratch space for the message being handled, reset once it has been handled
+    Arena *arena;
+    MqttPacketStream outbound;
+    MqttPacketStream inbound;
+    std::vector<PendingPublish> pending;
+    std::vector<uint8_t> buffer;
+
+    // Whole inbound packets waiting to be read by the MQTT client
+    std::vector<uint8_t> received;
+    size_t receivedPosition = 0;
+
+    uint32_t window = 0;
+    uint64_t immediateUntil = 0;
+    uint8_t sequence = 0;
+    // Set when a packet handed on by the current write was refused
+    bool writeFailed = false;
+    // The rest of packets the TCP client took in part or not at all, written before anything else
+    std::vector<uint8_t> unsent;
+    SparkplugTransportStatistics statistics = {};
+
+    // Topics of the current session, learned from the births
+    std::string topicPrefix;
+    std::string nodeId;
+    std::vector<std::string> bornDevices;
+    uint64_t birthTime = 0;
+
+    StoreAndForward *history = NULL;
+    uint64_t replayTime = 0;
+
+    SampleBatch *batch = NULL;
+    // The topic each batched metric is published on, made when the node is born
+    std::vector<std::string> batchTopics;
+
+    BirthCache births;
+    bool cacheBirths = true;
+
+    // Kept across sessions so the aliases in every birth are the same
+    AliasTable aliases;
+    bool useAliases = true;
+
+    std::unique_ptr<Deflate> deflate;
+    size_t compressionThreshold = 0;
+    // Kept between publishes so compressing doesn't touch the heap once it has grown
+    std::vector<uint8_t> compressed;
+
+    std::vector<LatencyTrack> latencies;
+
+    typedef struct
+    {
+        std::string device;
+        std::string name;
+    } AtLeastOnceMetric;
+
+    typedef enum
+    {
+        INFLIGHT_WAITING,
+        INFLIGHT_SENT,
+        INFLIGHT_DONE
+    } InFlightState;
+
+    typedef struct
+    {
+        InFlightState state;
+        // Left over from an earlier session, so its values are no longer current
+        bool historical;
+        uint8_t header;
+        uint16_t packetId;
+        std::string topic;
+        // The payload without its sequence number, which is given each time it is sent
+        std::vector<uint8_t> payload;
+    } InFlightPublish;
+
+    std::vector<AtLeastOnceMetric> atLeastOnce;
+    // A ring in the order the publishes were made, which is the order they are sent in
+    InFlightPublish inFlight[SPARKPLUG_INFLIGHT_SLOTS];
+    size_t inFlightHead = 0;
+    size_t inFlightCount = 0;
+    size_t inFlightSent = 0;
+    size_t inFlightWindow = SPARKPLUG_INFLIGHT_WINDOW;
+    // Publishes made while every slot was in use, at most one per topic and age
+    std::vector<InFlightPublish> backlog;
+    uint16_t packetId = SPARKPLUG_PACKET_ID_FIRST;
+    bool nodeBorn = false;
+
+    // The primary host's STATE topics of Sparkplug 3.0 and of earlier versions, empty when the host isn't followed
+    std::string stateTopic;
+    std::string legacyStateTopic;
+    bool hostOnline = true;
+    uint64_t hostTimestamp = 0;
+    uint16_t subscribeId = 0;
+    // Whether the MQTT client subscribed to each STATE itself, and so expects to be given it
+    bool clientFollowsState = false;
+    bool clientFollowsLegacyState = false;
+
+    void handleOutbound(std::vector<uint8_t> &packet);
+    bool handleInbound(std::vector<uint8_t> &packet);
+    void receive();
+    bool coalesce(MqttPublish *publish);
+    size_t forward(MqttPublish *publish, SparkplugMessageType type, bool acknowledged);
+    size_t send(PendingPublish *publish);
+    size_t send(uint8_t header, const char *topic, size_t topicLength, uint16_t packetId, ProtobufBuffer &payload);
+    size_t transmit(const uint8_t *data, size_t length);
+    void writeUnsent();
+    bool compress(ProtobufBuffer &payload, ProtobufBuffer *wrapper);
+    void release(PendingPublish *publish);
+    bool rewriting();
+    void birth(MqttPublish *publish, SparkplugMessageType type);
+    void death(MqttPublish *publish);
+    bool isBorn(const char *device, size_t length);
+    void replay();
+    void declareBatches(MqttPublish *publish, ProtobufBuffer *declared);
+    bool canPublishBatch(BatchedMetric *metric);
+    void publishBatches(uint64_t now);
+    void nameBatches();
+    size_t publishBatch(uint32_t key);
+    void unalias(std::vector<uint8_t> &packet, MqttPublish *publish);
+    bool rebirth();
+    size_t send(const CachedBirth *birth);
+    void clear();
+    void published(const char *topic, size_t topicLength);
+    bool needsAcknowledgement(MqttPublish *publish);
+    size_t deliver(MqttPublish *publish, ProtobufBuffer &payload);
+    size_t sendWaiting();
+    size_t send(InFlightPublish *entry);
+    bool acknowledge(std::vector<uint8_t> &packet);
+    void retire();
+    void admit();
+    InFlightPublish *firstWaiting();
+    uint16_t nextPacketId();
+    void subscribeState();
+    void hostState(MqttPublish *publish);
+    void pause();
+    void resume();
+    void requestRebirth();
+
+public:
+    /**
+     * @brief Construct a new Sparkplug Transport
+     *
+     * @param client The client that carries the MQTT connection
+     * @param arena Scratch space for encoding, reset after every publish and command
+     */
+    SparkplugTransport(Client *client, Arena *arena);
+
+    /**
+     * @brief Sets the window that metric changes are collected over before being published.
+     * Changes are published immediately for a window after an NCMD or DCMD is received,
+     * so metrics driven by commands are not delayed.
+     *
+     * @param window The window in milliseconds, or 0 to publish every change as it is made
+     */
+    void setWindow(uint32_t window);
+
+    /**
+     * @brief Replays the samples in the store as historical metrics once the node has been born.
+     * The store is marked online and offline as the session comes and goes.
+     *
+     * @param history
+     */
+    void setStoreAndForward(StoreAndForward *history);
+
+    /**
+     * @brief Publishes the batched metrics as DataSets, one row per sample.
+     * Each metric is added to its birth as an empty DataSet, and a batch is published
+     * once it is full or its oldest sample reaches the maximum age.
+     *
+     * @param batch
+     */
+    void setSampleBatch(SampleBatch *batch);
+
+    /**
+     * @brief Sets whether births are cached and used to answer rebirth commands
+     *
+     * @param enabled Defaults to true
+     */
+    void setBirthCache(bool enabled);
+
+    /**
+     * @brief Sets whether metrics are given aliases in their births and published by alias alone.
+     * Only outbound births and data use the aliases. Commands that only give an alias have the name
+     * added back before the MQTT client, which dispatches them by name, sees them.
+     * Turn this off if the application sets its own aliases, as they would clash.
+     *
+     * @param enabled Defaults to true
+     */
+    void setAliases(bool enabled);
+
+    /**
+     * @brief Compresses payloads larger than the threshold with DEFLATE, sending them as a
+     * Sparkplug compressed payload. Payloads that don't shrink are sent as they are.
+     *
+     * @param threshold Size of the encoded payload in bytes, or 0 to never compress
+     */
+    void setCompression(size_t threshold);
+
+    /**
+     * @brief Sends the data publishes that carry a metric at QoS 1, and keeps them until the broker
+     * acknowledges them. Those still waiting when the session ends are sent again with their metrics
+     * marked historical, once the node and device have been born in the next session. The metric is
+     * matched by name in the data published by the MQTT client.
+     *
+     * @param device The name of the device, or NULL for a metric of the node
+     * @param name The name of the metric
+     */
+    void deliverAtLeastOnce(const char *device, const char *name);
+
+    /**
+     * @brief Sets how many QoS 1 publishes can wait for an acknowledgement at once.
+     * Further publishes wait in the table until an acknowledgement makes room. Once all
+     * SPARKPLUG_INFLIGHT_SLOTS are in use they are held back, merged by topic, until a slot is freed.
+     *
+     * @param window From 1 to SPARKPLUG_INFLIGHT_SLOTS, defaults to SPARKPLUG_INFLIGHT_WINDOW
+     */
+    void setInFlightWindow(size_t window);
+
+    /**
+     * @brief Follows the STATE of the primary host, and pauses live data while it is offline.
+     * Samples go to the store and forward buffer while paused, if there is one. When the host comes
+     * back the node is born again from the cached births, or the MQTT client is asked to rebirth,
+     * and the stored samples are replayed.
+     * Both the spBv1.0/STATE topic of Sparkplug 3.0 and the STATE topic of earlier versions are
+     * followed. A host that publishes both is followed by its timestamped 3.0 STATE.
+     *
+     * @param hostId The primary host's ID
+     */
+    void followPrimaryHost(const char *hostId);
+
+    /**
+     * @brief Whether the primary host was online in its last STATE.
+     * Taken to be online until a STATE says otherwise, or when no host is followed.
+     *
+     * @return true if data is being published
+     */
+    bool isPrimaryHostOnline();
+
+    /**
+     * @brief Measures the latency from samples being captured to the data publish that carries them
+     * being written to the TCP client. That is when the publish enters the TCP client's send buffer,
+     * which can be before lwIP takes it if earlier publishes are still waiting to go.
+     *
+     * @param device The name of the device, or NULL for the metrics of the node
+     * @return size_t The key to give captured and getLatency
+     */
+    size_t trackLatency(const char *device);
+
+    /**
+     * @brief Marks a sample of the device as captured. The latency is recorded when the next NDATA or
+     * DDATA of the device is written, from the oldest sample captured since the last one.
+     *
+     * @param key From trackLatency
+     * @param timestamp Monotonic time the sample was captured in microseconds
+     */
+    void captured(size_t key, uint64_t timestamp);
+
+    /**
+     * @brief Get the latencies recorded for a device
+     *
+     * @param key From trackLatency
+     * @return LatencyHistogram*
+     */
+    LatencyHistogram *getLatency(size_t key);
+
+    /**
+     * @brief Publishes everything that is waiting for its window to close
+     */
+    void flush();
+
+    /**
+     * @brief Get the next time the transport has work to do, such as a window closing or a batch of samples to replay
+     *
+     * @return uint64_t Monotonic time in microseconds, or UINT64_MAX if nothing is waiting
+     */
+    uint64_t nextDeadline();
+
+    SparkplugTransportStatistics getStatistics();
+    BirthCacheStatistics getBirthCacheStatistics();
+
+    virtual int connect(const char *host, uint16_t port) override;
+    virtual size_t write(uint8_t) override;
+    virtual size_t write(const void *buffer, size_t length) override;
+    virtual int available() override;
+    virtual int read(void *buffer, size_t length) override;
+    virtual void stop() override;
+    virtual uint8_t connected() override;
+
+    /**
+     * @brief Publishes any windows that have closed, replays stored samples and syncs the underlying client
+     */
+    virtual void sync() override;
+};
+
+/**
+ * @brief Get the Sparkplug message type of a topic
+ *
+ * @param topic
+ * @param length
+ * @return SparkplugMessageType
+ */
+SparkplugMessageType sparkplugMessageType(const char *topic, size_t length);
+
+#endif /* SPARKPLUG_TRANSPORT */
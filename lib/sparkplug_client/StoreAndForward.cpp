@@ -0,0 +1,219 @@
+/*
+ * File: StoreAndForward.cpp
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#include "StoreAndForward.h"
+#include "Fnv.h"
+#include <time_service.h>
+#include "pico/stdlib.h"
+
+StoreAndForward::StoreAndForward(size_t capacity) : capacity(capacity), boot(get_rand_32())
+{
+    samples = new StoredSample[capacity];
+}
+
+StoreAndForward::~StoreAndForward()
+{
+    delete[] samples;
+}
+
+uint32_t StoreAndForward::add(const char *device, const char *name, uint8_t datatype)
+{
+    uint32_t key = fnvHash(fnvHash(fnvHash(FNV_OFFSET, device), "/"), name);
+
+    if (getMetric(key) == NULL)
+    {
+        metrics.push_back({.key = key,
+                           .datatype = datatype,
+                           .device = device ? device : "",
+                           .name = name});
+    }
+
+    return key;
+}
+
+StoredMetric *StoreAndForward::getMetric(uint32_t key)
+{
+    for (auto &metric : metrics)
+    {
+        if (metric.key == key)
+        {
+            return &metric;
+        }
+    }
+    return NULL;
+}
+
+void StoreAndForward::store(uint32_t key, uint64_t value)
+{
+    if (online)
+    {
+        return;
+    }
+
+    StoredSample sample = {.timestamp = time_service_monotonic_ms(), .value = value, .key = key, .boot = boot, .utc = false};
+    uint64_t utc;
+
+    if (time_service_utc_ms(&utc))
+    {
+        sample.timestamp = utc;
+        sample.utc = true;
+    }
+
+    statistics.stored++;
+
+    if (log)
+    {
+        log->append(&sample, sizeof(sample));
+        return;
+    }
+
+    if (capacity == 0)
+    {
+        statistics.dropped++;
+        return;
+    }
+
+    if (count == capacity)
+    {
+        head = (head + 1) % capacity;
+        count--;
+        statistics.dropped++;
+    }
+
+    samples[(head + count) % capacity] = sample;
+    count++;
+}
+
+bool StoreAndForward::peek(StoredSample *sample)
+{
+    if (log)
+    {
+        uint8_t record[FLASH_LOG_MAX_RECORD];
+        size_t length;
+
+        while (log->peek(record, &length))
+        {
+            if (length == sizeof(StoredSample))
+            {
+                memcpy(sample, record, sizeof(StoredSample));
+
+                if (sample->utc || sample->boot == boot)
+                {
+                    return true;
+                }
+                statistics.stale++;
+            }
+            log->pop();
+        }
+        return false;
+    }
+
+    if (count == 0)
+    {
+        return false;
+    }
+
+    *sample = samples[head];
+    return true;
+}
+
+bool StoreAndForward::remove()
+{
+    if (log)
+    {
+        if (log->empty())
+        {
+            return false;
+        }
+        log->pop();
+        return true;
+    }
+
+    if (count == 0)
+    {
+        return false;
+    }
+
+    head = (head + 1) % capacity;
+    count--;
+    return true;
+}
+
+void StoreAndForward::pop()
+{
+    if (remove())
+    {
+        statistics.replayed++;
+    }
+}
+
+void StoreAndForward::drop()
+{
+    if (remove())
+    {
+        statistics.discarded++;
+    }
+}
+
+size_t StoreAndForward::size()
+{
+    return log ? log->size() : count;
+}
+
+bool StoreAndForward::empty()
+{
+    return log ? log->empty() : count == 0;
+}
+
+void StoreAndForward::setFlashLog(FlashLog *log)
+{
+    this->log = log;
+}
+
+void StoreAndForward::setOnline(bool online)
+{
+    // The samples still being buffered need to be written before they can be replayed
+    if (online && !this->online && log)
+    {
+        log->flush();
+    }
+    this->online = online;
+}
+
+bool StoreAndForward::isOnline()
+{
+    return online;
+}
+
+StoreAndForwardStatistics StoreAndForward::getStatistics()
+{
+    return statistics;
+}
@@ -0,0 +1,248 @@
+/*
+ * File: StoreAndForward.h
+ * Project: pico_sparkplug_client
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef STOREANDFORWARD
+#define STOREANDFORWARD
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+#include <FlashLog.h>
+
+// Sparkplug B datatypes of the values that can be stored
+#define SPARKPLUG_INT8 1
+#define SPARKPLUG_INT16 2
+#define SPARKPLUG_INT32 3
+#define SPARKPLUG_INT64 4
+#define SPARKPLUG_UINT8 5
+#define SPARKPLUG_UINT16 6
+#define SPARKPLUG_UINT32 7
+#define SPARKPLUG_UINT64 8
+#define SPARKPLUG_FLOAT 9
+#define SPARKPLUG_DOUBLE 10
+#define SPARKPLUG_BOOLEAN 11
+
+#define STORE_AND_FORWARD_CAPACITY 1024
+
+/**
+ * @brief A metric value captured while the node was offline
+ */
+typedef struct __attribute__((packed))
+{
+    // Milliseconds the sample was taken, UTC if it was known and otherwise monotonic
+    uint64_t timestamp;
+    // The raw bits of the value, signed values are sign extended
+    uint64_t value;
+    // Hash of the device and metric name, which stays the same across reboots
+    uint32_t key;
+    // Picked at random each boot, so monotonic times from before a reboot can be told apart
+    uint32_t boot;
+    bool utc;
+} StoredSample;
+
+/**
+ * @brief A metric that samples are stored for
+ */
+typedef struct
+{
+    uint32_t key;
+    uint8_t datatype;
+    // Empty for metrics of the node
+    std::string device;
+    std::string name;
+} StoredMetric;
+
+typedef struct
+{
+    uint32_t stored;
+    uint32_t replayed;
+    // Oldest samples overwritten because the ring was full
+    uint32_t dropped;
+    // Samples in flash without UTC from before a reboot, whose time can't be known
+    uint32_t stale;
+    // Samples removed without being replayed, such as those of a device that wasn't born again
+    uint32_t discarded;
+} StoreAndForwardStatistics;
+
+/**
+ * @brief Get the Sparkplug datatype of a value type
+ *
+ * @tparam T
+ * @return uint8_t
+ */
+template <typename T>
+constexpr uint8_t sparkplugDatatype()
+{
+    if constexpr (std::is_same_v<T, bool>)
+        return SPARKPLUG_BOOLEAN;
+    else if constexpr (std::is_same_v<T, float>)
+        return SPARKPLUG_FLOAT;
+    else if constexpr (std::is_same_v<T, double>)
+        return SPARKPLUG_DOUBLE;
+    else if constexpr (std::is_signed_v<T>)
+        return sizeof(T) == 1 ? SPARKPLUG_INT8 : sizeof(T) == 2 ? SPARKPLUG_INT16
+                                             : sizeof(T) == 4   ? SPARKPLUG_INT32
+                                                                : SPARKPLUG_INT64;
+    else
+        return sizeof(T) == 1 ? SPARKPLUG_UINT8 : sizeof(T) == 2 ? SPARKPLUG_UINT16
+                                              : sizeof(T) == 4   ? SPARKPLUG_UINT32
+                                                                 : SPARKPLUG_UINT64;
+}
+
+/**
+ * @brief A bounded ring of metric samples taken while the node is offline.
+ * The samples are replayed as historical metrics once the node has been born again.
+ * When the ring is full the oldest samples are overwritten.
+ * The ring can be replaced by a FlashLog for samples that need to survive a reboot.
+ */
+class StoreAndForward
+{
+private:
+    StoredSample *samples;
+    FlashLog *log = NULL;
+    size_t capacity;
+    size_t head = 0;
+    size_t count = 0;
+    uint32_t boot;
+    bool online = false;
+    std::vector<StoredMetric> metrics;
+    StoreAndForwardStatistics statistics = {};
+
+    bool remove();
+
+public:
+    StoreAndForward(size_t capacity);
+    ~StoreAndForward();
+
+    /**
+     * @brief Adds a metric that samples will be stored for
+     *
+     * @param device The name of the device, or NULL for a metric of the node
+     * @param name The name of the metric
+     * @param datatype The Sparkplug datatype of the metric
+     * @return uint32_t The key of the metric
+     */
+    uint32_t add(const char *device, const char *name, uint8_t datatype);
+
+    /**
+     * @brief Get a metric that was added
+     *
+     * @param key
+     * @return StoredMetric* The metric, or NULL if the key is unknown
+     */
+    StoredMetric *getMetric(uint32_t key);
+
+    /**
+     * @brief Stores a sample if the node is offline
+     *
+     * @param key The key of the metric
+     * @param value The raw bits of the value
+     */
+    void store(uint32_t key, uint64_t value);
+
+    template <typename T>
+    void store(uint32_t key, T value)
+    {
+        uint64_t bits = 0;
+
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            memcpy(&bits, &value, sizeof(T));
+        }
+        else if constexpr (std::is_signed_v<T>)
+        {
+            bits = (uint64_t)(int64_t)value;
+        }
+        else
+        {
+            bits = (uint64_t)value;
+        }
+
+        store(key, bits);
+    }
+
+    /**
+     * @brief Get the oldest sample without removing it
+     *
+     * @param sample
+     * @return true if there was a sample
+     */
+    bool peek(StoredSample *sample);
+
+    /**
+     * @brief Removes the oldest sample once it has been replayed
+     */
+    void pop();
+
+    /**
+     * @brief Removes the oldest sample without replaying it
+     */
+    void drop();
+
+    /**
+     * @brief Get the number of samples waiting to be replayed, in RAM or in the log
+     *
+     * @return size_t
+     */
+    size_t size();
+
+    /**
+     * @brief Whether there are samples waiting to be replayed
+     *
+     * @return true if there are none
+     */
+    bool empty();
+
+    /**
+     * @brief Keeps the samples in a log in flash instead of RAM so they survive a loss of power.
+     * Samples are written a page at a time, and the buffered page is written when the node comes online.
+     * Samples taken before the time was known can't be replayed after a reboot, and are dropped when peeked.
+     *
+     * @param log A log that has already been started with begin
+     */
+    void setFlashLog(FlashLog *log);
+
+    /**
+     * @brief Sets whether samples are being published live.
+     * Samples are only stored while offline.
+     *
+     * @param online
+     */
+    void setOnline(bool online);
+    bool isOnline();
+
+    StoreAndForwardStatistics getStatistics();
+};
+
+#endif /* STOREANDFORWARD */
@@ -52,30 +52,6 @@
 
 #define POLL_TIME_S 5
 
-static DataBuffer *initializeDataBuffer(const void *buffer, size_t length)
-{
-    DataBuffer *dataBuffer;
-    dataBuffer = (DataBuffer *)malloc(sizeof(DataBuffer));
-
-    const uint8_t *data = (const uint8_t *)malloc(length);
-
-    dataBuffer->data = dataBuffer->position = data;
-    dataBuffer->length = length;
-    dataBuffer->next = NULL;
-
-    if (buffer != NULL)
-    {
-        memcpy((void *)dataBuffer->data, buffer, length);
-    }
-
-    return dataBuffer;
-}
-
-static DataBuffer *initializeDataBuffer(size_t length)
-{
-    return initializeDataBuffer(NULL, length);
-}
-
 // Declare all private member functions of SomeClass here
 struct PicoTcpClient::Private
 {
@@ -110,41 +86,46 @@ struct PicoTcpClient::Private
     }
 };
 
-err_t PicoTcpClient::writeDataBuffer(DataBuffer *buffer)
+err_t PicoTcpClient::writeQueued()
 {
-    DataBuffer *queue;
-    int availableLength;
-    err_t tcpCode = 0;
-
-    availableLength = tcp_sndbuf(tcpControlBlock);
-
-    queue = buffer;
+    err_t tcpCode = ERR_OK;
+    bool written = false;
 
-    while (availableLength > 0 && queue != NULL)
+    // tcp_write copies the data, so it leaves the ring as soon as lwIP has taken it
+    while (writeCount > 0)
     {
-        if (availableLength >= queue->length)
+        size_t length = PICO_TCP_CLIENT_BUFFER_SIZE - writeHead;
+        size_t space = tcp_sndbuf(tcpControlBlock);
+
+        length = writeCount < length ? writeCount : length;
+        length = space < length ? space : length;
+        if (length == 0)
         {
-            availableLength -= queue->length;
-            tcpCode = tcp_write(tcpControlBlock, queue->position, queue->length, TCP_WRITE_FLAG_COPY);
-            queue = queue->next;
+            break;
         }
-        else
+
+        tcpCode = tcp_write(tcpControlBlock, &writeBuffer[writeHead], length, TCP_WRITE_FLAG_COPY);
+        if (tcpCode != ERR_OK)
         {
-            queue->length -= availableLength;
-            tcpCode = tcp_write(tcpControlBlock, queue->position, availableLength, TCP_WRITE_FLAG_COPY);
-            queue->position += availableLength;
-            availableLength = 0;
+            break;
         }
+
+        writeHead = (writeHead + length) % PICO_TCP_CLIENT_BUFFER_SIZE;
+        writeCount -= length;
+        written = true;
+    }
+
+    if (written)
+    {
+        tcp_output(tcpControlBlock);
     }
 
     switch (tcpCode)
     {
     case ERR_OK:
-        /* code */
-        tcp_output(tcpControlBlock);
         break;
     case ERR_MEM:
-        /* code */
+        // lwIP is out of buffers, what's left is written once data has been acknowledged
         break;
     case ERR_CONN:
         // TODO: Handle Not Connected
@@ -164,34 +145,7 @@ err_t PicoTcpClient::writeDataBuffer(DataBuffer *buffer)
 
 int PicoTcpClient::sent(uint16_t length)
 {
-    DataBuffer *temp;
-    uint16_t remaining = length;
-
-    while (remaining > 0 && writeQueue != NULL)
-    {
-        if (remaining >= writeQueue->length)
-        {
-            remaining -= writeQueue->length;
-
-            temp = writeQueue;
-            writeQueue = writeQueue->next;
-
-            free((void *)temp->data);
-            free(temp);
-        }
-        else
-        {
-            writeQueue->length -= remaining;
-            remaining = 0;
-        }
-    }
-
-    if (writeQueue != NULL)
-    {
-        writeDataBuffer(writeQueue);
-    }
-
-    return ERR_OK;
+    return writeQueued() == ERR_ABRT ? ERR_ABRT : ERR_OK;
 }
 
 err_t PicoTcpClient::received(void *data, err_t errorCode)
@@ -208,35 +162,17 @@ err_t PicoTcpClient::received(void *data, err_t errorCode)
     cyw43_arch_lwip_check();
     if (payloadBuffer->tot_len > 0)
     {
-
-        DataBuffer *received;
-
-        received = initializeDataBuffer(payloadBuffer->tot_len);
-
-        if (received == NULL)
-        {
-            return ERR_MEM;
-        }
-
-        pbuf_copy_partial(payloadBuffer, (void *)received->data, payloadBuffer->tot_len, 0);
-        tcp_recved(tcpControlBlock, payloadBuffer->tot_len);
-
+        // The pbufs are kept until they are read, and the window is opened again as they are
         availableData += payloadBuffer->tot_len;
         if (receiveQueue == NULL)
         {
-            receiveQueue = received;
+            receiveQueue = payloadBuffer;
         }
         else
         {
-            DataBuffer *tail = receiveQueue, *next = tail->next;
-            while (next != NULL)
-            {
-                tail = next;
-                next = tail->next;
-            }
-
-            tail->next = received;
+            pbuf_cat(receiveQueue, payloadBuffer);
         }
+        return ERR_OK;
     }
 
     pbuf_free(payloadBuffer);
@@ -255,7 +191,7 @@ err_t PicoTcpClient::onConnected(int errorCode)
     isConnected = true;
     isConnecting = false;
     waitingReply = false;
-    return ERR_OK;
+    return writeQueued() == ERR_ABRT ? ERR_ABRT : ERR_OK;
 }
 
 void PicoTcpClient::onError(err_t errorCode)
@@ -274,14 +210,16 @@ void PicoTcpClient::onError(err_t errorCode)
     default:
         break;
     }
-    close();
+    // lwIP has already freed the pcb when it reports an error, closing it again would free it twice
+    tcpControlBlock = NULL;
+    clearQueues();
     waitingReply = false;
     isConnected = false;
 }
 
 err_t PicoTcpClient::poll()
 {
-    return ERR_OK;
+    return writeQueued() == ERR_ABRT ? ERR_ABRT : ERR_OK;
 }
 
 PicoTcpClient::PicoTcpClient()
@@ -372,29 +310,40 @@ size_t PicoTcpClient::write(uint8_t data)
 
 size_t PicoTcpClient::write(const void *buffer, size_t length)
 {
-    int returnCode = 0;
+    const uint8_t *data = (const uint8_t *)buffer;
+    size_t written = 0;
 
-    err_t tcpCode;
-
-    if (writeQueue == NULL)
+    // Makes what room lwIP's send buffer has, without waiting for acknowledgements to make more
+    if (tcpControlBlock != NULL && isConnected)
     {
-        writeQueue = initializeDataBuffer(buffer, length);
+        writeQueued();
+    }
 
-        tcpCode = writeDataBuffer(writeQueue);
+    while (written < length && writeCount < PICO_TCP_CLIENT_BUFFER_SIZE)
+    {
+        size_t space = PICO_TCP_CLIENT_BUFFER_SIZE - writeCount;
+        size_t tail = (writeHead + writeCount) % PICO_TCP_CLIENT_BUFFER_SIZE;
+        size_t chunk = length - written;
+        chunk = space < chunk ? space : chunk;
+        chunk = PICO_TCP_CLIENT_BUFFER_SIZE - tail < chunk ? PICO_TCP_CLIENT_BUFFER_SIZE - tail : chunk;
+
+        memcpy(&writeBuffer[tail], data + written, chunk);
+        writeCount += chunk;
+        written += chunk;
     }
-    else
+
+    if (tcpControlBlock != NULL && isConnected)
     {
-        DataBuffer *tail = writeQueue, *next = tail->next;
-        while (next != NULL)
-        {
-            tail = next;
-            next = tail->next;
-        }
+        writeQueued();
+    }
 
-        tail->next = initializeDataBuffer(buffer, length);
+    // The caller keeps what didn't fit and writes it again once acknowledgements have made room
+    if (written < length)
+    {
+        DEBUG("Write buffer full, %d of %d bytes taken\n", (int)written, (int)length);
     }
 
-    return 0;
+    return written;
 }
 
 int PicoTcpClient::available()
@@ -404,46 +353,23 @@ int PicoTcpClient::available()
 
 int PicoTcpClient::read(void *buffer, size_t length)
 {
-    size_t remaining, dataRead;
-    DataBuffer *queue, *temp;
-    err_t tcpCode;
-
-    uint8_t *position = (uint8_t *)buffer;
-
-    queue = receiveQueue;
-
-    dataRead = remaining = length < availableData ? length : availableData;
+    // The window is opened again by at most a u16_t at a time
+    size_t dataRead = length < (size_t)availableData ? length : availableData;
+    dataRead = dataRead < 0xFFFF ? dataRead : 0xFFFF;
 
-    while (remaining > 0 && queue != NULL)
+    if (dataRead == 0)
     {
-        if (remaining >= queue->length)
-        {
-            remaining -= queue->length;
-
-            memcpy(position, queue->position, queue->length);
-            position += queue->length;
-
-            temp = queue;
-
-            queue = queue->next;
-
-            free((void *)temp->data);
-            free(temp);
-        }
-        else
-        {
-            queue->length -= remaining;
-
-            memcpy(position, queue->position, remaining);
-
-            queue->position += remaining;
-            remaining = 0;
-        }
+        return 0;
     }
 
+    pbuf_copy_partial(receiveQueue, buffer, dataRead, 0);
+    receiveQueue = pbuf_free_header(receiveQueue, dataRead);
     availableData -= dataRead;
 
-    receiveQueue = queue;
+    if (tcpControlBlock != NULL)
+    {
+        tcp_recved(tcpControlBlock, dataRead);
+    }
 
     return dataRead;
 }
@@ -462,6 +388,22 @@ uint8_t PicoTcpClient::connected()
 
 void PicoTcpClient::sync()
 {
+    if (tcpControlBlock != NULL && isConnected && writeCount > 0)
+    {
+        writeQueued();
+    }
+}
+
+void PicoTcpClient::clearQueues()
+{
+    if (receiveQueue != NULL)
+    {
+        pbuf_free(receiveQueue);
+        receiveQueue = NULL;
+    }
+    availableData = 0;
+    writeHead = 0;
+    writeCount = 0;
 }
 
 void PicoTcpClient::close()
@@ -483,6 +425,7 @@ void PicoTcpClient::close()
         }
         tcpControlBlock = NULL;
     }
+    clearQueues();
 #if PICO_CYW43_ARCH_POLL
     cyw43_arch_poll();
 #endif
@@ -36,30 +36,23 @@
 #include "Client.h"
 
 #define BASE_ERROR -1
-#define BUFFER_SIZE 2048
+// Bytes written that lwIP hasn't taken yet are held in a ring of this size, a write returns short once it is full
+#define PICO_TCP_CLIENT_BUFFER_SIZE 8192
 
-typedef struct DataBuffer_t
-{
-    const uint8_t *data;
-    const uint8_t *position;
-    size_t length;
-    DataBuffer_t *next;
-} DataBuffer;
-
-#define DataBuffer_initializer \
-    {                          \
-        NULL, 0, NULL          \
-    }
+struct pbuf;
 
 class PicoTcpClient : Client
 {
 private:
     struct tcp_pcb *tcpControlBlock = NULL;
     int availableData = 0;
-    uint8_t *receivedData = NULL;
 
-    DataBuffer *writeQueue = NULL;
-    DataBuffer *receiveQueue = NULL;
+    // Received data is read straight out of the pbufs lwIP delivered it in
+    struct pbuf *receiveQueue = NULL;
+
+    uint8_t writeBuffer[PICO_TCP_CLIENT_BUFFER_SIZE];
+    size_t writeHead = 0;
+    size_t writeCount = 0;
 
     bool isConnected = false;
     bool isConfigured = false;
@@ -68,7 +61,8 @@ private:
 
     struct Private;
 
-    int8_t writeDataBuffer(DataBuffer *buffer);
+    int8_t writeQueued();
+    void clearQueues();
 
     int8_t onConnected(int errorCode);
     int8_t received(void *data, int8_t errorCode);
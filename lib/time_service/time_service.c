@@ -0,0 +1,110 @@
+/*
+ * File: time_service.c
+ * Project: home_controllers
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#include "time_service.h"
+#include "hardware/sync.h"
+
+// The UTC mapping is guarded by a sequence lock. The sequence is odd while the mapping is being written.
+static volatile uint32_t utc_sequence = 0;
+static volatile int64_t utc_offset = 0;
+static volatile bool utc_valid = false;
+
+static void write_mapping(int64_t offset, bool valid)
+{
+    // Interrupts are disabled so a reader in an interrupt handler on this core
+    // can never observe the sequence mid write and spin forever.
+    uint32_t interrupts = save_and_disable_interrupts();
+    utc_sequence = utc_sequence + 1;
+    __dmb();
+    utc_offset = offset;
+    utc_valid = valid;
+    __dmb();
+    utc_sequence = utc_sequence + 1;
+    restore_interrupts(interrupts);
+}
+
+static bool read_mapping(int64_t *offset)
+{
+    uint32_t sequence;
+    bool valid;
+
+    do
+    {
+        sequence = utc_sequence;
+        __dmb();
+        *offset = utc_offset;
+        valid = utc_valid;
+        __dmb();
+    } while ((sequence & 1) || sequence != utc_sequence);
+
+    return valid;
+}
+
+void time_service_set_utc_offset(int64_t offset)
+{
+    write_mapping(offset, true);
+}
+
+void time_service_clear_utc(void)
+{
+    write_mapping(0, false);
+}
+
+int64_t time_service_utc_offset(void)
+{
+    int64_t offset;
+    read_mapping(&offset);
+    return offset;
+}
+
+bool time_service_utc_valid(void)
+{
+    int64_t offset;
+    return read_mapping(&offset);
+}
+
+bool time_service_to_utc_ms(uint64_t monotonic, uint64_t *utc)
+{
+    int64_t offset;
+
+    if (!read_mapping(&offset))
+    {
+        return false;
+    }
+
+    *utc = (uint64_t)((int64_t)monotonic + offset) / TIME_SERVICE_US_PER_MS;
+    return true;
+}
+
+bool time_service_utc_ms(uint64_t *utc)
+{
+    return time_service_to_utc_ms(time_service_monotonic_us(), utc);
+}
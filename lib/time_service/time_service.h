@@ -0,0 +1,138 @@
+/*
+ * File: time_service.h
+ * Project: home_controllers
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef TIME_SERVICE
+#define TIME_SERVICE
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "pico/stdlib.h"
+
+/*
+ * A single time base for every library and project.
+ *
+ * The monotonic clock is the 64 bit hardware timer. It counts from boot, never wraps and
+ * never steps, so it is the only clock that should be used for intervals and deadlines.
+ *
+ * UTC is a mapping onto the monotonic clock, set by a time source such as the NtpClient.
+ * Timestamps are captured as monotonic microseconds and converted to UTC once, when they
+ * are published. All functions are lock free and safe to call from either core or from an
+ * interrupt handler.
+ */
+
+#define TIME_SERVICE_US_PER_MS 1000
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Get the monotonic time in microseconds since boot.
+     *
+     * @return uint64_t
+     */
+    static inline uint64_t time_service_monotonic_us(void)
+    {
+        return time_us_64();
+    }
+
+    /**
+     * @brief Get the monotonic time in milliseconds since boot.
+     *
+     * @return uint64_t
+     */
+    static inline uint64_t time_service_monotonic_ms(void)
+    {
+        return time_us_64() / TIME_SERVICE_US_PER_MS;
+    }
+
+    /**
+     * @brief Checks if a monotonic deadline has been reached.
+     *
+     * @param deadline Monotonic time in microseconds
+     * @return true if the deadline is now or in the past
+     */
+    static inline bool time_service_reached(uint64_t deadline)
+    {
+        return time_us_64() >= deadline;
+    }
+
+    /**
+     * @brief Sets the mapping from the monotonic clock to UTC and marks it as valid.
+     * Should only be called by a single time source.
+     *
+     * @param offset Microseconds to add to the monotonic time to get UTC microseconds since 1 Jan 1970
+     */
+    void time_service_set_utc_offset(int64_t offset);
+
+    /**
+     * @brief Marks the UTC mapping as invalid, for when the time source is lost or replaced.
+     */
+    void time_service_clear_utc(void);
+
+    /**
+     * @brief Get the offset from the monotonic clock to UTC in microseconds.
+     *
+     * @return int64_t The offset, or 0 if the mapping has never been set
+     */
+    int64_t time_service_utc_offset(void);
+
+    /**
+     * @brief Checks whether a time source has set the UTC mapping.
+     *
+     * @return true if the UTC time can be trusted
+     */
+    bool time_service_utc_valid(void);
+
+    /**
+     * @brief Converts a monotonic timestamp into UTC milliseconds since 1 Jan 1970.
+     *
+     * @param monotonic Monotonic time in microseconds, as captured with time_service_monotonic_us
+     * @param utc Set to the UTC time in milliseconds when the mapping is valid
+     * @return true if the mapping is valid and utc was set
+     */
+    bool time_service_to_utc_ms(uint64_t monotonic, uint64_t *utc);
+
+    /**
+     * @brief Get the current UTC time in milliseconds since 1 Jan 1970.
+     *
+     * @param utc Set to the UTC time in milliseconds when the mapping is valid
+     * @return true if the mapping is valid and utc was set
+     */
+    bool time_service_utc_ms(uint64_t *utc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIME_SERVICE */
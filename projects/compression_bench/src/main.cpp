@@ -0,0 +1,336 @@
+/*
+ * File: main.cpp
+ * Project: compression_bench
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+/*
+ * Measures the DEFLATE compressor on the payloads that are worth compressing. Reports the
+ * compressed size and the time taken for each, so the compression threshold can be chosen.
+ * Runs on a Pico W, printing over USB, or on Linux through the host build, where every
+ * stream is also checked against zlib and zlib's own ratios are shown for comparison.
+ */
+
+#include <Deflate.h>
+#include <Protobuf.h>
+#include <SparkplugPayload.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#ifdef PICO
+#include "pico/stdlib.h"
+#else
+#include <chrono>
+#endif
+
+#ifdef COMPRESSION_BENCH_ZLIB
+#include <zlib.h>
+#endif
+
+#define ITERATIONS 20
+
+// Sparkplug B datatypes and PropertyValue fields used by the sample payloads
+#define DATATYPE_INT32 3
+#define DATATYPE_FLOAT 9
+#define DATATYPE_BOOLEAN 11
+#define DATATYPE_STRING 12
+#define METRIC_PROPERTIES 9
+#define PROPERTY_SET_KEYS 1
+#define PROPERTY_SET_VALUES 2
+#define PROPERTY_VALUE_TYPE 1
+#define PROPERTY_VALUE_INT 3
+#define PROPERTY_VALUE_STRING 8
+
+#define SAMPLE_TIMESTAMP 1792300000000ull
+
+typedef struct
+{
+    const char *name;
+    std::vector<uint8_t> payload;
+} Sample;
+
+static uint64_t now()
+{
+#ifdef PICO
+    return time_us_64();
+#else
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static void addProperty(ProtobufWriter *keys, ProtobufWriter *values, ProtobufBuffer *value, const char *key, const char *text)
+{
+    ProtobufWriter valueWriter(value);
+
+    keys->bytesField(PROPERTY_SET_KEYS, key, strlen(key));
+    value->clear();
+    valueWriter.varintField(PROPERTY_VALUE_TYPE, DATATYPE_STRING);
+    valueWriter.bytesField(PROPERTY_VALUE_STRING, text, strlen(text));
+    values->bytesField(PROPERTY_SET_VALUES, value->data(), value->size());
+}
+
+static void addMetric(ProtobufWriter *payload, const char *name, uint64_t alias, int datatype, uint64_t value,
+                      const char *const *states = NULL, size_t stateCount = 0)
+{
+    ProtobufBuffer metric;
+    ProtobufWriter writer(&metric);
+
+    if (name)
+    {
+        writer.bytesField(METRIC_NAME, name, strlen(name));
+    }
+    writer.varintField(METRIC_ALIAS, alias);
+    writer.varintField(METRIC_TIMESTAMP, SAMPLE_TIMESTAMP + alias);
+    writer.varintField(METRIC_DATATYPE, datatype);
+
+    if (datatype == DATATYPE_FLOAT)
+    {
+        writer.fixed32Field(METRIC_FLOAT_VALUE, (uint32_t)value);
+    }
+    else if (datatype == DATATYPE_BOOLEAN)
+    {
+        writer.varintField(METRIC_BOOLEAN_VALUE, value != 0);
+    }
+    else
+    {
+        writer.varintField(METRIC_INT_VALUE, value);
+    }
+
+    // Enumerated values carry the name of every state, as the shed's Victron metrics do
+    if (stateCount > 0)
+    {
+        ProtobufBuffer properties;
+        ProtobufBuffer keys;
+        ProtobufBuffer values;
+        ProtobufBuffer property;
+        ProtobufWriter keysWriter(&keys);
+        ProtobufWriter valuesWriter(&values);
+
+        for (size_t i = 0; i < stateCount; i++)
+        {
+            char key[8];
+            snprintf(key, sizeof(key), "%u", (unsigned)i);
+            addProperty(&keysWriter, &valuesWriter, &property, key, states[i]);
+        }
+
+        properties.insert(properties.end(), keys.begin(), keys.end());
+        properties.insert(properties.end(), values.begin(), values.end());
+        writer.bytesField(METRIC_PROPERTIES, properties.data(), properties.size());
+    }
+
+    payload->bytesField(PAYLOAD_METRICS, metric.data(), metric.size());
+}
+
+static Sample shedBirth()
+{
+    static const char *const chargeStates[] = {"Off", "Low power", "Fault", "Bulk", "Absorption", "Float",
+                                               "Storage", "Equalize", "Inverting", "Power supply", "Starting-up",
+                                               "Repeated absorption", "Auto equalize", "BatterySafe", "External control"};
+    static const char *const errors[] = {"No error", "Battery voltage too high", "Charger temperature too high",
+                                         "Charger over current", "Charger current reversed", "Bulk time limit exceeded",
+                                         "Current sensor issue", "Terminals overheated", "Input voltage too high",
+                                         "Input current too high", "Input shutdown", "Factory calibration data lost",
+                                         "Invalid firmware", "User settings invalid"};
+    static const char *const trackerModes[] = {"Off", "Voltage or current limited", "MPP Tracker active"};
+    static const char *const offReasons[] = {"None", "No input power", "Switched off", "Remote input",
+                                             "Protection active", "Paygo", "BMS", "Engine shutdown detection",
+                                             "Analysing input voltage"};
+    static const char *const floats[] = {"Battery Voltage", "Battery Current", "Panel Voltage", "Panel Power",
+                                         "Load Current", "Yield Total", "Yield Today", "Yield Yesterday",
+                                         "Maximum Power Today", "Maximum Power Yesterday", "Temperature", "Humidity"};
+    static const char *const switches[] = {"Door Open", "Light", "Fan", "Load Output"};
+
+    Sample sample = {.name = "Shed NBIRTH"};
+    ProtobufBuffer payload;
+    ProtobufWriter writer(&payload);
+    uint64_t alias = 0;
+
+    writer.varintField(PAYLOAD_TIMESTAMP, SAMPLE_TIMESTAMP);
+    addMetric(&writer, "bdSeq", alias++, DATATYPE_INT32, 3);
+    addMetric(&writer, NODE_CONTROL_REBIRTH, alias++, DATATYPE_BOOLEAN, 0);
+
+    for (const char *name : floats)
+    {
+        std::string metric = std::string("Victron/") + name;
+        uint64_t index = alias++;
+        addMetric(&writer, metric.c_str(), index, DATATYPE_FLOAT, 0x41480000 + index * 1117);
+    }
+    for (const char *name : switches)
+    {
+        std::string metric = std::string("Shed/") + name;
+        uint64_t index = alias++;
+        addMetric(&writer, metric.c_str(), index, DATATYPE_BOOLEAN, index & 1);
+    }
+
+    addMetric(&writer, "Victron/Charge State", alias++, DATATYPE_INT32, 3, chargeStates, sizeof(chargeStates) / sizeof(chargeStates[0]));
+    addMetric(&writer, "Victron/Error", alias++, DATATYPE_INT32, 0, errors, sizeof(errors) / sizeof(errors[0]));
+    addMetric(&writer, "Victron/Tracker Mode", alias++, DATATYPE_INT32, 2, trackerModes, sizeof(trackerModes) / sizeof(trackerModes[0]));
+    addMetric(&writer, "Victron/Off Reason", alias++, DATATYPE_INT32, 0, offReasons, sizeof(offReasons) / sizeof(offReasons[0]));
+    writer.varintField(PAYLOAD_SEQ, 0);
+
+    sample.payload.assign(payload.begin(), payload.end());
+    return sample;
+}
+
+/**
+ * @brief A batch of replayed samples, by name or by alias
+ */
+static Sample replayBatch(const char *name, bool byName)
+{
+    Sample sample = {.name = name};
+    ProtobufBuffer payload;
+    ProtobufWriter writer(&payload);
+
+    writer.varintField(PAYLOAD_TIMESTAMP, SAMPLE_TIMESTAMP);
+    for (int i = 0; i < 16; i++)
+    {
+        ProtobufBuffer metric;
+        ProtobufWriter metricWriter(&metric);
+        const char *metricName = i % 2 ? "Victron/Battery Voltage" : "Victron/Panel Power";
+
+        if (byName)
+        {
+            metricWriter.bytesField(METRIC_NAME, metricName, strlen(metricName));
+        }
+        else
+        {
+            metricWriter.varintField(METRIC_ALIAS, 2 + i % 2);
+        }
+        metricWriter.varintField(METRIC_TIMESTAMP, SAMPLE_TIMESTAMP - (16 - i) * 60000);
+        metricWriter.varintField(METRIC_DATATYPE, DATATYPE_FLOAT);
+        metricWriter.varintField(METRIC_IS_HISTORICAL, 1);
+        metricWriter.fixed32Field(METRIC_FLOAT_VALUE, 0x41500000 + i * 2731);
+        writer.bytesField(PAYLOAD_METRICS, metric.data(), metric.size());
+    }
+    writer.varintField(PAYLOAD_SEQ, 17);
+
+    sample.payload.assign(payload.begin(), payload.end());
+    return sample;
+}
+
+static Sample dataUpdate()
+{
+    Sample sample = {.name = "DDATA by alias"};
+    ProtobufBuffer payload;
+    ProtobufWriter writer(&payload);
+
+    writer.varintField(PAYLOAD_TIMESTAMP, SAMPLE_TIMESTAMP);
+    addMetric(&writer, NULL, 2, DATATYPE_FLOAT, 0x41533333);
+    addMetric(&writer, NULL, 5, DATATYPE_FLOAT, 0x42C80000);
+    writer.varintField(PAYLOAD_SEQ, 42);
+
+    sample.payload.assign(payload.begin(), payload.end());
+    return sample;
+}
+
+#ifdef COMPRESSION_BENCH_ZLIB
+static bool verify(const Sample &sample, const uint8_t *stream, size_t length)
+{
+    std::vector<uint8_t> inflated(sample.payload.size());
+    uLongf inflatedLength = inflated.size();
+
+    return uncompress(inflated.data(), &inflatedLength, stream, length) == Z_OK &&
+           inflatedLength == sample.payload.size() &&
+           memcmp(inflated.data(), sample.payload.data(), inflatedLength) == 0;
+}
+
+static void zlibReference(const Sample &sample, int level)
+{
+    std::vector<uint8_t> output(compressBound(sample.payload.size()));
+    uLongf length = output.size();
+    uint64_t start = now();
+
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        length = output.size();
+        compress2(output.data(), &length, sample.payload.data(), sample.payload.size(), level);
+    }
+
+    printf("  zlib level %d: %5lu bytes, ratio %.2f, %6.1f us\n", level, (unsigned long)length,
+           (double)sample.payload.size() / length, (double)(now() - start) / ITERATIONS);
+}
+#endif
+
+int main()
+{
+    static Deflate deflate;
+    int failures = 0;
+
+#ifdef PICO
+    stdio_init_all();
+    // Give the USB serial time to be opened
+    sleep_ms(5000);
+#endif
+
+    std::vector<Sample> samples;
+    samples.push_back(shedBirth());
+    samples.push_back(replayBatch("Replay by name", true));
+    samples.push_back(replayBatch("Replay by alias", false));
+    samples.push_back(dataUpdate());
+
+    printf("DEFLATE, fixed codes, %u entry hash table, %u bytes of state\n", DEFLATE_HASH_SIZE, (unsigned)sizeof(Deflate));
+
+    for (auto &sample : samples)
+    {
+        std::vector<uint8_t> output(sample.payload.size() * 2 + 64);
+        size_t length = 0;
+        uint64_t start = now();
+
+        for (int i = 0; i < ITERATIONS; i++)
+        {
+            length = deflate.compress(sample.payload.data(), sample.payload.size(), output.data(), output.size());
+        }
+
+        double time = (double)(now() - start) / ITERATIONS;
+        printf("%-16s %5u -> %5u bytes, ratio %.2f, %8.1f us, %.2f us/byte\n", sample.name,
+               (unsigned)sample.payload.size(), (unsigned)length, (double)sample.payload.size() / length,
+               time, time / sample.payload.size());
+
+#ifdef COMPRESSION_BENCH_ZLIB
+        if (!verify(sample, output.data(), length))
+        {
+            printf("  stream does not inflate to the payload\n");
+            failures++;
+        }
+        zlibReference(sample, 1);
+        zlibReference(sample, 6);
+#endif
+    }
+
+#ifdef PICO
+    while (true)
+    {
+        sleep_ms(1000);
+    }
+#endif
+
+    return failures > 0 ? 1 : 0;
+}
@@ -36,6 +36,7 @@
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
 #include "hardware/adc.h"
+#include "time_service.h"
 #include <stdio.h>
 
 // Timers
@@ -50,19 +51,11 @@
 
 #define MAX_DOOR_VALUE 0xFFFF
 
-#define MAX_TIME 0xFFFFFFFF
-
 #define DOOR_IDENTIFIER 0b10000000
 
 #define LOW 0
 #define HIGH 1
 
-bool timestamp_elapsed(uint32_t stamp, uint32_t max)
-{
-    uint32_t now = time_us_32();
-    return (now > stamp && ((MAX_TIME - now) + stamp) > max);
-}
-
 // Union used for converting door data to a buffer for transmissions
 typedef union
 {
@@ -90,7 +83,7 @@ DoorControl door_control_initialize(DoorControl *door_control, int16_t min, int1
 
     uint16_t initialValue = adc_read();
 
-    door_control->time_stamp = time_us_32();
+    door_control->time_stamp = time_service_monotonic_us();
 
     *door_control = (DoorControl){
         .current_state = DOOR_IDLE,
@@ -175,18 +168,18 @@ DoorData door_control_get(DoorControl *door_control)
  */
 int door_control_execute(DoorControl *door_control)
 {
-    if (door_control->relay_output == HIGH && timestamp_elapsed(door_control->relay_time, RELAY_DELAY))
+    if (door_control->relay_output == HIGH && time_service_reached(door_control->relay_time))
     {
         gpio_put(RELAY_PIN, door_control->relay_output = LOW);
     }
 
-    if (!timestamp_elapsed(door_control->time_stamp, DOOR_SAMPLE_RATE))
+    if (!time_service_reached(door_control->time_stamp))
     {
         return 0;
     }
     else
     {
-        door_control->time_stamp = time_us_32() + DOOR_SAMPLE_RATE;
+        door_control->time_stamp = time_service_monotonic_us() + DOOR_SAMPLE_RATE;
     }
 
     uint16_t potentiometer_position = adc_read();
@@ -213,7 +206,7 @@ int door_control_execute(DoorControl *door_control)
         else
         {
             door_control->stablize_count = STABLIZE_COUNT_MAX;
-            if (timestamp_elapsed(door_control->command_time, DOOR_COMMAND_DELAY))
+            if (time_service_reached(door_control->command_time))
                 door_control->desired_state = ACTIVE;
         }
         break;
@@ -263,8 +256,8 @@ int door_control_execute(DoorControl *door_control)
         if (door_control->desired_state == START || door_control->desired_state == STOP)
         {
             gpio_put(RELAY_PIN, door_control->relay_output = HIGH);
-            door_control->command_time = time_us_32() + DOOR_COMMAND_DELAY;
-            door_control->relay_time = time_us_32() + RELAY_DELAY;
+            door_control->command_time = time_service_monotonic_us() + DOOR_COMMAND_DELAY;
+            door_control->relay_time = time_service_monotonic_us() + RELAY_DELAY;
         }
         door_control->current_state = door_control->desired_state;
         return 1;
@@ -59,9 +59,10 @@ typedef struct _DoorControl
     int16_t position_max;
     int8_t mean_position_delta;
     uint8_t relay_output;
-    uint32_t time_stamp;
-    uint32_t command_time;
-    uint32_t relay_time;
+    // Monotonic deadlines in microseconds
+    uint64_t time_stamp;
+    uint64_t command_time;
+    uint64_t relay_time;
     uint8_t stablize_count;
     uint8_t hold_transition;
 } DoorControl;
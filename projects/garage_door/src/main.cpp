@@ -1,7 +1,9 @@
 #include <string.h>
 #include <time.h>
 
-#include <PicoSparkplugClient.h>
+#include <NodeRuntime.h>
+#include <SpscRing.h>
+#include <Mailbox.h>
 
 #include <Node.h>
 #include <Device.h>
@@ -10,49 +12,73 @@
 #include <metrics/simple/DateTimeMetric.h>
 
 #include <NtpClient.h>
+#include <time_service.h>
 
 #include "pico/stdlib.h"
-#include "pico/cyw43_arch.h"
 #include "pico/multicore.h"
-#include "pico/util/queue.h"
 #include "hardware/gpio.h"
 #include "hardware/adc.h"
 
-#include "lwip/pbuf.h"
-#include "lwip/tcp.h"
-
 #include "door_control.h"
 
 #define TCP_PORT 4242
 #define DEBUG_printf printf
 #define BUF_SIZE 2048
 
-#define ADDRESS BROKER_ADDRESS
 #define GROUP_ID "Garage"
 #define NODE_ID "Door"
 #define HOST_ID "Home"
+#define DIAGNOSTICS_INTERVAL_S 60
+#define NODE_PERIOD_MS 100
 
 #define TEST_ITERATIONS 10
 #define POLL_TIME_S 5
 
-#define MAX_RETRIES 5000
-
-static queue_t sparkplugQueue;
-static queue_t doorQueue;
-
-void wifi_connect()
+// Position commands waiting for core 1, applied in order so the newest one wins
+#define DOOR_COMMAND_QUEUE 8
+// State and result changes waiting for core 0, each one is published
+#define DOOR_EVENT_QUEUE 16
+// Every position the door passes through while it moves, for core 0 to batch
+#define DOOR_TRACE_QUEUE 64
+// The trace of a movement is published a second at a time, or sooner if the door moves quickly
+#define POSITION_TRACE_BATCH {.maxSamples = 32, .maxAge = 1000}
+
+// Door samples are stamped with the monotonic time they were captured and converted to UTC when published
+typedef struct
 {
-
-    printf("Connecting to WiFi...\n");
-    if (cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK, 30000))
-    {
-        printf("failed to connect.\n");
-        return;
-    }
-    else
-    {
-        printf("WIFI Connected.\n");
-    }
+    DoorData data;
+    uint64_t timestamp;
+} DoorSample;
+
+static SpscRing<uint8_t, DOOR_COMMAND_QUEUE> doorCommands;
+static SpscRing<DoorSample, DOOR_EVENT_QUEUE> doorEvents;
+static SpscRing<DoorSample, DOOR_TRACE_QUEUE> doorTrace;
+// The position only needs its latest value, so it is overwritten rather than queued
+static Mailbox<DoorSample> doorSample;
+// Core 1 reports the time it spends controlling the door here
+static Diagnostics *diagnostics;
+
+// The metrics the door's samples are published to
+typedef struct
+{
+    std::shared_ptr<UInt8Metric> position;
+    std::shared_ptr<UInt8Metric> state;
+    std::shared_ptr<UInt8Metric> result;
+    std::shared_ptr<DateTimeMetric> sampleTime;
+    // Times each sample from capture on core 1 to its NDATA leaving
+    PicoSparkplugClient *client;
+    size_t latencyKey;
+    // Positions while the door moves, published as a DataSet
+    SampleBatch *batch;
+    uint32_t traceKey;
+    // Capture time of the last sample applied, and when the next state change may be
+    uint64_t applied;
+    uint64_t nextEvent;
+} DoorMetrics;
+
+static bool doorMoving(uint8_t state)
+{
+    return state == START || state == MONITOR || state == STOP;
 }
 
 void door_main()
@@ -61,141 +87,162 @@ void door_main()
     DoorControl doorControl;
     DoorControl *doorControlPtr = &doorControl;
     door_control_initialize(doorControlPtr, 220, 4095);
+    DoorData reported = door_control_get(doorControlPtr);
 
     while (true)
     {
-        if (!queue_is_empty(&sparkplugQueue))
-        {
-            uint8_t value;
-            queue_remove_blocking(&sparkplugQueue, &value);
-            door_control_set_position(doorControlPtr, value);
-        }
+        uint64_t start = time_service_monotonic_us();
+        bool worked = false;
 
-        if (door_control_execute(doorControlPtr) && queue_is_empty(&doorQueue))
+        uint8_t position;
+        while (doorCommands.pop(&position))
         {
-
-            DoorData doorData = door_control_get(doorControlPtr);
-            queue_add_blocking(&doorQueue, &doorData);
+            door_control_set_position(doorControlPtr, position);
+            worked = true;
         }
-    }
-}
-
-void mqtt_test()
-{
-    char clientId[40];
 
-    Uri uri(ADDRESS);
-    sprintf(clientId, "garage_door_%ld", get_rand_32());
-
-    NodeOptions nodeOptions = {
-        GROUP_ID,
-        NODE_ID,
-        HOST_ID,
-        100,
-        NODE_CONTROL_REBIRTH};
-
-    ClientOptions clientOptions = {
-        .address = uri,
-        .clientId = clientId,
-        .username = NULL,
-        .password = NULL,
-        .connectTimeout = 5000,
-        .keepAliveInterval = 5};
-
-    Node node = Node(&nodeOptions);
-
-    auto position = UInt8Metric::create("position", 0);
-
-    position->setCommandCallback(
-        [](__attribute__((unused)) Metric *metric, org_eclipse_tahu_protobuf_Payload_Metric *payload)
+        // The loop polls the door, only the passes where it did something count as busy
+        bool changed = door_control_execute(doorControlPtr);
+        worked = worked || changed;
+        if (changed)
         {
-            if (queue_is_empty(&sparkplugQueue))
+            DoorSample sample = {
+                .data = door_control_get(doorControlPtr),
+                .timestamp = time_service_monotonic_us()};
+            doorSample.write(sample);
+            if (doorMoving(sample.data.state))
             {
-                queue_add_blocking(&sparkplugQueue, &payload->value);
+                doorTrace.push(sample);
             }
-        });
 
-    auto state = UInt8Metric::create("state", 0);
-    auto result = UInt8Metric::create("result", 0);
+            if (sample.data.state != reported.state || sample.data.result != reported.result)
+            {
+                if (!doorEvents.push(sample))
+                {
+                    printf("Door event queue full, dropped state %d\n", sample.data.state);
+                }
+                reported = sample.data;
+            }
+            NodeScheduler::wake();
+        }
 
-    node.addMetric(position);
-    node.addMetric(state);
-    node.addMetric(result);
+        if (worked)
+        {
+            diagnostics->addCore1Busy((uint32_t)(time_service_monotonic_us() - start));
+        }
+    }
+}
 
-    auto *client = node.addClient<PicoSparkplugClient>(&clientOptions);
-    client->useNtpServer(NTP_ADDRESS, 123);
+// Publishes the samples from the door control on core 1. State changes are applied one per node period
+// so each gets its own NDATA, between them only the latest position is published.
+void publishDoorSample(DoorMetrics *metrics)
+{
+    DoorSample value;
 
-    node.enable();
+    // Every position is kept for the trace, while the metric only gets the latest
+    while (doorTrace.pop(&value))
+    {
+        metrics->batch->sample(metrics->traceKey, value.data.position, value.timestamp);
+    }
 
-    while (true)
+    if (!doorEvents.empty())
     {
-        wifi_connect();
-        while (cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA) == CYW43_LINK_JOIN)
+        if (!time_service_reached(metrics->nextEvent))
         {
-            printf("Wifi is connected, checking ntp server\n");
-            uint32_t retries = 0;
-
-            while (!node.isActive() && retries++ < MAX_RETRIES)
-            {
-#if PICO_CYW43_ARCH_POLL
-                cyw43_arch_poll();
-#endif
-                sleep_ms(1);
-            }
-
-            if (retries >= MAX_RETRIES)
-            {
-                continue;
-            }
-
-            uint32_t executeTime = 5;
-            while (node.isActive())
-            {
-                if (!queue_is_empty(&doorQueue))
-                {
-                    DoorData value;
-                    queue_remove_blocking(&doorQueue, &value);
-                    position->setValue(value.position);
-                    state->setValue(value.state);
-                    result->setValue(value.result);
-                }
-
-                node.execute(executeTime);
+            return;
+        }
+        doorEvents.pop(&value);
+        metrics->nextEvent = time_service_monotonic_us() + (uint64_t)NODE_PERIOD_MS * TIME_SERVICE_US_PER_MS;
+    }
+    else if (!doorSample.take(&value) || value.timestamp <= metrics->applied)
+    {
+        // The latest position was already applied with the last state change
+        return;
+    }
 
-                sleep_ms(executeTime);
+    metrics->applied = value.timestamp;
+    metrics->position->setValue(value.data.position);
+    metrics->state->setValue(value.data.state);
+    metrics->result->setValue(value.data.result);
 
-#if PICO_CYW43_ARCH_POLL
-                cyw43_arch_poll();
-#endif
-            }
-            printf("Node is no longer Active, checking wifi status\n");
-        }
-        printf("WIFI not connected, waiting 5 seconds\n");
-        sleep_ms(5000);
+    uint64_t sampleUtc;
+    if (time_service_to_utc_ms(value.timestamp, &sampleUtc))
+    {
+        metrics->sampleTime->setValue(sampleUtc);
     }
+
+    metrics->client->captured(metrics->latencyKey, value.timestamp);
 }
 
 int main()
 {
     stdio_init_all();
 
-    queue_init(&sparkplugQueue, sizeof(uint8_t), 1);
-    queue_init(&doorQueue, sizeof(DoorData), 1);
-
     adc_init();
 
-    multicore_launch_core1(door_main);
-
-    if (cyw43_arch_init())
-    {
-        printf("failed to initialise\n");
-        return 1;
-    }
-    cyw43_arch_enable_sta_mode();
-
-    mqtt_test();
+    NodeRuntimeOptions options = {
+        .ssid = WIFI_SSID,
+        .password = WIFI_PASSWORD,
+        .brokerAddress = BROKER_ADDRESS,
+        .ntpAddress = NTP_ADDRESS,
+        .ntpBroadcast = NTP_BROADCAST,
+        .groupId = GROUP_ID,
+        .nodeId = NODE_ID,
+        .hostId = HOST_ID,
+        .clientIdPrefix = "garage_door",
+        .period = NODE_PERIOD_MS,
+        .fastJoin = true,
+        .staticIp = STATIC_IP,
+        .netmask = STATIC_NETMASK,
+        .gateway = STATIC_GATEWAY,
+        .dnsServer = STATIC_DNS,
+        .diagnostics = true,
+        .diagnosticsInterval = DIAGNOSTICS_INTERVAL_S};
+
+    static NodeRuntime runtime(&options);
+    static DoorMetrics metrics = {
+        .position = UInt8Metric::create("position", 0),
+        .state = UInt8Metric::create("state", 0),
+        .result = UInt8Metric::create("result", 0),
+        .sampleTime = DateTimeMetric::create("sampleTime", 0),
+        .client = NULL,
+        .latencyKey = 0,
+        .batch = NULL,
+        .traceKey = 0,
+        .applied = 0,
+        .nextEvent = 0};
+
+    metrics.position->setCommandCallback(
+        [](__attribute__((unused)) Metric *metric, org_eclipse_tahu_protobuf_Payload_Metric *payload)
+        {
+            if (!doorCommands.push((uint8_t)payload->value.int_value))
+            {
+                printf("Door command queue full, dropped position %u\n", (unsigned)payload->value.int_value);
+            }
+        });
 
-    cyw43_arch_deinit();
+    Node *node = runtime.getNode();
+    node->addMetric(metrics.position);
+    node->addMetric(metrics.state);
+    node->addMetric(metrics.result);
+    node->addMetric(metrics.sampleTime);
+
+    metrics.client = runtime.getClient();
+    metrics.latencyKey = metrics.client->publishLatencyMetrics((Publishable *)node, NULL);
+    // A result lost to a dropped connection would leave the host not knowing whether the door moved
+    metrics.client->deliverAtLeastOnce(NULL, "result");
+    metrics.batch = metrics.client->enableSampleBatch();
+    metrics.traceKey = metrics.batch->add(NULL, "positionTrace", SPARKPLUG_UINT8, POSITION_TRACE_BATCH);
+
+    runtime.addTask([](void *context)
+                    { publishDoorSample((DoorMetrics *)context); },
+                    &metrics);
+    runtime.addDeadline([](void *context)
+                        { return doorEvents.empty() ? UINT64_MAX : ((DoorMetrics *)context)->nextEvent; },
+                        &metrics);
+
+    diagnostics = runtime.getDiagnostics();
+    multicore_launch_core1(door_main);
 
-    return 0;
-}
\ No newline at end of file
+    return runtime.run();
+}
@@ -2,16 +2,29 @@
 #include "hardware/gpio.h"
 #include "hardware/pwm.h"
 
+#include <NodeScheduler.h>
+#include <PicoSparkplugClient.h>
+
 #define LIGHT_PIN 9
 #define DOOR_SENSOR_PIN 3
 
 #define CLOCK 125000000
 
+// The door sensor is read every execution, so changes are limited to debounce the switch
+#define DOOR_REPORT_INTERVAL 100
+
+// The door is read by the node loop, the edge only has to wake it
+static void onDoorEdge(__attribute__((unused)) uint gpio, __attribute__((unused)) uint32_t events)
+{
+    NodeScheduler::wake();
+}
+
 Shed::Shed(Publishable *parent)
 {
     gpio_init(DOOR_SENSOR_PIN);
     gpio_set_dir(DOOR_SENSOR_PIN, GPIO_IN);
     gpio_pull_down(DOOR_SENSOR_PIN);
+    gpio_set_irq_enabled_with_callback(DOOR_SENSOR_PIN, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true, onDoorEdge);
     gpio_set_function(LIGHT_PIN, GPIO_FUNC_PWM);
 
     lightOutSlice = pwm_gpio_to_slice_num(LIGHT_PIN);
@@ -28,7 +41,7 @@ Shed::Shed(Publishable *parent)
 
     pwm_set_gpio_level(LIGHT_PIN, 0);
 
-    doorOpen = BooleanMetric::create("doorOpen", false);
+    doorOpen = FilteredMetric<BooleanMetric, bool>::create("doorOpen", false, {.minInterval = DOOR_REPORT_INTERVAL});
     intensity = UInt8Metric::create("lightIntensity", 33);
 
     intensity->setCommandCallback(
@@ -37,12 +50,32 @@ Shed::Shed(Publishable *parent)
             metric->setValue(&payload->value.boolean_value);
         });
 
-    parent->addMetrics({doorOpen, intensity});
+    parent->addMetrics({doorOpen->getMetric(), intensity});
+}
+
+void Shed::storeHistory(StoreAndForward *store)
+{
+    doorOpen->storeHistory(store, NULL);
+}
+
+void Shed::trackLatency(PicoSparkplugClient *client, Publishable *parent)
+{
+    latencyClient = client;
+    latencyKey = client->publishLatencyMetrics(parent, NULL);
+}
+
+uint64_t Shed::nextDeadline()
+{
+    uint64_t next = doorOpen->nextReport();
+    return next == UINT64_MAX ? UINT64_MAX : next * TIME_SERVICE_US_PER_MS;
 }
 
 void Shed::sync()
 {
-    doorOpen->setValue(!gpio_get(DOOR_SENSOR_PIN));
+    if (doorOpen->setValue(!gpio_get(DOOR_SENSOR_PIN)) && latencyClient)
+    {
+        latencyClient->captured(latencyKey, time_service_monotonic_us());
+    }
 
     pwm_set_gpio_level(
         LIGHT_PIN,
@@ -4,6 +4,9 @@
 #include "Publishable.h"
 #include "metrics/simple/UInt8Metric.h"
 #include "metrics/simple/BooleanMetric.h"
+#include "FilteredMetric.h"
+
+class PicoSparkplugClient;
 
 class Shed
 {
@@ -13,13 +16,38 @@ private:
     uint8_t lightIntensity = 25;
     uint lightPwmChannel;
 
-    std::shared_ptr<BooleanMetric> doorOpen;
+    std::shared_ptr<FilteredMetric<BooleanMetric, bool>> doorOpen;
     std::shared_ptr<UInt8Metric> intensity;
 
+    PicoSparkplugClient *latencyClient = NULL;
+    size_t latencyKey = 0;
+
 protected:
 public:
     Shed(Publishable *parent);
     void sync();
+
+    /**
+     * @brief Get the next time the door should be read again, when a change is being held back
+     *
+     * @return uint64_t Monotonic time in microseconds, or UINT64_MAX
+     */
+    uint64_t nextDeadline();
+
+    /**
+     * @brief Stores changes to the door while the node is offline
+     *
+     * @param store
+     */
+    void storeHistory(StoreAndForward *store);
+
+    /**
+     * @brief Publishes the latency from the door changing to the NDATA that reports it
+     *
+     * @param client
+     * @param parent The Node or Device to add the latency metrics to
+     */
+    void trackLatency(PicoSparkplugClient *client, Publishable *parent);
 };
 
 #endif /* SHED */
@@ -0,0 +1,208 @@
+/*
+ * File: VictronFrameParser.cpp
+ * Project: gardener
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#include "VictronFrameParser.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time_service.h>
+
+// Character denoting the start of a new field
+#define START_CHARACTER '\n'
+// Character denoting the end of a field
+#define END_CHARACTER '\r'
+// Character denoting the split between a fields label and data
+#define SPLIT_CHARACTER '\t'
+// Character denoting an Async message
+#define ASYNC_CHARACTER ':'
+
+VictronFrameParser::VictronFrameParser(VictronFrameCallback callback, void *context) : callback(callback), context(context)
+{
+}
+
+void VictronFrameParser::parse(const char *buffer, int size)
+{
+    int index = 0;
+    do
+    {
+        char input = buffer[index++];
+        VictronState previous = state;
+        switch (state)
+        {
+        case VictronState::LABEL:
+            if (input == SPLIT_CHARACTER)
+            {
+                state = VictronState::FIELD;
+                fieldIndex = 0;
+                memset(fieldData, 0, sizeof(fieldData));
+            }
+            else if (input == ASYNC_CHARACTER)
+            {
+                // Data we don't care about, ignore it
+                state = VictronState::ASYNC;
+            }
+            else if (labelIndex >= MAX_LABEL_LENGTH)
+            {
+                // Something went wrong and the label length is too long
+                // Return to idle
+                state = VictronState::IDLE;
+            }
+            else
+            {
+                labelData.buffer[labelIndex++] = input;
+            }
+            break;
+        case VictronState::FIELD:
+            if (input == END_CHARACTER)
+            {
+                state = VictronState::IDLE;
+                // Process everything
+                processEntry();
+            }
+            else if (input == ASYNC_CHARACTER && fieldIndex == 1 &&
+                     labelData.lower == VictronId::CHEC && labelData.upper == VictronId::KSUM)
+            {
+                // Async messages are sent straight after the checksum byte, without the end character
+                processEntry();
+                state = VictronState::ASYNC;
+            }
+            else if (fieldIndex >= MAX_FIELD_LENGTH)
+            {
+                // Something went wrong and the label length is too long
+                // Return to idle
+                state = VictronState::IDLE;
+            }
+            else
+            {
+                fieldData[fieldIndex++] = input;
+            }
+            break;
+        case VictronState::ASYNC:
+            if (input == START_CHARACTER)
+            {
+                // The next block starts with its own end and start characters
+                state = VictronState::IDLE;
+            }
+            break;
+        case VictronState::IDLE:
+            if (input == START_CHARACTER)
+            {
+                state = VictronState::LABEL;
+                memset(labelData.buffer, 0, MAX_LABEL_LENGTH);
+                labelIndex = 0;
+            }
+            break;
+        default:
+            break;
+        }
+        // Async messages are not part of the block checksum
+        if (previous != VictronState::ASYNC && state != VictronState::ASYNC)
+        {
+            checksum += input;
+        }
+    } while (index < size);
+}
+
+void VictronFrameParser::addField(int32_t value, const char *text)
+{
+    // Victron specifies a max number of fields.
+    // If we go over this count the block is bad, it fails its checksum anyway.
+    if (frame.count >= MAX_FIELDS_COUNT)
+    {
+        overflows++;
+        frame.count = 0;
+    }
+
+    VictronField *field = &frame.fields[frame.count++];
+    field->id = labelData.lower;
+    field->value = value;
+    field->text[0] = '\0';
+    if (text)
+    {
+        strncpy(field->text, text, MAX_FIELD_LENGTH);
+        field->text[MAX_FIELD_LENGTH] = '\0';
+    }
+}
+
+void VictronFrameParser::processEntry()
+{
+    switch (labelData.lower)
+    {
+    case VictronId::VOLTAGE:
+    case VictronId::PANEL_VOLTAGE:
+        addField(atol(fieldData), NULL);
+        break;
+    case VictronId::CURRENT:
+    case VictronId::PANEL_POWER:
+    case VictronId::LOAD_CURRENT:
+    case VictronId::YIELD_TOTAL:
+    case VictronId::YIELD_TODAY:
+    case VictronId::MAX_POWER_TODAY:
+    case VictronId::YIELD_YESTERDAY:
+    case VictronId::MAX_POWER_YESTERDAY:
+    case VictronId::DAY_SEQUENCE:
+    case VictronId::OPERATION_STATE:
+    case VictronId::ERROR_STATE:
+    case VictronId::TRACKER_OPERATION_MODE:
+        addField(atoi(fieldData), NULL);
+        break;
+    case VictronId::PRODUCT_ID:
+    case VictronId::FIRMWARE:
+    case VictronId::SERIAL_NUMBER:
+        addField(0, fieldData);
+        break;
+    case VictronId::LOAD: // ON/OFF value
+        addField(strcmp(fieldData, "ON") == 0, NULL);
+        break;
+    case VictronId::CHEC:
+        if (labelData.upper == VictronId::KSUM)
+        {
+            // Every byte of the block, the checksum byte included, adds up to zero
+            if (checksum == 0)
+            {
+                frame.capturedAt = time_service_monotonic_us();
+                frame.checksumErrors = checksumErrors;
+                frame.overflows = overflows;
+                callback(&frame, context);
+            }
+            else
+            {
+                checksumErrors++;
+            }
+            frame.count = 0;
+            checksum = 0;
+        }
+        break;
+    case VictronId::OFF_REASON:
+    default:
+        break;
+    }
+}
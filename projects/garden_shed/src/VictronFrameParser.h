@@ -0,0 +1,143 @@
+/*
+ * File: VictronFrameParser.h
+ * Project: gardener
+ * Created Date: Sunday October 18th 2026
+ * Author: Kyle Hofer
+ *
+ * MIT License
+ *
+ * Copyright (c) 2026 Kyle Hofer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * HISTORY:
+ */
+
+#ifndef VICTRONFRAMEPARSER
+#define VICTRONFRAMEPARSER
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Fields.h"
+
+// Max length of a Victron Field Label
+#define MAX_LABEL_LENGTH 8
+// Max length of a Victron Field Value
+#define MAX_FIELD_LENGTH 32
+// Maximum number of fields that in a single block with a checksum
+#define MAX_FIELDS_COUNT 22
+
+// State of the Victron serial
+enum class VictronState
+{
+    IDLE,
+    LABEL,
+    FIELD,
+    ASYNC,
+    CHECKSUM
+};
+
+// Used to convert Field labels to binary values for fast comparisons
+typedef union
+{
+    unsigned char buffer[MAX_LABEL_LENGTH];
+    struct
+    {
+        uint32_t lower;
+        uint32_t upper;
+    };
+} LabelToBuffer_u;
+
+/**
+ * @brief A field of a frame, numbers and ON/OFF are in value and text fields in text
+ */
+typedef struct
+{
+    uint32_t id;
+    int32_t value;
+    char text[MAX_FIELD_LENGTH + 1];
+} VictronField;
+
+/**
+ * @brief The fields of a block whose checksum was valid. Plain data, so it can be copied between cores.
+ */
+typedef struct
+{
+    // Monotonic time the checksum line arrived in microseconds
+    uint64_t capturedAt;
+    // Totals since boot at the time the frame was completed
+    uint32_t checksumErrors;
+    uint32_t overflows;
+    // Frames dropped before this one because the consumer fell behind, set by whoever queues the frame
+    uint32_t dropped;
+    uint8_t count;
+    VictronField fields[MAX_FIELDS_COUNT];
+} VictronFrame;
+
+/**
+ * @brief Gives a completed frame to whoever handles it. The frame is only valid for the call.
+ *
+ * @param frame
+ * @param context
+ */
+typedef void (*VictronFrameCallback)(const VictronFrame *frame, void *context);
+
+/**
+ * @brief Splits the VE.Direct text protocol into frames, only passing on those with a valid checksum.
+ * It doesn't allocate or touch any metrics, so it can run on its own core.
+ */
+class VictronFrameParser
+{
+private:
+    VictronState state = VictronState::IDLE;
+    uint8_t checksum = 0;
+    LabelToBuffer_u labelData = {};
+    int labelIndex = 0;
+    char fieldData[MAX_FIELD_LENGTH + 1] = {};
+    int fieldIndex = 0;
+    VictronFrame frame = {};
+    uint32_t checksumErrors = 0;
+    uint32_t overflows = 0;
+
+    VictronFrameCallback callback;
+    void *context;
+
+    void processEntry();
+    void addField(int32_t value, const char *text);
+
+public:
+    /**
+     * @brief Construct a new Victron Frame Parser
+     *
+     * @param callback Called with each frame whose checksum is valid
+     * @param context Passed to the callback
+     */
+    VictronFrameParser(VictronFrameCallback callback, void *context);
+
+    /**
+     * @brief Process a buffer read from the victron serial
+     *
+     * @param buffer buffer read from the serial
+     * @param size The number of bytes read
+     */
+    void parse(const char *buffer, int size);
+};
+
+#endif /* VICTRONFRAMEPARSER */
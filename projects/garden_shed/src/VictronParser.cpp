@@ -33,6 +33,7 @@
 #include "properties/simple/StringProperty.h"
 #include "properties/simple/UInt8Property.h"
 #include "properties/complex/PropertySet.h"
+#include "PicoSparkplugClient.h"
 
 #include "Fields.h"
 #ifndef __AVR__
@@ -42,52 +43,71 @@ using namespace std;
 #include <Arduino.h>
 #endif // __AVR__
 
-// Character denoting the start of a new field
-#define START_CHARACTER '\n'
-// Character denoting the end of a field
-#define END_CHARACTER '\r'
-// Character denoting the split between a fields label and data
-#define SPLIT_CHARACTER '\t'
-// Character denoting an Async message
-#define ASYNC_CHARACTER ':'
+#define VICTRON_DEVICE "Victron"
 
-VictronParser::VictronParser() : fieldHandlerFunc(NULL), fieldHandlerClass(NULL), fieldCount(0), device(Device("Victron", 1000))
+// Maximum milliseconds between reports of the measurements, even when they haven't changed
+#define MEASUREMENT_REPORT_INTERVAL 300000
+// Voltages are in mV and currents in mA. Everything else is reported whenever it changes.
+#define BATTERY_VOLTAGE_REPORT {.deadband = 20, .maxInterval = MEASUREMENT_REPORT_INTERVAL}
+#define PANEL_VOLTAGE_REPORT {.deadbandPercent = 2, .maxInterval = MEASUREMENT_REPORT_INTERVAL}
+#define CURRENT_REPORT {.deadband = 100, .maxInterval = MEASUREMENT_REPORT_INTERVAL}
+// The Victron sends a frame a second, so a batch holds half a minute of load switching
+#define CURRENT_TRACE_BATCH {.maxSamples = 30, .maxAge = 30000}
+
+VictronParser::VictronParser() : frameParser([](const VictronFrame *frame, void *context)
+                                              { ((VictronParser *)context)->apply(frame); },
+                                              this),
+                                 device(Device(VICTRON_DEVICE, 1000))
 {
     configureSparkplug();
 }
 
 void VictronParser::configureSparkplug()
 {
+    batteryVoltage = FilteredMetric<Int32Metric, int32_t>::create("batteryVoltage", 0, BATTERY_VOLTAGE_REPORT);
+    panelVoltage = FilteredMetric<Int32Metric, int32_t>::create("panelVoltage", 0, PANEL_VOLTAGE_REPORT);
+    current = FilteredMetric<Int16Metric, int16_t>::create("current", 0, CURRENT_REPORT);
+    yieldToday = FilteredMetric<Int16Metric, int16_t>::create("yieldToday", 0, {});
+    yieldYesterday = FilteredMetric<Int16Metric, int16_t>::create("yieldYesterday", 0, {});
+    maxPowerToday = FilteredMetric<Int16Metric, int16_t>::create("maxPowerToday", 0, {});
+    maxPowerYesterday = FilteredMetric<Int16Metric, int16_t>::create("maxPowerYesterday", 0, {});
+    daySequence = FilteredMetric<Int16Metric, int16_t>::create("daySequence", 0, {});
+    operationState = FilteredMetric<UInt8Metric, uint8_t>::create("operationState", 0, {});
+    errorState = FilteredMetric<Int8Metric, int8_t>::create("errorState", 0, {});
+    trackerOperationMode = FilteredMetric<Int8Metric, int8_t>::create("trackerOperationMode", 0, {});
+    loadActive = FilteredMetric<BooleanMetric, bool>::create("loadActive", 0, {});
+
     device.addMetrics({
-        batteryVoltage = Int32Metric::create("batteryVoltage", 0),
-        panelVoltage = Int32Metric::create("panelVoltage", 0),
-        current = Int16Metric::create("current", 0),
-        yieldToday = Int16Metric::create("yieldToday", 0),
-        yieldYesterday = Int16Metric::create("yieldYesterday", 0),
-        maxPowerToday = Int16Metric::create("maxPowerToday", 0),
-        maxPowerYesterday = Int16Metric::create("maxPowerYesterday", 0),
-        daySequence = Int16Metric::create("daySequence", 0),
-        operationState = UInt8Metric::create("operationState", 0),
-        errorState = Int8Metric::create("errorState", 0),
-        trackerOperationMode = Int8Metric::create("trackerOperationMode", 0),
-        loadActive = BooleanMetric::create("loadActive", 0),
+        batteryVoltage->getMetric(),
+        panelVoltage->getMetric(),
+        current->getMetric(),
+        yieldToday->getMetric(),
+        yieldYesterday->getMetric(),
+        maxPowerToday->getMetric(),
+        maxPowerYesterday->getMetric(),
+        daySequence->getMetric(),
+        operationState->getMetric(),
+        errorState->getMetric(),
+        trackerOperationMode->getMetric(),
+        loadActive->getMetric(),
         productId = StringMetric::create("productId", ""),
         firmware = StringMetric::create("firmware", ""),
         serialNumber = StringMetric::create("serialNumber", ""),
+        checksumErrors = Int32Metric::create("checksumErrors", 0),
+        overflows = Int32Metric::create("overflows", 0),
+        framesDropped = Int32Metric::create("framesDropped", 0),
     });
 
-    batteryVoltage->addProperty(StringProperty::create("unit", "V"));
-    panelVoltage->addProperty(StringProperty::create("unit", "V"));
-    current->addProperty(StringProperty::create("unit", "A"));
+    batteryVoltage->getMetric()->addProperty(StringProperty::create("unit", "V"));
+    panelVoltage->getMetric()->addProperty(StringProperty::create("unit", "V"));
+    current->getMetric()->addProperty(StringProperty::create("unit", "A"));
 
-    yieldToday->addProperty(StringProperty::create("unit", "W"));
-    yieldYesterday->addProperty(StringProperty::create("unit", "W"));
-    maxPowerToday->addProperty(StringProperty::create("unit", "W"));
-    maxPowerYesterday->addProperty(StringProperty::create("unit", "W"));
+    yieldToday->getMetric()->addProperty(StringProperty::create("unit", "W"));
+    yieldYesterday->getMetric()->addProperty(StringProperty::create("unit", "W"));
+    maxPowerToday->getMetric()->addProperty(StringProperty::create("unit", "W"));
+    maxPowerYesterday->getMetric()->addProperty(StringProperty::create("unit", "W"));
 
-    device.addMetric(operationState = UInt8Metric::create("operationState", 0));
-
-    operationState->addProperty(
+    operationState->getMetric()->addProperty(
         PropertySet::create("enum",
                             {
                                 UInt8Property::create("OFF", 0),
@@ -101,7 +121,7 @@ void VictronParser::configureSparkplug()
                                 UInt8Property::create("EXTERNAL_CONTROL", 252),
                             }));
 
-    errorState->addProperty(
+    errorState->getMetric()->addProperty(
         PropertySet::create("enum",
                             {
                                 UInt8Property::create("NO_ERROR", 0),
@@ -119,7 +139,7 @@ void VictronParser::configureSparkplug()
                                 UInt8Property::create("USER_SETTING_INVALID", 119),
                             }));
 
-    trackerOperationMode->addProperty(
+    trackerOperationMode->getMetric()->addProperty(
         PropertySet::create("enum",
                             {
                                 UInt8Property::create("OFF", 0),
@@ -127,7 +147,7 @@ void VictronParser::configureSparkplug()
                                 UInt8Property::create("MPP_TRACKER_ACTIVE", 2),
                             }));
 
-    loadActive->addProperties(
+    loadActive->getMetric()->addProperties(
         {
             StringProperty::create("trueText", "Active"),
             StringProperty::create("falseTest", "Deactive"),
@@ -139,227 +159,115 @@ Device *VictronParser::getDevice()
     return &device;
 }
 
-VictronParser::VictronParser(VictronFieldHandler *fieldHandlerClass) : fieldHandlerFunc(NULL), fieldHandlerClass(fieldHandlerClass), fieldCount(0){};
-VictronParser::VictronParser(void (*fieldHandlerFunc)(uint32_t, void *, size_t)) : fieldHandlerFunc(fieldHandlerFunc), fieldHandlerClass(NULL), fieldCount(0){};
+void VictronParser::storeHistory(StoreAndForward *store)
+{
+    const char *name = VICTRON_DEVICE;
+
+    batteryVoltage->storeHistory(store, name);
+    panelVoltage->storeHistory(store, name);
+    current->storeHistory(store, name);
+    yieldToday->storeHistory(store, name);
+    yieldYesterday->storeHistory(store, name);
+    maxPowerToday->storeHistory(store, name);
+    maxPowerYesterday->storeHistory(store, name);
+    daySequence->storeHistory(store, name);
+    operationState->storeHistory(store, name);
+    errorState->storeHistory(store, name);
+    trackerOperationMode->storeHistory(store, name);
+    loadActive->storeHistory(store, name);
+}
 
-VictronParser::~VictronParser()
+void VictronParser::batchCurrent(SampleBatch *batch)
 {
-    dumpFields();
+    currentBatch = batch;
+    currentKey = batch->add(VICTRON_DEVICE, "currentTrace", SPARKPLUG_INT16, CURRENT_TRACE_BATCH);
 }
 
-void VictronParser::dumpFields()
+void VictronParser::trackLatency(PicoSparkplugClient *client, Publishable *parent)
 {
-    for (int i = (fieldCount - 1); i >= 0; i--)
-    {
-        delete fields[i];
-    }
+    latencyClient = client;
+    latencyKey = client->publishLatencyMetrics(parent, VICTRON_DEVICE);
+}
 
-    fieldCount = 0;
+void VictronParser::deliverErrors(PicoSparkplugClient *client)
+{
+    client->deliverAtLeastOnce(VICTRON_DEVICE, "errorState");
 }
 
-void VictronParser::processFields()
+void VictronParser::apply(const VictronFrame *frame)
 {
-    Field *field;
-    for (int i = (fieldCount - 1); i >= 0; i--)
+    bool reported = false;
+
+    for (int i = 0; i < frame->count; i++)
     {
-        field = fields[i];
-        switch (field->getId())
+        const VictronField *field = &frame->fields[i];
+        switch (field->id)
         {
         case VictronId::VOLTAGE:
-            batteryVoltage->setValue(*((int32_t *)field->getData()));
+            reported |= batteryVoltage->setValue(field->value);
             break;
         case VictronId::PANEL_VOLTAGE:
-            panelVoltage->setValue(*((int32_t *)field->getData()));
+            reported |= panelVoltage->setValue(field->value);
             break;
         case VictronId::CURRENT:
-            current->setValue(*((int32_t *)field->getData()));
+            reported |= current->setValue((int16_t)field->value);
+            if (currentBatch)
+            {
+                currentBatch->sample(currentKey, (int16_t)field->value, frame->capturedAt);
+            }
             break;
         case VictronId::YIELD_TODAY:
-            yieldToday->setValue(*((int16_t *)field->getData()));
+            reported |= yieldToday->setValue((int16_t)field->value);
             break;
         case VictronId::MAX_POWER_TODAY:
-            maxPowerToday->setValue(*((int16_t *)field->getData()));
+            reported |= maxPowerToday->setValue((int16_t)field->value);
             break;
         case VictronId::YIELD_YESTERDAY:
-            yieldYesterday->setValue(*((int16_t *)field->getData()));
+            reported |= yieldYesterday->setValue((int16_t)field->value);
             break;
         case VictronId::MAX_POWER_YESTERDAY:
-            maxPowerYesterday->setValue(*((int16_t *)field->getData()));
+            reported |= maxPowerYesterday->setValue((int16_t)field->value);
             break;
         case VictronId::DAY_SEQUENCE:
-            daySequence->setValue(*((int8_t *)field->getData()));
+            reported |= daySequence->setValue((int16_t)field->value);
             break;
         case VictronId::OPERATION_STATE:
-            operationState->setValue(*((uint8_t *)field->getData()));
+            reported |= operationState->setValue((uint8_t)field->value);
             break;
         case VictronId::ERROR_STATE:
-            errorState->setValue(*((uint8_t *)field->getData()));
+            reported |= errorState->setValue((int8_t)field->value);
             break;
         case VictronId::TRACKER_OPERATION_MODE:
-            trackerOperationMode->setValue(*((uint8_t *)field->getData()));
+            reported |= trackerOperationMode->setValue((int8_t)field->value);
             break;
         case VictronId::LOAD:
-            loadActive->setValue(*((bool *)field->getData()));
-            break;
-        case VictronId::CHEC:
+            reported |= loadActive->setValue(field->value != 0);
             break;
         case VictronId::PRODUCT_ID: // All Strings, Might implement in Modbus later
-            productId->setValue((char *)field->getData());
+            productId->setValue((char *)field->text);
             break;
         case VictronId::FIRMWARE:
-            firmware->setValue((char *)field->getData());
+            firmware->setValue((char *)field->text);
+            break;
         case VictronId::SERIAL_NUMBER:
-            serialNumber->setValue((char *)field->getData());
-        case VictronId::OFF_REASON:
-
+            serialNumber->setValue((char *)field->text);
+            break;
         default:
             break;
         }
-
-        delete field;
     }
 
-    fieldCount = 0;
-}
+    checksumErrors->setValue((int32_t)frame->checksumErrors);
+    overflows->setValue((int32_t)frame->overflows);
+    framesDropped->setValue((int32_t)frame->dropped);
 
-void VictronParser::parse(const char *buffer, int size)
-{
-    int index = 0;
-    do
+    if (reported && latencyClient)
     {
-        char input = buffer[index++];
-        switch (state)
-        {
-        case VictronState::LABEL:
-            // cout << "LABEL\n";
-            if (input == SPLIT_CHARACTER)
-            {
-                state = VictronState::FIELD;
-                fieldIndex = 0;
-                memset(fieldData, 0, MAX_FIELD_LENGTH);
-            }
-            else if (input == ASYNC_CHARACTER)
-            {
-                // Data we don't care about, ignore it
-                state = VictronState::ASYNC;
-            }
-            else if (labelIndex >= MAX_LABEL_LENGTH)
-            {
-                // Something went wrong and the label length is too long
-                // Return to idle
-                state = VictronState::IDLE;
-            }
-            else
-            {
-                labelData.buffer[labelIndex++] = input;
-            }
-            break;
-        case VictronState::FIELD:
-            if (input == END_CHARACTER)
-            {
-                state = VictronState::IDLE;
-                // Process everything
-                processEntry();
-            }
-            else if (fieldIndex >= MAX_FIELD_LENGTH)
-            {
-                // Something went wrong and the label length is too long
-                // Return to idle
-                state = VictronState::IDLE;
-            }
-            else
-            {
-                fieldData[fieldIndex++] = input;
-            }
-            break;
-        case VictronState::IDLE:
-        case VictronState::ASYNC:
-            if (input == START_CHARACTER)
-            {
-                state = VictronState::LABEL;
-                memset(labelData.buffer, 0, MAX_LABEL_LENGTH);
-                labelIndex = 0;
-            }
-            break;
-        default:
-            break;
-        }
-        if (state != VictronState::ASYNC)
-        {
-            checksum += input;
-        }
-    } while (index < size);
+        latencyClient->captured(latencyKey, frame->capturedAt);
+    }
 }
 
-void VictronParser::processEntry()
+void VictronParser::parse(const char *buffer, int size)
 {
-    // Victron specifies a max number of fields.
-    // If we go over this count we might be overloading a queue.
-    // We should dump our queue as we've got ourselves into a bad state.
-    if (fieldCount >= MAX_FIELDS_COUNT)
-    {
-        dumpFields();
-    }
-
-    switch (labelData.lower)
-    {
-    case VictronId::VOLTAGE:
-    case VictronId::PANEL_VOLTAGE:
-        fields[fieldCount] = new Field(labelData.lower, atol(fieldData));
-        fieldCount++;
-        break;
-    case VictronId::CURRENT:
-    case VictronId::PANEL_POWER:
-    case VictronId::LOAD_CURRENT:
-    case VictronId::YIELD_TOTAL:
-    case VictronId::YIELD_TODAY:
-    case VictronId::MAX_POWER_TODAY:
-    case VictronId::YIELD_YESTERDAY:
-    case VictronId::MAX_POWER_YESTERDAY:
-    case VictronId::DAY_SEQUENCE:
-        fields[fieldCount] = new Field(labelData.lower, atoi(fieldData));
-        fieldCount++;
-        break;
-    case VictronId::OPERATION_STATE:
-    case VictronId::ERROR_STATE:
-    case VictronId::TRACKER_OPERATION_MODE:
-        fields[fieldCount] = new Field(labelData.lower, (int8_t)atoi(fieldData));
-        fieldCount++;
-        break;
-    case VictronId::PRODUCT_ID:
-    case VictronId::FIRMWARE:
-    case VictronId::SERIAL_NUMBER:
-        fields[fieldCount] = new Field(labelData.lower, fieldData, fieldIndex + 1);
-        fieldCount++;
-        break;
-    case VictronId::LOAD: // ON/OFF value
-        fields[fieldCount] = new Field(labelData.lower, (bool)(strcmp(fieldData, "ON") == 0));
-        fieldCount++;
-        break;
-    case VictronId::CHEC:
-        if (labelData.upper == VictronId::KSUM)
-        {
-            fields[fieldCount] = new Field(labelData.lower, checksum);
-            fieldCount++;
-            // if (checksum == 0)
-            // {
-            //     processFields();
-            // }
-            // else
-            // {
-            //     dumpFields();
-            // }
-            processFields();
-            checksum = 0;
-        }
-        break;
-    case VictronId::OFF_REASON:
-    default:
-        break;
-    }
-
-    if (fieldCount > 0)
-    {
-        // processFields();
-    }
+    frameParser.parse(buffer, size);
 }
@@ -46,110 +46,97 @@
 #include "metrics/simple/UInt8Metric.h"
 #include "metrics/simple/StringMetric.h"
 #include "metrics/simple/BooleanMetric.h"
+#include "FilteredMetric.h"
+#include "SampleBatch.h"
+#include "VictronFrameParser.h"
 
-// Max length of a Victron Field Label
-#define MAX_LABEL_LENGTH 8
-// Max length of a Victron Field Value
-#define MAX_FIELD_LENGTH 32
-// Maximum number of fields that in a single block with a checksum
-#define MAX_FIELDS_COUNT 22
-
-// State of the Victron serial
-enum class VictronState
-{
-    IDLE,
-    LABEL,
-    FIELD,
-    ASYNC,
-    CHECKSUM
-};
-
-// Used to convert Field labels to binary values for fast comparisons
-typedef union
-{
-    unsigned char buffer[MAX_LABEL_LENGTH];
-    struct
-    {
-        uint32_t lower;
-        uint32_t upper;
-    };
-} LabelToBuffer_u;
-
-class VictronFieldHandler
-{
-private:
-protected:
-public:
-    virtual void fieldUpdate(VictronId id, void *data, size_t size) = 0;
-};
+class PicoSparkplugClient;
 
+/**
+ * @brief Publishes the VE.Direct frames of a Victron charge controller as a device.
+ * Frames can be parsed here from the serial, or on another core with a VictronFrameParser and applied.
+ */
 class VictronParser
 {
 private:
-    VictronState state;
-    bool initialized;
-    int8_t checksum;
-    LabelToBuffer_u labelData;
-    int labelIndex;
-    char fieldData[MAX_FIELD_LENGTH];
-    int fieldIndex;
-    Field *fields[MAX_FIELDS_COUNT];
-    void (*fieldHandlerFunc)(uint32_t, void *, size_t);
-    VictronFieldHandler *fieldHandlerClass;
-    int fieldCount;
+    VictronFrameParser frameParser;
 
     Device device;
-    std::shared_ptr<Int32Metric> batteryVoltage;
-    std::shared_ptr<Int32Metric> panelVoltage;
-    std::shared_ptr<Int16Metric> current;
-    std::shared_ptr<Int16Metric> yieldToday;
-    std::shared_ptr<Int16Metric> yieldYesterday;
-    std::shared_ptr<Int16Metric> maxPowerToday;
-    std::shared_ptr<Int16Metric> maxPowerYesterday;
-    std::shared_ptr<Int16Metric> daySequence;
-    std::shared_ptr<UInt8Metric> operationState;
-    std::shared_ptr<Int8Metric> errorState;
-    std::shared_ptr<Int8Metric> trackerOperationMode;
-    std::shared_ptr<BooleanMetric> loadActive;
+    std::shared_ptr<FilteredMetric<Int32Metric, int32_t>> batteryVoltage;
+    std::shared_ptr<FilteredMetric<Int32Metric, int32_t>> panelVoltage;
+    std::shared_ptr<FilteredMetric<Int16Metric, int16_t>> current;
+    std::shared_ptr<FilteredMetric<Int16Metric, int16_t>> yieldToday;
+    std::shared_ptr<FilteredMetric<Int16Metric, int16_t>> yieldYesterday;
+    std::shared_ptr<FilteredMetric<Int16Metric, int16_t>> maxPowerToday;
+    std::shared_ptr<FilteredMetric<Int16Metric, int16_t>> maxPowerYesterday;
+    std::shared_ptr<FilteredMetric<Int16Metric, int16_t>> daySequence;
+    std::shared_ptr<FilteredMetric<UInt8Metric, uint8_t>> operationState;
+    std::shared_ptr<FilteredMetric<Int8Metric, int8_t>> errorState;
+    std::shared_ptr<FilteredMetric<Int8Metric, int8_t>> trackerOperationMode;
+    std::shared_ptr<FilteredMetric<BooleanMetric, bool>> loadActive;
     std::shared_ptr<StringMetric> productId;
     std::shared_ptr<StringMetric> firmware;
     std::shared_ptr<StringMetric> serialNumber;
+    std::shared_ptr<Int32Metric> checksumErrors;
+    std::shared_ptr<Int32Metric> overflows;
+    std::shared_ptr<Int32Metric> framesDropped;
+
+    PicoSparkplugClient *latencyClient = NULL;
+    size_t latencyKey = 0;
+    SampleBatch *currentBatch = NULL;
+    uint32_t currentKey = 0;
 
     void configureSparkplug();
 
+protected:
+public:
+    VictronParser();
+
     /**
-     * @brief Process an single field line containing a Label/Data combo
+     * @brief Process a buffer read from the victron serial
      *
+     * @param buffer buffer read from the serial
+     * @param size The number of bytes read
      */
-    void processEntry();
+    void parse(const char *buffer, int size);
 
     /**
-     * @brief Processes all fields in the queue
+     * @brief Publishes a frame parsed elsewhere, such as on core 1
      *
+     * @param frame
      */
-    void processFields();
+    void apply(const VictronFrame *frame);
+
+    Device *getDevice();
 
     /**
-     * @brief Frees all memory held by the fields queue
+     * @brief Stores the measurements taken while the node is offline
      *
+     * @param store
      */
-    void dumpFields();
+    void storeHistory(StoreAndForward *store);
 
-protected:
-public:
-    VictronParser();
-    VictronParser(VictronFieldHandler *dataHandler);
-    VictronParser(void (*function)(uint32_t, void *, size_t));
-    ~VictronParser();
+    /**
+     * @brief Publishes every current reading, rather than only those past the deadband, as a DataSet
+     *
+     * @param batch
+     */
+    void batchCurrent(SampleBatch *batch);
 
     /**
-     * @brief Process a buffer read from the victron serial
+     * @brief Publishes the latency from a block's checksum line arriving to the DDATA that reports it
      *
-     * @param buffer buffer read from the serial
-     * @param size The number of bytes read
+     * @param client
+     * @param parent The Node or Device to add the latency metrics to
      */
-    void parse(const char *buffer, int size);
-    Device *getDevice();
+    void trackLatency(PicoSparkplugClient *client, Publishable *parent);
+
+    /**
+     * @brief Publishes changes to the charger's error state at QoS 1, so a fault isn't missed
+     *
+     * @param client
+     */
+    void deliverErrors(PicoSparkplugClient *client);
 };
 
 #endif /* VICTRONPARSER */
@@ -1,19 +1,20 @@
 
+#include <string.h>
 #include "pico/stdlib.h"
 #include <stdio.h>
 
 #include <PicoSparkplugClient.h>
+#include <FlashLog.h>
+#include <NodeRuntime.h>
+#include <SpscRing.h>
 
-#include "pico/cyw43_arch.h"
 #include "pico/multicore.h"
-#include "pico/util/queue.h"
 #include "hardware/gpio.h"
 #include "hardware/pwm.h"
-
-#include "lwip/pbuf.h"
-#include "lwip/tcp.h"
+#include "hardware/irq.h"
 
 #include "VictronParser.h"
+#include "VictronFrameParser.h"
 #include "Shed.h"
 
 #include <Node.h>
@@ -32,12 +33,46 @@
 #define UART_TX_PIN 0
 #define UART_RX_PIN 1
 
-#define ADDRESS BROKER_ADDRESS
 #define GROUP_ID "Garden"
 #define NODE_ID "Shed"
 #define HOST_ID "Home"
+#define DIAGNOSTICS_INTERVAL_S 60
+#define NODE_PERIOD_MS 1000
+
+// A Victron frame and the shed sensors are published together rather than as they are parsed
+#define PUBLISH_WINDOW_MS 100
+// The births with the Victron's property sets, and replayed history, are the only publishes this large
+#define COMPRESSION_THRESHOLD 512
+
+// Core 1 owns the UART and parses the VE.Direct frames, so a slow pass of the node can't overflow the FIFO
+#define VICTRON_ON_CORE1 1
+// Frames waiting for core 0, the Victron sends one a second
+#define VICTRON_FRAME_QUEUE 8
+
+#if VICTRON_ON_CORE1
+static SpscRing<VictronFrame, VICTRON_FRAME_QUEUE> victronFrames;
+static Diagnostics *diagnostics;
+#endif
+
+// Wakes whichever core reads the UART when the Victron starts sending.
+// The interrupt stays off until the FIFO has been read.
+void onUartReceive()
+{
+    uart_set_irq_enables(UART_ID, false, false);
+#if VICTRON_ON_CORE1
+    __sev();
+#else
+    NodeScheduler::wake();
+#endif
+}
 
-#define MAX_RETRIES 5000
+// The interrupt is taken by the core that enables it
+void enableUartInterrupt()
+{
+    irq_set_exclusive_handler(UART0_IRQ, onUartReceive);
+    irq_set_enabled(UART0_IRQ, true);
+    uart_set_irq_enables(UART_ID, true, false);
+}
 
 void setupUart()
 {
@@ -61,99 +96,64 @@ void setupUart()
     uart_set_fifo_enabled(UART_ID, true);
 }
 
-void wifi_connect()
+#if VICTRON_ON_CORE1
+// Queues each frame with a valid checksum for core 0, and wakes it to publish
+void queueVictronFrame(const VictronFrame *frame, __attribute__((unused)) void *context)
 {
-    printf("Connecting to WiFi...\n");
-    if (cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK, 30000))
-    {
-        printf("failed to connect.\n");
-        return;
-    }
-    else
-    {
-        printf("WIFI Connected.\n");
-    }
+    static VictronFrame queued;
+
+    queued = *frame;
+    queued.dropped = victronFrames.getDropped();
+    victronFrames.push(queued);
+    NodeScheduler::wake();
 }
 
-void sparkplugExecute()
+void victron_main()
 {
-    char clientId[40];
-
-    Uri uri(ADDRESS);
-    sprintf(clientId, "garden_shed_%ld", get_rand_32());
-
-    NodeOptions nodeOptions = {
-        GROUP_ID,
-        NODE_ID,
-        HOST_ID,
-        1000,
-        NODE_CONTROL_REBIRTH};
-
-    ClientOptions clientOptions = {
-        .address = uri,
-        .clientId = clientId,
-        .username = NULL,
-        .password = NULL,
-        .connectTimeout = 5000,
-        .keepAliveInterval = 5};
-
-    Node node = Node(&nodeOptions);
-
-    VictronParser victronParser;
-
-    Shed shed((Publishable *)&node);
+    static VictronFrameParser frameParser(queueVictronFrame, NULL);
 
-    node.addDevice(victronParser.getDevice());
-    auto client = node.addClient<PicoSparkplugClient>(&clientOptions);
-    client->useNtpServer(NTP_ADDRESS, 123);
-
-    node.enable();
+    // Core 0 pauses this core while it writes the flash log
+    multicore_lockout_victim_init();
+    enableUartInterrupt();
 
     while (true)
     {
-        wifi_connect();
-        while (cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA) == CYW43_LINK_JOIN)
+        uint64_t start = time_service_monotonic_us();
+        while (uart_is_readable(UART_ID))
         {
-            printf("Wifi is connected\n");
-            uint32_t retries = 0;
+            char character = uart_getc(UART_ID);
+            frameParser.parse(&character, 1);
+        }
+        diagnostics->addCore1Busy((uint32_t)(time_service_monotonic_us() - start));
 
-            while (!node.isActive() && retries++ < MAX_RETRIES)
-            {
-#if PICO_CYW43_ARCH_POLL
-                cyw43_arch_poll();
-#endif
-                sleep_ms(1);
-            }
-
-            if (retries >= MAX_RETRIES)
-            {
-                continue;
-            }
-
-            printf("Node is Active, starting Sparkplug execution\n");
-            uint32_t executeTime = 5;
-            while (node.isActive())
-            {
-                while (uart_is_readable(UART_ID))
-                {
-                    char character = uart_getc(UART_ID);
-                    victronParser.parse(&character, 1);
-                }
-
-                shed.sync();
-
-                node.execute(executeTime);
-                sleep_ms(executeTime);
-
-#if PICO_CYW43_ARCH_POLL
-                cyw43_arch_poll();
+        // A byte that arrived after the FIFO was emptied raises the interrupt again, and its event
+        // is latched, so the wait can't miss it
+        uart_set_irq_enables(UART_ID, true, false);
+        __wfe();
+    }
+}
 #endif
-            }
-            printf("Node is no longer Active, checking wifi status\n");
-        }
-        printf("WIFI not connected, waiting 5 seconds\n");
-        sleep_ms(5000);
+
+// Reads the sensors, which carries on while offline so the samples can be stored
+void sample(VictronParser *victronParser, Shed *shed)
+{
+#if VICTRON_ON_CORE1
+    VictronFrame *frame;
+    while ((frame = victronFrames.front()) != NULL)
+    {
+        victronParser->apply(frame);
+        victronFrames.pop();
     }
+#else
+    while (uart_is_readable(UART_ID))
+    {
+        char character = uart_getc(UART_ID);
+        victronParser->parse(&character, 1);
+    }
+    uart_set_irq_enables(UART_ID, true, false);
+#endif
+
+    shed->sync();
 }
 
 int main()
@@ -162,16 +162,62 @@ int main()
 
     setupUart();
 
-    if (cyw43_arch_init())
-    {
-        printf("failed to initialise\n");
-        return 1;
-    }
-    cyw43_arch_enable_sta_mode();
-
-    sparkplugExecute();
-
-    cyw43_arch_deinit();
+    NodeRuntimeOptions options = {
+        .ssid = WIFI_SSID,
+        .password = WIFI_PASSWORD,
+        .brokerAddress = BROKER_ADDRESS,
+        .ntpAddress = NTP_ADDRESS,
+        .ntpBroadcast = NTP_BROADCAST,
+        .groupId = GROUP_ID,
+        .nodeId = NODE_ID,
+        .hostId = HOST_ID,
+        .clientIdPrefix = "garden_shed",
+        .period = NODE_PERIOD_MS,
+        .fastJoin = true,
+        .staticIp = STATIC_IP,
+        .netmask = STATIC_NETMASK,
+        .gateway = STATIC_GATEWAY,
+        .dnsServer = STATIC_DNS,
+        .diagnostics = true,
+        .diagnosticsInterval = DIAGNOSTICS_INTERVAL_S};
+
+    static NodeRuntime runtime(&options);
+    static VictronParser victronParser;
+    static Shed shed((Publishable *)runtime.getNode());
+
+    runtime.getNode()->addDevice(victronParser.getDevice());
+
+    PicoSparkplugClient *client = runtime.getClient();
+    client->setPublishWindow(PUBLISH_WINDOW_MS);
+    client->setCompression(COMPRESSION_THRESHOLD);
+    victronParser.deliverErrors(client);
+    victronParser.batchCurrent(client->enableSampleBatch());
+
+    // Samples taken while the broker is unreachable are kept in flash, as the battery can brown out before it's back
+    static FlashLog flashLog(FLASH_LOG_OFFSET, FLASH_LOG_SIZE);
+    flashLog.begin();
+    StoreAndForward *history = client->enableStoreAndForward(&flashLog);
+    victronParser.storeHistory(history);
+    shed.storeHistory(history);
+
+    // Percentiles of the time from a sample to its publish leaving, as metrics of the node
+    victronParser.trackLatency(client, (Publishable *)runtime.getNode());
+    shed.trackLatency(client, (Publishable *)runtime.getNode());
+
+    // The UART, the door and the network wake the loop between the door's deadlines
+    runtime.addTask([](__attribute__((unused)) void *context)
+                    { sample(&victronParser, &shed); },
+                    NULL);
+    runtime.addDeadline([](void *context)
+                        { return ((Shed *)context)->nextDeadline(); },
+                        &shed);
+
+#if VICTRON_ON_CORE1
+    diagnostics = runtime.getDiagnostics();
+    multicore_launch_core1(victron_main);
+#else
+    enableUartInterrupt();
+#endif
 
-    return 0;
-}
\ No newline at end of file
+    return runtime.run();
+}